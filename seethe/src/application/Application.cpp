@@ -1,6 +1,12 @@
 #include "Application.h"
+#include "utils/AllocationTracker.h"
+#include "utils/FrameStats.h"
 #include "utils/Log.h"
+#include "utils/Metrics.h"
+#include "utils/PerfCounters.h"
+#include "utils/SamplingProfiler.h"
 #include "utils/String.h"
+#include "utils/TuningParameters.h"
 #include "application/ui/fonts/Fonts.h"
 #include "application/change-requests/AddAtomsCR.h"
 #include "application/change-requests/AtomMaterialCR.h"
@@ -20,6 +26,15 @@ using namespace DirectX;
 
 namespace seethe
 {
+// Label for the selectable in the first column of a table row. Formatted into a stack buffer, because std::format would
+// build a std::string for every visible row on every frame
+static std::array<char, 24> RowLabel(size_t row) noexcept
+{
+	std::array<char, 24> label = {};
+	std::format_to_n(label.data(), label.size() - 1, " {}", row);
+	return label;
+}
+
 Application::Application() :
 	m_timer()
 {
@@ -139,6 +154,20 @@ void Application::Initialize()
 	static const ImWchar icon_ranges[] = { 0xE700, 0xF8B3, 0 };
 	font = io.Fonts->AddFontFromFileTTF("c:\\Windows\\Fonts\\segmdl2.ttf", 18.0f, &icons_config, icon_ranges);
 	ASSERT(font != nullptr, "Could not find font");
+
+	m_simulation.RegisterSimulationStartedHandler([this]()
+		{
+			if (m_simulationSettings.autoTune)
+				m_autoTuner.OnSimulationStarted(m_simulation);
+		}
+	);
+
+	// The allocation check (--check-allocations) measures the steady state of a running simulation
+	if (AllocationTracker::Get().IsCheckingSteadyState())
+	{
+		m_simulationSettings.playState = SimulationSettings::PlayState::PLAYING;
+		m_simulation.StartPlaying();
+	}
 }
 
 void Application::InitializeMaterials() noexcept
@@ -279,10 +308,23 @@ int Application::Run()
 {
 	while (true)
 	{
+		// Every scope from the previous iteration has closed by now, so this is the frame boundary for the profiler
+		PROFILE_END_FRAME();
+		ALLOCATION_END_FRAME();
+		FrameStats::Get().EndFrame();
+		PROFILE_SCOPE("Application::Run");
+
+		if (const std::optional<int> result = AllocationTracker::Get().GetCheckResult())
+		{
+			FrameStats::Get().LogReport();
+			return *result;
+		}
+
 		// process all messages pending, but to not block for new messages
 		if (const auto ecode = m_mainWindow->ProcessMessages())
 		{
 			// if return optional has value, means we're quitting so return exit code
+			FrameStats::Get().LogReport();
 			return *ecode;
 		}
 
@@ -323,6 +365,9 @@ int Application::Run()
 }
 void Application::Update()
 {
+	PROFILE_SCOPE("Application::Update");
+	ALLOCATION_TAG("Update");
+
 	// Cycle through the circular frame resource array.
 	m_currentFrameIndex = (m_currentFrameIndex + 1) % g_numFrameResources;
 
@@ -330,6 +375,8 @@ void Application::Update()
 	// If not, wait until the GPU has completed commands up to this fence point.
 	UINT64 currentFence = m_fences[m_currentFrameIndex]; 
 	{
+		PROFILE_SCOPE("Wait for frame resources");
+
 		if (currentFence != 0 && m_deviceResources->GetFence()->GetCompletedValue() < currentFence) 
 		{
 			HANDLE eventHandle = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS); 
@@ -381,10 +428,24 @@ void Application::Update()
 
 
 	m_simulation.Update(m_timer);
+
+	// All mutations for this frame (UI, mouse/keyboard input, undo/redo) have happened at this point, so
+	// this is where the simulation's coalesced events get dispatched
+	m_simulation.DispatchEvents();
+
 	m_mainSimulationWindow->Update(m_timer, m_currentFrameIndex);
+
+	// The top of the undo stack is not part of m_undoBytes (see Application.h), so it is the only one asked each frame
+	Metrics& metrics = Metrics::Get();
+	metrics.SetAtomCount(std::as_const(m_simulation).GetAtoms().size());
+	if (metrics.IsServed())
+		metrics.SetUndoBytes(m_undoBytes + (m_undoStack.empty() ? 0 : m_undoStack.top()->GetMemoryUsage()), m_redoBytes);
 }
 void Application::RenderUI()
 {
+	PROFILE_SCOPE("Application::RenderUI");
+	ALLOCATION_TAG("UI");
+
 	ImGuiIO& io = ImGui::GetIO();
 
 	static unsigned int fps = 0;
@@ -495,7 +556,10 @@ void Application::RenderUI()
 			{
 				m_redoStack.push(m_undoStack.top());
 				m_undoStack.top()->Undo(this);
+				m_redoBytes += m_undoStack.top()->GetMemoryUsage();
 				m_undoStack.pop();
+				if (!m_undoStack.empty())
+					m_undoBytes -= m_undoStack.top()->GetMemoryUsage();
 			}
 			ImGui::SetItemTooltip("Undo");
 			ImGui::SameLine();
@@ -507,6 +571,9 @@ void Application::RenderUI()
 			}
 			else if (ImGui::Button(ICON_REDO)) 
 			{
+				if (!m_undoStack.empty())
+					m_undoBytes += m_undoStack.top()->GetMemoryUsage();
+				m_redoBytes -= m_redoStack.top()->GetMemoryUsage();
 				m_undoStack.push(m_redoStack.top()); 
 				m_redoStack.top()->Redo(this);
 				m_redoStack.pop();
@@ -806,7 +873,7 @@ void Application::RenderUI()
 		{
 			ImGui::Begin("Atoms");
 
-			std::vector<Atom>& atoms = m_simulation.GetAtoms();
+			const AtomStore& atoms = std::as_const(m_simulation).GetAtoms();
 			XMFLOAT3 boxDims = m_simulation.GetDimensionMaxs();
 			const std::vector<size_t>& selectedAtomIndices = m_simulation.GetSelectedAtomIndices();
 
@@ -854,14 +921,15 @@ void Application::RenderUI()
 				{
 					for (size_t row_n = clipper.DisplayStart; row_n < clipper.DisplayEnd; row_n++) 
 					{
-						Atom& atom = atoms[row_n];
+						// Use const access here - non-const access would force the atom's chunk to be copied if it is shared with a snapshot
+						const Atom& atom = std::as_const(atoms)[row_n];
 
 						ImGui::TableNextRow(ImGuiTableRowFlags_None);
 
 						ImGui::TableSetColumnIndex(0);
 						ImGui::AlignTextToFramePadding();
 						bool itemIsSelected = m_simulation.AtomIsSelected(row_n);
-						if (ImGui::Selectable(std::format(" {}", row_n).c_str(), itemIsSelected, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap))
+						if (ImGui::Selectable(RowLabel(row_n).data(), itemIsSelected, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap))
 						{
 							if (ImGui::GetIO().KeyCtrl) 
 							{
@@ -905,36 +973,41 @@ void Application::RenderUI()
 				static bool velocityYSliderIsActive = false;
 				static bool velocityZSliderIsActive = false;
 
-				Atom& atom = atoms[selectedAtomIndices[0]];
+				// Edit a copy of the atom and only write it back through the simulation when a value changes. Non-const
+				// access to the store would mark every atom as changed on every frame this panel is shown
+				const size_t atomIndex = selectedAtomIndices[0];
+				const Atom atom = atoms[atomIndex];
 
-				XMFLOAT3 initialPosition = atom.position;
-				XMFLOAT3 initialVelocity = atom.velocity;
+				const XMFLOAT3 initialPosition = atom.position;
+				const XMFLOAT3 initialVelocity = atom.velocity;
+				XMFLOAT3 position = initialPosition;
+				XMFLOAT3 velocity = initialVelocity;
 
-				static auto CheckVelocitySlider = [this](const Atom& atom, const XMFLOAT3& initialVelocity, bool& sliderActive)
+				static auto CheckVelocitySlider = [this](size_t atomIndex, const XMFLOAT3& initialVelocity, const XMFLOAT3& velocity, bool& sliderActive)
 					{
 						if (ImGui::IsItemActive())
 						{
 							if (!sliderActive)
 							{
 								sliderActive = true;
-								AddUndoCR<AtomVelocityCR>(initialVelocity, atom.velocity, m_simulation.IndexOf(atom));
+								AddUndoCR<AtomVelocityCR>(initialVelocity, velocity, atomIndex);
 							}
 						}
 						else if (sliderActive) 
 						{
 							sliderActive = false;
 							AtomVelocityCR* cr = static_cast<AtomVelocityCR*>(m_undoStack.top().get());
-							cr->m_velocityFinal = atom.velocity;
+							cr->m_velocityFinal = velocity;
 						}
 					};
-				static auto CheckPositionSlider = [this](const Atom& atom, const XMFLOAT3& initialPosition, bool& sliderActive, MovementDirection direction)
+				static auto CheckPositionSlider = [this](size_t atomIndex, const XMFLOAT3& initialPosition, const XMFLOAT3& position, bool& sliderActive, MovementDirection direction)
 					{
 						if (ImGui::IsItemActive()) 
 						{
 							if (!sliderActive) 
 							{
 								sliderActive = true; 
-								AddUndoCR<AtomsMovedCR>(m_simulation.IndexOf(atom), initialPosition, atom.position);
+								AddUndoCR<AtomsMovedCR>(atomIndex, initialPosition, position);
 								m_mainSimulationWindow->StartSelectionMovement(direction);
 							}
 
@@ -945,7 +1018,7 @@ void Application::RenderUI()
 						{
 							sliderActive = false; 
 							AtomsMovedCR* cr = static_cast<AtomsMovedCR*>(m_undoStack.top().get());
-							cr->m_positionFinal = atom.position;  
+							cr->m_positionFinal = position;  
 
 							if (!(m_simulationSettings.mouseState == SimulationSettings::MouseState::MOVING_ATOMS))
 								m_mainSimulationWindow->EndSelectionMovement();
@@ -955,31 +1028,34 @@ void Application::RenderUI()
 				ImGui::Spacing();
 				ImGui::Text("Atom:");
 				ImGui::SameLine();
-				ImGui::Text("%d - %s", m_simulation.IndexOf(atom), AtomNames[static_cast<size_t>(atom.type) - 1]);
+				ImGui::Text("%zu - %s", atomIndex, AtomNames[static_cast<size_t>(atom.type) - 1]);
 
 				ImGui::Spacing();
 				ImGui::Indent();
 				ImGui::AlignTextToFramePadding();
 				ImGui::Text("Position  X");
 				ImGui::SameLine(100.0f);
-				ImGui::DragFloat("##atomPositionX", &atom.position.x, 0.2f, -boxDims.x + atom.radius, boxDims.x - atom.radius);
-				CheckPositionSlider(atom, initialPosition, positionXSliderIsActive, MovementDirection::X);
+				if (ImGui::DragFloat("##atomPositionX", &position.x, 0.2f, -boxDims.x + atom.radius, boxDims.x - atom.radius))
+					m_simulation.SetAtomPosition(atomIndex, position);
+				CheckPositionSlider(atomIndex, initialPosition, position, positionXSliderIsActive, MovementDirection::X);
 				ImGui::Unindent();
 
 				ImGui::Indent(77.0f);
 				ImGui::AlignTextToFramePadding();
 				ImGui::Text("Y");
 				ImGui::SameLine(100.0f);
-				ImGui::DragFloat("##atomPositionY", &atom.position.y, 0.2f, -boxDims.y + atom.radius, boxDims.y - atom.radius);
-				CheckPositionSlider(atom, initialPosition, positionYSliderIsActive, MovementDirection::Y);
+				if (ImGui::DragFloat("##atomPositionY", &position.y, 0.2f, -boxDims.y + atom.radius, boxDims.y - atom.radius))
+					m_simulation.SetAtomPosition(atomIndex, position);
+				CheckPositionSlider(atomIndex, initialPosition, position, positionYSliderIsActive, MovementDirection::Y);
 				ImGui::Unindent(77.0f);
 
 				ImGui::Indent(76.0f);
 				ImGui::AlignTextToFramePadding();
 				ImGui::Text("Z");
 				ImGui::SameLine();
-				ImGui::DragFloat("##atomPositionZ", &atom.position.z, 0.2f, -boxDims.z + atom.radius, boxDims.z - atom.radius);
-				CheckPositionSlider(atom, initialPosition, positionZSliderIsActive, MovementDirection::Z);
+				if (ImGui::DragFloat("##atomPositionZ", &position.z, 0.2f, -boxDims.z + atom.radius, boxDims.z - atom.radius))
+					m_simulation.SetAtomPosition(atomIndex, position);
+				CheckPositionSlider(atomIndex, initialPosition, position, positionZSliderIsActive, MovementDirection::Z);
 				ImGui::Unindent(76.0f);
 
 				ImGui::Spacing();
@@ -988,22 +1064,25 @@ void Application::RenderUI()
 				ImGui::AlignTextToFramePadding();
 				ImGui::Text("Velocity  X");
 				ImGui::SameLine(100.0f);
-				ImGui::DragFloat("##atomVelocityX", &atom.velocity.x, 0.5f, -10.0, 10.0);
-				CheckVelocitySlider(atom, initialVelocity, velocityXSliderIsActive);
+				if (ImGui::DragFloat("##atomVelocityX", &velocity.x, 0.5f, -10.0, 10.0))
+					m_simulation.SetAtomVelocity(atomIndex, velocity);
+				CheckVelocitySlider(atomIndex, initialVelocity, velocity, velocityXSliderIsActive);
 				ImGui::Unindent();
 
 				ImGui::Indent(77.0f);
 				ImGui::AlignTextToFramePadding();
 				ImGui::Text("Y");
 				ImGui::SameLine(100.0f);
-				ImGui::DragFloat("##atomVelocityY", &atom.velocity.y, 0.5f, -10.0, 10.0);
-				CheckVelocitySlider(atom, initialVelocity, velocityYSliderIsActive);
+				if (ImGui::DragFloat("##atomVelocityY", &velocity.y, 0.5f, -10.0, 10.0))
+					m_simulation.SetAtomVelocity(atomIndex, velocity);
+				CheckVelocitySlider(atomIndex, initialVelocity, velocity, velocityYSliderIsActive);
 
 				ImGui::AlignTextToFramePadding();
 				ImGui::Text("Z");
 				ImGui::SameLine(100.0f);
-				ImGui::DragFloat("##atomVelocityZ", &atom.velocity.z, 0.5f, -10.0, 10.0);
-				CheckVelocitySlider(atom, initialVelocity, velocityZSliderIsActive);
+				if (ImGui::DragFloat("##atomVelocityZ", &velocity.z, 0.5f, -10.0, 10.0))
+					m_simulation.SetAtomVelocity(atomIndex, velocity);
+				CheckVelocitySlider(atomIndex, initialVelocity, velocity, velocityZSliderIsActive);
 				ImGui::Unindent(77.0f);
 
 				
@@ -1254,7 +1333,7 @@ void Application::RenderUI()
 							ImGui::TableSetColumnIndex(0);
 							ImGui::AlignTextToFramePadding();
 							bool itemIsSelected = row_n == selectedLightIndex;
-							if (ImGui::Selectable(std::format(" {}", row_n).c_str(), itemIsSelected, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap))
+							if (ImGui::Selectable(RowLabel(row_n).data(), itemIsSelected, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap))
 								selectedLightIndex = row_n;
 
 							// Strength
@@ -1315,7 +1394,7 @@ void Application::RenderUI()
 							ImGui::TableSetColumnIndex(0);
 							ImGui::AlignTextToFramePadding();
 							bool itemIsSelected = (row_n + m_mainLighting->NumDirectionalLights()) == selectedLightIndex;
-							if (ImGui::Selectable(std::format(" {}", row_n).c_str(), itemIsSelected, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap))
+							if (ImGui::Selectable(RowLabel(row_n).data(), itemIsSelected, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap))
 								selectedLightIndex = row_n + m_mainLighting->NumDirectionalLights();
 
 							// Strength
@@ -1384,7 +1463,7 @@ void Application::RenderUI()
 							ImGui::TableSetColumnIndex(0);
 							ImGui::AlignTextToFramePadding();
 							bool itemIsSelected = (row_n + m_mainLighting->NumDirectionalLights() + m_mainLighting->NumPointLights()) == selectedLightIndex;
-							if (ImGui::Selectable(std::format(" {}", row_n).c_str(), itemIsSelected, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap))
+							if (ImGui::Selectable(RowLabel(row_n).data(), itemIsSelected, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap))
 								selectedLightIndex = row_n + m_mainLighting->NumDirectionalLights() + m_mainLighting->NumPointLights(); 
 
 							// Strength
@@ -1454,6 +1533,16 @@ void Application::RenderUI()
 				ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "N/A");
 			ImGui::Spacing();
 
+			// Auto-tuning
+			ImGui::SeparatorText("Performance Tuning");
+			ImGui::Checkbox("Auto-Tune When Playing Starts", &m_simulationSettings.autoTune);
+			if (ImGui::IsItemHovered(ImGuiHoveredFlags_ForTooltip))
+				ImGui::SetTooltip("Times a few trial steps to pick the thread count, grid cell size and grain sizes for this scene");
+			const TuningParameters& tuning = TuningParameters::Current();
+			ImGui::Text("Threads: %u, Atoms Per Cell: %.1f", tuning.threadCount, tuning.gridAtomsPerCell);
+			ImGui::Text("Grain Sizes: %zu chunks (simulation), %zu atoms (AO)", tuning.simulationGrainSize, tuning.ambientOcclusionGrainSize);
+			ImGui::Spacing();
+
 
 			// Simulation Box
 			ImGui::SeparatorText("Simulation Box");
@@ -1492,8 +1581,8 @@ void Application::RenderUI()
 					boxDims.z = initialBoxDims.x;
 
 					// Get the initial atom positions before setting the new dimensions
-					std::vector<Atom> atomsInitial = {};
-					std::vector<Atom> atomsFinal = {};
+					AtomStore atomsInitial = {};
+					AtomStore atomsFinal = {};
 					if (m_simulationSettings.allowAtomsToRelocateWhenUpdatingBoxDimensions) 
 						atomsInitial = m_simulation.GetAtoms();
 
@@ -1525,7 +1614,7 @@ void Application::RenderUI()
 					{
 						isActive = true;
 						// Create the change request for the undo stack
-						std::vector<Atom> atomsInitial = {};
+						AtomStore atomsInitial = {};
 						if (m_simulationSettings.allowAtomsToRelocateWhenUpdatingBoxDimensions)
 							atomsInitial = m_simulation.GetAtoms();
 						AddUndoCR<BoxResizeCR>(initialBoxDims, boxDims, m_simulationSettings.allowAtomsToRelocateWhenUpdatingBoxDimensions, m_simulationSettings.forceSidesToBeEqual, m_simulationSettings.forceSidesToBeEqual, atomsInitial);
@@ -1555,7 +1644,7 @@ void Application::RenderUI()
 					{
 						isActive = true; 
 						// Create the change request for the undo stack
-						std::vector<Atom> atomsInitial = {};
+						AtomStore atomsInitial = {};
 						if (m_simulationSettings.allowAtomsToRelocateWhenUpdatingBoxDimensions)
 							atomsInitial = m_simulation.GetAtoms();
 						AddUndoCR<BoxResizeCR>(initialBoxDims, boxDims, m_simulationSettings.allowAtomsToRelocateWhenUpdatingBoxDimensions, m_simulationSettings.forceSidesToBeEqual, m_simulationSettings.forceSidesToBeEqual, atomsInitial);
@@ -1610,9 +1699,232 @@ void Application::RenderUI()
 		ImGui::Begin("Bottom Panel"); 
 
 		ImGui::Text("FPS: %d", fps);
+		ImGui::SameLine();
+		ImGui::Text("(p99 frame: %.2f ms)", FrameStats::ToDisplayUnits(FrameMetric::FRAME_TIME, static_cast<double>(FrameStats::Get().GetHistogram(FrameMetric::FRAME_TIME).ValueAtPercentile(99.0))));
+
+		ImGui::End();
+	}
+
+	// Performance - percentiles since startup (or the last reset), so that stutter is not averaged away like it is in the FPS
+	{
+		ImGui::Begin("Performance");
+
+		FrameStats& frameStats = FrameStats::Get();
+		if (ImGui::Button("Reset"))
+			frameStats.Reset();
+		ImGui::SameLine();
+		if (ImGui::Button("Log"))
+			frameStats.LogReport();
+
+		if (ImGui::BeginTable("Frame stats", 8, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+		{
+			ImGui::TableSetupColumn("Metric");
+			ImGui::TableSetupColumn("Samples");
+			ImGui::TableSetupColumn("Mean");
+			ImGui::TableSetupColumn("p50");
+			ImGui::TableSetupColumn("p90");
+			ImGui::TableSetupColumn("p99");
+			ImGui::TableSetupColumn("p99.9");
+			ImGui::TableSetupColumn("Max");
+			ImGui::TableHeadersRow();
+
+			for (size_t iii = 0; iii < FrameMetricCount; ++iii)
+			{
+				const FrameMetric metric = static_cast<FrameMetric>(iii);
+				const Histogram& histogram = frameStats.GetHistogram(metric);
+				auto Column = [metric](double value)
+					{
+						ImGui::TableNextColumn();
+						ImGui::Text("%.3f %s", FrameStats::ToDisplayUnits(metric, value), FrameStats::GetDisplayUnits(metric));
+					};
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::TextUnformatted(FrameMetricNames[iii]);
+				ImGui::TableNextColumn(); ImGui::Text("%llu", histogram.GetCount());
+				Column(histogram.GetMean());
+				for (double percentile : { 50.0, 90.0, 99.0, 99.9 })
+					Column(static_cast<double>(histogram.ValueAtPercentile(percentile)));
+				Column(static_cast<double>(histogram.GetMax()));
+			}
+			ImGui::EndTable();
+		}
+
+		ImGui::End();
+	}
+
+#ifdef ENABLE_PROFILING
+	// Profiler
+	{
+		ImGui::Begin("Profiler");
+
+		Profiler& profiler = Profiler::Get();
+		const double frameMs = static_cast<double>(profiler.GetLastFrameDurationNs()) / 1e6;
+		ImGui::Text("Frame: %.3f ms", frameMs);
+		if (profiler.GetDroppedCount() > 0)
+		{
+			ImGui::SameLine();
+			ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "(%llu scopes dropped)", profiler.GetDroppedCount());
+		}
+
+		bool paused = profiler.IsPaused();
+		if (ImGui::Checkbox("Pause", &paused))
+			profiler.SetPaused(paused);
+
+		ImGui::SameLine();
+		ImGui::BeginDisabled(profiler.IsCapturing());
+		if (ImGui::Button("Capture 120 frames"))
+			profiler.CaptureFrames(120, "seethe-trace.json");
+		ImGui::EndDisabled();
+		if (ImGui::IsItemHovered(ImGuiHoveredFlags_ForTooltip))
+			ImGui::SetTooltip("Writes a Chrome trace_event file (open it with chrome://tracing or ui.perfetto.dev)");
+
+		// Sampling catches the hotspots that are not inside a PROFILE_SCOPE()
+		SamplingProfiler& sampler = SamplingProfiler::Get();
+		ImGui::SameLine();
+		if (!sampler.IsRunning())
+		{
+			if (ImGui::Button("Start Sampling"))
+				sampler.Start();
+		}
+		else if (ImGui::Button("Stop Sampling"))
+		{
+			sampler.Stop();
+			sampler.WriteCollapsedStacks("seethe-profile.folded");
+		}
+		if (ImGui::IsItemHovered(ImGuiHoveredFlags_ForTooltip))
+			ImGui::SetTooltip("Writes collapsed stacks for a flame graph (flamegraph.pl or speedscope.app) when stopped");
+		if (sampler.IsRunning())
+		{
+			ImGui::SameLine();
+			ImGui::Text("%zu samples (%llu dropped)", sampler.GetSampleCount(), sampler.GetDroppedCount());
+		}
+		else if (!sampler.GetUnavailableReason().empty())
+		{
+			ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Sampling unavailable: %s", sampler.GetUnavailableReason().c_str());
+		}
+
+		for (const Profiler::ThreadFrame& thread : profiler.GetLastFrame())
+		{
+			// Threads that did nothing this frame are left out
+			if (thread.nodes.size() == 1)
+				continue;
+
+			if (!ImGui::TreeNodeEx(thread.threadName.c_str(), ImGuiTreeNodeFlags_DefaultOpen))
+				continue;
+
+			auto DrawNode = [&](this auto&& self, std::uint32_t index) -> void
+				{
+					const Profiler::FrameNode& node = thread.nodes[index];
+					const double ms = static_cast<double>(node.totalNs) / 1e6;
+					const double percent = frameMs > 0.0 ? 100.0 * ms / frameMs : 0.0;
+
+					ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen;
+					if (node.firstChild == Profiler::NoNode)
+						flags |= ImGuiTreeNodeFlags_Leaf;
+
+					// The id is the node's index, so nodes with the same name under different parents stay distinct
+					const std::string& name = profiler.GetName(node.nameId);
+					if (ImGui::TreeNodeEx(reinterpret_cast<void*>(static_cast<std::uintptr_t>(index)), flags, "%s: %.3f ms (%.1f%%) x%u", name.c_str(), ms, percent, node.count))
+					{
+						for (std::uint32_t child = node.firstChild; child != Profiler::NoNode; child = thread.nodes[child].nextSibling)
+							self(child);
+						ImGui::TreePop();
+					}
+				};
+
+			for (std::uint32_t child = thread.nodes[0].firstChild; child != Profiler::NoNode; child = thread.nodes[child].nextSibling)
+				DrawNode(child);
+
+			ImGui::TreePop();
+		}
+
+		// Accumulated hardware counters for the PROFILE_PHASE() scopes. Without counters (i.e. not on Linux, or no
+		// permission) only the time columns are filled in
+		ImGui::SeparatorText("Phases");
+		if (ImGui::Button("Reset"))
+			PhaseCounters::Get().Reset();
+		ImGui::SameLine();
+		if (ImGui::Button("Log"))
+			PhaseCounters::Get().LogReport();
+
+		if (ImGui::BeginTable("Phases", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+		{
+			ImGui::TableSetupColumn("Phase");
+			ImGui::TableSetupColumn("ms/call");
+			ImGui::TableSetupColumn("IPC");
+			ImGui::TableSetupColumn("L1D miss/atom");
+			ImGui::TableSetupColumn("LLC miss/atom");
+			ImGui::TableSetupColumn("Branch miss/atom");
+			ImGui::TableHeadersRow();
+
+			PhaseCounters::Get().ForEachPhase([](const PhaseCounters::Phase& phase)
+			{
+				if (phase.calls == 0)
+					return;
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::TextUnformatted(phase.name.c_str());
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", static_cast<double>(phase.ns) / 1e6 / static_cast<double>(phase.calls));
+
+				auto Column = [](bool valid, double value)
+					{
+						ImGui::TableNextColumn();
+						if (valid)
+							ImGui::Text("%.3f", value);
+						else
+							ImGui::TextDisabled("-");
+					};
+				Column(phase.valid[static_cast<size_t>(PerfCounter::CYCLES)], phase.IPC());
+				Column(phase.valid[static_cast<size_t>(PerfCounter::L1D_MISSES)], phase.PerWork(PerfCounter::L1D_MISSES));
+				Column(phase.valid[static_cast<size_t>(PerfCounter::LLC_MISSES)], phase.PerWork(PerfCounter::LLC_MISSES));
+				Column(phase.valid[static_cast<size_t>(PerfCounter::BRANCH_MISSES)], phase.PerWork(PerfCounter::BRANCH_MISSES));
+			});
+			ImGui::EndTable();
+		}
+
+		ImGui::End();
+	}
+#endif
+
+#ifdef ENABLE_ALLOCATION_TRACKING
+	// Allocations
+	{
+		ImGui::Begin("Allocations");
+
+		const AllocationTracker& tracker = AllocationTracker::Get();
+		ImGui::Text("Last frame: %llu allocations (%llu bytes), %llu frees", tracker.GetLastFrameAllocations(), tracker.GetLastFrameBytes(), tracker.GetLastFrameFrees());
+		if (tracker.IsCheckingSteadyState())
+			ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Allocation check running");
+
+		if (ImGui::BeginTable("Allocation tags", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+		{
+			ImGui::TableSetupColumn("Tag");
+			ImGui::TableSetupColumn("Allocations/frame");
+			ImGui::TableSetupColumn("Bytes/frame");
+			ImGui::TableSetupColumn("Total allocations");
+			ImGui::TableSetupColumn("Total bytes");
+			ImGui::TableSetupColumn("Live bytes");
+			ImGui::TableHeadersRow();
+
+			tracker.ForEachTag([](const AllocationTracker::TagCounters& counters)
+			{
+				// Tags that allocated this frame stand out - in the steady state there should not be any
+				const ImVec4 color = counters.frameAllocations > 0 ? ImVec4(1.0f, 0.6f, 0.0f, 1.0f) : ImGui::GetStyleColorVec4(ImGuiCol_Text);
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::TextColored(color, "%s", counters.name);
+				ImGui::TableNextColumn(); ImGui::TextColored(color, "%llu", counters.frameAllocations);
+				ImGui::TableNextColumn(); ImGui::TextColored(color, "%llu", counters.frameBytes);
+				ImGui::TableNextColumn(); ImGui::Text("%llu", counters.totalAllocations);
+				ImGui::TableNextColumn(); ImGui::Text("%llu", counters.totalBytes);
+				ImGui::TableNextColumn(); ImGui::Text("%llu", counters.liveBytes);
+			});
+			ImGui::EndTable();
+		}
 
 		ImGui::End();
 	}
+#endif
 
 	// Viewport
 	{
@@ -1629,6 +1941,15 @@ void Application::RenderUI()
 		ImVec2 pos = ImGui::GetWindowPos();
 		m_mainSimulationWindow->SetWindow(pos.y, pos.x, ImGui::GetWindowHeight(), ImGui::GetWindowWidth());
 
+		// Marquee selection rectangle
+		if (m_mainSimulationWindow->MarqueeSelectionIsActive())
+		{
+			auto [topLeft, bottomRight] = m_mainSimulationWindow->GetMarqueeCorners();
+			ImDrawList* drawList = ImGui::GetWindowDrawList();
+			drawList->AddRectFilled(ImVec2(topLeft.x, topLeft.y), ImVec2(bottomRight.x, bottomRight.y), IM_COL32(90, 150, 255, 40));
+			drawList->AddRect(ImVec2(topLeft.x, topLeft.y), ImVec2(bottomRight.x, bottomRight.y), IM_COL32(90, 150, 255, 200));
+		}
+
 		ImGui::End();
 	}
 
@@ -1670,6 +1991,9 @@ void Application::RenderUI()
 }
 void Application::Render()
 {
+	PROFILE_SCOPE("Application::Render");
+	ALLOCATION_TAG("Render");
+
 	auto commandList = m_deviceResources->GetCommandList();
 
 	// Indicate a state transition on the resource usage.
@@ -1722,6 +2046,8 @@ void Application::Render()
 }
 void Application::Present()
 {
+	PROFILE_SCOPE("Application::Present");
+
 	m_deviceResources->Present(); 
 
 	m_fences[m_currentFrameIndex] = m_deviceResources->GetCurrentFenceValue(); 
@@ -1800,7 +2126,7 @@ void Application::RemoveAllSelectedAtoms() noexcept
 	data.reserve(indices.size());
 	for (size_t index : indices)
 	{
-		const Atom& atom = m_simulation.GetAtom(index); 
+		const Atom& atom = std::as_const(m_simulation).GetAtom(index); 
 		data.emplace_back(index, AtomTPV(atom.type, atom.position, atom.velocity)); 
 	}
 	AddUndoCR<RemoveAtomsCR>(std::move(data));
@@ -7,10 +7,12 @@
 #include "rendering/Renderer.h"
 #include "utils/Timer.h"
 #include "utils/Constants.h"
+#include "utils/AllocationTracker.h"
 #include "ui/SimulationWindow.h"
 #include "application/rendering/Light.h"
 #include "application/rendering/Material.h"
 #include "application/change-requests/ChangeRequest.h"
+#include "application/AutoTuner.h"
 
 #include "imgui.h"
 #include "backends/imgui_impl_win32.h"
@@ -52,6 +54,9 @@ struct SimulationSettings
 	// Box Settings
 	bool allowAtomsToRelocateWhenUpdatingBoxDimensions = false;
 	bool forceSidesToBeEqual = true;
+
+	// Pick the thread count, grid cell size and grain sizes by timing trial steps whenever the simulation starts (see AutoTuner)
+	bool autoTune = false;
 };
 
 class Application
@@ -99,11 +104,16 @@ public:
 	template<typename T, typename... Args>
 	void AddUndoCR(Args&&... args) noexcept
 	{
+		ALLOCATION_TAG("Undo");
+
 		std::shared_ptr<ChangeRequest> cr = std::make_shared<T>(std::forward<Args>(args)...);
+		if (!m_undoStack.empty())
+			m_undoBytes += m_undoStack.top()->GetMemoryUsage();
 		m_undoStack.push(cr);
 		// Clear the Redo Stack
 		while (m_redoStack.size() > 0)
 			m_redoStack.pop();
+		m_redoBytes = 0;
 	}
 
 	void SetMaterial(AtomType atomType, const Material& material) noexcept;
@@ -151,9 +161,14 @@ private:
 	std::vector<Material> m_materials = {};
 
 	SimulationSettings m_simulationSettings;
+	AutoTuner m_autoTuner;
 
 	std::stack<std::shared_ptr<ChangeRequest>> m_undoStack;
 	std::stack<std::shared_ptr<ChangeRequest>> m_redoStack;
+	// Running totals of GetMemoryUsage() for the metrics. The UI keeps extending the change request on top of the undo
+	// stack in place (i.e. while atoms are dragged), so m_undoBytes leaves it out until something is pushed on top of it
+	size_t m_undoBytes = 0;
+	size_t m_redoBytes = 0;
 
 
 
@@ -0,0 +1,287 @@
+#include "AutoTuner.h"
+#include "HeadlessFrame.h"
+#include "simulation/Simulation.h"
+#include "utils/AllocationTracker.h"
+#include "utils/Log.h"
+#include "utils/ThreadPool.h"
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace seethe
+{
+namespace
+{
+constexpr float TimeStep = 1.0f / 60.0f;
+
+constexpr std::array<float, 4> GridAtomsPerCellCandidates = { 1.0f, 2.0f, 4.0f, 8.0f };
+constexpr std::array<size_t, 3> SimulationGrainSizeCandidates = { 1, 4, 16 };
+constexpr std::array<size_t, 3> AmbientOcclusionGrainSizeCandidates = { 64, 256, 1024 };
+
+// 1, 2, 4, ... and finally the hardware thread count itself if it is not a power of two
+std::vector<unsigned int> ThreadCountCandidates() noexcept
+{
+	const unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<unsigned int> counts;
+	for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+		counts.push_back(threads);
+	counts.push_back(maxThreads);
+	return counts;
+}
+
+std::string CpuBrand() noexcept
+{
+	// The brand string is 48 characters spread across the registers of 3 CPUID leaves
+	std::array<unsigned int, 12> registers = {};
+#if defined(_M_X64) || defined(_M_IX86)
+	std::array<int, 4> info = {};
+	__cpuid(info.data(), static_cast<int>(0x80000000));
+	if (static_cast<unsigned int>(info[0]) >= 0x80000004)
+	{
+		for (unsigned int leaf = 0; leaf < 3; ++leaf)
+		{
+			__cpuid(info.data(), static_cast<int>(0x80000002 + leaf));
+			std::memcpy(registers.data() + 4 * leaf, info.data(), sizeof(info));
+		}
+	}
+#elif defined(__x86_64__) || defined(__i386__)
+	for (unsigned int leaf = 0; leaf < 3; ++leaf)
+		__get_cpuid(0x80000002 + leaf, &registers[4 * leaf], &registers[4 * leaf + 1], &registers[4 * leaf + 2], &registers[4 * leaf + 3]);
+#endif
+	if (registers[0] == 0)
+		return "Unknown CPU";
+
+	std::string brand(reinterpret_cast<const char*>(registers.data()), sizeof(registers));
+	brand.resize(std::strlen(brand.c_str()));
+
+	// The brand string is padded with spaces
+	const size_t first = brand.find_first_not_of(' ');
+	const size_t last = brand.find_last_not_of(' ');
+	return first == std::string::npos ? "Unknown CPU" : brand.substr(first, last - first + 1);
+}
+
+json ToJson(const TuningParameters& parameters, double stepMs) noexcept
+{
+	return {
+		{ "ThreadCount", parameters.threadCount },
+		{ "GridAtomsPerCell", parameters.gridAtomsPerCell },
+		{ "SimulationGrainSize", parameters.simulationGrainSize },
+		{ "AmbientOcclusionGrainSize", parameters.ambientOcclusionGrainSize },
+		{ "StepMs", stepMs }
+	};
+}
+
+// Throws json::exception if a value is missing or has the wrong type. The thread count is clamped to what the machine
+// has, so an edited (or copied) cache can not make the ThreadPool start thousands of threads
+TuningParameters FromJson(const json& data)
+{
+	TuningParameters parameters;
+	parameters.threadCount = std::clamp(data.at("ThreadCount").get<unsigned int>(), 1u, std::max(1u, std::thread::hardware_concurrency()));
+	parameters.gridAtomsPerCell = std::max(0.125f, data.at("GridAtomsPerCell").get<float>());
+	parameters.simulationGrainSize = std::max<size_t>(1, data.at("SimulationGrainSize").get<size_t>());
+	parameters.ambientOcclusionGrainSize = std::max<size_t>(1, data.at("AmbientOcclusionGrainSize").get<size_t>());
+	return parameters;
+}
+
+void LogParameters(std::string_view prefix, const TuningParameters& parameters) noexcept
+{
+	LOG_INFO("{}: {} threads, {} atoms per grid cell, simulation grain {} chunks, ambient occlusion grain {} atoms",
+		prefix, parameters.threadCount, parameters.gridAtomsPerCell, parameters.simulationGrainSize, parameters.ambientOcclusionGrainSize);
+}
+
+// Fastest of TrialSteps steps of 'atoms' with 'parameters' applied (the fastest is the least disturbed by whatever
+// else the machine is doing)
+double MeasureStepMs(Simulation& trial, const AtomStore& atoms, const TuningParameters& parameters) noexcept
+{
+	TuningParameters::Apply(parameters);
+
+	// Every trial starts from the same positions
+	trial.SetAtoms(atoms);
+	HeadlessFrame frame(trial);
+	for (unsigned int iii = 0; iii < AutoTuner::WarmupSteps; ++iii)
+		frame.Step(trial, TimeStep);
+
+	double fastest = std::numeric_limits<double>::max();
+	for (unsigned int iii = 0; iii < AutoTuner::TrialSteps; ++iii)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		frame.Step(trial, TimeStep);
+		fastest = std::min(fastest, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+	return fastest;
+}
+}
+
+AutoTuner::AutoTuner(std::filesystem::path cachePath) noexcept :
+	m_cachePath(std::move(cachePath))
+{
+	LoadCache();
+}
+
+void AutoTuner::OnSimulationStarted(const Simulation& simulation) noexcept
+{
+	const size_t atomCount = simulation.GetAtoms().size();
+	if (atomCount < MinAtomCount)
+		return;
+	if (m_tunedAtomCount > 0 && atomCount < m_tunedAtomCount * RetuneFactor && atomCount * RetuneFactor > m_tunedAtomCount)
+		return;
+
+	ALLOCATION_TAG("Auto-tune");
+	m_tunedAtomCount = atomCount;
+
+	const std::string hardware = HardwareSignature();
+	const std::string scene = SceneSignature(simulation);
+
+	if (m_cache.contains(hardware) && m_cache[hardware].contains(scene))
+	{
+		try
+		{
+			const TuningParameters parameters = FromJson(m_cache[hardware][scene]);
+			TuningParameters::Apply(parameters);
+			LogParameters(std::format("Auto-tune (cached for {})", scene), parameters);
+			return;
+		}
+		catch (const json::exception& e)
+		{
+			LOG_WARN("Ignoring the cached tuning for '{}': {}", scene, e.what());
+		}
+	}
+
+	const TuningParameters parameters = Tune(simulation);
+	m_cache[hardware][scene] = ToJson(parameters, m_lastStepMs);
+	SaveCache();
+}
+
+TuningParameters AutoTuner::Tune(const Simulation& simulation) noexcept
+{
+	ALLOCATION_TAG("Auto-tune");
+	const auto start = std::chrono::steady_clock::now();
+
+	const AtomStore atoms = simulation.SnapshotAtoms();
+	Simulation trial;
+	trial.SetDimensions(simulation.GetDimensions());
+	trial.StartPlaying();
+
+	TuningParameters best = TuningParameters::Current();
+	best.threadCount = ThreadPool::Get().GetThreadCount();
+	double bestMs = MeasureStepMs(trial, atoms, best);
+	unsigned int trialCount = 1;
+	bool outOfTime = false;
+
+	// Tries every candidate value of one knob with the others left at their best values so far
+	const auto Search = [&](auto knob, const auto& candidates)
+		{
+			for (const auto& value : candidates)
+			{
+				if (value == best.*knob)
+					continue;
+				if (std::chrono::steady_clock::now() - start > TimeBudget)
+				{
+					outOfTime = true;
+					return;
+				}
+
+				TuningParameters candidate = best;
+				candidate.*knob = value;
+				const double stepMs = MeasureStepMs(trial, atoms, candidate);
+				++trialCount;
+				if (stepMs < bestMs)
+				{
+					best = candidate;
+					bestMs = stepMs;
+				}
+			}
+		};
+
+	// Roughly in order of how much they matter
+	Search(&TuningParameters::threadCount, ThreadCountCandidates());
+	Search(&TuningParameters::gridAtomsPerCell, GridAtomsPerCellCandidates);
+	Search(&TuningParameters::simulationGrainSize, SimulationGrainSizeCandidates);
+	Search(&TuningParameters::ambientOcclusionGrainSize, AmbientOcclusionGrainSizeCandidates);
+
+	TuningParameters::Apply(best);
+	m_lastStepMs = bestMs;
+
+	const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	if (outOfTime)
+		LOG_WARN("Auto-tune ran out of time after {} trials - the remaining candidates were not tried", trialCount);
+	LogParameters(std::format("Auto-tune ({} trials in {:.0f} ms, {:.3f} ms per step, {})", trialCount, elapsedMs, bestMs, SceneSignature(simulation)), best);
+	return best;
+}
+
+std::string AutoTuner::HardwareSignature() noexcept
+{
+	return std::format("{}, {} threads", CpuBrand(), std::thread::hardware_concurrency());
+}
+
+std::string AutoTuner::SceneSignature(const Simulation& simulation) noexcept
+{
+	const size_t atomCount = std::max<size_t>(1, simulation.GetAtoms().size());
+	const DirectX::XMFLOAT3 dimensions = simulation.GetDimensions();
+	const double volume = std::max(1e-6, static_cast<double>(dimensions.x) * dimensions.y * dimensions.z);
+	const double density = static_cast<double>(atomCount) / volume;
+
+	return std::format("2^{} atoms, 2^{} atoms per unit^3", std::lround(std::log2(static_cast<double>(atomCount))), std::lround(std::log2(density)));
+}
+
+void AutoTuner::LoadCache() noexcept
+{
+	if (!std::filesystem::exists(m_cachePath))
+		return;
+
+	try
+	{
+		std::ifstream file(m_cachePath);
+		m_cache = json::parse(file);
+		if (!m_cache.is_object())
+			throw std::runtime_error("The top level must be an object");
+	}
+	catch (const std::exception& e)
+	{
+		LOG_WARN("Ignoring the tuning cache '{}': {}", m_cachePath.string(), e.what());
+		m_cache = json::object();
+		return;
+	}
+
+	// OnSimulationStarted() indexes the cache as hardware -> scene -> parameters, which throws if either of the first two
+	// levels is not an object. Drop whatever does not have that shape and keep the rest (the parameters themselves are
+	// checked when they are used)
+	for (auto hardware = m_cache.begin(); hardware != m_cache.end(); )
+	{
+		if (!hardware->is_object())
+		{
+			LOG_WARN("Ignoring the tuning cache entry '{}': not an object", hardware.key());
+			hardware = m_cache.erase(hardware);
+			continue;
+		}
+
+		for (auto scene = hardware->begin(); scene != hardware->end(); )
+		{
+			if (!scene->is_object())
+			{
+				LOG_WARN("Ignoring the tuning cache entry '{}' / '{}': not an object", hardware.key(), scene.key());
+				scene = hardware->erase(scene);
+			}
+			else
+			{
+				++scene;
+			}
+		}
+		++hardware;
+	}
+}
+
+void AutoTuner::SaveCache() const noexcept
+{
+	std::ofstream file(m_cachePath);
+	if (!file.is_open())
+	{
+		LOG_ERROR("Failed to open tuning cache '{}'", m_cachePath.string());
+		return;
+	}
+	file << m_cache.dump(4) << '\n';
+}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "pch.h"
+#include "utils/TuningParameters.h"
+
+namespace seethe
+{
+class Simulation;
+
+// Picks the TuningParameters (thread count, grid cell size and grain sizes) for the machine and the scene by timing
+// short trial steps of the actual scene. Each trial plays a copy of the atoms through a HeadlessFrame, so it measures
+// the same per-frame CPU work as the simulation window, and the fastest parameters are applied.
+//
+// The search is a coordinate descent: starting from the current parameters, each knob in turn is set to every one of
+// its candidate values while the others stay put, and the fastest value is kept. It stops early once TimeBudget is
+// used up. Results are cached in a JSON file keyed by the hardware (CPU and thread count) and the scene (atom count and
+// density, both rounded to a power of two), so a scene that was tuned before is only looked up.
+class AutoTuner
+{
+public:
+	// Smaller scenes run well with anything, so they are not worth the time it takes to tune
+	static constexpr size_t MinAtomCount = 1'000;
+
+	// Tune again once the atom count has grown or shrunk by this factor since the last tuning
+	static constexpr size_t RetuneFactor = 2;
+
+	static constexpr std::chrono::milliseconds TimeBudget{ 3'000 };
+	static constexpr unsigned int WarmupSteps = 1;
+	static constexpr unsigned int TrialSteps = 3;
+
+	AutoTuner(std::filesystem::path cachePath = "tuning-cache.json") noexcept;
+	AutoTuner(const AutoTuner&) = delete;
+	AutoTuner(AutoTuner&&) = delete;
+	AutoTuner& operator=(const AutoTuner&) = delete;
+	AutoTuner& operator=(AutoTuner&&) = delete;
+	~AutoTuner() noexcept = default;
+
+	// Called when the simulation starts playing. Applies the cached parameters for this scene, or tunes (and caches the
+	// result) if there are none. Does nothing if the atom count is close to the one the current parameters are for
+	void OnSimulationStarted(const Simulation& simulation) noexcept;
+
+	// Runs the trials for the simulation's current atoms (ignoring the cache), applies the fastest parameters and
+	// returns them. The simulation itself is not modified
+	TuningParameters Tune(const Simulation& simulation) noexcept;
+
+	ND static std::string HardwareSignature() noexcept;
+	ND static std::string SceneSignature(const Simulation& simulation) noexcept;
+
+private:
+	void LoadCache() noexcept;
+	void SaveCache() const noexcept;
+
+	std::filesystem::path m_cachePath;
+	json m_cache = json::object();
+
+	// Atom count the current parameters were picked for (0 if they never were)
+	size_t m_tunedAtomCount = 0;
+
+	// Time per step with the parameters the last Tune() picked
+	double m_lastStepMs = 0.0;
+};
+}
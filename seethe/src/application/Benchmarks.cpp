@@ -0,0 +1,327 @@
+#include "Benchmarks.h"
+#include "application/rendering/AtomInstancePacker.h"
+#include "simulation/Simulation.h"
+#include "utils/Benchmark.h"
+#include "utils/Log.h"
+#include "utils/RadixSortBenchmark.h"
+#include "utils/ThreadPool.h"
+
+using namespace DirectX;
+
+namespace seethe
+{
+namespace
+{
+constexpr float TimeStep = 1.0f / 60.0f;
+
+// Written to so that the compiler cannot optimize away results the benchmarks do not otherwise use
+volatile std::uint64_t s_sink = 0;
+
+// Fills the simulation with 'count' randomly placed and moving atoms. The box grows with the atom count so the density
+// (about one atom per 8 cubic units) and therefore the work per atom stays about the same at every size
+void FillSimulation(Simulation& simulation, size_t count, std::mt19937& rng) noexcept
+{
+	const float length = std::max(20.0f, 2.0f * std::cbrt(static_cast<float>(count)));
+	simulation.SetDimensions(length);
+
+	// Keep the atoms clear of the walls (the largest radius is well below 2)
+	std::uniform_real_distribution<float> positionDist(-length / 2.0f + 2.0f, length / 2.0f - 2.0f);
+	std::uniform_real_distribution<float> velocityDist(-2.0f, 2.0f);
+	std::uniform_int_distribution<int> typeDist(1, static_cast<int>(AtomTypeCount));
+
+	std::vector<AtomTPV> atoms;
+	atoms.reserve(count);
+	for (size_t iii = 0; iii < count; ++iii)
+	{
+		atoms.emplace_back(
+			static_cast<AtomType>(typeDist(rng)),
+			XMFLOAT3{ positionDist(rng), positionDist(rng), positionDist(rng) },
+			XMFLOAT3{ velocityDist(rng), velocityDist(rng), velocityDist(rng) }
+		);
+	}
+	simulation.AddAtoms(atoms);
+	simulation.DispatchEvents();
+}
+
+// 'count' distinct indices in [0, size), in random order
+std::vector<size_t> DistinctIndices(size_t size, size_t count, std::mt19937& rng) noexcept
+{
+	std::vector<size_t> indices(size);
+	std::iota(indices.begin(), indices.end(), size_t{ 0 });
+	std::shuffle(indices.begin(), indices.end(), rng);
+	indices.resize(count);
+	return indices;
+}
+
+void BenchmarkUpdate(BenchmarkSuite& suite) noexcept
+{
+	for (size_t count : { 1'000, 10'000, 100'000, 1'000'000, 10'000'000 })
+	{
+		const std::string name = std::format("Simulation::Update/{}", count);
+		if (!suite.Matches(name))
+			continue;
+
+		std::mt19937 rng = BenchmarkSuite::MakeRng();
+		Simulation simulation;
+		FillSimulation(simulation, count, rng);
+		simulation.StartPlaying();
+
+		suite.Run(name, count, [&simulation]() { simulation.Update(TimeStep); });
+	}
+}
+
+void BenchmarkAddRemoveSet(BenchmarkSuite& suite) noexcept
+{
+	for (size_t count : { 1'000, 10'000, 100'000 })
+	{
+		const std::string addName = std::format("Simulation::AddAtoms/{}", count);
+		const std::string insertName = std::format("Simulation::AddAtoms (at indices)/{}", count);
+		const std::string removeName = std::format("Simulation::RemoveAtoms/{}", count);
+		if (!suite.Matches(addName) && !suite.Matches(insertName) && !suite.Matches(removeName))
+			continue;
+
+		std::mt19937 rng = BenchmarkSuite::MakeRng();
+		Simulation source;
+		FillSimulation(source, count, rng);
+		const AtomStore initial = source.SnapshotAtoms();
+
+		// Adding every atom to an empty simulation (i.e. loading a file or pasting)
+		std::vector<AtomTPV> data;
+		data.reserve(count);
+		for (const Atom& atom : initial)
+			data.emplace_back(atom.type, atom.position, atom.velocity);
+
+		Simulation simulation;
+		simulation.SetDimensions(source.GetDimensions());
+		suite.Run(addName, count,
+			[&simulation]() { simulation.SetAtoms(AtomStore{}); },
+			[&simulation, &data]() { simulation.AddAtoms(data); }
+		);
+
+		// Removing 1% of the atoms and putting them back where they were (what undo/redo of a removal does)
+		const std::vector<size_t> removed = DistinctIndices(count, count / 100, rng);
+		std::vector<std::tuple<size_t, AtomTPV>> inserted;
+		inserted.reserve(removed.size());
+		for (size_t index : removed)
+			inserted.emplace_back(index, data[index]);
+
+		suite.Run(insertName, removed.size(),
+			[&simulation, &initial]() { simulation.SetAtoms(initial); },
+			[&simulation, &inserted]() { simulation.AddAtoms(inserted); }
+		);
+		suite.Run(removeName, removed.size(),
+			[&simulation, &initial]() { simulation.SetAtoms(initial); },
+			[&simulation, &removed]() { simulation.RemoveAtoms(removed); }
+		);
+	}
+
+	for (size_t count : { 10'000, 100'000, 1'000'000 })
+	{
+		const std::string name = std::format("Simulation::SetAtoms/{}", count);
+		if (!suite.Matches(name))
+			continue;
+
+		std::mt19937 rng = BenchmarkSuite::MakeRng();
+		Simulation simulation;
+		FillSimulation(simulation, count, rng);
+		const AtomStore atoms = simulation.SnapshotAtoms();
+
+		suite.Run(name, count, [&simulation, &atoms]() { simulation.SetAtoms(atoms); });
+	}
+}
+
+void BenchmarkSelection(BenchmarkSuite& suite) noexcept
+{
+	constexpr size_t atomCount = 100'000;
+	constexpr size_t queryCount = 10'000;
+	constexpr std::array<size_t, 2> selectSizes = { 1'000, 10'000 };
+	constexpr std::array<size_t, 2> bulkSelectSizes = { 10'000, 100'000 };
+	constexpr std::array<size_t, 3> isSelectedSizes = { 1'000, 10'000, 100'000 };
+
+	// Only fill the simulation if the filter matches one of the concrete benchmarks below
+	const auto matchesAny = [&suite](std::string_view prefix, std::span<const size_t> sizes)
+	{
+		return std::ranges::any_of(sizes, [&suite, prefix](size_t size) { return suite.Matches(std::format("{}/{}", prefix, size)); });
+	};
+	if (!matchesAny("Simulation::SelectAtom", selectSizes) &&
+		!matchesAny("Simulation::SelectAtoms (bulk)", bulkSelectSizes) &&
+		!matchesAny("Simulation::AtomIsSelected", isSelectedSizes))
+		return;
+
+	std::mt19937 rng = BenchmarkSuite::MakeRng();
+	Simulation simulation;
+	FillSimulation(simulation, atomCount, rng);
+
+	for (size_t selectionSize : selectSizes)
+	{
+		const std::vector<size_t> indices = DistinctIndices(atomCount, selectionSize, rng);
+		suite.Run(std::format("Simulation::SelectAtom/{}", selectionSize), selectionSize,
+			[&simulation]() { simulation.ClearSelectedAtoms(); },
+			[&simulation, &indices]()
+			{
+				for (size_t index : indices)
+					simulation.SelectAtom(index);
+			}
+		);
+	}
+
+	for (size_t selectionSize : bulkSelectSizes)
+	{
+		const std::vector<size_t> indices = DistinctIndices(atomCount, selectionSize, rng);
+		suite.Run(std::format("Simulation::SelectAtoms (bulk)/{}", selectionSize), selectionSize,
+			[&simulation]() { simulation.ClearSelectedAtoms(); },
+			[&simulation, &indices]() { simulation.SelectAtoms(indices); }
+		);
+	}
+
+	for (size_t selectionSize : isSelectedSizes)
+	{
+		// NOTE: Generate the inputs even if the benchmark is filtered out, so the inputs of the ones after it do not change
+		const std::string name = std::format("Simulation::AtomIsSelected/{}", selectionSize);
+		const std::vector<size_t> indices = DistinctIndices(atomCount, selectionSize, rng);
+		std::uniform_int_distribution<size_t> indexDist(0, atomCount - 1);
+		std::vector<size_t> queries(queryCount);
+		for (size_t& query : queries)
+			query = indexDist(rng);
+
+		if (!suite.Matches(name))
+			continue;
+
+		simulation.SelectAtoms(indices, true);
+		suite.Run(name, queryCount, [&simulation, &queries]()
+			{
+				std::uint64_t selected = 0;
+				for (size_t index : queries)
+					selected += simulation.AtomIsSelected(index) ? 1 : 0;
+				s_sink = selected;
+			}
+		);
+	}
+	simulation.ClearSelectedAtoms();
+}
+
+void BenchmarkPicking(BenchmarkSuite& suite) noexcept
+{
+	constexpr size_t rayCount = 10'000;
+
+	for (size_t count : { 10'000, 100'000, 1'000'000 })
+	{
+		const std::string buildName = std::format("AtomBVH::Build/{}", count);
+		const std::string pickName = std::format("AtomBVH::Intersect/{}", count);
+		if (!suite.Matches(buildName) && !suite.Matches(pickName))
+			continue;
+
+		std::mt19937 rng = BenchmarkSuite::MakeRng();
+		Simulation simulation;
+		FillSimulation(simulation, count, rng);
+
+		AtomBVH bvh;
+		const AtomStore& atoms = std::as_const(simulation).GetAtoms();
+		suite.Run(buildName, count, [&bvh, &atoms]() { bvh.Build(atoms); });
+
+		// Rays from outside the box toward random points inside it, like picking with the mouse from different angles
+		const float length = simulation.GetDimensions().x;
+		std::uniform_real_distribution<float> insideDist(-length / 2.0f, length / 2.0f);
+		std::uniform_real_distribution<float> directionDist(-1.0f, 1.0f);
+		std::vector<std::pair<XMFLOAT3, XMFLOAT3>> rays(rayCount);
+		for (auto& [origin, direction] : rays)
+		{
+			const XMVECTOR outward = XMVector3Normalize(XMVectorSet(directionDist(rng), directionDist(rng), directionDist(rng), 0.0f));
+			const XMVECTOR target = XMVectorSet(insideDist(rng), insideDist(rng), insideDist(rng), 0.0f);
+			const XMVECTOR start = XMVectorAdd(target, XMVectorScale(outward, 2.0f * length));
+			XMStoreFloat3(&origin, start);
+			XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSubtract(target, start)));
+		}
+
+		const AtomBVH& pickBVH = simulation.GetBVH();
+		suite.Run(pickName, rayCount, [&pickBVH, &rays]()
+			{
+				std::uint64_t hits = 0;
+				for (const auto& [origin, direction] : rays)
+					hits += pickBVH.Intersect(XMLoadFloat3(&origin), XMLoadFloat3(&direction)).has_value() ? 1 : 0;
+				s_sink = hits;
+			}
+		);
+	}
+}
+
+void BenchmarkInstancePacking(BenchmarkSuite& suite) noexcept
+{
+	for (size_t count : { 10'000, 100'000, 1'000'000 })
+	{
+		const std::string name = std::format("PackAtomInstances/{}", count);
+		if (!suite.Matches(name))
+			continue;
+
+		std::mt19937 rng = BenchmarkSuite::MakeRng();
+		Simulation simulation;
+		FillSimulation(simulation, count, rng);
+
+		const std::vector<std::uint8_t> ambientAccess(count, 255);
+		std::vector<std::uint32_t> indices(count);
+		std::iota(indices.begin(), indices.end(), 0u);
+		std::vector<AtomInstanceData> output(count);
+
+		const AtomStore& atoms = std::as_const(simulation).GetAtoms();
+		suite.Run(name, count, [&atoms, &ambientAccess, &indices, &output]()
+			{
+				PackAtomInstances(atoms, ambientAccess, indices, output);
+			}
+		);
+	}
+}
+
+void BenchmarkUndoRedo(BenchmarkSuite& suite) noexcept
+{
+	for (size_t count : { 10'000, 100'000, 1'000'000 })
+	{
+		const std::string name = std::format("Simulation play undo + redo/{}", count);
+		if (!suite.Matches(name))
+			continue;
+
+		std::mt19937 rng = BenchmarkSuite::MakeRng();
+		Simulation simulation;
+		FillSimulation(simulation, count, rng);
+
+		// Play for a bit, so that undo and redo actually swap between two different sets of positions
+		const AtomStore initial = simulation.SnapshotAtoms();
+		simulation.StartPlaying();
+		for (unsigned int iii = 0; iii < 10; ++iii)
+			simulation.Update(TimeStep);
+		simulation.StopPlaying();
+
+		// NOTE: This is exactly what SimulationPlayCR's Undo() and Redo() do. The change request itself needs the
+		//       Application, which would keep the suite from building without the Windows headers
+		AtomStore played;
+		suite.Run(name, count, [&simulation, &initial, &played]()
+			{
+				played = simulation.SnapshotAtoms();
+				simulation.SetAtoms(initial);
+				simulation.SetAtoms(played);
+			}
+		);
+	}
+}
+}
+
+int RunBenchmarks(std::string_view filter, const std::filesystem::path& outputPath) noexcept
+{
+	LOG_INFO("Running benchmarks matching '{}' ({} threads, seed {})", filter, ThreadPool::Get().GetThreadCount(), BenchmarkSuite::Seed);
+
+	BenchmarkSuite suite(filter);
+	BenchmarkUpdate(suite);
+	BenchmarkAddRemoveSet(suite);
+	BenchmarkSelection(suite);
+	BenchmarkPicking(suite);
+	BenchmarkInstancePacking(suite);
+	BenchmarkUndoRedo(suite);
+	BenchmarkRadixSort(suite);
+
+	if (suite.GetResults().empty())
+	{
+		LOG_ERROR("No benchmark matches '{}'", filter);
+		return 1;
+	}
+	return suite.WriteJson(outputPath) ? 0 : 1;
+}
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+// Benchmarks for the simulation and the editor operations built on it: stepping the simulation (10^3 - 10^7 atoms),
+// adding/removing/setting atoms, selection, picking rays against the BVH, packing instance data, undo/redo of a
+// simulation play and the RadixSorter used for the depth sort (see RadixSortBenchmark.h). Nothing here creates a
+// window or touches the GPU, and nothing here needs the Windows headers, so the benchmarks run headless on any
+// platform.
+//
+// Runs every benchmark whose name contains 'filter' (all of them if it is empty), logs the results and writes them as
+// JSON to 'outputPath'. Returns the process exit code. Run it by starting the application (or seethe-bench, which the
+// CMake build produces) with
+//     --benchmark [filter] [--benchmark-out <path>]
+ND int RunBenchmarks(std::string_view filter, const std::filesystem::path& outputPath) noexcept;
+}
@@ -1,6 +1,10 @@
 #include "pch.h"
 #include "Application.h"
+#include "HeadlessModes.h"
+#include "utils/AllocationTracker.h"
 #include "utils/Log.h"
+#include "utils/MetricsServer.h"
+#include "utils/SamplingProfiler.h"
 
 using seethe::Application;
 
@@ -18,7 +22,59 @@ int APIENTRY WinMain(
 {
 	try
 	{
+		// NOTE: __argc/__argv are filled in by the CRT for both main() and WinMain()
+
+		// Samples the whole run (whichever mode it is) and writes the collapsed stacks when it ends. The argument after
+		// it (if any) is the output path
+		std::optional<seethe::ScopedSamplingProfile> sampleProfile;
+		for (int iii = 1; iii < __argc; ++iii)
+		{
+			if (std::string_view(__argv[iii]) == "--sample-profile")
+			{
+				const bool hasPath = iii + 1 < __argc && !std::string_view(__argv[iii + 1]).starts_with("--");
+				sampleProfile.emplace(hasPath ? std::filesystem::path(__argv[iii + 1]) : std::filesystem::path("seethe-profile.folded"));
+			}
+		}
+
+		// Serves live metrics for Prometheus on 127.0.0.1 for the whole run. The argument after it (if any) is the port
+		seethe::MetricsServer metricsServer;
+		for (int iii = 1; iii < __argc; ++iii)
+		{
+			if (std::string_view(__argv[iii]) == "--metrics-port")
+			{
+				const bool hasPort = iii + 1 < __argc && !std::string_view(__argv[iii + 1]).starts_with("--");
+				if (!metricsServer.Start(hasPort ? static_cast<std::uint16_t>(std::strtoul(__argv[iii + 1], nullptr, 10)) : seethe::MetricsServer::DefaultPort))
+					return 1;
+			}
+		}
+
+		// Benchmarks and scaling tests run without a window and exit
+		if (std::optional<int> exitCode = seethe::RunHeadlessMode(__argc, __argv))
+			return *exitCode;
+
+		for (int iii = 1; iii < __argc; ++iii)
+		{
+			// Runs the simulation and fails (exit code 1) if any frame allocates once it has warmed up
+			if (std::string_view(__argv[iii]) == "--check-allocations")
+			{
+#ifdef ENABLE_ALLOCATION_TRACKING
+				seethe::AllocationTracker::Get().StartSteadyStateCheck(300, 600);
+#else
+				LOG_ERROR("{}", "--check-allocations requires a build with ENABLE_ALLOCATION_TRACKING");
+				return 1;
+#endif
+			}
+		}
+
 		std::unique_ptr<Application> app = std::make_unique<Application>();
+
+		// Picks the thread count, grid cell size and grain sizes whenever the simulation starts (see AutoTuner)
+		for (int iii = 1; iii < __argc; ++iii)
+		{
+			if (std::string_view(__argv[iii]) == "--auto-tune")
+				app->GetSimulationSettings().autoTune = true;
+		}
+
 		app->Initialize();
 		return app->Run();
 	}
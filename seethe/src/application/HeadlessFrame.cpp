@@ -0,0 +1,70 @@
+#include "HeadlessFrame.h"
+#include "simulation/Simulation.h"
+#include "utils/PerfCounters.h"
+
+using namespace DirectX;
+
+namespace seethe
+{
+HeadlessFrame::HeadlessFrame(const Simulation& simulation) noexcept
+{
+	const XMFLOAT3 dimensions = simulation.GetDimensions();
+	const float length = std::max(dimensions.x, std::max(dimensions.y, dimensions.z));
+
+	const XMVECTOR eye = XMVectorScale(XMVector3Normalize(XMVectorSet(1.0f, 0.8f, -1.2f, 0.0f)), 1.2f * length);
+	const XMMATRIX view = XMMatrixLookAtLH(eye, XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	m_farZ = 4.0f * length;
+	const XMMATRIX proj = XMMatrixPerspectiveFovLH(FovY, Aspect, NearZ, m_farZ);
+
+	XMStoreFloat4x4(&m_view, view);
+	m_frustum = Frustum(XMMatrixMultiply(view, proj));
+	m_pixelsPerUnit = XMVectorGetY(proj.r[1]) * 0.5f * ViewportHeight;
+}
+
+void HeadlessFrame::Step(Simulation& simulation, float dt) noexcept
+{
+	simulation.Update(dt);
+	simulation.DispatchEvents();
+
+	const AtomStore& atoms = std::as_const(simulation).GetAtoms();
+	const XMMATRIX view = XMLoadFloat4x4(&m_view);
+
+	// Every phase counts one unit of work per atom, so their counters can be compared per atom-step
+	{
+		PROFILE_PHASE("HeadlessFrame::Cull", atoms.size());
+		m_culler.Cull(atoms, m_frustum);
+	}
+	{
+		PROFILE_PHASE("HeadlessFrame::DepthSort", atoms.size());
+		m_depthSorter.Sort(atoms, m_culler.GetVisibleIndices(), view, NearZ, m_farZ);
+	}
+	{
+		PROFILE_PHASE("HeadlessFrame::OcclusionCull", atoms.size());
+		m_occlusionCuller.Cull(atoms, m_depthSorter.GetSortedIndices(), view, FovY, Aspect, NearZ);
+	}
+	{
+		PROFILE_PHASE("HeadlessFrame::SelectLod", atoms.size());
+		m_lodSelector.Select(atoms, m_occlusionCuller.GetVisibleIndices(), view, m_pixelsPerUnit);
+	}
+	{
+		// Every atom moves while playing, so the ambient occlusion is always recomputed from scratch
+		PROFILE_PHASE("HeadlessFrame::AmbientOcclusion", atoms.size());
+		m_ambientOcclusion.Update(atoms, simulation.GetSpatialIndex(), {}, true);
+	}
+
+	PROFILE_PHASE("HeadlessFrame::PackInstances", atoms.size());
+	size_t count = 0;
+	for (unsigned int lod = 0; lod < AtomLodSelector::LodCount; ++lod)
+		count += m_lodSelector.GetInstances(lod).size();
+	m_instances.reserve(atoms.size());
+	m_instances.resize(count);
+
+	size_t offset = 0;
+	for (unsigned int lod = 0; lod < AtomLodSelector::LodCount; ++lod)
+	{
+		const std::vector<std::uint32_t>& instances = m_lodSelector.GetInstances(lod);
+		PackAtomInstances(atoms, m_ambientOcclusion.GetValues(), instances, std::span(m_instances.data() + offset, instances.size()));
+		offset += instances.size();
+	}
+}
+}
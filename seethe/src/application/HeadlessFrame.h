@@ -0,0 +1,49 @@
+#pragma once
+#include "pch.h"
+#include "application/rendering/AtomInstancePacker.h"
+#include "rendering/AtomAmbientOcclusion.h"
+#include "rendering/AtomCuller.h"
+#include "rendering/AtomDepthSorter.h"
+#include "rendering/AtomLodSelector.h"
+#include "rendering/AtomOcclusionCuller.h"
+#include "utils/Frustum.h"
+
+namespace seethe
+{
+class Simulation;
+
+// The per-frame CPU work that SimulationWindow::UpdateAtomInstances() does while the simulation is playing, with a
+// fixed camera that looks at the whole box. Used to measure the frame pipeline without a window or the GPU
+class HeadlessFrame
+{
+public:
+	static constexpr float FovY = 0.25f * DirectX::XM_PI;
+	static constexpr float Aspect = 16.0f / 9.0f;
+	static constexpr float NearZ = 0.1f;
+	static constexpr float ViewportHeight = 1080.0f;
+
+	HeadlessFrame(const Simulation& simulation) noexcept;
+	HeadlessFrame(const HeadlessFrame&) = delete;
+	HeadlessFrame(HeadlessFrame&&) = delete;
+	HeadlessFrame& operator=(const HeadlessFrame&) = delete;
+	HeadlessFrame& operator=(HeadlessFrame&&) = delete;
+	~HeadlessFrame() noexcept = default;
+
+	// Steps the simulation by 'dt' and then culls, sorts, selects LODs, updates the ambient occlusion and packs the
+	// instance data for the new positions
+	void Step(Simulation& simulation, float dt) noexcept;
+
+private:
+	DirectX::XMFLOAT4X4 m_view = {};
+	Frustum m_frustum;
+	float m_farZ = 1.0f;
+	float m_pixelsPerUnit = 1.0f;
+
+	AtomCuller m_culler;
+	AtomDepthSorter m_depthSorter;
+	AtomOcclusionCuller m_occlusionCuller;
+	AtomLodSelector m_lodSelector;
+	AtomAmbientOcclusion m_ambientOcclusion;
+	std::vector<AtomInstanceData> m_instances;
+};
+}
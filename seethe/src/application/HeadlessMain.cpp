@@ -0,0 +1,48 @@
+#include "pch.h"
+#include "HeadlessModes.h"
+#include "utils/Log.h"
+#include "utils/MetricsServer.h"
+#include "utils/SamplingProfiler.h"
+
+// Entry point of seethe-bench, which the CMake build produces: the headless modes of the application (see
+// RunHeadlessMode()) without the window, the renderer or the Windows headers
+int main(int argc, char** argv)
+{
+	try
+	{
+		// Same as the application: samples the whole run and writes the collapsed stacks when it ends
+		std::optional<seethe::ScopedSamplingProfile> sampleProfile;
+		for (int iii = 1; iii < argc; ++iii)
+		{
+			if (std::string_view(argv[iii]) == "--sample-profile")
+			{
+				const bool hasPath = iii + 1 < argc && !std::string_view(argv[iii + 1]).starts_with("--");
+				sampleProfile.emplace(hasPath ? std::filesystem::path(argv[iii + 1]) : std::filesystem::path("seethe-profile.folded"));
+			}
+		}
+
+		// Same as the application: serves live metrics for Prometheus on 127.0.0.1 while the benchmarks run. The argument
+		// after it (if any) is the port
+		seethe::MetricsServer metricsServer;
+		for (int iii = 1; iii < argc; ++iii)
+		{
+			if (std::string_view(argv[iii]) == "--metrics-port")
+			{
+				const bool hasPort = iii + 1 < argc && !std::string_view(argv[iii + 1]).starts_with("--");
+				if (!metricsServer.Start(hasPort ? static_cast<std::uint16_t>(std::strtoul(argv[iii + 1], nullptr, 10)) : seethe::MetricsServer::DefaultPort))
+					return 1;
+			}
+		}
+
+		if (std::optional<int> exitCode = seethe::RunHeadlessMode(argc, argv))
+			return *exitCode;
+
+		LOG_ERROR("{}", "Usage: seethe-bench (--benchmark [filter] [--benchmark-out <path>] | --scaling-test [atoms] [--scaling-threads <n>] [--scaling-out <path>] | --benchmark-radix-sort [filter] [--benchmark-out <path>]) [--sample-profile [path]] [--metrics-port [port]]");
+		return 1;
+	}
+	catch (std::exception& e)
+	{
+		LOG_ERROR("Caught exception: {}", e.what());
+		return 2;
+	}
+}
@@ -0,0 +1,72 @@
+#include "HeadlessModes.h"
+#include "Benchmarks.h"
+#include "ScalingTest.h"
+#include "utils/FrameStats.h"
+#include "utils/PerfCounters.h"
+#include "utils/RadixSortBenchmark.h"
+
+namespace seethe
+{
+namespace
+{
+std::optional<int> RunMode(int argc, char** argv) noexcept
+{
+	for (int iii = 1; iii < argc; ++iii)
+	{
+		// Runs the benchmark suite (or only its RadixSorter benchmarks). The argument after it (if any) is a filter, and
+		// --benchmark-out <path> (anywhere on the command line) sets where the JSON results are written
+		const std::string_view mode = argv[iii];
+		if (mode == "--benchmark" || mode == "--benchmark-radix-sort")
+		{
+			std::string_view filter;
+			if (iii + 1 < argc && !std::string_view(argv[iii + 1]).starts_with("--"))
+				filter = argv[iii + 1];
+
+			std::filesystem::path output = "benchmark-results.json";
+			for (int jjj = 1; jjj + 1 < argc; ++jjj)
+			{
+				if (std::string_view(argv[jjj]) == "--benchmark-out")
+					output = argv[jjj + 1];
+			}
+			return mode == "--benchmark" ? RunBenchmarks(filter, output) : RunRadixSortBenchmarks(filter, output);
+		}
+
+		// Strong/weak thread scaling of the whole per-frame pipeline on synthetic scenes. The argument after it (if any)
+		// is the atom count for strong scaling
+		if (std::string_view(argv[iii]) == "--scaling-test")
+		{
+			ScalingTestOptions options;
+			if (iii + 1 < argc && !std::string_view(argv[iii + 1]).starts_with("--"))
+				options.atomCount = std::max<size_t>(1, std::strtoull(argv[iii + 1], nullptr, 10));
+
+			for (int jjj = 1; jjj + 1 < argc; ++jjj)
+			{
+				if (std::string_view(argv[jjj]) == "--scaling-threads")
+					options.maxThreads = std::max(1u, static_cast<unsigned int>(std::strtoul(argv[jjj + 1], nullptr, 10)));
+				else if (std::string_view(argv[jjj]) == "--scaling-out")
+					options.outputPath = argv[jjj + 1];
+			}
+
+			// Weak scaling ends at the same size as strong scaling
+			options.atomsPerThread = std::max<size_t>(1'000, options.atomCount / options.maxThreads);
+			return RunScalingTest(options);
+		}
+	}
+	return std::nullopt;
+}
+}
+
+std::optional<int> RunHeadlessMode(int argc, char** argv) noexcept
+{
+	// Same as the application when it exits: the step time (and any upload) percentiles of the whole run, which the
+	// per-benchmark numbers would not show on their own. The per-phase hardware counters are only available on Linux,
+	// where this is the only way to run the simulation, so they are reported here as well
+	const std::optional<int> exitCode = RunMode(argc, argv);
+	if (exitCode)
+	{
+		FrameStats::Get().LogReport();
+		PhaseCounters::Get().LogReport();
+	}
+	return exitCode;
+}
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+// The modes that run without a window and exit: --benchmark, --scaling-test and --benchmark-radix-sort. If the command
+// line asks for one of them, it is run, the FrameStats report is logged and its exit code returned. Otherwise nothing
+// happens and nullopt is returned.
+//
+// NOTE: This only needs the standard library, so both the application and seethe-bench (the CMake build) use it
+ND std::optional<int> RunHeadlessMode(int argc, char** argv) noexcept;
+}
@@ -0,0 +1,264 @@
+#include "ScalingTest.h"
+#include "HeadlessFrame.h"
+#include "simulation/Simulation.h"
+#include "utils/Benchmark.h"
+#include "utils/Log.h"
+#include "utils/ThreadPool.h"
+
+using namespace DirectX;
+
+namespace seethe
+{
+namespace
+{
+constexpr float TimeStep = 1.0f / 60.0f;
+
+struct ScalingResult
+{
+	SyntheticScene scene;
+	size_t atoms;
+	unsigned int threads;
+	double stepMs;
+	double speedup;
+	double efficiency;
+
+	ND double AtomStepsPerSecond() const noexcept { return static_cast<double>(atoms) * 1000.0 / stepMs; }
+};
+
+// 1, 2, 4, ... and finally 'maxThreads' itself if it is not a power of two
+std::vector<unsigned int> ThreadCounts(unsigned int maxThreads) noexcept
+{
+	std::vector<unsigned int> counts;
+	for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+		counts.push_back(threads);
+	counts.push_back(maxThreads);
+	return counts;
+}
+
+// Median time per step, measured (and logged) by the benchmark harness
+double MeasureStepMs(BenchmarkSuite& suite, std::string_view name, Simulation& simulation) noexcept
+{
+	HeadlessFrame frame(simulation);
+	simulation.StartPlaying();
+	suite.Run(name, std::as_const(simulation).GetAtoms().size(), [&frame, &simulation]() { frame.Step(simulation, TimeStep); });
+	simulation.StopPlaying();
+	return suite.GetResults().back().medianMs;
+}
+
+void LogTable(std::string_view title, std::span<const ScalingResult> results) noexcept
+{
+	LOG_INFO("{}", title);
+	LOG_INFO("  {:>7} | {:>10} | {:>10} | {:>12} | {:>7} | {:>10}", "threads", "atoms", "ms/step", "atom-steps/s", "speedup", "efficiency");
+	for (const ScalingResult& result : results)
+	{
+		LOG_INFO("  {:>7} | {:>10} | {:>10.3f} | {:>12.4e} | {:>7.2f} | {:>9.1f}%",
+			result.threads, result.atoms, result.stepMs, result.AtomStepsPerSecond(), result.speedup, result.efficiency * 100.0);
+	}
+}
+
+json ToJson(std::span<const ScalingResult> results) noexcept
+{
+	json array = json::array();
+	for (const ScalingResult& result : results)
+	{
+		array.push_back({
+			{ "Scene", SyntheticSceneNames[static_cast<size_t>(result.scene)] },
+			{ "Atoms", result.atoms },
+			{ "Threads", result.threads },
+			{ "StepMs", result.stepMs },
+			{ "AtomStepsPerSecond", result.AtomStepsPerSecond() },
+			{ "Speedup", result.speedup },
+			{ "Efficiency", result.efficiency }
+		});
+	}
+	return array;
+}
+}
+
+void GenerateScene(Simulation& simulation, SyntheticScene scene, size_t atomCount, std::mt19937& rng) noexcept
+{
+	constexpr float maxRadius = AtomicRadii.back();
+	constexpr AtomType largestType = static_cast<AtomType>(AtomTypeCount);
+	const float count = static_cast<float>(std::max<size_t>(atomCount, 1));
+
+	std::uniform_int_distribution<int> typeDist(1, static_cast<int>(AtomTypeCount));
+	std::uniform_real_distribution<float> unitDist(-1.0f, 1.0f);
+	std::normal_distribution<float> thermalDist(0.0f, 0.5f);
+
+	std::vector<AtomTPV> atoms;
+	atoms.reserve(atomCount);
+	float length = 0.0f;
+
+	switch (scene)
+	{
+	case SyntheticScene::UNIFORM_GAS:
+	{
+		// About one atom per 64 cubic units
+		length = std::max(20.0f, 4.0f * std::cbrt(count));
+		for (size_t iii = 0; iii < atomCount; ++iii)
+		{
+			atoms.emplace_back(static_cast<AtomType>(typeDist(rng)),
+				XMFLOAT3{ unitDist(rng) * length / 2.0f, unitDist(rng) * length / 2.0f, unitDist(rng) * length / 2.0f },
+				XMFLOAT3{ unitDist(rng) * 5.0f, unitDist(rng) * 5.0f, unitDist(rng) * 5.0f });
+		}
+		break;
+	}
+	case SyntheticScene::DENSE_LATTICE:
+	{
+		const float spacing = 2.0f * maxRadius + 0.1f;
+		const size_t side = static_cast<size_t>(std::ceil(std::cbrt(count)));
+		length = static_cast<float>(side) * spacing;
+		for (size_t iii = 0; iii < atomCount; ++iii)
+		{
+			const auto coordinate = [&](size_t cell) { return -length / 2.0f + spacing * (static_cast<float>(cell) + 0.5f); };
+			atoms.emplace_back(static_cast<AtomType>(typeDist(rng)),
+				XMFLOAT3{ coordinate(iii % side), coordinate(iii / side % side), coordinate(iii / (side * side)) },
+				XMFLOAT3{ thermalDist(rng), thermalDist(rng), thermalDist(rng) });
+		}
+		break;
+	}
+	case SyntheticScene::CLUSTERED_DROPLETS:
+	{
+		// Droplets of ~5000 atoms at close to lattice density (~8 cubic units per atom) that together fill about 5% of
+		// the box. Each droplet drifts as a whole, plus some thermal motion
+		const size_t dropletCount = std::max<size_t>(1, atomCount / 5000);
+		const float dropletRadius = std::cbrt(3.0f * (count / static_cast<float>(dropletCount)) * 8.0f / (4.0f * XM_PI));
+		length = std::max(4.0f * dropletRadius, std::cbrt(20.0f * 8.0f * count));
+
+		const float centerRange = std::max(0.0f, length / 2.0f - dropletRadius);
+		std::vector<std::pair<XMFLOAT3, XMFLOAT3>> droplets(dropletCount);
+		for (auto& [center, drift] : droplets)
+		{
+			center = { unitDist(rng) * centerRange, unitDist(rng) * centerRange, unitDist(rng) * centerRange };
+			drift = { unitDist(rng), unitDist(rng), unitDist(rng) };
+		}
+
+		for (size_t iii = 0; iii < atomCount; ++iii)
+		{
+			const auto& [center, drift] = droplets[iii % dropletCount];
+
+			// Uniform inside the sphere: a random direction and a radius that grows with the cube root
+			XMFLOAT3 offset;
+			XMStoreFloat3(&offset, XMVectorScale(XMVector3Normalize(XMVectorSet(thermalDist(rng), thermalDist(rng), thermalDist(rng), 0.0f)),
+				dropletRadius * std::cbrt((unitDist(rng) + 1.0f) / 2.0f)));
+
+			atoms.emplace_back(static_cast<AtomType>(typeDist(rng)),
+				XMFLOAT3{ center.x + offset.x, center.y + offset.y, center.z + offset.z },
+				XMFLOAT3{ drift.x + thermalDist(rng), drift.y + thermalDist(rng), drift.z + thermalDist(rng) });
+		}
+		break;
+	}
+	case SyntheticScene::SIZE_DISPARITY:
+	{
+		// 90% of the smallest type and 10% of the largest, at moderate density. The largest atoms dominate the grid
+		// cell size, so the small ones end up many to a cell
+		std::bernoulli_distribution largeDist(0.1);
+		length = std::max(20.0f, 3.0f * std::cbrt(count));
+		for (size_t iii = 0; iii < atomCount; ++iii)
+		{
+			atoms.emplace_back(largeDist(rng) ? largestType : AtomType::HYDROGEN,
+				XMFLOAT3{ unitDist(rng) * length / 2.0f, unitDist(rng) * length / 2.0f, unitDist(rng) * length / 2.0f },
+				XMFLOAT3{ unitDist(rng) * 5.0f, unitDist(rng) * 5.0f, unitDist(rng) * 5.0f });
+		}
+		break;
+	}
+	case SyntheticScene::COUNT:
+		ASSERT(false, "COUNT is not a scene");
+		break;
+	}
+
+	// Nothing may start outside the box
+	const float limit = length / 2.0f - maxRadius;
+	for (AtomTPV& atom : atoms)
+	{
+		atom.position.x = std::clamp(atom.position.x, -limit, limit);
+		atom.position.y = std::clamp(atom.position.y, -limit, limit);
+		atom.position.z = std::clamp(atom.position.z, -limit, limit);
+	}
+
+	simulation.SetAtoms(AtomStore{});
+	simulation.SetDimensions(length);
+	simulation.AddAtoms(atoms);
+	simulation.DispatchEvents();
+}
+
+int RunScalingTest(const ScalingTestOptions& options) noexcept
+{
+	ThreadPool& pool = ThreadPool::Get();
+	const unsigned int initialThreadCount = pool.GetThreadCount();
+	const std::vector<unsigned int> threadCounts = ThreadCounts(std::max(1u, options.maxThreads));
+
+	LOG_INFO("Scaling test: {} atoms (strong), {} atoms per thread (weak), up to {} threads", options.atomCount, options.atomsPerThread, threadCounts.back());
+
+	BenchmarkSuite suite("");
+	std::vector<ScalingResult> strong;
+	std::vector<ScalingResult> weak;
+	Simulation simulation;
+
+	for (size_t sceneIndex = 0; sceneIndex < SyntheticSceneCount; ++sceneIndex)
+	{
+		const SyntheticScene scene = static_cast<SyntheticScene>(sceneIndex);
+		const std::string_view sceneName = SyntheticSceneNames[sceneIndex];
+
+		// Strong scaling - every thread count starts from the same atoms
+		std::mt19937 rng = BenchmarkSuite::MakeRng();
+		GenerateScene(simulation, scene, options.atomCount, rng);
+		const AtomStore initial = simulation.SnapshotAtoms();
+
+		const size_t strongFirst = strong.size();
+		for (unsigned int threads : threadCounts)
+		{
+			pool.SetThreadCount(threads);
+			simulation.SetAtoms(initial);
+
+			const double stepMs = MeasureStepMs(suite, std::format("Strong/{}/{} threads", sceneName, threads), simulation);
+			const double speedup = strong.size() > strongFirst ? strong[strongFirst].stepMs / stepMs : 1.0;
+			strong.push_back({ scene, options.atomCount, threads, stepMs, speedup, speedup / threads });
+		}
+
+		// Weak scaling - the scene grows with the thread count
+		const size_t weakFirst = weak.size();
+		for (unsigned int threads : threadCounts)
+		{
+			pool.SetThreadCount(threads);
+			rng = BenchmarkSuite::MakeRng();
+			GenerateScene(simulation, scene, options.atomsPerThread * threads, rng);
+
+			const double stepMs = MeasureStepMs(suite, std::format("Weak/{}/{} threads", sceneName, threads), simulation);
+			const double efficiency = weak.size() > weakFirst ? weak[weakFirst].stepMs / stepMs : 1.0;
+			weak.push_back({ scene, options.atomsPerThread * threads, threads, stepMs, efficiency * threads, efficiency });
+		}
+
+		LogTable(std::format("Strong scaling: {}, {} atoms", sceneName, options.atomCount), std::span(strong).subspan(strongFirst));
+		LogTable(std::format("Weak scaling: {}, {} atoms per thread", sceneName, options.atomsPerThread), std::span(weak).subspan(weakFirst));
+	}
+
+	pool.SetThreadCount(initialThreadCount);
+
+	const json results = {
+		{ "Context", {
+			{ "Date", std::format("{:%F %T}", std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now())) },
+#if defined(DEBUG)
+			{ "Build", "Debug" },
+#else
+			{ "Build", "Release" },
+#endif
+			{ "HardwareThreads", std::thread::hardware_concurrency() },
+			{ "Seed", BenchmarkSuite::Seed },
+			{ "TimeStep", TimeStep }
+		} },
+		{ "StrongScaling", ToJson(strong) },
+		{ "WeakScaling", ToJson(weak) }
+	};
+
+	std::ofstream file(options.outputPath);
+	if (!file.is_open())
+	{
+		LOG_ERROR("Failed to open scaling test output file '{}'", options.outputPath.string());
+		return 1;
+	}
+	file << results.dump(4) << '\n';
+	LOG_INFO("Scaling test results written to '{}'", options.outputPath.string());
+	return 0;
+}
+}
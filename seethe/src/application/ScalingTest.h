@@ -0,0 +1,43 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+class Simulation;
+
+enum class SyntheticScene
+{
+	UNIFORM_GAS,		// Random positions and velocities, sparse
+	DENSE_LATTICE,		// A simple cubic lattice with the atoms almost touching, slow thermal motion
+	CLUSTERED_DROPLETS,	// Dense droplets of atoms scattered through a mostly empty box
+	SIZE_DISPARITY,		// Mostly the smallest atom type with a few of the largest
+	COUNT
+};
+constexpr size_t SyntheticSceneCount = static_cast<size_t>(SyntheticScene::COUNT);
+constexpr std::array<std::string_view, SyntheticSceneCount> SyntheticSceneNames = { "uniform gas", "dense lattice", "clustered droplets", "size disparity" };
+
+// Replaces the contents of the simulation with 'atomCount' atoms laid out like 'scene' (and sizes the box to fit)
+void GenerateScene(Simulation& simulation, SyntheticScene scene, size_t atomCount, std::mt19937& rng) noexcept;
+
+struct ScalingTestOptions
+{
+	size_t atomCount = 200'000;				// Strong scaling: the same scene at every thread count
+	size_t atomsPerThread = 50'000;			// Weak scaling: the scene grows with the thread count
+	unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	std::filesystem::path outputPath = "scaling-results.json";
+};
+
+// End-to-end scaling curves for sizing hardware. Each synthetic scene is played through the same per-frame CPU work
+// the simulation window does while the simulation is playing (step the simulation, update the spatial index, then
+// cull, depth sort, occlusion cull, select LODs, update the ambient occlusion and pack the instance data) with the
+// shared ThreadPool limited to 1, 2, 4, ... maxThreads threads:
+//
+//   - Strong scaling: the same 'atomCount' atoms at every thread count. Efficiency = T(1) / (threads * T(threads))
+//   - Weak scaling:   'atomsPerThread' atoms per thread. Efficiency = T(1) / T(threads)
+//
+// Reports the time per step, atom-steps per second, speedup and parallel efficiency as tables in the log and as JSON
+// written to 'outputPath'. Nothing here creates a window or touches the GPU. Returns the process exit code.
+// Run it by starting the application with
+//     --scaling-test [atom count] [--scaling-threads <max threads>] [--scaling-out <path>]
+ND int RunScalingTest(const ScalingTestOptions& options) noexcept;
+}
@@ -29,6 +29,7 @@ public:
 
 	void Undo(Application* app) noexcept override;
 	void Redo(Application* app) noexcept override;
+	ND size_t GetMemoryUsage() const noexcept override { return sizeof(*this) + m_atomData.capacity() * sizeof(AtomTPV); }
 
 private:
 	std::vector<AtomTPV> m_atomData;
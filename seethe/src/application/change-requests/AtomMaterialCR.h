@@ -22,6 +22,7 @@ public:
 
 	void Undo(Application* app) noexcept override;
 	void Redo(Application* app) noexcept override;
+	ND size_t GetMemoryUsage() const noexcept override { return sizeof(*this); }
 
 	Material m_materialInitial;
 	Material m_materialFinal;
@@ -6,12 +6,10 @@ namespace seethe
 {
 void AtomVelocityCR::Undo(Application* app) noexcept
 {
-	Atom& atom = app->GetSimulation().GetAtom(m_index);
-	atom.velocity = m_velocityInitial;
+	app->GetSimulation().SetAtomVelocity(m_index, m_velocityInitial);
 }
 void AtomVelocityCR::Redo(Application* app) noexcept
 {
-	Atom& atom = app->GetSimulation().GetAtom(m_index);
-	atom.velocity = m_velocityFinal;
+	app->GetSimulation().SetAtomVelocity(m_index, m_velocityFinal);
 }
 }
\ No newline at end of file
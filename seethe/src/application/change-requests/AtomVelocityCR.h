@@ -21,6 +21,7 @@ public:
 
 	void Undo(Application* app) noexcept override;
 	void Redo(Application* app) noexcept override;
+	ND size_t GetMemoryUsage() const noexcept override { return sizeof(*this); }
 
 	DirectX::XMFLOAT3 m_velocityInitial;
 	DirectX::XMFLOAT3 m_velocityFinal;
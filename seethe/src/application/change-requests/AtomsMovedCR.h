@@ -26,6 +26,7 @@ public:
 
 	void Undo(Application* app) noexcept override;
 	void Redo(Application* app) noexcept override;
+	ND size_t GetMemoryUsage() const noexcept override { return sizeof(*this) + m_indices.capacity() * sizeof(size_t); }
 
 	DirectX::XMFLOAT3 m_positionInitial;
 	DirectX::XMFLOAT3 m_positionFinal;
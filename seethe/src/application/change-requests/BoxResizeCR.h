@@ -10,7 +10,7 @@ class BoxResizeCR : public ChangeRequest
 public:
 	BoxResizeCR(const DirectX::XMFLOAT3& initial, const DirectX::XMFLOAT3& final, bool allowRelocation, 
 		bool forceSidesToBeEqualInitial, bool forceSidesToBeEqualFinal,
-		const std::vector<Atom>& atomsInitial = {}, const std::vector<Atom>& atomsFinal = {}) noexcept :
+		const AtomStore& atomsInitial = {}, const AtomStore& atomsFinal = {}) noexcept :
 		m_initial(initial), m_final(final), m_allowAtomsToRelocate(allowRelocation), 
 		m_forceSidesToBeEqualInitial(forceSidesToBeEqualInitial),
 		m_forceSidesToBeEqualFinal(forceSidesToBeEqualFinal),
@@ -25,6 +25,7 @@ public:
 
 	void Undo(Application* app) noexcept override;
 	void Redo(Application* app) noexcept override;
+	ND size_t GetMemoryUsage() const noexcept override { return sizeof(*this) + m_atomsInitial.ChunkBytes() + m_atomsFinal.ChunkBytes(); }
 
 	DirectX::XMFLOAT3 m_initial;
 	DirectX::XMFLOAT3 m_final;
@@ -32,7 +33,7 @@ public:
 	bool m_forceSidesToBeEqualInitial;
 	bool m_forceSidesToBeEqualFinal;
 	
-	std::vector<Atom> m_atomsInitial;
-	std::vector<Atom> m_atomsFinal;
+	AtomStore m_atomsInitial;
+	AtomStore m_atomsFinal;
 };
 }
\ No newline at end of file
@@ -16,5 +16,9 @@ public:
 
 	virtual void Undo(Application*) noexcept = 0;
 	virtual void Redo(Application*) noexcept = 0;
+
+	// Approximate bytes held by this change request, including what it owns (for the undo stack metrics). Atom chunks
+	// that are shared with the simulation or with other change requests are counted by each of them
+	ND virtual size_t GetMemoryUsage() const noexcept = 0;
 };
 }
\ No newline at end of file
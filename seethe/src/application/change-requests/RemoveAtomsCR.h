@@ -29,6 +29,7 @@ public:
 
 	void Undo(Application* app) noexcept override;
 	void Redo(Application* app) noexcept override;
+	ND size_t GetMemoryUsage() const noexcept override { return sizeof(*this) + m_indicesAndData.capacity() * sizeof(std::tuple<size_t, AtomTPV>); }
 
 private:
 	std::vector<std::tuple<size_t, AtomTPV>> m_indicesAndData;
@@ -9,7 +9,7 @@ void SimulationPlayCR::Undo(Application* app) noexcept
 	Simulation& simulation = app->GetSimulation();
 
 	// First, keep track of where the atoms currently are
-	m_final = simulation.GetAtoms();
+	m_final = simulation.SnapshotAtoms();
 
 	// Replace all atoms to their initial locations
 	simulation.SetAtoms(m_initial);
@@ -8,7 +8,7 @@ namespace seethe
 class SimulationPlayCR : public ChangeRequest
 {
 public:
-	SimulationPlayCR(const std::vector<Atom>& initial, const std::vector<Atom> & final = {}) noexcept :
+	SimulationPlayCR(const AtomStore& initial, const AtomStore& final = {}) noexcept :
 		m_initial(initial), m_final(final)
 	{}
 	SimulationPlayCR(const SimulationPlayCR&) noexcept = default;
@@ -19,8 +19,9 @@ public:
 
 	void Undo(Application* app) noexcept override;
 	void Redo(Application* app) noexcept override;
+	ND size_t GetMemoryUsage() const noexcept override { return sizeof(*this) + m_initial.ChunkBytes() + m_final.ChunkBytes(); }
 
-	std::vector<Atom> m_initial;
-	std::vector<Atom> m_final;
+	AtomStore m_initial;
+	AtomStore m_final;
 };
 }
\ No newline at end of file
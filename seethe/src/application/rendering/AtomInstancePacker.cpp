@@ -0,0 +1,53 @@
+#include "AtomInstancePacker.h"
+
+using namespace DirectX;
+
+namespace seethe
+{
+void PackAtomInstances(const AtomStore& atoms, std::span<const std::uint8_t> ambientAccess, std::span<const std::uint32_t> indices, std::span<AtomInstanceData> output) noexcept
+{
+	ASSERT(output.size() >= indices.size(), "Output is too small");
+	ASSERT(ambientAccess.size() >= atoms.size(), "Missing ambient occlusion values");
+
+	// Minus one because Hydrogen = 1 but its material is at index 0, etc
+	auto MaterialOf = [](const Atom& atom) -> std::uint32_t { return static_cast<std::uint32_t>(atom.type) - 1; };
+	auto LowBitsOf = [&](std::uint32_t index) -> std::uint32_t
+		{
+			return (static_cast<std::uint32_t>(ambientAccess[index]) << AtomInstanceData::AmbientAccessShift) | MaterialOf(atoms[index]);
+		};
+
+	const XMVECTOR radiusMask = XMVectorReplicateInt(AtomInstanceData::RadiusMask);
+	const XMVECTOR selectW = XMVectorSelectControl(0, 0, 0, 1);
+
+	auto Store = [&](const Atom& atom, FXMVECTOR radiusAndMaterial, AtomInstanceData& record)
+		{
+			// xyz come from the position and w from the packed radius/material vector (which has been splatted)
+			XMVECTOR packed = XMVectorSelect(XMLoadFloat3(&atom.position), radiusAndMaterial, selectW);
+			XMStoreFloat4A(reinterpret_cast<XMFLOAT4A*>(&record), packed);
+		};
+
+	size_t iii = 0;
+	for (; iii + 4 <= indices.size(); iii += 4)
+	{
+		const Atom& a = atoms[indices[iii]];
+		const Atom& b = atoms[indices[iii + 1]];
+		const Atom& c = atoms[indices[iii + 2]];
+		const Atom& d = atoms[indices[iii + 3]];
+
+		XMVECTOR radii = XMVectorSet(a.radius, b.radius, c.radius, d.radius);
+		XMVECTOR lowBits = XMVectorSetInt(LowBitsOf(indices[iii]), LowBitsOf(indices[iii + 1]), LowBitsOf(indices[iii + 2]), LowBitsOf(indices[iii + 3]));
+		XMVECTOR radiusAndMaterial = XMVectorOrInt(XMVectorAndInt(radii, radiusMask), lowBits);
+
+		Store(a, XMVectorSplatX(radiusAndMaterial), output[iii]);
+		Store(b, XMVectorSplatY(radiusAndMaterial), output[iii + 1]);
+		Store(c, XMVectorSplatZ(radiusAndMaterial), output[iii + 2]);
+		Store(d, XMVectorSplatW(radiusAndMaterial), output[iii + 3]);
+	}
+
+	for (; iii < indices.size(); ++iii)
+	{
+		const Atom& atom = atoms[indices[iii]];
+		output[iii] = PackAtomInstance(atom.position, atom.radius, MaterialOf(atom), ambientAccess[indices[iii]]);
+	}
+}
+}
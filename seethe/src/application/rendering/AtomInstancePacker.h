@@ -0,0 +1,23 @@
+#pragma once
+#include "pch.h"
+#include "application/rendering/InstanceData.h"
+#include "simulation/Atom.h"
+#include "utils/Log.h"
+
+namespace seethe
+{
+// Packs a single atom instance. Used for the instances that do not come straight from the atom store (i.e. the
+// selection outline, which inflates the radius)
+ND inline AtomInstanceData PackAtomInstance(const DirectX::XMFLOAT3& position, float radius, std::uint32_t materialIndex, std::uint8_t ambientAccess = 255) noexcept
+{
+	ASSERT(materialIndex <= AtomInstanceData::MaterialMask, "Material index does not fit in the packed radius");
+	return { position, (std::bit_cast<std::uint32_t>(radius) & AtomInstanceData::RadiusMask) |
+		(static_cast<std::uint32_t>(ambientAccess) << AtomInstanceData::AmbientAccessShift) | materialIndex };
+}
+
+// Writes the compact instance record for each of the atoms in 'indices' to 'output' (which must be at least as large
+// as 'indices'). Four atoms are packed per iteration: the radius/material/occlusion words for all four are built with
+// a single vector AND/OR, and each record is then written with one 16 byte store.
+// 'ambientAccess' holds one ambient occlusion byte per atom (indexed like the atom store, see AtomAmbientOcclusion)
+void PackAtomInstances(const AtomStore& atoms, std::span<const std::uint8_t> ambientAccess, std::span<const std::uint32_t> indices, std::span<AtomInstanceData> output) noexcept;
+}
@@ -11,4 +11,21 @@ struct InstanceData
 	std::uint32_t Pad1;
 	std::uint32_t Pad2;
 };
+
+// Compact instance data for atoms (16 bytes vs. 80 for InstanceData). The vertex shader expands the position and
+// radius into the world transform, so there is no per-atom matrix math on the CPU.
+// The low 13 bits of the radius' mantissa are reused: bits 0-4 hold the material index and bits 5-12 the ambient
+// occlusion byte (see AtomAmbientOcclusion). That changes the radius by less than 0.1%, which is not visible, and
+// saves having to pad the struct out to 32 bytes
+struct alignas(16) AtomInstanceData
+{
+	DirectX::XMFLOAT3 Position;
+	std::uint32_t RadiusAndMaterial;
+
+	static constexpr std::uint32_t MaterialMask = 0x1F;
+	static constexpr std::uint32_t AmbientAccessShift = 5;
+	static constexpr std::uint32_t AmbientAccessMask = 0xFF << AmbientAccessShift;
+	static constexpr std::uint32_t RadiusMask = ~(MaterialMask | AmbientAccessMask);
+};
+static_assert(sizeof(AtomInstanceData) == 16);
 }
\ No newline at end of file
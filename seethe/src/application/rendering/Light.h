@@ -1,5 +1,6 @@
 #pragma once
 #include "pch.h"
+#include "utils/Log.h"
 
 namespace seethe
 {
@@ -31,20 +32,27 @@ public:
 
 	ND constexpr Light& GetDirectionalLight(size_t index) noexcept
 	{
-		ASSERT(index >= 0 && index < m_numDirectionalLights, "Invalid index");
+		ASSERT(index < m_numDirectionalLights, "Invalid index");
 		return m_lights[index];
 	}
 	ND constexpr Light& GetPointLight(size_t index) noexcept
 	{
-		ASSERT(index >= 0 && index < m_numPointLights, "Invalid index");
+		ASSERT(index < m_numPointLights, "Invalid index");
 		return m_lights[m_numDirectionalLights + index];
 	}
 	ND constexpr Light& GetSpotLight(size_t index) noexcept
 	{
-		ASSERT(index >= 0 && index < m_numSpotLights, "Invalid index");
+		ASSERT(index < m_numSpotLights, "Invalid index");
 		return m_lights[index + m_numDirectionalLights + m_numPointLights];
 	}
 
+	// Read-only access by absolute index (directional lights first, then point lights, then spot lights)
+	ND constexpr const Light& GetLight(size_t index) const noexcept
+	{
+		ASSERT(index < static_cast<size_t>(m_numDirectionalLights) + m_numPointLights + m_numSpotLights, "Invalid index");
+		return m_lights[index];
+	}
+
 	constexpr void AddDirectionalLight(const DirectX::XMFLOAT3& strength, const DirectX::XMFLOAT3& direction) noexcept
 	{
 		MoveSpotLightsBack();
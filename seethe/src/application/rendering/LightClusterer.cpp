@@ -0,0 +1,167 @@
+#include "LightClusterer.h"
+#include "utils/Log.h"
+#include "utils/ThreadPool.h"
+
+using namespace DirectX;
+
+namespace seethe
+{
+LightClusterer::LightClusterer() noexcept :
+	m_clusterLights(ClusterCount),
+	m_clusters(ClusterCount)
+{
+}
+
+bool LightClusterer::Update(const SceneLighting& lighting, FXMMATRIX view, float fovY, float aspect, float nearZ, float farZ) noexcept
+{
+	ASSERT(nearZ > 0.0f && farZ > nearZ, "Invalid depth range");
+
+	ClusterFrustum frustum;
+	XMStoreFloat4x4(&frustum.view, view);
+	frustum.tanHalfFovY = std::tan(0.5f * fovY);
+	frustum.tanHalfFovX = frustum.tanHalfFovY * aspect;
+	frustum.nearZ = nearZ;
+	frustum.farZ = farZ;
+
+	// If the slices themselves moved (or the lights were shuffled around because a directional light was added),
+	// every cluster has to be rebuilt
+	bool allDirty = false;
+	for (unsigned int slice = 0; slice <= ClusterCountZ; ++slice)
+	{
+		const float depth = nearZ * std::pow(farZ / nearZ, static_cast<float>(slice) / ClusterCountZ);
+		allDirty |= depth != m_sliceDepths[slice];
+		m_sliceDepths[slice] = depth;
+	}
+
+	const std::uint32_t firstLight = lighting.NumDirectionalLights();
+	const size_t lightCount = static_cast<size_t>(lighting.NumPointLights()) + lighting.NumSpotLights();
+	allDirty |= firstLight != m_firstLight || lightCount != m_bounds.size();
+	m_firstLight = firstLight;
+
+	std::swap(m_bounds, m_previousBounds);
+	m_bounds.resize(lightCount);
+
+	ThreadPool::Get().ParallelFor(lightCount, 64, [&](size_t begin, size_t end)
+		{
+			for (size_t iii = begin; iii < end; ++iii)
+				m_bounds[iii] = ComputeBounds(lighting.GetLight(firstLight + iii), frustum);
+		}
+	);
+
+	// A slice only needs to be rebinned if some light covers a different set of tiles in it than last frame
+	bool anyDirty = false;
+	for (unsigned int slice = 0; slice < ClusterCountZ; ++slice)
+	{
+		bool dirty = allDirty;
+		for (size_t iii = 0; iii < lightCount && !dirty; ++iii)
+			dirty = m_bounds[iii][slice] != m_previousBounds[iii][slice];
+
+		m_dirtySlices[slice] = dirty;
+		anyDirty |= dirty;
+	}
+
+	if (!anyDirty)
+		return false;
+
+	ThreadPool::Get().ParallelFor(ClusterCountZ, 1, [this](size_t begin, size_t end)
+		{
+			for (size_t slice = begin; slice < end; ++slice)
+			{
+				if (m_dirtySlices[slice])
+					BinSlice(static_cast<unsigned int>(slice));
+			}
+		}
+	);
+
+	Flatten();
+	return true;
+}
+
+LightClusterer::LightBounds LightClusterer::ComputeBounds(const Light& light, const ClusterFrustum& frustum) const noexcept
+{
+	LightBounds bounds = {};
+
+	const XMFLOAT4X4& v = frustum.view;
+	const XMFLOAT3& p = light.Position;
+	const float cx = p.x * v._11 + p.y * v._21 + p.z * v._31 + v._41;
+	const float cy = p.x * v._12 + p.y * v._22 + p.z * v._32 + v._42;
+	const float cz = p.x * v._13 + p.y * v._23 + p.z * v._33 + v._43;
+
+	// NOTE: Spot lights also use the full sphere. The shader has no cone cutoff (the spot factor only fades the light
+	//       out), so the only hard limit on a spot light's reach is FalloffEnd
+	const float r = light.FalloffEnd;
+	if (r <= 0.0f || cz + r <= frustum.nearZ || cz - r >= frustum.farZ)
+		return bounds;
+
+	for (unsigned int slice = 0; slice < ClusterCountZ; ++slice)
+	{
+		const float zlo = std::max(m_sliceDepths[slice], cz - r);
+		const float zhi = std::min(m_sliceDepths[slice + 1], cz + r);
+		if (zlo >= zhi)
+			continue;
+
+		// Radius of the largest cross section of the sphere within [zlo, zhi]
+		const float dz = cz < zlo ? zlo - cz : (cz > zhi ? cz - zhi : 0.0f);
+		const float rxy = std::sqrt(std::max(r * r - dz * dz, 0.0f));
+
+		// Project the cross section's extents. Each edge is projected at whichever end of the depth range pushes it
+		// further out, so the rectangle is conservative
+		const float left = cx - rxy;
+		const float right = cx + rxy;
+		const float bottom = cy - rxy;
+		const float top = cy + rxy;
+
+		const float ndcLeft = left / ((left < 0.0f ? zlo : zhi) * frustum.tanHalfFovX);
+		const float ndcRight = right / ((right > 0.0f ? zlo : zhi) * frustum.tanHalfFovX);
+		const float ndcBottom = bottom / ((bottom < 0.0f ? zlo : zhi) * frustum.tanHalfFovY);
+		const float ndcTop = top / ((top > 0.0f ? zlo : zhi) * frustum.tanHalfFovY);
+
+		if (ndcRight < -1.0f || ndcLeft > 1.0f || ndcTop < -1.0f || ndcBottom > 1.0f)
+			continue;
+
+		// Tile rows are counted from the top of the screen
+		auto toTile = [](float t, unsigned int count)
+			{
+				return static_cast<std::uint8_t>(std::clamp(static_cast<int>(std::floor(t * count)), 0, static_cast<int>(count) - 1));
+			};
+
+		TileRect& rect = bounds[slice];
+		rect.x0 = toTile(0.5f + 0.5f * ndcLeft, ClusterCountX);
+		rect.x1 = toTile(0.5f + 0.5f * ndcRight, ClusterCountX);
+		rect.y0 = toTile(0.5f - 0.5f * ndcTop, ClusterCountY);
+		rect.y1 = toTile(0.5f - 0.5f * ndcBottom, ClusterCountY);
+	}
+
+	return bounds;
+}
+
+void LightClusterer::BinSlice(unsigned int slice) noexcept
+{
+	const size_t first = static_cast<size_t>(slice) * ClusterCountX * ClusterCountY;
+	for (size_t cluster = first; cluster < first + ClusterCountX * ClusterCountY; ++cluster)
+		m_clusterLights[cluster].clear();
+
+	for (size_t iii = 0; iii < m_bounds.size(); ++iii)
+	{
+		const TileRect& rect = m_bounds[iii][slice];
+		if (rect.IsEmpty())
+			continue;
+
+		const std::uint32_t lightIndex = m_firstLight + static_cast<std::uint32_t>(iii);
+		for (unsigned int y = rect.y0; y <= rect.y1; ++y)
+			for (unsigned int x = rect.x0; x <= rect.x1; ++x)
+				m_clusterLights[first + y * ClusterCountX + x].push_back(lightIndex);
+	}
+}
+
+void LightClusterer::Flatten() noexcept
+{
+	m_lightIndices.clear();
+	for (size_t cluster = 0; cluster < ClusterCount; ++cluster)
+	{
+		const std::vector<std::uint32_t>& lights = m_clusterLights[cluster];
+		m_clusters[cluster] = { static_cast<std::uint32_t>(m_lightIndices.size()), static_cast<std::uint32_t>(lights.size()) };
+		m_lightIndices.insert(m_lightIndices.end(), lights.begin(), lights.end());
+	}
+}
+}
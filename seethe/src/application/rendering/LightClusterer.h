@@ -0,0 +1,94 @@
+#pragma once
+#include "pch.h"
+#include "application/rendering/Light.h"
+
+namespace seethe
+{
+// Offset/count into the light index list for a single cluster (matches 'uint2' in the pixel shader)
+struct LightCluster
+{
+	std::uint32_t Offset = 0;
+	std::uint32_t Count = 0;
+};
+
+// LightClusterer does clustered light culling on the CPU. The view frustum is split into a grid of "froxels":
+// ClusterCountX x ClusterCountY screen tiles, each split into ClusterCountZ depth slices that grow exponentially with
+// distance (so near slices are thin and far slices are deep). Every point/spot light is binned into the clusters its
+// range overlaps, and the result is a compact list of light indices per cluster. The pixel shader looks up the cluster
+// it is in and only shades those lights (plus the directional lights, which affect everything).
+//
+// Lights are bounded by a sphere of radius FalloffEnd (the shaders contribute nothing beyond it). The bounds of each
+// light are kept per depth slice from frame to frame, and only the slices where some light's tile rectangle actually
+// changed are rebinned (in parallel, one slice per task). With a static camera and static lights, Update() does not
+// rebin anything and reports that nothing changed.
+class LightClusterer
+{
+public:
+	static constexpr unsigned int ClusterCountX = 16;
+	static constexpr unsigned int ClusterCountY = 9;
+	static constexpr unsigned int ClusterCountZ = 24;
+	static constexpr size_t ClusterCount = static_cast<size_t>(ClusterCountX) * ClusterCountY * ClusterCountZ;
+
+	LightClusterer() noexcept;
+	LightClusterer(const LightClusterer&) noexcept = default;
+	LightClusterer(LightClusterer&&) noexcept = default;
+	LightClusterer& operator=(const LightClusterer&) noexcept = default;
+	LightClusterer& operator=(LightClusterer&&) noexcept = default;
+	~LightClusterer() noexcept = default;
+
+	// Returns true if the cluster data changed since the previous call
+	bool Update(const SceneLighting& lighting, DirectX::FXMMATRIX view, float fovY, float aspect, float nearZ, float farZ) noexcept;
+
+	// Clusters are ordered x fastest, then y (top row first), then depth slice
+	ND constexpr const std::vector<LightCluster>& GetClusters() const noexcept { return m_clusters; }
+	ND constexpr const std::vector<std::uint32_t>& GetLightIndices() const noexcept { return m_lightIndices; }
+
+	// The depth slice for a view space depth z is floor(log(z) * scale + bias)
+	ND static inline float DepthSliceScale(float nearZ, float farZ) noexcept { return ClusterCountZ / std::log(farZ / nearZ); }
+	ND static inline float DepthSliceBias(float nearZ, float farZ) noexcept { return -std::log(nearZ) * DepthSliceScale(nearZ, farZ); }
+
+private:
+	// Tile rectangle (inclusive) covered by a light within one depth slice. An empty rectangle has x0 > x1
+	struct TileRect
+	{
+		std::uint8_t x0 = 1;
+		std::uint8_t x1 = 0;
+		std::uint8_t y0 = 1;
+		std::uint8_t y1 = 0;
+
+		ND constexpr bool IsEmpty() const noexcept { return x0 > x1; }
+		ND constexpr bool operator==(const TileRect&) const noexcept = default;
+	};
+	using LightBounds = std::array<TileRect, ClusterCountZ>;
+
+	struct ClusterFrustum
+	{
+		DirectX::XMFLOAT4X4 view;
+		float tanHalfFovX;
+		float tanHalfFovY;
+		float nearZ;
+		float farZ;
+	};
+
+	ND LightBounds ComputeBounds(const Light& light, const ClusterFrustum& frustum) const noexcept;
+	void BinSlice(unsigned int slice) noexcept;
+	void Flatten() noexcept;
+
+	// View space depth at which each slice starts (ClusterCountZ + 1 entries, the last one is the far plane)
+	std::array<float, ClusterCountZ + 1> m_sliceDepths = {};
+
+	// Bounds of each point/spot light, for this frame and the previous one
+	std::vector<LightBounds> m_bounds;
+	std::vector<LightBounds> m_previousBounds;
+	std::array<bool, ClusterCountZ> m_dirtySlices = {};
+
+	// Index of the first point light in SceneLighting (light indices in the lists are absolute)
+	std::uint32_t m_firstLight = std::numeric_limits<std::uint32_t>::max();
+
+	// Light indices per cluster (the capacity of each list is kept from frame to frame)
+	std::vector<std::vector<std::uint32_t>> m_clusterLights;
+
+	std::vector<LightCluster> m_clusters;
+	std::vector<std::uint32_t> m_lightIndices;
+};
+}
@@ -21,6 +21,19 @@ struct PassConstants
 	float TotalTime = 0.0f;
 	float DeltaTime = 0.0f;
 
+	// Clustered lighting: the pixel shader maps its position within the viewport to a cluster tile and its view
+	// space depth to a depth slice (slice = log(depth) * ClusterDepthScale + ClusterDepthBias)
+	DirectX::XMFLOAT2 ViewportTopLeft = { 0.0f, 0.0f };
+	DirectX::XMFLOAT2 InvViewportSize = { 0.0f, 0.0f };
+	std::uint32_t ClusterCountX = 1;
+	std::uint32_t ClusterCountY = 1;
+	std::uint32_t ClusterCountZ = 1;
+	float ClusterDepthScale = 0.0f;
+	float ClusterDepthBias = 0.0f;
+	float Pad1 = 0.0f;
+	float Pad2 = 0.0f;
+	float Pad3 = 0.0f;
+
 	//	seethe::SceneLighting Lighting = {};
 
 	//	DirectX::XMFLOAT4 AmbientLight = { 0.0f, 0.0f, 0.0f, 1.0f };
@@ -1,9 +1,12 @@
 #include "SimulationWindow.h"
 #include "application/Application.h"
+#include "application/rendering/AtomInstancePacker.h"
 #include "application/change-requests/AtomsMovedCR.h"
 #include "application/change-requests/BoxResizeCR.h"
 #include "rendering/GeometryGenerator.h"
+#include "utils/AllocationTracker.h"
 #include "utils/Constants.h"
+#include "utils/PerfCounters.h"
 
 using namespace DirectX;
 
@@ -48,7 +51,7 @@ void SimulationWindow::RegisterEventHandlers() noexcept
 
 	// Box Size Changed
 	m_simulation.RegisterBoxSizeChangedHandler(
-		[this]()
+		[this](const ChangedRange&)
 		{
 			OnBoxSizeChanged();
 
@@ -58,9 +61,11 @@ void SimulationWindow::RegisterEventHandlers() noexcept
 	);
 
 	// Atoms Added/Removed/Selected
-	m_simulation.RegisterAtomsAddedHandler([this]() { OnAtomsAdded(); });
-	m_simulation.RegisterAtomsRemovedHandler([this]() { OnAtomsRemoved(); });
-	m_simulation.RegisterSelectedAtomsChangedHandler([this]() { OnSelectedAtomsChanged(); });
+	// NOTE: These are coalesced by the simulation, so each one is invoked at most once per frame no matter how many
+	//       atoms were added/removed/selected during that frame. The range covers all of them
+	m_simulation.RegisterAtomsAddedHandler([this](const ChangedRange& range) { OnAtomsAdded(range); });
+	m_simulation.RegisterAtomsRemovedHandler([this](const ChangedRange& range) { OnAtomsRemoved(range); });
+	m_simulation.RegisterSelectedAtomsChangedHandler([this](const ChangedRange& range) { OnSelectedAtomsChanged(range); });
 
 	// Simulation Play/Paused
 	m_simulation.RegisterSimulationStartedHandler([this]() { OnSimulationPlay(); });
@@ -73,16 +78,27 @@ void SimulationWindow::InitializeRenderPasses()
 	constexpr unsigned int perPassCBRegister = 1;
 	constexpr unsigned int lightingCBRegister = 2;
 	constexpr unsigned int materialsCBRegister = 3;
+	constexpr unsigned int atomInstancesSRVRegister = 0;
+	constexpr unsigned int lightClustersSRVRegister = 1;
+	constexpr unsigned int lightIndicesSRVRegister = 2;
+
+	// Root parameter indices (the CBV's happen to match their registers)
+	constexpr unsigned int atomInstancesRootParameter = 4;
+	constexpr unsigned int lightClustersRootParameter = 5;
+	constexpr unsigned int lightIndicesRootParameter = 6;
 
 	// Root parameter can be a table, root descriptor or root constants.
 	// *** Perfomance TIP: Order from most frequent to least frequent.
-	CD3DX12_ROOT_PARAMETER slotRootParameter[4];
+	CD3DX12_ROOT_PARAMETER slotRootParameter[7];
 	slotRootParameter[0].InitAsConstantBufferView(objectCBRegister);	// Object/Instance Constant Buffer 
 	slotRootParameter[1].InitAsConstantBufferView(perPassCBRegister);	// Per Pass Constants   
 	slotRootParameter[2].InitAsConstantBufferView(lightingCBRegister);	// Lighting Data   
 	slotRootParameter[3].InitAsConstantBufferView(materialsCBRegister);	// Material Constant Buffer
+	slotRootParameter[4].InitAsShaderResourceView(atomInstancesSRVRegister);	// Atom Instances (StructuredBuffer - no 64 KB limit)
+	slotRootParameter[5].InitAsShaderResourceView(lightClustersSRVRegister);	// Light Clusters (offset/count per cluster)
+	slotRootParameter[6].InitAsShaderResourceView(lightIndicesSRVRegister);		// Light Indices (referenced by the clusters)
 
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(4, slotRootParameter, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(7, slotRootParameter, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
 	std::shared_ptr<RootSignature> rootSig1 = std::make_shared<RootSignature>(m_deviceResources, rootSigDesc);
 	RenderPass& pass1 = m_renderer->EmplaceBackRenderPass(rootSig1, "Render Pass #1");
@@ -128,6 +144,14 @@ void SimulationWindow::InitializeRenderPasses()
 			passConstants.TotalTime = timer.TotalTime();
 			passConstants.DeltaTime = timer.DeltaTime();
 
+			passConstants.ViewportTopLeft = DirectX::XMFLOAT2(m_viewport.TopLeftX, m_viewport.TopLeftY);
+			passConstants.InvViewportSize = DirectX::XMFLOAT2(1.0f / m_viewport.Width, 1.0f / m_viewport.Height);
+			passConstants.ClusterCountX = LightClusterer::ClusterCountX;
+			passConstants.ClusterCountY = LightClusterer::ClusterCountY;
+			passConstants.ClusterCountZ = LightClusterer::ClusterCountZ;
+			passConstants.ClusterDepthScale = LightClusterer::DepthSliceScale(camera.GetNearZ(), camera.GetFarZ());
+			passConstants.ClusterDepthBias = LightClusterer::DepthSliceBias(camera.GetNearZ(), camera.GetFarZ());
+
 			m_passConstantsBuffer->CopyData(frameIndex, passConstants);
 		};
 
@@ -138,6 +162,36 @@ void SimulationWindow::InitializeRenderPasses()
 	m_lightingConstantBuffer->CopyData(m_lighting);
 	RootConstantBufferView& lightingCBV = pass1.EmplaceBackRootConstantBufferView(lightingCBRegister, m_lightingConstantBuffer.get());
 
+	// Point/spot lights are binned into view space clusters on the CPU, so each pixel only shades the lights that can
+	// reach it. The cluster grid and the light index lists only change when the camera or a light moves, so like the
+	// instance data they are kept in a versioned upload buffer per frame resource, and a frame in which
+	// LightClusterer::Update() reports no change uploads nothing and keeps using what each copy already holds
+	m_lightClusterBuffer = std::make_unique<VersionedUploadBuffer<LightCluster>>(m_deviceResources, LightClusterer::ClusterCount);
+	m_lightIndexBuffer = std::make_unique<VersionedUploadBuffer<std::uint32_t>>(m_deviceResources);
+
+	RootShaderResourceView& lightClustersSRV = pass1.EmplaceBackRootShaderResourceView(lightClustersRootParameter);
+	lightClustersSRV.Update = [this](RootShaderResourceView* srv, const Timer& timer, int frameIndex)
+		{
+			const Camera& camera = m_renderer->GetCamera();
+			if (m_lightClusterer.Update(m_lighting, camera.GetView(), camera.GetFovY(), camera.GetAspect(), camera.GetNearZ(), camera.GetFarZ()))
+			{
+				// The light index lists are packed back to back, so a change anywhere moves everything after it
+				m_lightClusterChanges.MarkAllDirty();
+				m_lightClusterChanges.Commit();
+			}
+
+			m_lightClusterBuffer->Update(frameIndex, m_lightClusterer.GetClusters(), m_lightClusterChanges);
+			srv->SetGPUVirtualAddress(m_lightClusterBuffer->GetGPUVirtualAddress(frameIndex));
+		};
+
+	RootShaderResourceView& lightIndicesSRV = pass1.EmplaceBackRootShaderResourceView(lightIndicesRootParameter);
+	lightIndicesSRV.Update = [this](RootShaderResourceView* srv, const Timer& timer, int frameIndex)
+		{
+			// NOTE: The buffer always has room for at least one element, so the SRV points at a valid address even with no lights
+			m_lightIndexBuffer->Update(frameIndex, m_lightClusterer.GetLightIndices(), m_lightClusterChanges);
+			srv->SetGPUVirtualAddress(m_lightIndexBuffer->GetGPUVirtualAddress(frameIndex));
+		};
+
 	// For the materials, we use a static constant buffer. This means we don't use a mapped upload heap and transfer material
 	// data to the GPU every frame. Instead, we only upload material data to the GPU when the material data changes.
 	// NOTE: This also means we don't need to supply the CBV Update lambda because we don't need to update this every frame
@@ -155,11 +209,21 @@ void SimulationWindow::InitializeRenderPasses()
 	// Blending:		None
 	// Stenciling:		None
 
-	GeometryGenerator::MeshData sphereMesh = GeometryGenerator::CreateSphere(1.0f, 20, 20);
-	std::vector<Vertex> sphereVertices;
-	sphereVertices.reserve(sphereMesh.Vertices.size());
-	for (GeometryGenerator::Vertex& v : sphereMesh.Vertices)
-		sphereVertices.push_back({ v.Position, v.Normal });
+	// Submeshes [0, LodCount) are the sphere LODs (most detailed first) and the arrow comes right after them
+	std::vector<std::vector<Vertex>> vertices;
+	std::vector<std::vector<std::uint16_t>> indices;
+
+	for (unsigned int tessellation : AtomLodSelector::LodTessellation)
+	{
+		GeometryGenerator::MeshData sphereMesh = GeometryGenerator::CreateSphere(1.0f, tessellation, tessellation);
+		std::vector<Vertex> sphereVertices;
+		sphereVertices.reserve(sphereMesh.Vertices.size());
+		for (GeometryGenerator::Vertex& v : sphereMesh.Vertices)
+			sphereVertices.push_back({ v.Position, v.Normal });
+
+		vertices.push_back(std::move(sphereVertices));
+		indices.push_back(std::move(sphereMesh.GetIndices16()));
+	}
 
 	GeometryGenerator::MeshData arrowMesh = GeometryGenerator::CreateArrow(0.25f, 0.25f, 0.5f, 2.0f, 0.8f, 20, 20);
 	std::vector<Vertex> arrowVertices;
@@ -167,17 +231,13 @@ void SimulationWindow::InitializeRenderPasses()
 	for (GeometryGenerator::Vertex& v : arrowMesh.Vertices)
 		arrowVertices.push_back({ v.Position, v.Normal });
 
-	std::vector<std::vector<Vertex>> vertices;
-	vertices.push_back(std::move(sphereVertices));
 	vertices.push_back(std::move(arrowVertices));
-
-	std::vector<std::vector<std::uint16_t>> indices;
-	indices.push_back(std::move(sphereMesh.GetIndices16()));
 	indices.push_back(std::move(arrowMesh.GetIndices16()));
 
 	m_sphereMeshGroup = std::make_shared<MeshGroup<Vertex>>(m_deviceResources, vertices, indices);
 
 	m_phongVSInstanced = std::make_unique<Shader>("src/shaders/output/PhongInstancedVS.cso");
+	m_phongAtomVS = std::make_unique<Shader>("src/shaders/output/PhongAtomVS.cso");
 	m_phongPSInstanced = std::make_unique<Shader>("src/shaders/output/PhongInstancedPS.cso");
 
 	m_inputLayoutInstanced = std::make_unique<InputLayout>(
@@ -191,7 +251,7 @@ void SimulationWindow::InitializeRenderPasses()
 	ZeroMemory(&psoDesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
 	psoDesc.InputLayout = m_inputLayoutInstanced->GetInputLayoutDesc();
 	psoDesc.pRootSignature = rootSig1->Get();
-	psoDesc.VS = m_phongVSInstanced->GetShaderByteCode();
+	psoDesc.VS = m_phongAtomVS->GetShaderByteCode();
 	psoDesc.PS = m_phongPSInstanced->GetShaderByteCode();
 	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
@@ -206,42 +266,53 @@ void SimulationWindow::InitializeRenderPasses()
 
 	RenderPassLayer& layer1 = pass1.EmplaceBackRenderPassLayer(m_deviceResources, m_sphereMeshGroup, psoDesc, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, "Layer #1");
 
-	m_instanceConstantBuffer = std::make_unique<ConstantBufferMapped<InstanceData>>(m_deviceResources);
-
-	RenderItem& sphereRI = layer1.EmplaceBackRenderItem();
-	sphereRI.SetInstanceCount(static_cast<unsigned int>(m_simulation.GetAtoms().size()));
-
-	m_instanceData = std::vector<InstanceData>(10);
+	// The instance data is kept in one versioned upload buffer per frame resource. Each copy only receives the
+	// instances that changed since it was last written, so nothing is uploaded at all while the scene is idle
+	m_atomInstanceBuffer = std::make_unique<VersionedUploadBuffer<AtomInstanceData>>(m_deviceResources);
+	m_selectedAtomInstanceBuffer = std::make_unique<VersionedUploadBuffer<AtomInstanceData>>(m_deviceResources, 64);
 
-	RootConstantBufferView& sphereInstanceCBV = sphereRI.EmplaceBackRootConstantBufferView(objectCBRegister, m_instanceConstantBuffer.get());
-	sphereInstanceCBV.Update = [this](const Timer& timer, int frameIndex)
-		{
-			int iii = 0;
+	// One render item per sphere LOD. Each one draws the atoms that were bucketed into its LOD this frame
+	for (unsigned int lod = 0; lod < AtomLodSelector::LodCount; ++lod)
+	{
+		RenderItem& sphereRI = layer1.EmplaceBackRenderItem(lod, 0);
 
-			const std::vector<Atom>& atoms = m_simulation.GetAtoms();
-			for (const auto& atom : atoms)
+		RootShaderResourceView& sphereInstanceSRV = sphereRI.EmplaceBackRootShaderResourceView(atomInstancesRootParameter);
+		sphereInstanceSRV.Update = [this, lod](RootShaderResourceView* srv, const Timer& timer, int frameIndex)
 			{
-				const DirectX::XMFLOAT3& p = atom.position;
-				const float radius = atom.radius;
+				// The render items are updated in order, so the LOD 0 item is the first to run each frame. It brings
+				// the instance data for all of the LODs (and the selected atoms) up to date and syncs this frame's copy
+				if (lod == 0)
+				{
+					UpdateAtomInstances();
+					m_atomInstanceBuffer->Update(frameIndex, m_atomInstances, m_atomInstanceChanges);
+				}
 
-				DirectX::XMStoreFloat4x4(&m_instanceData[iii].World,
-					DirectX::XMMatrixTranspose(
-						DirectX::XMMatrixScaling(radius, radius, radius) * DirectX::XMMatrixTranslation(p.x, p.y, p.z)
-					)
-				);
+				srv->SetGPUVirtualAddress(m_atomInstanceBuffer->GetGPUVirtualAddress(frameIndex) + m_atomInstanceLodOffsets[lod] * sizeof(AtomInstanceData));
+				m_renderer->GetRenderPass(0).GetRenderPassLayers()[0].GetRenderItems()[lod].SetInstanceCount(static_cast<unsigned int>(m_packedLodInstances[lod].size()));
+			};
+	}
 
-				m_instanceData[iii].MaterialIndex = static_cast<std::uint32_t>(atom.type) - 1; // Minus one because Hydrogen = 1 but is at index 0, etc
 
-				++iii;
-			}
 
-			m_instanceConstantBuffer->CopyData(frameIndex, m_instanceData);
-		};
+	// Beginning of Layer #1b (Arrow) -----------------------------------------------------------------------
+	// Description:		Opaque Items w/ Phong Shading that need a full world matrix
+	// Shading:			Phong
+	// Vertex Type:		Vertex
+	// Input Layout:	[FLOAT3, FLOAT3] (position, normal)
+	// Topology:		Triangle
+	// Blending:		None
+	// Stenciling:		None
+	//
+	// NOTE: The atoms use compact instance data that can only describe a uniformly scaled sphere, so the arrow
+	//       (which needs rotation) gets its own layer that uses the same mesh group but the full InstanceData VS
 
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC arrowDesc = psoDesc;
+	arrowDesc.VS = m_phongVSInstanced->GetShaderByteCode();
 
+	RenderPassLayer& arrowLayer = pass1.EmplaceBackRenderPassLayer(m_deviceResources, m_sphereMeshGroup, arrowDesc, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, "Layer #1b");
 
 	// Arrow
-	RenderItem& arrowRI = layer1.EmplaceBackRenderItem(1);
+	RenderItem& arrowRI = arrowLayer.EmplaceBackRenderItem(AtomLodSelector::LodCount);
 	arrowRI.SetActive(false);
 
 	m_arrowConstantBuffer = std::make_unique<ConstantBufferStatic<InstanceData>>(m_deviceResources, 1);	
@@ -295,6 +366,7 @@ void SimulationWindow::InitializeRenderPasses()
 	std::shared_ptr<MeshGroup<SolidColorVertex>> boxMeshGroup = std::make_shared<MeshGroup<SolidColorVertex>>(m_deviceResources, boxVerticesList, boxIndicesList);
 
 	m_solidVS = std::make_unique<Shader>("src/shaders/output/SolidVS.cso");
+	m_solidAtomVS = std::make_unique<Shader>("src/shaders/output/SolidAtomVS.cso");
 	m_solidPS = std::make_unique<Shader>("src/shaders/output/SolidPS.cso");
 
 	m_solidInputLayout = std::make_unique<InputLayout>(
@@ -430,6 +502,9 @@ void SimulationWindow::InitializeRenderPasses()
 	// Stenciling:		Write 1 to stencil buffer for each pixel
 
 
+	// Same mesh as the most detailed sphere LOD
+	GeometryGenerator::MeshData sphereMesh = GeometryGenerator::CreateSphere(1.0f, AtomLodSelector::LodTessellation[0], AtomLodSelector::LodTessellation[0]);
+
 	std::vector<SolidColorVertex> sphereStencilVertices;
 	sphereStencilVertices.reserve(sphereMesh.Vertices.size());
 	for (GeometryGenerator::Vertex& v : sphereMesh.Vertices)
@@ -469,7 +544,7 @@ void SimulationWindow::InitializeRenderPasses()
 	ZeroMemory(&stencilPSODesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
 	stencilPSODesc.InputLayout = m_solidInputLayout->GetInputLayoutDesc();
 	stencilPSODesc.pRootSignature = rootSig1->Get(); 
-	stencilPSODesc.VS = m_solidVS->GetShaderByteCode();
+	stencilPSODesc.VS = m_solidAtomVS->GetShaderByteCode();
 	stencilPSODesc.PS = m_solidPS->GetShaderByteCode();
 	stencilPSODesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 	stencilPSODesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
@@ -486,39 +561,15 @@ void SimulationWindow::InitializeRenderPasses()
 	RenderPassLayer& layer5 = pass1.EmplaceBackRenderPassLayer(m_deviceResources, stencilMeshGroup, stencilPSODesc, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, "Layer #4");
 	layer5.SetStencilRef(1); 
 
-	m_selectedAtomInstanceConstantBuffer = std::make_unique<ConstantBufferMapped<InstanceData>>(m_deviceResources);
-	m_selectedAtomsInstanceData = std::vector<InstanceData>(10);
-
 	RenderItem& sphereStencilRI = layer5.EmplaceBackRenderItem();
 	sphereStencilRI.SetInstanceCount(static_cast<unsigned int>(m_simulation.GetSelectedAtomIndices().size()));
 
-	RootConstantBufferView& sphereStencilInstanceCBV = sphereStencilRI.EmplaceBackRootConstantBufferView(objectCBRegister, m_selectedAtomInstanceConstantBuffer.get());
-	sphereStencilInstanceCBV.Update = [this](const Timer& timer, int frameIndex)
+	RootShaderResourceView& sphereStencilInstanceSRV = sphereStencilRI.EmplaceBackRootShaderResourceView(atomInstancesRootParameter);
+	sphereStencilInstanceSRV.Update = [this](RootShaderResourceView* srv, const Timer& timer, int frameIndex)
 		{
-			const std::vector<Atom>& atoms = m_simulation.GetAtoms();
-			const std::vector<size_t>& selectedIndices = m_simulation.GetSelectedAtomIndices();
-
-			int iii = 0;
- 
-			for (size_t index : selectedIndices)
-			{
-				const Atom& atom = atoms[index];
-
-				const DirectX::XMFLOAT3& p = atom.position; 
-				const float radius = atom.radius; 
-
-				DirectX::XMStoreFloat4x4(&m_selectedAtomsInstanceData[iii].World,
-					DirectX::XMMatrixTranspose( 
-						DirectX::XMMatrixScaling(radius, radius, radius) * DirectX::XMMatrixTranslation(p.x, p.y, p.z) 
-					)
-				);
-
-				m_selectedAtomsInstanceData[iii].MaterialIndex = 0;
-
-				++iii; 
-			}
-
-			m_selectedAtomInstanceConstantBuffer->CopyData(frameIndex, m_selectedAtomsInstanceData);
+			// NOTE: The instances were already packed by UpdateAtomInstances() (layer 1 is updated first)
+			m_selectedAtomInstanceBuffer->Update(frameIndex, m_selectedAtomInstances, m_selectedAtomInstanceChanges);
+			srv->SetGPUVirtualAddress(m_selectedAtomInstanceBuffer->GetGPUVirtualAddress(frameIndex));
 		};
 
 	
@@ -551,7 +602,7 @@ void SimulationWindow::InitializeRenderPasses()
 	ZeroMemory(&outlinePSODesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
 	outlinePSODesc.InputLayout = m_solidInputLayout->GetInputLayoutDesc();
 	outlinePSODesc.pRootSignature = rootSig1->Get();
-	outlinePSODesc.VS = m_solidVS->GetShaderByteCode();
+	outlinePSODesc.VS = m_solidAtomVS->GetShaderByteCode();
 	outlinePSODesc.PS = m_solidPS->GetShaderByteCode();
 	outlinePSODesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 	outlinePSODesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
@@ -568,66 +619,223 @@ void SimulationWindow::InitializeRenderPasses()
 	RenderPassLayer& layer6 = pass1.EmplaceBackRenderPassLayer(m_deviceResources, stencilMeshGroup, outlinePSODesc, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, "Layer #5");
 	layer6.SetStencilRef(0);
 
-	m_selectedAtomInstanceOutlineConstantBuffer = std::make_unique<ConstantBufferMapped<InstanceData>>(m_deviceResources);
-	m_selectedAtomsInstanceOutlineData = std::vector<InstanceData>(10);
-
 	RenderItem& sphereOutlineRI = layer6.EmplaceBackRenderItem();
 	sphereOutlineRI.SetInstanceCount(static_cast<unsigned int>(m_simulation.GetSelectedAtomIndices().size())); 
 
-	RootConstantBufferView& outlineStencilInstanceCBV = sphereOutlineRI.EmplaceBackRootConstantBufferView(objectCBRegister, m_selectedAtomInstanceOutlineConstantBuffer.get());
-	outlineStencilInstanceCBV.Update = [this](const Timer& timer, int frameIndex)
+	RootShaderResourceView& outlineStencilInstanceSRV = sphereOutlineRI.EmplaceBackRootShaderResourceView(atomInstancesRootParameter);
+	outlineStencilInstanceSRV.Update = [this](RootShaderResourceView* srv, const Timer& timer, int frameIndex)
 		{
-			const std::vector<Atom>& atoms = m_simulation.GetAtoms();
-			const std::vector<size_t>& selectedIndices = m_simulation.GetSelectedAtomIndices();
+			// Update() is a no-op if the stencil layer already synced this frame's copy
+			m_selectedAtomInstanceBuffer->Update(frameIndex, m_selectedAtomInstances, m_selectedAtomInstanceChanges);
+			srv->SetGPUVirtualAddress(m_selectedAtomInstanceBuffer->GetGPUVirtualAddress(frameIndex) + m_selectedAtomOutlineOffset * sizeof(AtomInstanceData));
+		};
+}
 
-			int iii = 0; 
+void SimulationWindow::Update(const Timer& timer, int frameIndex)
+{ 
+	m_renderer->Update(timer, frameIndex);
+
+	if (m_oneTimeUpdateFns.size() > 0)
+	{
+		for (auto& fn : m_oneTimeUpdateFns)
+			fn();
 
-			XMVECTOR cameraPos = m_renderer->GetCamera().GetPosition();
+		m_oneTimeUpdateFns.clear();
+	}
+}
 
-			for (size_t index : selectedIndices) 
+void SimulationWindow::UpdateAtomInstances() noexcept
+{
+	const AtomStore& atoms = m_simulation.GetAtoms();
+	const Camera& camera = m_renderer->GetCamera();
+
+	// Figure out what changed since the instance data was last built
+	const DirectX::XMFLOAT4X4 view = camera.GetView4x4f();
+	const DirectX::XMFLOAT4X4 proj = camera.GetProj4x4f();
+	const bool viewChanged = memcmp(&view, &m_atomInstancesView, sizeof(view)) != 0 ||
+		memcmp(&proj, &m_atomInstancesProj, sizeof(proj)) != 0 ||
+		m_viewport.Height != m_atomInstancesViewportHeight;
+
+	const DirtyRangeTracker& atomChanges = m_simulation.GetAtomChanges();
+	const bool allAtomsChanged = !atomChanges.CollectSince(m_atomChangesVersion, m_changedAtomRanges);
+	const bool atomsChanged = allAtomsChanged || m_changedAtomRanges.size() > 0;
+	m_atomChangesVersion = atomChanges.Version();
+
+	if (viewChanged || atomsChanged)
+	{
+		PROFILE_PHASE("SimulationWindow::UpdateAtomInstances", atoms.size());
+		ALLOCATION_TAG("Atom instances");
+
+		m_atomInstancesView = view;
+		m_atomInstancesProj = proj;
+		m_atomInstancesViewportHeight = m_viewport.Height;
+
+		// Frustum cull the atoms, sort the visible ones front to back, drop the ones buried behind nearer atoms and
+		// then bucket the rest by how large they appear on screen. Bucketing keeps the sorted order, so each LOD is
+		// drawn front to back as well, which lets early depth testing reject most of the hidden pixels before the
+		// Phong pixel shader runs
+		m_atomCuller.Cull(atoms, camera.GetFrustum());
+		m_atomDepthSorter.Sort(atoms, m_atomCuller.GetVisibleIndices(), camera.GetView(), camera.GetNearZ(), camera.GetFarZ());
+		m_atomOcclusionCuller.Cull(atoms, m_atomDepthSorter.GetSortedIndices(), camera.GetView(), camera.GetFovY(), camera.GetAspect(), camera.GetNearZ());
+
+		const float pixelsPerUnit = proj._22 * 0.5f * m_viewport.Height;
+		m_atomLodSelector.Select(atoms, m_atomOcclusionCuller.GetVisibleIndices(), camera.GetView(), pixelsPerUnit);
+
+		// The ambient occlusion only depends on the atoms themselves, so it is left alone when just the camera moves
+		const bool ambientOcclusionChanged = atomsChanged &&
+			m_atomAmbientOcclusion.Update(atoms, m_simulation.GetSpatialIndex(), m_changedAtomRanges, allAtomsChanged);
+
+		// The instance data itself does not depend on the camera. So if every visible atom landed in the same LOD
+		// (and the same spot within it) as last time, only the atoms that moved need to be repacked. That is the
+		// common case both when the camera moves a little and when the user drags a few atoms around
+		bool sameInstances = !allAtomsChanged;
+		for (unsigned int lod = 0; lod < AtomLodSelector::LodCount && sameInstances; ++lod)
+			sameInstances = m_atomLodSelector.GetInstances(lod) == m_packedLodInstances[lod];
+
+		if (sameInstances)
+		{
+			auto Repack = [&](size_t index)
+				{
+					const std::uint32_t slot = m_atomInstanceSlots[index];
+					if (slot == std::numeric_limits<std::uint32_t>::max())
+						return;
+
+					const std::uint32_t atomIndex = static_cast<std::uint32_t>(index);
+					PackAtomInstances(atoms, m_atomAmbientOcclusion.GetValues(), std::span(&atomIndex, 1), std::span(&m_atomInstances[slot], 1));
+					m_atomInstanceChanges.MarkDirty(slot);
+				};
+
+			for (const IndexRange& range : m_changedAtomRanges)
 			{
-				const Atom& atom = atoms[index]; 
-				const DirectX::XMFLOAT3& p = atom.position; 
+				for (size_t iii = range.begin; iii < range.end && iii < m_atomInstanceSlots.size(); ++iii)
+					Repack(iii);
+			}
+
+			// Atoms that did not change themselves but whose neighbors moved closer or further away
+			if (ambientOcclusionChanged)
+			{
+				for (std::uint32_t index : m_atomAmbientOcclusion.GetChangedIndices())
+					Repack(index);
+			}
+		}
+		else
+			PackAllAtomInstances();
 
-				float distance = XMVectorGetX(XMVector3Length(cameraPos - XMLoadFloat3(&p)));
+		m_atomInstanceChanges.Commit();
+	}
 
-				// Increase the radius - this creates the outline effect around the atom
-				// NOTE: 0.003 was used because this width seems appealing. It could easily be made smaller or larger
-				// NOTE: We use simulation.GetSelectedAtomCenter() and compute an increase to the radius based on the 
-				//		 center of the selected atoms and would therefore not need to compute the distance to every
-				//		 single atom. However, this leads to undesirable results when some atoms are far from the selected
-				//		 atoms center. Atoms close to the camera get a noticably larger outline while atoms further get a
-				//		 very thin outline.
-				const float radius = atom.radius + (0.003f * distance);
+	// The outline radius depends on the distance to the camera, so all of the selected atoms are repacked when the
+	// camera or the atoms change. When only the selection changed, just the part of it that changed is repacked
+	if (m_simulation.GetSelectedAtomIndices().size() > 0 && (viewChanged || atomsChanged))
+		PackSelectedAtomInstances();
+	else if (m_selectedAtomChanges.occurrences > 0)
+		PackSelectedAtomInstances(m_selectedAtomChanges);
 
-				DirectX::XMStoreFloat4x4(&m_selectedAtomsInstanceOutlineData[iii].World,
-					DirectX::XMMatrixTranspose( 
-						DirectX::XMMatrixScaling(radius, radius, radius) * DirectX::XMMatrixTranslation(p.x, p.y, p.z) 
-					) 
-				);
+	m_selectedAtomChanges = {};
+}
+void SimulationWindow::PackAllAtomInstances() noexcept
+{
+	const AtomStore& atoms = m_simulation.GetAtoms();
 
-				m_selectedAtomsInstanceOutlineData[iii].MaterialIndex = g_selectedAtomOutlineMaterialIndex;
+	// Root SRV addresses must be 256 byte aligned, so each LOD starts on a multiple of this many instances
+	constexpr size_t instanceAlignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT / sizeof(AtomInstanceData);
+	static_assert(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT % sizeof(AtomInstanceData) == 0);
 
-				++iii;
-			}
+	size_t count = 0;
+	for (unsigned int lod = 0; lod < AtomLodSelector::LodCount; ++lod)
+	{
+		m_atomInstanceLodOffsets[lod] = count;
+		count += (m_atomLodSelector.GetInstances(lod).size() + instanceAlignment - 1) / instanceAlignment * instanceAlignment;
+	}
+	m_atomInstances.resize(count);
 
-			m_selectedAtomInstanceOutlineConstantBuffer->CopyData(frameIndex, m_selectedAtomsInstanceOutlineData);
-		};
+	// Only the position/radius/material/occlusion is uploaded - the vertex shader builds the world transform
+	m_atomInstanceSlots.assign(atoms.size(), std::numeric_limits<std::uint32_t>::max());
+	for (unsigned int lod = 0; lod < AtomLodSelector::LodCount; ++lod)
+	{
+		const std::vector<std::uint32_t>& instances = m_atomLodSelector.GetInstances(lod);
+		const size_t offset = m_atomInstanceLodOffsets[lod];
+
+		PackAtomInstances(atoms, m_atomAmbientOcclusion.GetValues(), instances, std::span(m_atomInstances.data() + offset, instances.size()));
+
+		for (size_t iii = 0; iii < instances.size(); ++iii)
+			m_atomInstanceSlots[instances[iii]] = static_cast<std::uint32_t>(offset + iii);
+
+		m_packedLodInstances[lod] = instances;
+	}
+
+	m_atomInstanceChanges.MarkAllDirty();
 }
+void SimulationWindow::PackSelectedAtomInstances() noexcept
+{
+	// The outline instances must also start on a 256 byte boundary (see PackAllAtomInstances())
+	constexpr size_t instanceAlignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT / sizeof(AtomInstanceData);
+	const size_t count = m_simulation.GetSelectedAtomIndices().size();
+	m_selectedAtomOutlineOffset = (count + instanceAlignment - 1) / instanceAlignment * instanceAlignment;
 
-void SimulationWindow::Update(const Timer& timer, int frameIndex)
-{ 
-	m_renderer->Update(timer, frameIndex);
+	PackSelectedAtomInstances(0);
 
-	if (m_oneTimeUpdateFns.size() > 0)
+	m_selectedAtomInstanceChanges.MarkAllDirty();
+	m_selectedAtomInstanceChanges.Commit();
+}
+void SimulationWindow::PackSelectedAtomInstances(const ChangedRange& changes) noexcept
+{
+	const std::vector<size_t>& selectedIndices = m_simulation.GetSelectedAtomIndices();
+	const size_t count = selectedIndices.size();
+
+	// Without room for the new stencil instances before the outline instances, everything has to move
+	if (count > m_selectedAtomOutlineOffset)
 	{
-		for (auto& fn : m_oneTimeUpdateFns)
-			fn();
+		PackSelectedAtomInstances();
+		return;
+	}
 
-		m_oneTimeUpdateFns.clear();
+	// Atoms are only ever appended to the selection or erased from it, so the selection stays the same up to the first
+	// atom (selected before or now) in [begin, end). Only the instances from there on have to be packed again
+	auto Changed = [&changes](size_t index) { return index >= changes.begin && index < changes.end; };
+	const size_t first = std::min(
+		static_cast<size_t>(std::ranges::find_if(m_packedSelectedAtoms, Changed) - m_packedSelectedAtoms.begin()),
+		static_cast<size_t>(std::ranges::find_if(selectedIndices, Changed) - selectedIndices.begin()));
+
+	PackSelectedAtomInstances(first);
+
+	if (first < count)
+	{
+		m_selectedAtomInstanceChanges.MarkDirty(first, count);
+		m_selectedAtomInstanceChanges.MarkDirty(m_selectedAtomOutlineOffset + first, m_selectedAtomOutlineOffset + count);
 	}
+	m_selectedAtomInstanceChanges.Commit();
 }
+void SimulationWindow::PackSelectedAtomInstances(size_t first) noexcept
+{
+	const AtomStore& atoms = m_simulation.GetAtoms();
+	const std::vector<size_t>& selectedIndices = m_simulation.GetSelectedAtomIndices();
+
+	m_selectedAtomInstances.resize(m_selectedAtomOutlineOffset + selectedIndices.size());
+	m_packedSelectedAtoms = selectedIndices;
+
+	XMVECTOR cameraPos = m_renderer->GetCamera().GetPosition();
+
+	for (size_t iii = first; iii < selectedIndices.size(); ++iii)
+	{
+		const Atom& atom = atoms[selectedIndices[iii]];
+		const DirectX::XMFLOAT3& p = atom.position;
+
+		float distance = XMVectorGetX(XMVector3Length(cameraPos - XMLoadFloat3(&p)));
+
+		// Increase the radius - this creates the outline effect around the atom
+		// NOTE: 0.003 was used because this width seems appealing. It could easily be made smaller or larger
+		// NOTE: We use simulation.GetSelectedAtomCenter() and compute an increase to the radius based on the 
+		//		 center of the selected atoms and would therefore not need to compute the distance to every
+		//		 single atom. However, this leads to undesirable results when some atoms are far from the selected
+		//		 atoms center. Atoms close to the camera get a noticably larger outline while atoms further get a
+		//		 very thin outline.
+		const float radius = atom.radius + (0.003f * distance);
 
+		m_selectedAtomInstances[iii] = PackAtomInstance(p, atom.radius, 0);
+		m_selectedAtomInstances[m_selectedAtomOutlineOffset + iii] = PackAtomInstance(p, radius, g_selectedAtomOutlineMaterialIndex);
+	}
+}
 void SimulationWindow::StartSelectionMovement(MovementDirection direction) noexcept
 {
 	m_movementDirection = direction;
@@ -642,8 +850,8 @@ void SimulationWindow::SelectionMovementDirectionChangedImpl() noexcept
 	// If nothing is selected, turn off the layers that renders the axis and drag plane
 	if (m_simulation.GetSelectedAtomIndices().size() == 0)
 	{
-		pass1Layers[2].SetActive(false);
 		pass1Layers[3].SetActive(false);
+		pass1Layers[4].SetActive(false);
 		return;
 	}
 
@@ -655,8 +863,8 @@ void SimulationWindow::SelectionMovementDirectionChangedImpl() noexcept
 	{
 	case MovementDirection::X:
 	{
-		pass1Layers[3].SetActive(false); // Turn off the transparent plane layer
-		pass1Layers[2].SetActive(true);
+		pass1Layers[4].SetActive(false); // Turn off the transparent plane layer
+		pass1Layers[3].SetActive(true);
 
 		InstanceData axisData = {};
 		axisData.MaterialIndex = g_solidAxisColorMaterialIndex;
@@ -666,8 +874,8 @@ void SimulationWindow::SelectionMovementDirectionChangedImpl() noexcept
 	}
 	case MovementDirection::Y:
 	{
-		pass1Layers[3].SetActive(false); // Turn off the transparent plane layer
-		pass1Layers[2].SetActive(true);
+		pass1Layers[4].SetActive(false); // Turn off the transparent plane layer
+		pass1Layers[3].SetActive(true);
 
 		InstanceData axisData = {};
 		axisData.MaterialIndex = g_solidAxisColorMaterialIndex;
@@ -677,8 +885,8 @@ void SimulationWindow::SelectionMovementDirectionChangedImpl() noexcept
 	}
 	case MovementDirection::Z:
 	{
-		pass1Layers[3].SetActive(false); // Turn off the transparent plane layer
-		pass1Layers[2].SetActive(true);
+		pass1Layers[4].SetActive(false); // Turn off the transparent plane layer
+		pass1Layers[3].SetActive(true);
 
 		InstanceData axisData = {};
 		axisData.MaterialIndex = g_solidAxisColorMaterialIndex;
@@ -688,9 +896,9 @@ void SimulationWindow::SelectionMovementDirectionChangedImpl() noexcept
 	}
 	default:
 	{
-		pass1Layers[2].SetActive(false);	// Disable the solid cylinder layer
-		pass1Layers[3].SetActive(true);		// Activate the drag plane layer
-		pass1Layers[3].GetRenderItems()[0].SetInstanceCount(1);
+		pass1Layers[3].SetActive(false);	// Disable the solid cylinder layer
+		pass1Layers[4].SetActive(true);		// Activate the drag plane layer
+		pass1Layers[4].GetRenderItems()[0].SetInstanceCount(1);
 
 		SelectionMovementDragPlaneChangedImpl();
 		break;
@@ -789,12 +997,13 @@ void SimulationWindow::EndSelectionMovement() noexcept
 {
 	m_selectionBeingMovedStateIsActive = false;
 	m_selectionIsBeingDragged = false;
+	m_marqueeSelectionIsActive = false;
 
 	switch (m_movementDirection)
 	{
 	case MovementDirection::X:
 	case MovementDirection::Y:
-	case MovementDirection::Z: m_renderer->GetRenderPass(0).GetRenderPassLayers()[2].SetActive(false); break;
+	case MovementDirection::Z: m_renderer->GetRenderPass(0).GetRenderPassLayers()[3].SetActive(false); break;
 	}
 }
 
@@ -906,25 +1115,29 @@ void SimulationWindow::OnBoxFaceHighlightChanged() noexcept
 		}
 	);
 }
-void SimulationWindow::OnSelectedAtomsChanged() noexcept
+void SimulationWindow::OnSelectedAtomsChanged(const ChangedRange& range) noexcept
 {
 	const std::vector<size_t>& selectedIndices = m_simulation.GetSelectedAtomIndices();
 	unsigned int count = static_cast<unsigned int>(selectedIndices.size());
+
+	// Only the atoms in [begin, end) were selected or unselected. The instances are repacked for them the next time the
+	// instance data is updated
+	m_selectedAtomChanges.Include(range.begin, range.end);
 	std::vector<RenderPassLayer>& pass1Layers = m_renderer->GetRenderPass(0).GetRenderPassLayers();
 
-	// Layer at index 4: Stencil layer that writes to the stencil buffer
-	// Layer at index 5: Outline layer that draws the solid outline around selected atoms
+	// Layer at index 5: Stencil layer that writes to the stencil buffer
+	// Layer at index 6: Outline layer that draws the solid outline around selected atoms
 	if (count == 0)
 	{
-		pass1Layers[4].SetActive(false);
 		pass1Layers[5].SetActive(false);
+		pass1Layers[6].SetActive(false);
 	}
 	else
 	{
-		pass1Layers[4].SetActive(true);
 		pass1Layers[5].SetActive(true);
-		pass1Layers[4].GetRenderItems()[0].SetInstanceCount(count);
+		pass1Layers[6].SetActive(true);
 		pass1Layers[5].GetRenderItems()[0].SetInstanceCount(count);
+		pass1Layers[6].GetRenderItems()[0].SetInstanceCount(count);
 	}
 
 	// If we are allow the mouse to move the selected atoms, then we need to update the constant buffer
@@ -932,21 +1145,18 @@ void SimulationWindow::OnSelectedAtomsChanged() noexcept
 	if (m_selectionBeingMovedStateIsActive)
 		SelectionMovementDirectionChanged();
 }
-void SimulationWindow::OnAtomsAdded() noexcept
+void SimulationWindow::OnAtomsAdded(const ChangedRange& range) noexcept
 {
-	// Make sure the instance data vector has enough capacity for the new atoms
-	const std::vector<Atom>& atoms = m_simulation.GetAtoms();
-	if (atoms.size() > m_instanceData.size())
-		m_instanceData.resize(atoms.size());
-
-	// Make sure the sphere render item has the appropriate instance count
-	m_renderer->GetRenderPass(0).GetRenderPassLayers()[0].GetRenderItems()[0].SetInstanceCount(static_cast<unsigned int>(atoms.size()));
+	// The atoms in [begin, end) were added or shifted by an insert. The simulation records the same range in its change
+	// tracker, so the next instance update only repacks (and recomputes the ambient occlusion of) those atoms and their
+	// neighbors. The new atoms start out without an instance slot
+	m_atomInstanceSlots.resize(m_simulation.GetAtoms().size(), std::numeric_limits<std::uint32_t>::max());
 }
-void SimulationWindow::OnAtomsRemoved() noexcept
+void SimulationWindow::OnAtomsRemoved(const ChangedRange& range) noexcept
 {
-	// Make sure the sphere render item has the appropriate instance count
-	const std::vector<Atom>& atoms = m_simulation.GetAtoms();
-	m_renderer->GetRenderPass(0).GetRenderPassLayers()[0].GetRenderItems()[0].SetInstanceCount(static_cast<unsigned int>(atoms.size()));
+	// The atoms in [begin, end) were removed or shifted down and are repacked the same way. The slots past the new end
+	// belonged to atoms that no longer exist
+	m_atomInstanceSlots.resize(std::min(m_atomInstanceSlots.size(), m_simulation.GetAtoms().size()));
 }
 void SimulationWindow::OnSimulationPlay() noexcept
 {
@@ -954,14 +1164,14 @@ void SimulationWindow::OnSimulationPlay() noexcept
 	// the axis cylinder when the simulation plays
 	if (m_selectionBeingMovedStateIsActive)
 	{
-		m_renderer->GetRenderPass(0).GetRenderPassLayers()[2].SetActive(false);
+		m_renderer->GetRenderPass(0).GetRenderPassLayers()[3].SetActive(false);
 	}
 }
 void SimulationWindow::OnSimulationPause() noexcept
 {
 	if (m_selectionBeingMovedStateIsActive)
 	{
-		m_renderer->GetRenderPass(0).GetRenderPassLayers()[2].SetActive(true);
+		m_renderer->GetRenderPass(0).GetRenderPassLayers()[3].SetActive(true);
 		SelectionMovementDirectionChanged();
 	}
 }
@@ -1100,6 +1310,12 @@ void SimulationWindow::HandleLButtonDown() noexcept
 
 		if (m_selectionIsBeingDragged)
 			selectionCenterAtStartOfDrag = m_simulation.GetSelectedAtomsCenter();
+		else if (m_shiftIsPressed && !m_simulation.IsPlaying())
+		{
+			m_marqueeSelectionIsActive = true;
+			m_marqueeStart = m_mouseLastPos;
+			m_marqueeEnd = m_mouseLastPos;
+		}
 	}
 }
 void SimulationWindow::HandleLButtonUp() noexcept
@@ -1124,6 +1340,11 @@ void SimulationWindow::HandleLButtonUp() noexcept
 			m_selectionIsBeingDragged = false;
 			m_application.AddUndoCR<AtomsMovedCR>(m_simulation.GetSelectedAtomIndices(), selectionCenterAtStartOfDrag, m_simulation.GetSelectedAtomsCenter());
 		}
+		else if (m_marqueeSelectionIsActive)
+		{
+			m_marqueeSelectionIsActive = false;
+			SelectAtomsInMarquee();
+		}
 		else if (m_atomHoveredOverIndex.has_value())
 		{
 			m_simulation.SelectAtom(m_atomHoveredOverIndex.value());
@@ -1194,6 +1415,10 @@ void SimulationWindow::HandleMouseMove(float x, float y) noexcept
 			{
 				DragSelectedAtoms(x, y);
 			}
+			else if (m_marqueeSelectionIsActive)
+			{
+				m_marqueeEnd = { x, y };
+			}
 			else
 			{
 				m_atomHoveredOverIndex = PickAtom(x, y); 
@@ -1316,7 +1541,7 @@ void SimulationWindow::HandleMouseMove(float x, float y) noexcept
 
 	Camera& camera = m_renderer->GetCamera();
 
-	if (m_mouseLButtonDown && !m_selectionIsBeingDragged)
+	if (m_mouseLButtonDown && !m_selectionIsBeingDragged && !m_marqueeSelectionIsActive)
 	{
 		// If the camera is in a constant rotation (because arrow keys are down), disable dragging
 		if (camera.IsInConstantRotation())
@@ -1691,74 +1916,68 @@ void SimulationWindow::HandleChar(char c) noexcept
 
 std::optional<size_t> SimulationWindow::PickAtom(float x, float y)
 {
-	std::optional<size_t> pickedAtom = std::nullopt;
-
 	Camera& camera = m_renderer->GetCamera();
 	XMMATRIX projection = camera.GetProj();
 	XMMATRIX view = camera.GetView();
 
-	BoundingBox bounds = m_sphereMeshGroup->GetSubmesh(0).Bounds; 
-	BoundingSphere sphere = m_sphereMeshGroup->GetSubmesh(0).Sphere;
-
 	XMVECTOR clickpointNear = XMVectorSet(x, y, 0.0f, 1.0f);
 	XMVECTOR clickpointFar = XMVectorSet(x, y, 1.0f, 1.0f);
 
-	XMVECTOR origin, destination, direction; 
+	// Unproject the ray a single time into world space and then let the BVH find the closest atom it hits. This
+	// avoids having to construct a world matrix and unproject the ray for every atom
+	XMVECTOR origin = XMVector3Unproject(
+		clickpointNear,
+		m_viewport.TopLeftX,
+		m_viewport.TopLeftY,
+		m_viewport.Width,
+		m_viewport.Height,
+		m_viewport.MinDepth,
+		m_viewport.MaxDepth,
+		projection,
+		view,
+		XMMatrixIdentity());
 
-	float minDistance = FLT_MAX; 
-	float distance = FLT_MAX;
-	for (const Atom& atom : m_simulation.GetAtoms()) 
-	{
-		// Construct world matrix
-		const DirectX::XMFLOAT3& p = atom.position;
-		const float radius = atom.radius / 2;
-		XMMATRIX world = XMMatrixScaling(radius, radius, radius) * XMMatrixTranslation(p.x, p.y, p.z);
-
-		origin = XMVector3Unproject(
-			clickpointNear, 
-			m_viewport.TopLeftX,
-			m_viewport.TopLeftY,
-			m_viewport.Width,
-			m_viewport.Height,
-			m_viewport.MinDepth, 
-			m_viewport.MaxDepth,  
-			projection, 
-			view, 
-			world); 
-
-		destination = XMVector3Unproject( 
-			clickpointFar,
-			m_viewport.TopLeftX,
-			m_viewport.TopLeftY,
-			m_viewport.Width,
-			m_viewport.Height,
-			m_viewport.MinDepth,
-			m_viewport.MaxDepth,
-			projection, 
-			view, 
-			world);
-
-		direction = XMVector3Normalize(destination - origin); 
-
-//		if (bounds.Intersects(origin, direction, distance))
-//		{
-//			LOG_TRACE("INTERSECTION: {}", distance); 
-//		}
-		if (sphere.Intersects(origin, direction, distance))
-		{
-			// The distance we get back is relative to the scale that was used when calling XMVector3Unproject
-			// In order to get them back to the same scale, we must multiply by the scale factor that was used
-			distance *= radius;
+	XMVECTOR destination = XMVector3Unproject(
+		clickpointFar,
+		m_viewport.TopLeftX,
+		m_viewport.TopLeftY,
+		m_viewport.Width,
+		m_viewport.Height,
+		m_viewport.MinDepth,
+		m_viewport.MaxDepth,
+		projection,
+		view,
+		XMMatrixIdentity());
 
-			if (distance < minDistance)
-			{
-				minDistance = distance;
-				pickedAtom = m_simulation.IndexOf(atom);
-			}
-		}
-	}
+	XMVECTOR direction = XMVector3Normalize(destination - origin);
+
+	// NOTE: The BVH tests against the full radius, which is the size the atom is drawn at (the unit sphere mesh scaled
+	//       by 'radius'). The per-atom unprojection this replaced only tested half of it
+	std::optional<AtomBVH::RayHit> hit = m_simulation.GetBVH().Intersect(origin, direction);
+	if (hit.has_value())
+		return hit->atomIndex;
+
+	return std::nullopt;
+}
+void SimulationWindow::SelectAtomsInMarquee() noexcept
+{
+	auto [topLeft, bottomRight] = GetMarqueeCorners();
+
+	// A click without any real drag would produce a degenerate frustum, so just ignore it
+	constexpr float minimumSize = 2.0f;
+	if (bottomRight.x - topLeft.x < minimumSize || bottomRight.y - topLeft.y < minimumSize)
+		return;
+
+	// Convert the rectangle to normalized device coordinates. Screen y grows downward, but NDC y grows upward
+	auto ToNdcX = [this](float x) { return 2.0f * (x - m_viewport.TopLeftX) / m_viewport.Width - 1.0f; };
+	auto ToNdcY = [this](float y) { return 1.0f - 2.0f * (y - m_viewport.TopLeftY) / m_viewport.Height; };
+
+	Camera& camera = m_renderer->GetCamera();
+	Frustum frustum(camera.GetView() * camera.GetProj(), { ToNdcX(topLeft.x), ToNdcY(bottomRight.y), ToNdcX(bottomRight.x), ToNdcY(topLeft.y) });
 
-	return pickedAtom;
+	// Let the BVH find every atom inside the sub-frustum and then apply them all as a single selection change
+	std::vector<size_t> indices = m_simulation.AtomsInFrustum(frustum);
+	m_simulation.SelectAtoms(indices, true);
 }
 void SimulationWindow::PickBoxWalls(float x, float y)
 {
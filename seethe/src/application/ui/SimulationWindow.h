@@ -1,8 +1,15 @@
 #pragma once
 #include "pch.h"
+#include "rendering/AtomAmbientOcclusion.h"
+#include "rendering/AtomCuller.h"
+#include "rendering/AtomDepthSorter.h"
+#include "rendering/AtomLodSelector.h"
+#include "rendering/AtomOcclusionCuller.h"
 #include "rendering/Renderer.h"
+#include "rendering/VersionedUploadBuffer.h"
 #include "application/rendering/InstanceData.h"
 #include "application/rendering/Light.h"
+#include "application/rendering/LightClusterer.h"
 #include "application/rendering/Material.h"
 #include "application/rendering/PassConstants.h"
 #include "application/rendering/VertexTypes.h"
@@ -75,6 +82,17 @@ public:
 
 	void NotifyLightingChanged() noexcept { m_oneTimeUpdateFns.push_back([this]() { OnLightingChangedImpl(); }); }
 
+	// Marquee selection: while atoms can be selected, holding Shift and dragging with the left mouse button draws a
+	// rectangle, and every atom inside it is selected when the button is released
+	ND constexpr bool MarqueeSelectionIsActive() const noexcept { return m_marqueeSelectionIsActive; }
+	ND constexpr std::pair<DirectX::XMFLOAT2, DirectX::XMFLOAT2> GetMarqueeCorners() const noexcept
+	{
+		return {
+			{ std::min(m_marqueeStart.x, m_marqueeEnd.x), std::min(m_marqueeStart.y, m_marqueeEnd.y) },
+			{ std::max(m_marqueeStart.x, m_marqueeEnd.x), std::max(m_marqueeStart.y, m_marqueeEnd.y) }
+		};
+	}
+
 private:
 	void RegisterEventHandlers() noexcept;
 
@@ -82,9 +100,9 @@ private:
 
 	void OnBoxSizeChanged() noexcept;
 	void OnBoxFaceHighlightChanged() noexcept;
-	void OnSelectedAtomsChanged() noexcept;
-	void OnAtomsAdded() noexcept;
-	void OnAtomsRemoved() noexcept;
+	void OnSelectedAtomsChanged(const ChangedRange& range) noexcept;
+	void OnAtomsAdded(const ChangedRange& range) noexcept;
+	void OnAtomsRemoved(const ChangedRange& range) noexcept;
 	void OnSimulationPlay() noexcept;
 	void OnSimulationPause() noexcept;
 
@@ -126,8 +144,14 @@ private:
 	}
 
 	void InitializeRenderPasses();
+	void UpdateAtomInstances() noexcept;
+	void PackAllAtomInstances() noexcept;
+	void PackSelectedAtomInstances() noexcept;
+	void PackSelectedAtomInstances(const ChangedRange& changes) noexcept;
+	void PackSelectedAtomInstances(size_t first) noexcept;
 
 	std::optional<size_t> PickAtom(float x, float y);
+	void SelectAtomsInMarquee() noexcept;
 	void PickBoxWalls(float x, float y);
 
 	constexpr void ClearMouseHoverWallState() noexcept
@@ -164,11 +188,11 @@ private:
 		auto& pass1Layers = m_renderer->GetRenderPass(0).GetRenderPassLayers();
 
 		// Box Wall transparency layer
-		pass1Layers[3].SetActive(active);
-		pass1Layers[3].GetRenderItems()[0].SetInstanceCount(2); // 2 instances because 2 walls
+		pass1Layers[4].SetActive(active);
+		pass1Layers[4].GetRenderItems()[0].SetInstanceCount(2); // 2 instances because 2 walls
 
 		// Arrow Render Item
-		pass1Layers[0].GetRenderItems()[1].SetActive(active);
+		pass1Layers[1].GetRenderItems()[0].SetActive(active);
 	}
 
 	constexpr void SelectionMovementDirectionChanged() noexcept { m_oneTimeUpdateFns.push_back([this]() { SelectionMovementDirectionChangedImpl(); }); }
@@ -191,8 +215,10 @@ private:
 
 	// Shaders
 	std::unique_ptr<Shader> m_phongVSInstanced = nullptr;
+	std::unique_ptr<Shader> m_phongAtomVS = nullptr;
 	std::unique_ptr<Shader> m_phongPSInstanced = nullptr;
 	std::unique_ptr<Shader> m_solidVS = nullptr;
+	std::unique_ptr<Shader> m_solidAtomVS = nullptr;
 	std::unique_ptr<Shader> m_solidPS = nullptr;
 
 	// Input Layouts
@@ -203,14 +229,45 @@ private:
 	std::shared_ptr<MeshGroup<Vertex>> m_sphereMeshGroup = nullptr;
 
 	// Instance Data
-	std::vector<InstanceData> m_instanceData;
-	std::vector<InstanceData> m_selectedAtomsInstanceData;
-	std::vector<InstanceData> m_selectedAtomsInstanceOutlineData;
+	AtomCuller m_atomCuller;
+	AtomDepthSorter m_atomDepthSorter;
+	AtomOcclusionCuller m_atomOcclusionCuller;
+	AtomLodSelector m_atomLodSelector;
+	AtomAmbientOcclusion m_atomAmbientOcclusion;
+
+	// Every visible atom, packed LOD by LOD ([LOD 0 | LOD 1 | ...]), with each LOD starting on a 256 byte boundary so
+	// that it can be bound as its own root SRV. m_atomInstanceSlots maps an atom index to where it was packed, so when
+	// only a few atoms move, only their slots need to be repacked (and re-uploaded)
+	std::vector<AtomInstanceData> m_atomInstances;
+	std::array<size_t, AtomLodSelector::LodCount> m_atomInstanceLodOffsets = {};
+	std::array<std::vector<std::uint32_t>, AtomLodSelector::LodCount> m_packedLodInstances;
+	std::vector<std::uint32_t> m_atomInstanceSlots;
+	DirtyRangeTracker m_atomInstanceChanges;
+	std::unique_ptr<VersionedUploadBuffer<AtomInstanceData>> m_atomInstanceBuffer = nullptr;
+
+	// Selected atoms, packed as [stencil instances | outline instances]. m_packedSelectedAtoms is the selection they were
+	// packed from and m_selectedAtomChanges the atoms whose selection changed since then
+	std::vector<AtomInstanceData> m_selectedAtomInstances;
+	size_t m_selectedAtomOutlineOffset = 0;
+	std::vector<size_t> m_packedSelectedAtoms;
+	ChangedRange m_selectedAtomChanges;
+	DirtyRangeTracker m_selectedAtomInstanceChanges;
+	std::unique_ptr<VersionedUploadBuffer<AtomInstanceData>> m_selectedAtomInstanceBuffer = nullptr;
+
+	// Clustered Lighting
+	LightClusterer m_lightClusterer;
+	DirtyRangeTracker m_lightClusterChanges;
+	std::unique_ptr<VersionedUploadBuffer<LightCluster>> m_lightClusterBuffer = nullptr;
+	std::unique_ptr<VersionedUploadBuffer<std::uint32_t>> m_lightIndexBuffer = nullptr;
+
+	// What the instance data was last built from. If none of these changed, the instance data is already up to date
+	std::uint64_t m_atomChangesVersion = DirtyRangeTracker::NoVersion;
+	DirectX::XMFLOAT4X4 m_atomInstancesView = {};
+	DirectX::XMFLOAT4X4 m_atomInstancesProj = {};
+	float m_atomInstancesViewportHeight = 0.0f;
+	std::vector<IndexRange> m_changedAtomRanges;
 
 	// Constant Buffers - Mapped
-	std::unique_ptr<ConstantBufferMapped<InstanceData>>		m_instanceConstantBuffer;
-	std::unique_ptr<ConstantBufferMapped<InstanceData>>		m_selectedAtomInstanceConstantBuffer;
-	std::unique_ptr<ConstantBufferMapped<InstanceData>>		m_selectedAtomInstanceOutlineConstantBuffer;
 	std::unique_ptr<ConstantBufferMapped<PassConstants>>	m_passConstantsBuffer;
 
 	// Constant Buffers - Static
@@ -282,5 +339,10 @@ private:
 	MovementDirection m_movementDirection = MovementDirection::X;
 	std::optional<size_t> m_atomHoveredOverIndex = std::nullopt;
 	DirectX::XMFLOAT3 selectionCenterAtStartOfDrag = { 0.0f, 0.0f, 0.0f };
+
+	// Marquee selection state (screen coordinates, same space as the viewport)
+	bool m_marqueeSelectionIsActive = false;
+	DirectX::XMFLOAT2 m_marqueeStart = { 0.0f, 0.0f };
+	DirectX::XMFLOAT2 m_marqueeEnd = { 0.0f, 0.0f };
 };
 }
\ No newline at end of file
@@ -8,8 +8,14 @@
 #define STRINGIFY2(X) #X
 #define STRINGIFY(X) STRINGIFY2(X)
 
+#if defined(_WIN32)
+#define DEBUG_BREAK() __debugbreak()
+#else
+#define DEBUG_BREAK() __builtin_trap()
+#endif
+
 #ifdef DEBUG
-#define ASSERT(x, ...) { if (!(x)) { LOG_ERROR("Assertion Failed: {0}", __VA_ARGS__); __debugbreak(); } }
+#define ASSERT(x, ...) { if (!(x)) { LOG_ERROR("Assertion Failed: {0}", __VA_ARGS__); seethe::log::Flush(); DEBUG_BREAK(); } }
 #else
 #define ASSERT(x, ...)
 #endif
@@ -17,8 +23,12 @@
 
 #include <algorithm> 
 #include <array>
+#include <atomic>
+#include <bit>
+#include <cfloat>
 #include <chrono>
 #include <concepts>
+#include <condition_variable>
 #include <deque>
 #include <filesystem>
 #include <format>
@@ -26,13 +36,17 @@
 #include <functional>
 #include <iterator>
 #include <memory>
+#include <mutex>
+#include <numeric>
 #include <optional>
 #include <queue>
+#include <random>
 #include <span>
 #include <stack>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <tuple>
 #include <type_traits>
 #include <unordered_map>
@@ -41,6 +55,9 @@
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
+// NOTE: Only the Windows build (seethe.vcxproj) has a renderer. The CMake build for other platforms compiles just the
+//       simulation and the CPU-side rendering code, which only need DirectXMath
+#if defined(_WIN32)
 #define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
 
 #define NOGDICAPMASKS
@@ -90,19 +107,25 @@ using json = nlohmann::json;
 #include <dxgi1_4.h>
 #include <d3d12.h>
 #include <D3Dcompiler.h>
+#endif
+
 #include <DirectXMath.h>
 #include <DirectXPackedVector.h>
 #include <DirectXColors.h>
 #include <DirectXCollision.h>
 
 #include "utils/Constants.h"
+#if defined(_WIN32)
 #include "utils/d3dx12.h"
 #include "utils/DDSTextureLoader.h"
+#endif
 #include "utils/MathHelper.h"
 
+#if defined(_WIN32)
 // Link necessary d3d12 libraries.
 #pragma comment(lib, "d3dcompiler.lib")
 #pragma comment(lib, "D3D12.lib")
 #pragma comment(lib, "dxgi.lib")
 
-#pragma comment(lib, "dxguid.lib")
\ No newline at end of file
+#pragma comment(lib, "dxguid.lib")
+#endif
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "AtomAmbientOcclusion.h"
+#include "utils/Log.h"
+#include "utils/ThreadPool.h"
+#include "utils/TuningParameters.h"
+
+using namespace DirectX;
+
+namespace seethe
+{
+static constexpr float MaxAtomRadius = std::ranges::max(AtomicRadii);
+
+AtomAmbientOcclusion::AtomAmbientOcclusion(float reach) noexcept :
+	m_reach(reach)
+{
+	ASSERT(reach > 0.0f, "Reach must be positive");
+
+	// Fibonacci sphere - evenly spread directions with no clumping at the poles
+	const float goldenAngle = XM_PI * (3.0f - std::sqrt(5.0f));
+	auto Direction = [goldenAngle](unsigned int iii)
+		{
+			const float y = 1.0f - 2.0f * (static_cast<float>(iii) + 0.5f) / DirectionCount;
+			const float ringRadius = std::sqrt(1.0f - y * y);
+			const float theta = goldenAngle * static_cast<float>(iii);
+			return XMFLOAT3(ringRadius * std::cos(theta), y, ringRadius * std::sin(theta));
+		};
+
+	for (unsigned int group = 0; group < DirectionCount / 4; ++group)
+	{
+		const XMFLOAT3 a = Direction(4 * group);
+		const XMFLOAT3 b = Direction(4 * group + 1);
+		const XMFLOAT3 c = Direction(4 * group + 2);
+		const XMFLOAT3 d = Direction(4 * group + 3);
+
+		m_directions[group].x = { a.x, b.x, c.x, d.x };
+		m_directions[group].y = { a.y, b.y, c.y, d.y };
+		m_directions[group].z = { a.z, b.z, c.z, d.z };
+	}
+}
+
+bool AtomAmbientOcclusion::Update(const AtomStore& atoms, const AtomGrid& grid, std::span<const IndexRange> changed, bool allChanged) noexcept
+{
+	// The atom count changes when atoms are added or removed. The atoms that were shifted by that must be part of
+	// 'changed' (the simulation's change tracker does that), the new atoms at the end are always recomputed and so is
+	// everything near where the atoms past the new end used to be
+	const size_t count = atoms.size();
+	const size_t previousCount = m_values.size();
+	const size_t keptCount = std::min(previousCount, count);
+
+	size_t changedCount = std::max(previousCount, count) - keptCount;
+	for (const IndexRange& range : changed)
+		changedCount += range.Count();
+	allChanged |= static_cast<float>(changedCount) > FullUpdateFraction * static_cast<float>(count);
+
+	m_values.resize(count, 255);
+	m_dirtyIndices.clear();
+
+	if (allChanged)
+	{
+		m_positions.resize(count);
+		m_dirtyIndices.resize(count);
+		std::iota(m_dirtyIndices.begin(), m_dirtyIndices.end(), 0u);
+	}
+	else
+	{
+		// An atom's value can only change if some atom within reach of its surface moved (or changed size), so
+		// mark everything near both the old and the new position of each changed atom
+		const float influence = 2.0f * MaxAtomRadius + m_reach;
+		std::vector<size_t>& neighbors = m_neighbors;
+
+		m_isDirty.assign(count, 0);
+		auto Mark = [this](size_t index)
+			{
+				if (!m_isDirty[index])
+				{
+					m_isDirty[index] = 1;
+					m_dirtyIndices.push_back(static_cast<std::uint32_t>(index));
+				}
+			};
+		auto MarkNear = [&](const XMFLOAT3& position)
+			{
+				neighbors.clear();
+				grid.QueryRadius(position, influence, neighbors);
+				for (size_t neighbor : neighbors)
+					Mark(neighbor);
+			};
+
+		for (size_t iii = count; iii < previousCount; ++iii)
+			MarkNear(m_positions[iii]);
+
+		m_positions.resize(count);
+		for (size_t iii = keptCount; iii < count; ++iii)
+		{
+			m_positions[iii] = atoms[iii].position;
+			Mark(iii);
+			MarkNear(m_positions[iii]);
+		}
+
+		for (const IndexRange& range : changed)
+		{
+			for (size_t iii = range.begin; iii < range.end && iii < keptCount; ++iii)
+			{
+				Mark(iii);
+				MarkNear(atoms[iii].position);
+				MarkNear(m_positions[iii]);
+			}
+		}
+	}
+
+	Recompute(atoms, grid);
+
+	m_changed.clear();
+	m_changed.reserve(count);
+	for (size_t iii = 0; iii < m_dirtyIndices.size(); ++iii)
+	{
+		const std::uint32_t index = m_dirtyIndices[iii];
+		m_positions[index] = atoms[index].position;
+		if (m_values[index] != m_recomputed[iii])
+		{
+			m_values[index] = m_recomputed[iii];
+			m_changed.push_back(index);
+		}
+	}
+
+	return m_changed.size() > 0;
+}
+
+void AtomAmbientOcclusion::Recompute(const AtomStore& atoms, const AtomGrid& grid) noexcept
+{
+	m_recomputed.resize(m_dirtyIndices.size());
+
+	ThreadPool::Get().ParallelFor(m_dirtyIndices.size(), TuningParameters::Current().ambientOcclusionGrainSize, [&](size_t begin, size_t end)
+		{
+			// One scratch list per thread, reused from frame to frame
+			thread_local std::vector<size_t> neighbors;
+			for (size_t iii = begin; iii < end; ++iii)
+				m_recomputed[iii] = Compute(atoms, grid, m_dirtyIndices[iii], neighbors);
+		}
+	);
+}
+
+std::uint8_t AtomAmbientOcclusion::Compute(const AtomStore& atoms, const AtomGrid& grid, size_t index, std::vector<size_t>& neighbors) const noexcept
+{
+	const Atom& atom = atoms[index];
+	const float range = atom.radius + m_reach;
+
+	neighbors.clear();
+	grid.QueryRadius(atom.position, range + MaxAtomRadius, neighbors);
+
+	std::array<XMVECTOR, DirectionCount / 4> blocked;
+	blocked.fill(XMVectorZero());
+
+	const XMVECTOR center = XMLoadFloat3(&atom.position);
+	const XMVECTOR rangeV = XMVectorReplicate(range);
+	const XMVECTOR inverseReach = XMVectorReplicate(1.0f / m_reach);
+	const XMVECTOR zero = XMVectorZero();
+
+	for (size_t neighborIndex : neighbors)
+	{
+		if (neighborIndex == index)
+			continue;
+
+		const Atom& neighbor = atoms[neighborIndex];
+		const XMVECTOR toNeighbor = XMVectorSubtract(XMLoadFloat3(&neighbor.position), center);
+		const float distanceSq = XMVectorGetX(XMVector3LengthSq(toNeighbor));
+		const float reach = range + neighbor.radius;
+		if (distanceSq >= reach * reach)
+			continue;
+
+		const XMVECTOR wx = XMVectorSplatX(toNeighbor);
+		const XMVECTOR wy = XMVectorSplatY(toNeighbor);
+		const XMVECTOR wz = XMVectorSplatZ(toNeighbor);
+		const XMVECTOR distanceSqV = XMVectorReplicate(distanceSq);
+		const XMVECTOR radiusSq = XMVectorReplicate(neighbor.radius * neighbor.radius);
+
+		for (size_t group = 0; group < blocked.size(); ++group)
+		{
+			const DirectionGroup& d = m_directions[group];
+
+			// t = distance along the ray to the point closest to the neighbor's center. The ray enters the neighbor
+			// sqrt(r^2 - (|w|^2 - t^2)) before that
+			const XMVECTOR t = XMVectorMultiplyAdd(wx, XMLoadFloat4A(&d.x), XMVectorMultiplyAdd(wy, XMLoadFloat4A(&d.y), XMVectorMultiply(wz, XMLoadFloat4A(&d.z))));
+			const XMVECTOR h = XMVectorSubtract(radiusSq, XMVectorSubtract(distanceSqV, XMVectorMultiply(t, t)));
+			const XMVECTOR entry = XMVectorSubtract(t, XMVectorSqrt(XMVectorMax(h, zero)));
+			const XMVECTOR hit = XMVectorAndInt(XMVectorGreaterOrEqual(h, zero), XMVectorGreater(t, zero));
+
+			// 1 at the atom's surface (or inside it), fading to 0 at the end of the reach
+			const XMVECTOR amount = XMVectorSaturate(XMVectorMultiply(XMVectorSubtract(rangeV, entry), inverseReach));
+			blocked[group] = XMVectorMax(blocked[group], XMVectorSelect(zero, amount, hit));
+		}
+	}
+
+	XMVECTOR total = zero;
+	for (const XMVECTOR& b : blocked)
+		total = XMVectorAdd(total, b);
+
+	XMFLOAT4 lanes;
+	XMStoreFloat4(&lanes, total);
+	const float accessibility = 1.0f - (lanes.x + lanes.y + lanes.z + lanes.w) / DirectionCount;
+	return static_cast<std::uint8_t>(std::clamp(accessibility, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "pch.h"
+#include "simulation/Atom.h"
+#include "simulation/AtomGrid.h"
+#include "utils/DirtyRangeTracker.h"
+
+namespace seethe
+{
+// AtomAmbientOcclusion estimates how much of the ambient light reaches each atom, so that atoms buried in a cluster
+// are darker than the ones on its surface. It runs on the CPU and only when atoms move, so it costs nothing per
+// frame on the GPU (as opposed to screen space AO).
+//
+// For each atom, a fixed set of DirectionCount directions (a Fibonacci sphere) are cast from the atom's center
+// against the neighbors found in the AtomGrid. A direction that hits a neighbor right at the atom's surface is fully
+// blocked, and the amount of blocking fades out linearly until the neighbor is 'reach' beyond the surface. The atom's
+// value is the average accessibility over all directions, quantized to a byte (255 = nothing nearby, 0 = buried).
+// The directions are stored as 4-wide SoA vectors so each neighbor is tested against 4 directions at once.
+//
+// Update() only recomputes the atoms whose neighborhood changed: the atoms that changed themselves, plus every atom
+// within reach of where they were or where they are now. If too many atoms changed, everything is recomputed
+// instead. Either way the work is spread across the shared ThreadPool.
+class AtomAmbientOcclusion
+{
+public:
+	static constexpr unsigned int DirectionCount = 32;
+	static_assert(DirectionCount % 4 == 0);
+
+	static constexpr float DefaultReach = 2.0f;
+
+	// Past this fraction of changed atoms, finding the affected neighborhoods costs more than just recomputing
+	static constexpr float FullUpdateFraction = 0.25f;
+
+	AtomAmbientOcclusion(float reach = DefaultReach) noexcept;
+	AtomAmbientOcclusion(const AtomAmbientOcclusion&) noexcept = default;
+	AtomAmbientOcclusion(AtomAmbientOcclusion&&) noexcept = default;
+	AtomAmbientOcclusion& operator=(const AtomAmbientOcclusion&) noexcept = default;
+	AtomAmbientOcclusion& operator=(AtomAmbientOcclusion&&) noexcept = default;
+	~AtomAmbientOcclusion() noexcept = default;
+
+	// 'changed' are the atom ranges that changed since the last call (see DirtyRangeTracker), including the atoms that
+	// were shifted when atoms were added/removed. Pass 'allChanged' when that is not known. Returns true if any atom's
+	// value changed - those atoms are listed by GetChangedIndices()
+	bool Update(const AtomStore& atoms, const AtomGrid& grid, std::span<const IndexRange> changed, bool allChanged) noexcept;
+
+	// Computes a single atom's value from scratch. 'neighbors' is scratch space
+	ND std::uint8_t Compute(const AtomStore& atoms, const AtomGrid& grid, size_t index, std::vector<size_t>& neighbors) const noexcept;
+
+	// One value per atom, indexed the same way as the atom store
+	ND constexpr const std::vector<std::uint8_t>& GetValues() const noexcept { return m_values; }
+	ND constexpr const std::vector<std::uint32_t>& GetChangedIndices() const noexcept { return m_changed; }
+	ND constexpr size_t GetLastRecomputedCount() const noexcept { return m_dirtyIndices.size(); }
+
+private:
+	void Recompute(const AtomStore& atoms, const AtomGrid& grid) noexcept;
+
+	float m_reach;
+
+	// Directions, 4 at a time: (x0 x1 x2 x3), (y0 y1 y2 y3), (z0 z1 z2 z3)
+	struct DirectionGroup
+	{
+		DirectX::XMFLOAT4A x;
+		DirectX::XMFLOAT4A y;
+		DirectX::XMFLOAT4A z;
+	};
+	std::array<DirectionGroup, DirectionCount / 4> m_directions;
+
+	std::vector<std::uint8_t> m_values;
+	std::vector<DirectX::XMFLOAT3> m_positions;		// Where each atom was when the values were last computed
+
+	std::vector<std::uint8_t> m_isDirty;
+	std::vector<std::uint32_t> m_dirtyIndices;
+	std::vector<std::uint8_t> m_recomputed;
+	std::vector<std::uint32_t> m_changed;
+	std::vector<size_t> m_neighbors;
+};
+}
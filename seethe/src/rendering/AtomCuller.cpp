@@ -0,0 +1,33 @@
+#include "AtomCuller.h"
+#include "utils/ThreadPool.h"
+
+namespace seethe
+{
+void AtomCuller::Cull(const AtomStore& atoms, const Frustum& frustum) noexcept
+{
+	const size_t chunkCount = atoms.ChunkCount();
+
+	// NOTE: Only grow this - the inner vectors keep their capacity from frame to frame, so steady state culling
+	//       does not allocate
+	if (m_visiblePerChunk.size() < chunkCount)
+		m_visiblePerChunk.resize(chunkCount);
+
+	ThreadPool::Get().ParallelFor(chunkCount, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t chunk = begin; chunk < end; ++chunk)
+			{
+				std::vector<std::uint32_t>& visible = m_visiblePerChunk[chunk];
+				visible.clear();
+				visible.reserve(AtomStore::ChunkCapacity);
+				frustum.CullSpheres(atoms.GetChunk(chunk), chunk * AtomStore::ChunkCapacity, visible);
+			}
+		}
+	);
+
+	// Reserved for every atom, so that more atoms coming into view does not allocate either
+	m_visible.clear();
+	m_visible.reserve(atoms.size());
+	for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+		m_visible.insert(m_visible.end(), m_visiblePerChunk[chunk].begin(), m_visiblePerChunk[chunk].end());
+}
+}
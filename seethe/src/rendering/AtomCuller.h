@@ -0,0 +1,34 @@
+#pragma once
+#include "pch.h"
+#include "simulation/Atom.h"
+#include "utils/Frustum.h"
+
+namespace seethe
+{
+// AtomCuller determines which atoms are inside the view frustum so that only those need to be written to the
+// instance buffer and drawn. When zoomed in, this is usually a small fraction of all the atoms.
+//
+// Each chunk of the atom store is culled independently (in parallel on the shared ThreadPool) with the 4-wide sphere
+// test in Frustum, and the per-chunk results are then concatenated. The visible indices are therefore always in
+// ascending order, which keeps the instance data writes sequential.
+class AtomCuller
+{
+public:
+	AtomCuller() noexcept = default;
+	AtomCuller(const AtomCuller&) noexcept = default;
+	AtomCuller(AtomCuller&&) noexcept = default;
+	AtomCuller& operator=(const AtomCuller&) noexcept = default;
+	AtomCuller& operator=(AtomCuller&&) noexcept = default;
+	~AtomCuller() noexcept = default;
+
+	void Cull(const AtomStore& atoms, const Frustum& frustum) noexcept;
+
+	ND constexpr const std::vector<std::uint32_t>& GetVisibleIndices() const noexcept { return m_visible; }
+	ND constexpr unsigned int GetVisibleCount() const noexcept { return static_cast<unsigned int>(m_visible.size()); }
+
+private:
+	// One list per chunk so that chunks can be culled in parallel without any synchronization
+	std::vector<std::vector<std::uint32_t>> m_visiblePerChunk;
+	std::vector<std::uint32_t> m_visible;
+};
+}
@@ -0,0 +1,63 @@
+#include "AtomDepthSorter.h"
+
+using namespace DirectX;
+
+namespace seethe
+{
+void AtomDepthSorter::Sort(const AtomStore& atoms, std::span<const std::uint32_t> visibleIndices, FXMMATRIX view, float nearZ, float farZ) noexcept
+{
+	constexpr std::uint8_t hidden = 0;
+	constexpr std::uint8_t visible = 1;
+	constexpr std::uint8_t added = 2;
+
+	if (m_state.size() != atoms.size())
+		m_state.assign(atoms.size(), hidden);
+
+	// Every atom could become visible, so reserve for that rather than growing as more of them come into view
+	m_order.reserve(atoms.size());
+	m_keys.reserve(atoms.size());
+	m_sorter.Reserve(atoms.size());
+
+	for (std::uint32_t index : visibleIndices)
+		m_state[index] = visible;
+
+	// Start from last frame's order so the keys are already (nearly) sorted. Atoms that are no longer visible are
+	// dropped and the newly visible atoms go at the end
+	// NOTE: When atoms are added/removed, indices in the old order may refer to different atoms. That only costs a
+	//       less sorted starting point - every visible atom still ends up in the list exactly once
+	size_t kept = 0;
+	for (std::uint32_t index : m_order)
+	{
+		if (index < m_state.size() && m_state[index] == visible)
+		{
+			m_order[kept++] = index;
+			m_state[index] = added;
+		}
+	}
+	m_order.resize(kept);
+
+	for (std::uint32_t index : visibleIndices)
+	{
+		if (m_state[index] == visible)
+			m_order.push_back(index);
+		m_state[index] = hidden;
+	}
+
+	// Only the view space depth is needed, which is the dot product with the 3rd column of the view matrix
+	XMFLOAT4X4 v;
+	XMStoreFloat4x4(&v, view);
+
+	constexpr float maxKey = static_cast<float>((1u << KeyBits) - 1);
+	const float scale = maxKey / std::max(farZ - nearZ, 1e-6f);
+
+	m_keys.resize(m_order.size());
+	for (size_t iii = 0; iii < m_order.size(); ++iii)
+	{
+		const XMFLOAT3& p = atoms[m_order[iii]].position;
+		const float depth = p.x * v._13 + p.y * v._23 + p.z * v._33 + v._43;
+		m_keys[iii] = static_cast<std::uint32_t>(std::clamp((depth - nearZ) * scale, 0.0f, maxKey));
+	}
+
+	m_sorter.Sort(m_keys, m_order, KeyBits);
+}
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "pch.h"
+#include "simulation/Atom.h"
+#include "utils/RadixSort.h"
+
+namespace seethe
+{
+// AtomDepthSorter orders the visible atoms front to back so that the opaque atoms drawn first fill the depth buffer
+// and the Phong pixel shader is skipped (by early depth testing) for most of the atoms hidden behind them.
+//
+// The view space depth of each atom is quantized to a 16 bit key in [near, far] and the atoms are sorted by that key
+// with RadixSorter. The sorted order is remembered, and the next Sort() starts from it (atoms that are no longer
+// visible are dropped and newly visible ones are appended). While the camera moves slowly, that input is already
+// almost sorted, so the sort is close to a single linear pass.
+class AtomDepthSorter
+{
+public:
+	static constexpr unsigned int KeyBits = 16;
+
+	AtomDepthSorter() noexcept = default;
+	AtomDepthSorter(const AtomDepthSorter&) noexcept = default;
+	AtomDepthSorter(AtomDepthSorter&&) noexcept = default;
+	AtomDepthSorter& operator=(const AtomDepthSorter&) noexcept = default;
+	AtomDepthSorter& operator=(AtomDepthSorter&&) noexcept = default;
+	~AtomDepthSorter() noexcept = default;
+
+	void Sort(const AtomStore& atoms, std::span<const std::uint32_t> visibleIndices, DirectX::FXMMATRIX view, float nearZ, float farZ) noexcept;
+
+	// The visible atom indices, nearest first
+	ND constexpr const std::vector<std::uint32_t>& GetSortedIndices() const noexcept { return m_order; }
+	ND constexpr const RadixSorter& GetSorter() const noexcept { return m_sorter; }
+
+private:
+	RadixSorter m_sorter;
+
+	std::vector<std::uint32_t> m_order;
+	std::vector<std::uint32_t> m_keys;
+
+	// Per atom index: whether the atom is visible this frame and whether it has already been added to m_order
+	std::vector<std::uint8_t> m_state;
+};
+}
@@ -0,0 +1,40 @@
+#include "AtomLodSelector.h"
+
+using namespace DirectX;
+
+namespace seethe
+{
+void AtomLodSelector::Select(const AtomStore& atoms, std::span<const std::uint32_t> visibleIndices, FXMMATRIX view, float pixelsPerUnit) noexcept
+{
+	// Any LOD could end up with every atom. Reserving for that up front means the number of visible atoms and the split
+	// between the LODs can change from frame to frame without allocating
+	for (std::vector<std::uint32_t>& instances : m_instances)
+	{
+		instances.clear();
+		instances.reserve(atoms.size());
+	}
+
+	if (m_previousLod.size() != atoms.size())
+		m_previousLod.resize(atoms.size(), NoLod);
+
+	// Only the view space depth is needed, which is the dot product with the 3rd column of the view matrix
+	XMFLOAT4X4 v;
+	XMStoreFloat4x4(&v, view);
+
+	// Atoms that are (partially) behind the near plane are treated as being at this depth so they get full detail
+	constexpr float minimumDepth = 1e-3f;
+
+	for (std::uint32_t index : visibleIndices)
+	{
+		const Atom& atom = atoms[index];
+		const XMFLOAT3& p = atom.position;
+
+		float depth = std::max(p.x * v._13 + p.y * v._23 + p.z * v._33 + v._43, minimumDepth);
+		float projectedRadius = atom.radius * pixelsPerUnit / depth;
+
+		unsigned int lod = LodForRadius(projectedRadius, m_previousLod[index]);
+		m_previousLod[index] = static_cast<std::uint8_t>(lod);
+		m_instances[lod].push_back(index);
+	}
+}
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "pch.h"
+#include "simulation/Atom.h"
+
+namespace seethe
+{
+// AtomLodSelector decides which level of detail sphere mesh each visible atom is drawn with. Atoms are bucketed by
+// their projected radius in pixels, so an atom that covers a couple of pixels is drawn with a few dozen triangles
+// instead of the several hundred that the full detail sphere has.
+//
+// To avoid atoms visibly popping back and forth when they sit right at a threshold (i.e. while the camera slowly
+// zooms), the LOD chosen last frame is remembered for each atom and only changes once the projected radius has moved
+// past the threshold by more than the hysteresis factor.
+class AtomLodSelector
+{
+public:
+	static constexpr unsigned int LodCount = 4;
+
+	// Sphere tessellation (slices/stacks) for each LOD. LOD 0 is the most detailed
+	static constexpr std::array<unsigned int, LodCount> LodTessellation = { 20, 12, 8, 6 };
+
+	// An atom uses the most detailed LOD whose threshold its projected radius (in pixels) is at or above
+	static constexpr std::array<float, LodCount> LodThresholds = { 40.0f, 14.0f, 5.0f, 0.0f };
+	static constexpr float Hysteresis = 0.15f;
+
+	AtomLodSelector() noexcept = default;
+	AtomLodSelector(const AtomLodSelector&) noexcept = default;
+	AtomLodSelector(AtomLodSelector&&) noexcept = default;
+	AtomLodSelector& operator=(const AtomLodSelector&) noexcept = default;
+	AtomLodSelector& operator=(AtomLodSelector&&) noexcept = default;
+	~AtomLodSelector() noexcept = default;
+
+	// 'pixelsPerUnit' is the projected size in pixels of something 1 unit large at a view space depth of 1, which for
+	// a perspective projection is proj._22 * (viewport height / 2)
+	void Select(const AtomStore& atoms, std::span<const std::uint32_t> visibleIndices, DirectX::FXMMATRIX view, float pixelsPerUnit) noexcept;
+
+	ND constexpr const std::vector<std::uint32_t>& GetInstances(unsigned int lod) const noexcept { return m_instances[lod]; }
+	ND constexpr unsigned int GetInstanceCount(unsigned int lod) const noexcept { return static_cast<unsigned int>(m_instances[lod].size()); }
+
+	// Picks the LOD for the given projected radius, taking the LOD used last frame into account
+	ND static constexpr unsigned int LodForRadius(float projectedRadius, unsigned int previousLod) noexcept
+	{
+		if (previousLod >= LodCount)
+		{
+			unsigned int lod = 0;
+			while (projectedRadius < LodThresholds[lod])
+				++lod;
+			return lod;
+		}
+
+		unsigned int lod = previousLod;
+		while (lod > 0 && projectedRadius >= LodThresholds[lod - 1] * (1.0f + Hysteresis))
+			--lod;
+		while (lod < LodCount - 1 && projectedRadius < LodThresholds[lod] * (1.0f - Hysteresis))
+			++lod;
+		return lod;
+	}
+
+private:
+	static_assert(LodThresholds[LodCount - 1] == 0.0f, "The last LOD must accept everything");
+	static constexpr std::uint8_t NoLod = std::numeric_limits<std::uint8_t>::max();
+
+	std::array<std::vector<std::uint32_t>, LodCount> m_instances;
+
+	// LOD used last frame, per atom index
+	// NOTE: This is indexed by atom index, so when atoms are added/removed some atoms may briefly use a stale
+	//       value. The worst case is a single frame where an atom is drawn at a neighboring LOD
+	std::vector<std::uint8_t> m_previousLod;
+};
+}
@@ -0,0 +1,214 @@
+#include "AtomOcclusionCuller.h"
+#include "utils/ThreadPool.h"
+
+using namespace DirectX;
+
+namespace seethe
+{
+AtomOcclusionCuller::AtomOcclusionCuller(unsigned int width, unsigned int height) noexcept :
+	m_width(std::max(4u, width & ~3u)),		// Rows are rasterized 4 pixels at a time
+	m_height(std::max(1u, height))
+{
+	unsigned int w = m_width;
+	unsigned int h = m_height;
+	while (true)
+	{
+		m_levels.push_back({ w, h, std::vector<float>(static_cast<size_t>(w) * h, FLT_MAX) });
+		if (w == 1 && h == 1)
+			break;
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+	}
+}
+
+void AtomOcclusionCuller::Cull(const AtomStore& atoms, std::span<const std::uint32_t> indices, FXMMATRIX view, float fovY, float aspect, float nearZ) noexcept
+{
+	XMStoreFloat4x4(&m_view, view);
+	m_nearZ = nearZ;
+
+	const float tanHalfFovY = std::tan(0.5f * fovY);
+	m_pixelsPerTanX = 0.5f * m_width / (tanHalfFovY * aspect);
+	m_pixelsPerTanY = 0.5f * m_height / tanHalfFovY;
+
+	// 1. Occluders - the nearest atoms that are large enough on screen to fully cover some pixels
+	// NOTE: The pixel radius uses the smaller of the two scales, which keeps the disc conservative if the buffer's
+	//       aspect ratio does not exactly match the viewport
+	const float pixelsPerTan = std::min(m_pixelsPerTanX, m_pixelsPerTanY);
+	constexpr float halfPixelDiagonal = 0.70711f;
+
+	m_occluders.clear();
+	m_occluders.reserve(MaxOccluders);
+	for (size_t iii = 0; iii < indices.size() && m_occluders.size() < MaxOccluders; ++iii)
+	{
+		const Atom& atom = atoms[indices[iii]];
+		const XMFLOAT3 c = ToView(atom.position);
+		if (c.z - atom.radius <= m_nearZ)
+			continue;
+
+		const float distance = std::sqrt(c.x * c.x + c.y * c.y + c.z * c.z);
+		const float coveredRadius = atom.radius / distance * pixelsPerTan - halfPixelDiagonal;
+		if (coveredRadius < MinOccluderRadiusPixels)
+			continue;
+
+		Occluder& occluder = m_occluders.emplace_back();
+		occluder.x = 0.5f * m_width + c.x / c.z * m_pixelsPerTanX;
+		occluder.y = 0.5f * m_height - c.y / c.z * m_pixelsPerTanY;
+		occluder.radiusSq = coveredRadius * coveredRadius;
+		occluder.depth = c.z + atom.radius;
+		occluder.y0 = static_cast<int>(std::floor(occluder.y - coveredRadius));
+		occluder.y1 = static_cast<int>(std::ceil(occluder.y + coveredRadius));
+	}
+
+	// 2. Rasterize the occluders (one band of rows per task) and build the hierarchy
+	const unsigned int bandCount = (m_height + BandHeight - 1) / BandHeight;
+	ThreadPool::Get().ParallelFor(bandCount, 1, [this](size_t begin, size_t end)
+		{
+			for (size_t band = begin; band < end; ++band)
+				RasterizeBand(static_cast<unsigned int>(band));
+		}
+	);
+
+	BuildHierarchy();
+
+	// 3. Test every atom against the hierarchy
+	// Reserved for every atom, so that more atoms coming into view does not allocate
+	m_isVisible.reserve(atoms.size());
+	m_isVisible.resize(indices.size());
+	ThreadPool::Get().ParallelFor(indices.size(), 2048, [&](size_t begin, size_t end)
+		{
+			for (size_t iii = begin; iii < end; ++iii)
+			{
+				const Atom& atom = atoms[indices[iii]];
+				m_isVisible[iii] = !IsOccluded(ToView(atom.position), atom.radius);
+			}
+		}
+	);
+
+	m_visible.clear();
+	m_visible.reserve(atoms.size());
+	for (size_t iii = 0; iii < indices.size(); ++iii)
+	{
+		if (m_isVisible[iii])
+			m_visible.push_back(indices[iii]);
+	}
+	m_occludedCount = indices.size() - m_visible.size();
+}
+
+void AtomOcclusionCuller::RasterizeBand(unsigned int band) noexcept
+{
+	Level& level = m_levels[0];
+	const int rowBegin = static_cast<int>(band * BandHeight);
+	const int rowEnd = std::min(rowBegin + static_cast<int>(BandHeight), static_cast<int>(m_height));
+
+	for (int y = rowBegin; y < rowEnd; ++y)
+		std::fill_n(level.depth.begin() + static_cast<size_t>(y) * m_width, m_width, FLT_MAX);
+
+	const XMVECTOR laneOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+	const XMVECTOR four = XMVectorReplicate(4.0f);
+
+	for (const Occluder& occluder : m_occluders)
+	{
+		if (occluder.y1 < rowBegin || occluder.y0 >= rowEnd)
+			continue;
+
+		const float radius = std::sqrt(occluder.radiusSq);
+		const int x0 = std::max(0, static_cast<int>(std::floor(occluder.x - radius))) & ~3;
+		const int x1 = std::min(static_cast<int>(m_width) - 1, static_cast<int>(std::ceil(occluder.x + radius)));
+		if (x1 < x0)
+			continue;
+
+		const XMVECTOR depth = XMVectorReplicate(occluder.depth);
+		const XMVECTOR radiusSq = XMVectorReplicate(occluder.radiusSq);
+		const XMVECTOR centerX = XMVectorReplicate(occluder.x);
+
+		for (int y = std::max(rowBegin, occluder.y0); y < std::min(rowEnd, occluder.y1 + 1); ++y)
+		{
+			const float dy = (static_cast<float>(y) + 0.5f) - occluder.y;
+			const XMVECTOR dySq = XMVectorReplicate(dy * dy);
+			if (dy * dy > occluder.radiusSq)
+				continue;
+
+			float* row = level.depth.data() + static_cast<size_t>(y) * m_width;
+			XMVECTOR dx = XMVectorSubtract(XMVectorAdd(XMVectorReplicate(static_cast<float>(x0)), laneOffsets), centerX);
+
+			for (int x = x0; x <= x1; x += 4)
+			{
+				// Pixel centers inside the shrunken disc are entirely covered by the occluder
+				const XMVECTOR inside = XMVectorLessOrEqual(XMVectorMultiplyAdd(dx, dx, dySq), radiusSq);
+
+				XMFLOAT4* pixels = reinterpret_cast<XMFLOAT4*>(row + x);
+				const XMVECTOR current = XMLoadFloat4(pixels);
+				XMStoreFloat4(pixels, XMVectorSelect(current, XMVectorMin(current, depth), inside));
+
+				dx = XMVectorAdd(dx, four);
+			}
+		}
+	}
+}
+
+void AtomOcclusionCuller::BuildHierarchy() noexcept
+{
+	for (size_t levelIndex = 1; levelIndex < m_levels.size(); ++levelIndex)
+	{
+		const Level& src = m_levels[levelIndex - 1];
+		Level& dst = m_levels[levelIndex];
+
+		for (unsigned int y = 0; y < dst.height; ++y)
+		{
+			const unsigned int sy0 = 2 * y;
+			const unsigned int sy1 = std::min(2 * y + 1, src.height - 1);
+
+			for (unsigned int x = 0; x < dst.width; ++x)
+			{
+				const unsigned int sx0 = 2 * x;
+				const unsigned int sx1 = std::min(2 * x + 1, src.width - 1);
+
+				dst.depth[static_cast<size_t>(y) * dst.width + x] = std::max(
+					std::max(src.depth[static_cast<size_t>(sy0) * src.width + sx0], src.depth[static_cast<size_t>(sy0) * src.width + sx1]),
+					std::max(src.depth[static_cast<size_t>(sy1) * src.width + sx0], src.depth[static_cast<size_t>(sy1) * src.width + sx1]));
+			}
+		}
+	}
+}
+
+bool AtomOcclusionCuller::IsOccluded(const XMFLOAT3& c, float radius) const noexcept
+{
+	const float zlo = c.z - radius;
+	const float zhi = c.z + radius;
+	if (zlo <= m_nearZ)
+		return false;
+
+	// Conservative screen rectangle of the sphere's bounding box: each edge is projected at whichever depth pushes
+	// it further out
+	const float left = c.x - radius;
+	const float right = c.x + radius;
+	const float bottom = c.y - radius;
+	const float top = c.y + radius;
+
+	const float pxLeft = 0.5f * m_width + left / (left < 0.0f ? zlo : zhi) * m_pixelsPerTanX;
+	const float pxRight = 0.5f * m_width + right / (right > 0.0f ? zlo : zhi) * m_pixelsPerTanX;
+	const float pxTop = 0.5f * m_height - top / (top > 0.0f ? zlo : zhi) * m_pixelsPerTanY;
+	const float pxBottom = 0.5f * m_height - bottom / (bottom < 0.0f ? zlo : zhi) * m_pixelsPerTanY;
+
+	// Anything that reaches off screen is treated as visible - the buffer knows nothing about what is out there
+	if (pxLeft < 0.0f || pxTop < 0.0f || pxRight >= static_cast<float>(m_width) || pxBottom >= static_cast<float>(m_height))
+		return false;
+
+	const unsigned int x0 = static_cast<unsigned int>(pxLeft);
+	const unsigned int x1 = static_cast<unsigned int>(pxRight);
+	const unsigned int y0 = static_cast<unsigned int>(pxTop);
+	const unsigned int y1 = static_cast<unsigned int>(pxBottom);
+
+	// Pick the level where the rectangle spans at most 2 texels in each direction
+	const unsigned int size = std::max(x1 - x0, y1 - y0) + 1;
+	const unsigned int levelIndex = std::min(static_cast<unsigned int>(std::bit_width(size - 1)), GetLevelCount() - 1);
+	const Level& level = m_levels[levelIndex];
+
+	float farthest = 0.0f;
+	for (unsigned int y = y0 >> levelIndex; y <= (y1 >> levelIndex); ++y)
+		for (unsigned int x = x0 >> levelIndex; x <= (x1 >> levelIndex); ++x)
+			farthest = std::max(farthest, level.depth[static_cast<size_t>(y) * level.width + x]);
+
+	return zlo > farthest;
+}
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "pch.h"
+#include "simulation/Atom.h"
+
+namespace seethe
+{
+// AtomOcclusionCuller removes atoms that are hidden behind other atoms before their instance data is packed. In dense
+// liquids and solids most atoms are buried below the outer layer, so this is usually the majority of them.
+//
+// It works on a small software depth buffer (view space depth, 256x144 by default):
+//
+//   1. The nearest atoms (the input is expected to be sorted front to back) are rasterized as occluder discs. For an
+//      atom with view space center c and radius r, every ray whose direction is within r/|c| (in tan space) of the
+//      direction to c is guaranteed to hit the sphere, and never any further than c.z + r. So a disc of that radius
+//      around the projected center, written at depth c.z + r, can only ever claim less occlusion than the atom
+//      really provides. Only pixels that are entirely inside a disc are written, and each pixel keeps the nearest
+//      depth written to it. Rows are split into bands that are rasterized in parallel on the shared ThreadPool, 4
+//      pixels at a time with DirectXMath vectors.
+//   2. A max-depth hierarchy (HiZ) is built on top: each texel holds the farthest depth of the 4 texels below it.
+//   3. Every atom's bounding sphere is projected to a conservative screen rectangle and tested against the HiZ level
+//      where that rectangle covers at most 2x2 texels. The atom is hidden if its nearest point is farther than the
+//      farthest depth in those texels. The tests are also spread across the ThreadPool.
+//
+// The visible atoms keep their input order, so the front to back order from AtomDepthSorter is preserved.
+class AtomOcclusionCuller
+{
+public:
+	static constexpr unsigned int DefaultWidth = 256;
+	static constexpr unsigned int DefaultHeight = 144;
+
+	// Only the nearest atoms are drawn as occluders, and only if their disc fully covers a few pixels
+	static constexpr size_t MaxOccluders = 4096;
+	static constexpr float MinOccluderRadiusPixels = 1.5f;
+
+	static constexpr unsigned int BandHeight = 8;
+
+	AtomOcclusionCuller(unsigned int width = DefaultWidth, unsigned int height = DefaultHeight) noexcept;
+	AtomOcclusionCuller(const AtomOcclusionCuller&) noexcept = default;
+	AtomOcclusionCuller(AtomOcclusionCuller&&) noexcept = default;
+	AtomOcclusionCuller& operator=(const AtomOcclusionCuller&) noexcept = default;
+	AtomOcclusionCuller& operator=(AtomOcclusionCuller&&) noexcept = default;
+	~AtomOcclusionCuller() noexcept = default;
+
+	// 'indices' should be sorted front to back (see AtomDepthSorter) - the first ones are used as occluders
+	void Cull(const AtomStore& atoms, std::span<const std::uint32_t> indices, DirectX::FXMMATRIX view, float fovY, float aspect, float nearZ) noexcept;
+
+	ND constexpr const std::vector<std::uint32_t>& GetVisibleIndices() const noexcept { return m_visible; }
+	ND constexpr size_t GetOccluderCount() const noexcept { return m_occluders.size(); }
+	ND constexpr size_t GetOccludedCount() const noexcept { return m_occludedCount; }
+
+	// Depth buffer/HiZ access (level 0 is the full resolution buffer). Empty texels hold FLT_MAX
+	ND constexpr unsigned int GetLevelCount() const noexcept { return static_cast<unsigned int>(m_levels.size()); }
+	ND constexpr unsigned int GetLevelWidth(unsigned int level) const noexcept { return m_levels[level].width; }
+	ND constexpr unsigned int GetLevelHeight(unsigned int level) const noexcept { return m_levels[level].height; }
+	ND inline float GetDepth(unsigned int level, unsigned int x, unsigned int y) const noexcept { return m_levels[level].depth[static_cast<size_t>(y) * m_levels[level].width + x]; }
+
+	// Tests a single sphere (view space center and radius) against the current HiZ
+	ND bool IsOccluded(const DirectX::XMFLOAT3& center, float radius) const noexcept;
+
+private:
+	struct Occluder
+	{
+		float x;			// Center, in pixels
+		float y;
+		float radiusSq;		// Squared radius (in pixels) of the area where pixels are entirely covered
+		float depth;
+		int y0;				// Rows touched
+		int y1;
+	};
+
+	struct Level
+	{
+		unsigned int width;
+		unsigned int height;
+		std::vector<float> depth;
+	};
+
+	ND inline DirectX::XMFLOAT3 ToView(const DirectX::XMFLOAT3& p) const noexcept
+	{
+		const DirectX::XMFLOAT4X4& v = m_view;
+		return { p.x * v._11 + p.y * v._21 + p.z * v._31 + v._41,
+				 p.x * v._12 + p.y * v._22 + p.z * v._32 + v._42,
+				 p.x * v._13 + p.y * v._23 + p.z * v._33 + v._43 };
+	}
+
+	void RasterizeBand(unsigned int band) noexcept;
+	void BuildHierarchy() noexcept;
+
+	unsigned int m_width;
+	unsigned int m_height;
+	std::vector<Level> m_levels;
+
+	// Per frame view/projection values
+	DirectX::XMFLOAT4X4 m_view = {};
+	float m_nearZ = 1.0f;
+	float m_pixelsPerTanX = 1.0f;
+	float m_pixelsPerTanY = 1.0f;
+
+	std::vector<Occluder> m_occluders;
+	std::vector<std::uint8_t> m_isVisible;
+	std::vector<std::uint32_t> m_visible;
+	size_t m_occludedCount = 0;
+};
+}
@@ -1,4 +1,5 @@
 #include "Camera.h"
+#include "utils/Log.h"
 
 using namespace DirectX;
 
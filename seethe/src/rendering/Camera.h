@@ -1,5 +1,6 @@
 #pragma once
 #include "pch.h"
+#include "utils/Frustum.h"
 #include "utils/Log.h"
 #include "utils/MathHelper.h"
 #include "utils/Timer.h"
@@ -63,6 +64,8 @@ public:
 
 	ND constexpr DirectX::XMFLOAT4X4 GetView4x4f() const noexcept { return m_view; }
 	ND constexpr DirectX::XMFLOAT4X4 GetProj4x4f() const noexcept { return m_proj; }
+	// World space frustum planes for the current view/projection (i.e. for culling)
+	ND inline Frustum GetFrustum() const noexcept { return Frustum(GetView() * GetProj()); }
 
 //	// Strafe/Walk the camera a distance d.
 //	void Strafe(float d) noexcept;
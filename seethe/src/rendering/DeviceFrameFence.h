@@ -0,0 +1,21 @@
+#pragma once
+#include "pch.h"
+#include "DeviceResources.h"
+#include "FrameFence.h"
+
+namespace seethe
+{
+// FrameFence backed by the device's fence. Application::Present() increments the fence value and then signals it,
+// so the frame currently being recorded will signal one more than the current value
+class DeviceFrameFence : public FrameFence
+{
+public:
+	DeviceFrameFence(std::shared_ptr<DeviceResources> deviceResources) noexcept : m_deviceResources(deviceResources) {}
+
+	ND std::uint64_t GetPendingValue() const noexcept override { return m_deviceResources->GetCurrentFenceValue() + 1; }
+	ND std::uint64_t GetCompletedValue() const noexcept override { return m_deviceResources->GetFence()->GetCompletedValue(); }
+
+private:
+	std::shared_ptr<DeviceResources> m_deviceResources;
+};
+}
@@ -1,7 +1,7 @@
 #include "DeviceResources.h"
 #include "utils/Log.h"
 #include "utils/String.h"
-//#include "utils/Profile.h"
+#include "utils/Profiler.h"
 
 
 using Microsoft::WRL::ComPtr;
@@ -22,7 +22,7 @@ namespace seethe
 		m_height(height),
 		m_width(width)
 	{
-		// PROFILE_SCOPE("DeviceResources(HWND hWnd, int height, int width)");
+		PROFILE_SCOPE("DeviceResources(HWND hWnd, int height, int width)");
 
 		CreateDevice();
 		CreateCommandObjects();
@@ -449,7 +449,7 @@ namespace seethe
 
 	void DeviceResources::Present()
 	{
-		// PROFILE_SCOPE("m_swapChain->Present()");
+		PROFILE_SCOPE("m_swapChain->Present()");
 
 		// swap the back and front buffers
 		GFX_THROW_INFO(m_swapChain->Present(0, 0));
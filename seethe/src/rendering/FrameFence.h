@@ -0,0 +1,84 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+// FrameFence is the only thing resource retirement needs to know about GPU synchronization: the fence value that the
+// commands currently being recorded will signal, and the last fence value the GPU has actually reached.
+//
+// NOTE: This is an interface so that the retirement logic can be driven by a ManualFrameFence (and therefore run
+//       without a device). DeviceFrameFence (see DeviceFrameFence.h) is the D3D12 implementation
+class FrameFence
+{
+public:
+	FrameFence() noexcept = default;
+	FrameFence(const FrameFence&) noexcept = default;
+	FrameFence(FrameFence&&) noexcept = default;
+	FrameFence& operator=(const FrameFence&) noexcept = default;
+	FrameFence& operator=(FrameFence&&) noexcept = default;
+	virtual ~FrameFence() noexcept = default;
+
+	// Fence value that will be signaled once the GPU has finished the frame currently being recorded
+	ND virtual std::uint64_t GetPendingValue() const noexcept = 0;
+	// Last fence value the GPU has completed
+	ND virtual std::uint64_t GetCompletedValue() const noexcept = 0;
+};
+
+// FrameFence whose values are set by hand. Useful for exercising RetiredResources without a GPU
+class ManualFrameFence : public FrameFence
+{
+public:
+	ND std::uint64_t GetPendingValue() const noexcept override { return m_pending; }
+	ND std::uint64_t GetCompletedValue() const noexcept override { return m_completed; }
+
+	// Emulate Present(): the frame being recorded is submitted and the next frame will signal a larger value
+	constexpr void Submit() noexcept { ++m_pending; }
+	// Emulate the GPU catching up to 'value'
+	constexpr void Complete(std::uint64_t value) noexcept { m_completed = std::max(m_completed, value); }
+
+private:
+	std::uint64_t m_pending = 1;
+	std::uint64_t m_completed = 0;
+};
+
+// RetiredResources keeps resources that were replaced (i.e. an upload buffer that had to grow) alive until the GPU is
+// done with them. A resource retired while a frame is being recorded may still be used by that frame and by every
+// frame before it, so it is tagged with the fence value of the frame being recorded and released once the GPU has
+// completed that value.
+template <typename Resource>
+class RetiredResources
+{
+public:
+	void Retire(Resource resource, const FrameFence& fence) { m_resources.emplace_back(fence.GetPendingValue(), std::move(resource)); }
+
+	// Releases every resource the GPU has finished with and returns how many were released
+	size_t Release(const FrameFence& fence) noexcept
+	{
+		if (m_resources.empty())
+			return 0;
+
+		const std::uint64_t completed = fence.GetCompletedValue();
+		return std::erase_if(m_resources, [completed](const Entry& entry) { return completed >= entry.fenceValue; });
+	}
+
+	// Hands every resource to 'fn' without looking at the fence (i.e. for a delayed delete when the owner goes away)
+	template <typename F>
+	void ReleaseAll(F&& fn)
+	{
+		for (Entry& entry : m_resources)
+			fn(std::move(entry.resource));
+		m_resources.clear();
+	}
+
+	ND inline size_t GetCount() const noexcept { return m_resources.size(); }
+	ND inline bool IsEmpty() const noexcept { return m_resources.empty(); }
+
+private:
+	struct Entry
+	{
+		std::uint64_t fenceValue;
+		Resource resource;
+	};
+	std::vector<Entry> m_resources;
+};
+}
@@ -1,9 +1,63 @@
 #include "GeometryGenerator.h"
+#include "MeshOptimizer.h"
+#include "utils/Log.h"
 
 using namespace DirectX;
 
 namespace seethe
 {
+namespace
+{
+// Generated meshes, keyed by the generator and its parameters (i.e. "Sphere(1, 20, 20)")
+std::mutex g_meshCacheMutex;
+std::unordered_map<std::string, GeometryGenerator::MeshData> g_meshCache;
+}
+
+GeometryGenerator::MeshData GeometryGenerator::Memoize(const std::string& key, const std::function<MeshData()>& build) noexcept
+{
+	std::lock_guard<std::mutex> lock(g_meshCacheMutex);
+
+	auto it = g_meshCache.find(key);
+	if (it == g_meshCache.end())
+	{
+		MeshData meshData = build();
+
+		VertexCacheStats before = AnalyzeVertexCache(meshData.Indices32, meshData.Vertices.size());
+		size_t verticesBefore = meshData.Vertices.size();
+
+		OptimizeMesh(meshData.Vertices, meshData.Indices32);
+
+		VertexCacheStats after = AnalyzeVertexCache(meshData.Indices32, meshData.Vertices.size());
+		LOG_INFO("GeometryGenerator: {} - vertices {} -> {}, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+			key, verticesBefore, meshData.Vertices.size(), before.ACMR, after.ACMR, before.ATVR, after.ATVR);
+
+		it = g_meshCache.emplace(key, std::move(meshData)).first;
+	}
+
+	return it->second;
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32 sliceCount, uint32 stackCount) noexcept
+{
+	return Memoize(std::format("Sphere({}, {}, {})", radius, sliceCount, stackCount),
+		[=]() { return BuildSphere(radius, sliceCount, stackCount); });
+}
+GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions) noexcept
+{
+	return Memoize(std::format("Geosphere({}, {})", radius, numSubdivisions),
+		[=]() { return BuildGeosphere(radius, numSubdivisions); });
+}
+GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount) noexcept
+{
+	return Memoize(std::format("Cylinder({}, {}, {}, {}, {})", bottomRadius, topRadius, height, sliceCount, stackCount),
+		[=]() { return BuildCylinder(bottomRadius, topRadius, height, sliceCount, stackCount); });
+}
+GeometryGenerator::MeshData GeometryGenerator::CreateArrow(float bottomCylinderRadius, float topCylinderRadius, float headRadius, float cylinderHeight, float headHeight, uint32 sliceCount, uint32 stackCount) noexcept
+{
+	return Memoize(std::format("Arrow({}, {}, {}, {}, {}, {}, {})", bottomCylinderRadius, topCylinderRadius, headRadius, cylinderHeight, headHeight, sliceCount, stackCount),
+		[=]() { return BuildArrow(bottomCylinderRadius, topCylinderRadius, headRadius, cylinderHeight, headHeight, sliceCount, stackCount); });
+}
+
 GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float height, float depth, uint32 numSubdivisions) noexcept
 {
 	MeshData meshData;
@@ -97,7 +151,7 @@ GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float heig
 	return meshData;
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32 sliceCount, uint32 stackCount) noexcept
+GeometryGenerator::MeshData GeometryGenerator::BuildSphere(float radius, uint32 sliceCount, uint32 stackCount) noexcept
 {
 	MeshData meshData;
 
@@ -217,15 +271,17 @@ void GeometryGenerator::Subdivide(MeshData& meshData) noexcept
 	meshData.Vertices.resize(0);
 	meshData.Indices32.resize(0);
 
-	//       v1
-	//       *
-	//      / \
-	//     /   \
-	//  m0*-----*m1
-	//   / \   / \
-	//  /   \ /   \
-	// *-----*-----*
-	// v0    m2     v2
+	/*
+	       v1
+	       *
+	      / \
+	     /   \
+	  m0*-----*m1
+	   / \   / \
+	  /   \ /   \
+	 *-----*-----*
+	 v0    m2     v2
+	*/
 
 	uint32 numTris = (uint32)inputCopy.Indices32.size() / 3;
 	for (uint32 i = 0; i < numTris; ++i)
@@ -302,7 +358,7 @@ GeometryGenerator::Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Ve
 	return v;
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions) noexcept
+GeometryGenerator::MeshData GeometryGenerator::BuildGeosphere(float radius, uint32 numSubdivisions) noexcept
 {
 	MeshData meshData;
 
@@ -377,7 +433,7 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uin
 	return meshData;
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount) noexcept
+GeometryGenerator::MeshData GeometryGenerator::BuildCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount) noexcept
 {
 	MeshData meshData;
 
@@ -471,7 +527,7 @@ GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius
 	return meshData;
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreateArrow(float bottomCylinderRadius, float topCylinderRadius, float headRadius, float cylinderHeight, float headHeight, uint32 sliceCount, uint32 stackCount) noexcept
+GeometryGenerator::MeshData GeometryGenerator::BuildArrow(float bottomCylinderRadius, float topCylinderRadius, float headRadius, float cylinderHeight, float headHeight, uint32 sliceCount, uint32 stackCount) noexcept
 {
 	MeshData meshData; 
 
@@ -600,8 +656,8 @@ GeometryGenerator::MeshData GeometryGenerator::CreateArrow(float bottomCylinderR
 }
 
 
-void GeometryGenerator::BuildCylinderTopCap(float bottomRadius, float topRadius, float height,
-	uint32 sliceCount, uint32 stackCount, MeshData& meshData) noexcept
+void GeometryGenerator::BuildCylinderTopCap([[maybe_unused]] float bottomRadius, float topRadius, float height,
+	uint32 sliceCount, [[maybe_unused]] uint32 stackCount, MeshData& meshData) noexcept
 {
 	uint32 baseIndex = (uint32)meshData.Vertices.size();
 
@@ -636,8 +692,8 @@ void GeometryGenerator::BuildCylinderTopCap(float bottomRadius, float topRadius,
 	}
 }
 
-void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadius, float height,
-	uint32 sliceCount, uint32 stackCount, MeshData& meshData) noexcept
+void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, [[maybe_unused]] float topRadius, float height,
+	uint32 sliceCount, [[maybe_unused]] uint32 stackCount, MeshData& meshData) noexcept
 {
 	// 
 	// Build bottom cap.
@@ -64,6 +64,11 @@ public:
 	///</summary>
 	ND static MeshData CreateBox(float width, float height, float depth, uint32 numSubdivisions) noexcept;
 
+	// NOTE: CreateSphere/CreateGeosphere/CreateCylinder/CreateArrow are memoized per parameter set, so asking for the
+	//       same mesh twice only generates it once. The meshes are also run through the mesh optimizer (duplicate
+	//       vertex welding, vertex cache ordering and vertex fetch ordering) the first time they are generated, since
+	//       they are drawn many times (i.e. the sphere is drawn once per atom)
+
 	///<summary>
 	/// Creates a sphere centered at the origin with the given radius.  The
 	/// slices and stacks parameters control the degree of tessellation.
@@ -98,6 +103,12 @@ public:
 	ND static MeshData CreateQuad(float x, float y, float w, float h, float depth) noexcept;
 
 private:
+	ND static MeshData Memoize(const std::string& key, const std::function<MeshData()>& build) noexcept;
+	ND static MeshData BuildSphere(float radius, uint32 sliceCount, uint32 stackCount) noexcept;
+	ND static MeshData BuildGeosphere(float radius, uint32 numSubdivisions) noexcept;
+	ND static MeshData BuildCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount) noexcept;
+	ND static MeshData BuildArrow(float bottomCylinderRadius, float topCylinderRadius, float headRadius, float cylinderHeight, float headHeight, uint32 sliceCount, uint32 stackCount) noexcept;
+
 	static void Subdivide(MeshData& meshData) noexcept;
 	ND static Vertex MidPoint(const Vertex& v0, const Vertex& v1) noexcept;
 	static void BuildCylinderTopCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData) noexcept;
@@ -0,0 +1,141 @@
+#include "MeshOptimizer.h"
+#include "utils/Log.h"
+
+namespace seethe
+{
+VertexCacheStats AnalyzeVertexCache(std::span<const std::uint32_t> indices, size_t vertexCount, unsigned int cacheSize) noexcept
+{
+	VertexCacheStats stats;
+	if (indices.size() < 3 || vertexCount == 0)
+		return stats;
+
+	// FIFO cache: a vertex is in the cache if it was inserted within the last 'cacheSize' misses
+	std::vector<size_t> insertedAt(vertexCount, std::numeric_limits<size_t>::max());
+	size_t misses = 0;
+
+	for (std::uint32_t index : indices)
+	{
+		if (insertedAt[index] == std::numeric_limits<size_t>::max() || misses - insertedAt[index] >= cacheSize)
+		{
+			insertedAt[index] = misses;
+			++misses;
+		}
+	}
+
+	stats.ACMR = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+	stats.ATVR = static_cast<float>(misses) / static_cast<float>(vertexCount);
+	return stats;
+}
+
+std::vector<std::uint32_t> OptimizeVertexCache(std::span<const std::uint32_t> indices, size_t vertexCount, unsigned int cacheSize)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return std::vector<std::uint32_t>(indices.begin(), indices.end());
+
+	// Vertex -> triangle adjacency (compressed: the triangles of vertex v are at [offsets[v], offsets[v + 1]))
+	std::vector<std::uint32_t> liveTriangles(vertexCount, 0);
+	for (size_t iii = 0; iii < triangleCount * 3; ++iii)
+		++liveTriangles[indices[iii]];
+
+	std::vector<std::uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v)
+		offsets[v + 1] = offsets[v] + liveTriangles[v];
+
+	std::vector<std::uint32_t> adjacency(offsets[vertexCount]);
+	{
+		std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t iii = 0; iii < triangleCount * 3; ++iii)
+			adjacency[fill[indices[iii]]++] = static_cast<std::uint32_t>(iii / 3);
+	}
+
+	std::vector<std::uint32_t> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<std::uint32_t> deadEnd;
+	std::vector<std::uint32_t> candidates;
+
+	std::vector<std::uint32_t> output;
+	output.reserve(triangleCount * 3);
+
+	std::uint32_t time = cacheSize + 1;
+	size_t cursor = 0;
+	std::int64_t fanning = 0;
+
+	while (fanning >= 0)
+	{
+		// Emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		const std::uint32_t f = static_cast<std::uint32_t>(fanning);
+		for (std::uint32_t a = offsets[f]; a < offsets[f + 1]; ++a)
+		{
+			const std::uint32_t triangle = adjacency[a];
+			if (emitted[triangle])
+				continue;
+
+			for (unsigned int corner = 0; corner < 3; ++corner)
+			{
+				const std::uint32_t v = indices[triangle * 3 + corner];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				--liveTriangles[v];
+
+				if (time - cacheTime[v] > cacheSize)
+					cacheTime[v] = time++;
+			}
+			emitted[triangle] = true;
+		}
+
+		// Next fanning vertex: the candidate that is still in the cache and will stay there while its remaining
+		// triangles are emitted, preferring the one that entered the cache earliest
+		fanning = -1;
+		std::int64_t bestPriority = -1;
+		for (std::uint32_t v : candidates)
+		{
+			if (liveTriangles[v] == 0)
+				continue;
+
+			std::int64_t priority = 0;
+			if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+				priority = time - cacheTime[v];
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				fanning = v;
+			}
+		}
+
+		// Dead end: go back through the recently used vertices, and then just scan for any vertex with triangles left
+		while (fanning < 0 && !deadEnd.empty())
+		{
+			const std::uint32_t v = deadEnd.back();
+			deadEnd.pop_back();
+			if (liveTriangles[v] > 0)
+				fanning = v;
+		}
+		while (fanning < 0 && cursor < vertexCount)
+		{
+			if (liveTriangles[cursor] > 0)
+				fanning = static_cast<std::int64_t>(cursor);
+			++cursor;
+		}
+	}
+
+	ASSERT(output.size() == triangleCount * 3, "Every triangle should have been emitted exactly once");
+	return output;
+}
+
+size_t BuildVertexFetchRemap(std::span<const std::uint32_t> indices, size_t vertexCount, std::vector<std::uint32_t>& remap)
+{
+	remap.assign(vertexCount, InvalidVertex);
+
+	std::uint32_t next = 0;
+	for (std::uint32_t index : indices)
+	{
+		if (remap[index] == InvalidVertex)
+			remap[index] = next++;
+	}
+	return next;
+}
+}
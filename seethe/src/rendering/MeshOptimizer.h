@@ -0,0 +1,93 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+// Post-transform vertex cache statistics for an indexed triangle list, simulated with a FIFO cache
+//   ACMR (average cache miss ratio) = vertices transformed / triangles.      Lower bound ~0.5, naive meshes ~1.0+
+//   ATVR (average transform to vertex ratio) = vertices transformed / vertices.  1.0 is ideal
+struct VertexCacheStats
+{
+	float ACMR = 0.0f;
+	float ATVR = 0.0f;
+};
+
+ND VertexCacheStats AnalyzeVertexCache(std::span<const std::uint32_t> indices, size_t vertexCount, unsigned int cacheSize = 16) noexcept;
+
+// Reorders the triangles so that they reuse vertices that are still in the post-transform cache (Tipsify, Sander et
+// al. 2007). Triangles are walked as fans around a "fanning" vertex, and the next fanning vertex is the neighbor
+// that will still be in the cache after all of its remaining triangles are emitted. The winding of every triangle is
+// kept as is.
+ND std::vector<std::uint32_t> OptimizeVertexCache(std::span<const std::uint32_t> indices, size_t vertexCount, unsigned int cacheSize = 16);
+
+// Builds the remap table for reordering the vertices into the order they are first referenced by 'indices', so the
+// vertex fetches walk through memory linearly. Unreferenced vertices map to InvalidVertex. Returns the number of
+// referenced vertices
+inline constexpr std::uint32_t InvalidVertex = std::numeric_limits<std::uint32_t>::max();
+size_t BuildVertexFetchRemap(std::span<const std::uint32_t> indices, size_t vertexCount, std::vector<std::uint32_t>& remap);
+
+// Reorders 'vertices' for linear fetching and rewrites 'indices' to match (unreferenced vertices are dropped)
+template<typename V>
+void OptimizeVertexFetch(std::vector<V>& vertices, std::vector<std::uint32_t>& indices)
+{
+	std::vector<std::uint32_t> remap;
+	const size_t count = BuildVertexFetchRemap(indices, vertices.size(), remap);
+
+	std::vector<V> reordered(count);
+	for (size_t iii = 0; iii < vertices.size(); ++iii)
+	{
+		if (remap[iii] != InvalidVertex)
+			reordered[remap[iii]] = vertices[iii];
+	}
+
+	for (std::uint32_t& index : indices)
+		index = remap[index];
+
+	vertices = std::move(reordered);
+}
+
+// Merges vertices that are bit for bit identical and points the indices at the surviving copy. Only exact duplicates
+// are merged, so seams that need distinct normals/texture coordinates are left alone
+// NOTE: The vertices themselves are not removed here - OptimizeVertexFetch() drops the ones that are no longer used
+template<typename V>
+void WeldVertices(std::span<const V> vertices, std::vector<std::uint32_t>& indices)
+{
+	static_assert(std::is_trivially_copyable_v<V>);
+
+	auto less = [&vertices](std::uint32_t a, std::uint32_t b)
+		{
+			int cmp = memcmp(&vertices[a], &vertices[b], sizeof(V));
+			return cmp < 0 || (cmp == 0 && a < b);
+		};
+
+	std::vector<std::uint32_t> order(vertices.size());
+	std::iota(order.begin(), order.end(), 0u);
+	std::sort(order.begin(), order.end(), less);
+
+	// Every vertex maps to the lowest index with the same contents
+	std::vector<std::uint32_t> canonical(vertices.size());
+	for (size_t iii = 0; iii < order.size(); ++iii)
+	{
+		const bool sameAsPrevious = iii > 0 && memcmp(&vertices[order[iii]], &vertices[order[iii - 1]], sizeof(V)) == 0;
+		canonical[order[iii]] = sameAsPrevious ? canonical[order[iii - 1]] : order[iii];
+	}
+
+	for (std::uint32_t& index : indices)
+		index = canonical[index];
+}
+
+// Runs all of the above: welding, vertex cache ordering and then vertex fetch ordering
+// NOTE: Small meshes whose rings already fit in the cache can be in a better order than Tipsify produces, so the new
+//       triangle order is only kept if it actually lowers the ACMR
+template<typename V>
+void OptimizeMesh(std::vector<V>& vertices, std::vector<std::uint32_t>& indices, unsigned int cacheSize = 16)
+{
+	WeldVertices(std::span<const V>(vertices), indices);
+
+	std::vector<std::uint32_t> reordered = OptimizeVertexCache(indices, vertices.size(), cacheSize);
+	if (AnalyzeVertexCache(reordered, vertices.size(), cacheSize).ACMR < AnalyzeVertexCache(indices, vertices.size(), cacheSize).ACMR)
+		indices = std::move(reordered);
+
+	OptimizeVertexFetch(vertices, indices);
+}
+}
@@ -2,6 +2,7 @@
 #include "pch.h"
 #include "RootConstantBufferView.h"
 #include "RootDescriptorTable.h"
+#include "RootShaderResourceView.h"
 #include "utils/Log.h"
 #include "utils/Timer.h"
 
@@ -21,6 +22,9 @@ public:
 
 		for (auto& dt : m_descriptorTables)
 			dt.Update(&dt, timer, frameIndex);
+
+		for (auto& srv : m_shaderResourceViews)
+			srv.Update(&srv, timer, frameIndex);
 	}
 
 	constexpr void PushBackRootConstantBufferView(RootConstantBufferView&& rcbv) noexcept { m_constantBufferViews.push_back(std::move(rcbv)); }
@@ -31,11 +35,17 @@ public:
 	constexpr void PushBackRootDescriptorTable(const RootDescriptorTable& rdt) noexcept { m_descriptorTables.push_back(rdt); }
 	constexpr RootDescriptorTable& EmplaceBackRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE descriptorHandle) noexcept { return m_descriptorTables.emplace_back(rootParameterIndex, descriptorHandle); }
 
+	constexpr void PushBackRootShaderResourceView(RootShaderResourceView&& srv) noexcept { m_shaderResourceViews.push_back(std::move(srv)); }
+	constexpr void PushBackRootShaderResourceView(const RootShaderResourceView& srv) noexcept { m_shaderResourceViews.push_back(srv); }
+	constexpr RootShaderResourceView& EmplaceBackRootShaderResourceView(UINT rootParameterIndex) noexcept { return m_shaderResourceViews.emplace_back(rootParameterIndex); }
+
 	// See here for article on 'deducing this' pattern: https://devblogs.microsoft.com/cppblog/cpp23-deducing-this/
 	template <class Self>
 	ND constexpr auto&& GetRootConstantBufferViews(this Self&& self) noexcept { return std::forward<Self>(self).m_constantBufferViews; }
 	template <class Self>
 	ND constexpr auto&& GetRootDescriptorTables(this Self&& self) noexcept { return std::forward<Self>(self).m_descriptorTables; }
+	template <class Self>
+	ND constexpr auto&& GetRootShaderResourceViews(this Self&& self) noexcept { return std::forward<Self>(self).m_shaderResourceViews; }
 
 	ND constexpr bool IsActive() const noexcept { return m_active; }
 	constexpr void SetActive(bool active) noexcept { m_active = active; }
@@ -47,6 +57,9 @@ protected:
 	// 0+ descriptor tables for per-item resources
 	std::vector<RootDescriptorTable> m_descriptorTables;
 
+	// 0+ root shader resource views for per-item structured buffers
+	std::vector<RootShaderResourceView> m_shaderResourceViews;
+
 	bool m_active = true;
 };
 
@@ -4,6 +4,7 @@
 #include "utils/Timer.h"
 #include "RootSignature.h"
 #include "RootConstantBufferView.h"
+#include "RootShaderResourceView.h"
 #include "RenderPassLayer.h"
 #include "ComputeLayer.h"
 
@@ -30,6 +31,7 @@ public:
 		PostWork(std::move(rhs.PostWork)),
 		m_rootSignature(rhs.m_rootSignature),
 		m_constantBufferViews(std::move(rhs.m_constantBufferViews)),
+		m_shaderResourceViews(std::move(rhs.m_shaderResourceViews)),
 		m_renderPassLayers(std::move(rhs.m_renderPassLayers)),
 		m_computeLayers(std::move(rhs.m_computeLayers)),
 		m_name(std::move(rhs.m_name))
@@ -40,6 +42,7 @@ public:
 		PostWork = std::move(rhs.PostWork);
 		m_rootSignature = rhs.m_rootSignature;
 		m_constantBufferViews = std::move(rhs.m_constantBufferViews);
+		m_shaderResourceViews = std::move(rhs.m_shaderResourceViews);
 		m_renderPassLayers = std::move(rhs.m_renderPassLayers);
 		m_computeLayers = std::move(rhs.m_computeLayers);
 		m_name = std::move(rhs.m_name);
@@ -53,6 +56,10 @@ public:
 		// Loop over the constant buffer views to update per-pass constants
 		for (auto& rcbv : m_constantBufferViews)
 			rcbv.Update(timer, frameIndex);
+
+		// Then the shader resource views (these come second so they can rely on the per-pass constants being current)
+		for (auto& srv : m_shaderResourceViews)
+			srv.Update(&srv, timer, frameIndex);
 	}
 
 
@@ -62,6 +69,8 @@ public:
 	template <class Self>
 	ND constexpr auto&& GetRootConstantBufferViews(this Self&& self) noexcept { return std::forward<Self>(self).m_constantBufferViews; }
 	template <class Self>
+	ND constexpr auto&& GetRootShaderResourceViews(this Self&& self) noexcept { return std::forward<Self>(self).m_shaderResourceViews; }
+	template <class Self>
 	ND constexpr auto&& GetRenderPassLayers(this Self&& self) noexcept { return std::forward<Self>(self).m_renderPassLayers; }
 	template <class Self>
 	ND constexpr auto&& GetComputeLayers(this Self&& self) noexcept { return std::forward<Self>(self).m_computeLayers; }
@@ -72,10 +81,12 @@ public:
 	constexpr void SetName(std::string_view name) noexcept { m_name = name; }
 
 	constexpr void PushBackRootConstantBufferView(RootConstantBufferView&& rcbv) noexcept { m_constantBufferViews.push_back(std::move(rcbv)); }
+	constexpr void PushBackRootShaderResourceView(RootShaderResourceView&& srv) noexcept { m_shaderResourceViews.push_back(std::move(srv)); }
 	constexpr void PushBackRenderPassLayer(RenderPassLayer&& rpl) noexcept { m_renderPassLayers.push_back(std::move(rpl)); }
 	constexpr void PushBackComputeLayer(ComputeLayer&& cl) noexcept { m_computeLayers.push_back(std::move(cl)); }
 
 	constexpr RootConstantBufferView& EmplaceBackRootConstantBufferView(UINT rootParameterIndex, ConstantBufferBase* cb) noexcept { return m_constantBufferViews.emplace_back(rootParameterIndex, cb); }
+	constexpr RootShaderResourceView& EmplaceBackRootShaderResourceView(UINT rootParameterIndex) noexcept { return m_shaderResourceViews.emplace_back(rootParameterIndex); }
 	RenderPassLayer& EmplaceBackRenderPassLayer(std::shared_ptr<DeviceResources> deviceResources,
 		std::shared_ptr<MeshGroupBase> meshGroup,
 		const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
@@ -102,6 +113,9 @@ private:
 	// 0+ constant buffer views for per-pass constants
 	std::vector<RootConstantBufferView> m_constantBufferViews;
 
+	// 0+ shader resource views for per-pass buffers
+	std::vector<RootShaderResourceView> m_shaderResourceViews;
+
 	// 0+ render layers
 	std::vector<RenderPassLayer> m_renderPassLayers;
 
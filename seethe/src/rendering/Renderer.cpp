@@ -83,6 +83,14 @@ void Renderer::Render(const Simulation& simulation, int frameIndex)
 			);
 		}
 
+		// Bind any per-pass shader resource views
+		for (const RootShaderResourceView& srv : pass.GetRootShaderResourceViews())
+		{
+			GFX_THROW_INFO_ONLY(
+				commandList->SetGraphicsRootShaderResourceView(srv.GetRootParameterIndex(), srv.GetGPUVirtualAddress())
+			);
+		}
+
 		// Render the render layers for the pass
 		for (const RenderPassLayer& layer : pass.GetRenderPassLayers())
 		{
@@ -130,6 +138,13 @@ void Renderer::Render(const Simulation& simulation, int frameIndex)
 					);
 				}
 
+				for (const RootShaderResourceView& srv : item.GetRootShaderResourceViews())
+				{
+					GFX_THROW_INFO_ONLY(
+						commandList->SetGraphicsRootShaderResourceView(srv.GetRootParameterIndex(), srv.GetGPUVirtualAddress())
+					);
+				}
+
 				SubmeshGeometry mesh = meshGroup->GetSubmesh(item.GetSubmeshIndex());
 				GFX_THROW_INFO_ONLY(
 					commandList->DrawIndexedInstanced(mesh.IndexCount, item.GetInstanceCount(), mesh.StartIndexLocation, mesh.BaseVertexLocation, 0)
@@ -175,6 +190,12 @@ void Renderer::RunComputeLayer(const ComputeLayer& layer, const Timer* timer, in
 				commandList->SetComputeRootConstantBufferView(cbv.GetRootParameterIndex(), cbv.GetConstantBuffer()->GetGPUVirtualAddress(frameIndex))
 			);
 		}
+		for (const RootShaderResourceView& srv : item.GetRootShaderResourceViews())
+		{
+			GFX_THROW_INFO_ONLY(
+				commandList->SetComputeRootShaderResourceView(srv.GetRootParameterIndex(), srv.GetGPUVirtualAddress())
+			);
+		}
 
 		GFX_THROW_INFO_ONLY(commandList->Dispatch(item.GetThreadGroupCountX(), item.GetThreadGroupCountY(), item.GetThreadGroupCountZ()));
 	}
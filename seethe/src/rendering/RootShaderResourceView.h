@@ -0,0 +1,35 @@
+#pragma once
+#include "pch.h"
+#include "utils/Timer.h"
+
+
+namespace seethe
+{
+// Root SRV (i.e. a StructuredBuffer bound directly in the root signature). Unlike a RootConstantBufferView, the
+// address is not tied to a single buffer - each frame resource's copy of a VersionedUploadBuffer lives at a different
+// address, so the Update function is expected to set the address for the current frame
+class RootShaderResourceView
+{
+public:
+	inline RootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address = 0) noexcept :
+		m_rootParameterIndex(rootParameterIndex),
+		m_gpuVirtualAddress(address)
+	{}
+	RootShaderResourceView(const RootShaderResourceView&) noexcept = default;
+	RootShaderResourceView(RootShaderResourceView&&) noexcept = default;
+	RootShaderResourceView& operator=(const RootShaderResourceView&) noexcept = default;
+	RootShaderResourceView& operator=(RootShaderResourceView&&) noexcept = default;
+	~RootShaderResourceView() noexcept = default;
+
+	std::function<void(RootShaderResourceView*, const Timer&, int)> Update = [](RootShaderResourceView*, const Timer&, int) {};
+
+	ND constexpr UINT GetRootParameterIndex() const noexcept { return m_rootParameterIndex; }
+	ND constexpr D3D12_GPU_VIRTUAL_ADDRESS GetGPUVirtualAddress() const noexcept { return m_gpuVirtualAddress; }
+
+	constexpr void SetGPUVirtualAddress(D3D12_GPU_VIRTUAL_ADDRESS address) noexcept { m_gpuVirtualAddress = address; }
+
+private:
+	UINT m_rootParameterIndex;
+	D3D12_GPU_VIRTUAL_ADDRESS m_gpuVirtualAddress;
+};
+}
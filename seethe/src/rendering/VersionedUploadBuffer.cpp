@@ -0,0 +1,58 @@
+#include "VersionedUploadBuffer.h"
+
+namespace seethe
+{
+VersionedUploadBufferBase::VersionedUploadBufferBase(std::shared_ptr<DeviceResources> deviceResources) noexcept :
+	m_deviceResources(deviceResources),
+	m_fence(deviceResources)
+{
+	ASSERT(m_deviceResources != nullptr, "No device resources");
+}
+
+VersionedUploadBufferBase::~VersionedUploadBufferBase() noexcept
+{
+	// The buffers might still be in use by the GPU, so do a delayed delete
+	if (m_deviceResources != nullptr)
+	{
+		m_retiredBuffers.ReleaseAll([this](Microsoft::WRL::ComPtr<ID3D12Resource> buffer) { m_deviceResources->DelayedDelete(buffer); });
+
+		if (m_uploadBuffer != nullptr)
+			m_deviceResources->DelayedDelete(m_uploadBuffer);
+	}
+}
+
+void VersionedUploadBufferBase::CreateBuffer(size_t regionByteSize)
+{
+	auto props = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	auto desc = CD3DX12_RESOURCE_DESC::Buffer(static_cast<UINT64>(regionByteSize) * g_numFrameResources);
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> buffer = nullptr;
+	GFX_THROW_INFO(
+		m_deviceResources->GetDevice()->CreateCommittedResource(
+			&props,
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&buffer)
+		)
+	);
+
+	BYTE* mappedData = nullptr;
+	GFX_THROW_INFO(
+		buffer->Map(0, nullptr, reinterpret_cast<void**>(&mappedData))
+	);
+
+	if (m_uploadBuffer != nullptr)
+		m_retiredBuffers.Retire(m_uploadBuffer, m_fence);
+
+	m_uploadBuffer = buffer;
+	m_mappedData = mappedData;
+	m_regionByteSize = regionByteSize;
+}
+
+void VersionedUploadBufferBase::ReleaseRetiredBuffers() noexcept
+{
+	m_retiredBuffers.Release(m_fence);
+}
+}
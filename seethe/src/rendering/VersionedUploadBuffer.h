@@ -0,0 +1,131 @@
+#pragma once
+#include "pch.h"
+#include "DeviceResources.h"
+#include "DeviceFrameFence.h"
+#include "utils/Constants.h"
+#include "utils/DirtyRangeTracker.h"
+#include "utils/FrameStats.h"
+
+namespace seethe
+{
+class VersionedUploadBufferBase
+{
+public:
+	VersionedUploadBufferBase(std::shared_ptr<DeviceResources> deviceResources) noexcept;
+	VersionedUploadBufferBase(VersionedUploadBufferBase&&) noexcept = default;
+	VersionedUploadBufferBase& operator=(VersionedUploadBufferBase&&) noexcept = default;
+	virtual ~VersionedUploadBufferBase() noexcept;
+
+	ND inline D3D12_GPU_VIRTUAL_ADDRESS GetGPUVirtualAddress(unsigned int frameIndex) const noexcept
+	{
+		return m_uploadBuffer->GetGPUVirtualAddress() + static_cast<UINT64>(frameIndex) * m_regionByteSize;
+	}
+
+	// Number of bytes written by the most recent Update() (useful to verify that an idle scene uploads nothing)
+	ND constexpr size_t GetBytesCopiedLastUpdate() const noexcept { return m_bytesCopiedLastUpdate; }
+
+protected:
+	VersionedUploadBufferBase(const VersionedUploadBufferBase&) = delete;
+	VersionedUploadBufferBase& operator=(const VersionedUploadBufferBase&) = delete;
+
+	// Replaces the buffer with one that has 'regionByteSize' bytes per frame resource. The old buffer may still be in
+	// use by the frames in flight, so it is only released once the frame currently being recorded has completed
+	void CreateBuffer(size_t regionByteSize);
+	void ReleaseRetiredBuffers() noexcept;
+
+	std::shared_ptr<DeviceResources> m_deviceResources;
+	DeviceFrameFence m_fence;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_uploadBuffer = nullptr;
+	BYTE* m_mappedData = nullptr;
+	size_t m_regionByteSize = 0;
+	size_t m_bytesCopiedLastUpdate = 0;
+
+	RetiredResources<Microsoft::WRL::ComPtr<ID3D12Resource>> m_retiredBuffers;
+};
+
+// VersionedUploadBuffer keeps one persistently mapped copy of an array per frame resource (like ConstantBufferMapped,
+// but without the 64 KB limit and read through a root SRV). Each copy remembers the version of the DirtyRangeTracker it
+// was last synced to, so Update() only copies the ranges that changed since that copy was last written. If nothing
+// changed, Update() does nothing at all, which is what keeps an idle scene from re-uploading every instance every frame.
+//
+// NOTE: The copy for 'frameIndex' may only be written once the GPU is done with that frame resource. That is already
+//       guaranteed by Application::Update(), which waits on the frame resource's fence before updating anything
+template<typename T>
+class VersionedUploadBuffer : public VersionedUploadBufferBase
+{
+public:
+	VersionedUploadBuffer(std::shared_ptr<DeviceResources> deviceResources, size_t initialCapacity = 1024) :
+		VersionedUploadBufferBase(deviceResources)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		Reserve(std::max<size_t>(initialCapacity, 1));
+	}
+	VersionedUploadBuffer(VersionedUploadBuffer&&) noexcept = default;
+	VersionedUploadBuffer& operator=(VersionedUploadBuffer&&) noexcept = default;
+	virtual ~VersionedUploadBuffer() noexcept override = default;
+
+	// Brings the copy for 'frameIndex' up to date with 'source'. 'changes' must describe every change made to 'source'
+	void Update(unsigned int frameIndex, std::span<const T> source, const DirtyRangeTracker& changes)
+	{
+		ASSERT(frameIndex < static_cast<unsigned int>(g_numFrameResources), "Invalid frame index");
+
+		ReleaseRetiredBuffers();
+		m_bytesCopiedLastUpdate = 0;
+
+		if (source.size() > m_capacity)
+			Reserve(std::max(source.size(), m_capacity * 2));
+
+		Region& region = m_regions[frameIndex];
+		if (region.version == changes.Version() && region.size == source.size())
+			return;
+
+		T* destination = reinterpret_cast<T*>(m_mappedData + frameIndex * m_regionByteSize);
+
+		if (region.size == source.size() && changes.CollectSince(region.version, m_ranges))
+		{
+			for (const IndexRange& range : m_ranges)
+			{
+				const size_t end = std::min(range.end, source.size());
+				if (range.begin < end)
+				{
+					memcpy(destination + range.begin, source.data() + range.begin, (end - range.begin) * sizeof(T));
+					m_bytesCopiedLastUpdate += (end - range.begin) * sizeof(T);
+				}
+			}
+		}
+		else
+		{
+			memcpy(destination, source.data(), source.size_bytes());
+			m_bytesCopiedLastUpdate = source.size_bytes();
+		}
+
+		region.version = changes.Version();
+		region.size = source.size();
+		FrameStats::Get().AddUploadBytes(m_bytesCopiedLastUpdate);
+	}
+
+	ND constexpr size_t GetCapacity() const noexcept { return m_capacity; }
+
+private:
+	void Reserve(size_t capacity)
+	{
+		// Root SRV/CBV addresses must be aligned to 256 bytes, so every region must start on a 256 byte boundary
+		const size_t alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+		CreateBuffer((capacity * sizeof(T) + alignment - 1) & ~(alignment - 1));
+
+		m_capacity = capacity;
+		m_regions.fill({});
+	}
+
+	struct Region
+	{
+		std::uint64_t version = DirtyRangeTracker::NoVersion;
+		size_t size = 0;
+	};
+
+	size_t m_capacity = 0;
+	std::array<Region, g_numFrameResources> m_regions;
+	std::vector<IndexRange> m_ranges;
+};
+}
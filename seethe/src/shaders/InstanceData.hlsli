@@ -10,4 +10,29 @@ struct InstanceData
     uint Pad0;
     uint Pad1;
     uint Pad2;
-};
\ No newline at end of file
+};
+
+// Compact per-atom instance data. Atoms are always uniformly scaled spheres, so instead of a full world matrix we
+// only send the position and radius and expand that into a world transform in the vertex shader. The material index
+// and the ambient occlusion byte are stored in the low 13 bits of the radius (see AtomInstanceData in InstanceData.h)
+// NOTE: This is read from a StructuredBuffer (root SRV) so, unlike InstanceData, there is no maximum instance count
+
+struct AtomInstanceData
+{
+    float3 Position;
+    uint RadiusAndMaterial;
+};
+
+float UnpackAtomRadius(uint radiusAndMaterial)
+{
+    return asfloat(radiusAndMaterial & 0xFFFFE000);
+}
+uint UnpackAtomMaterialIndex(uint radiusAndMaterial)
+{
+    return radiusAndMaterial & 0x1F;
+}
+// Fraction of the ambient light that reaches the atom (1 = unoccluded)
+float UnpackAtomAmbientAccess(uint radiusAndMaterial)
+{
+    return float((radiusAndMaterial >> 5) & 0xFF) / 255.0f;
+}
\ No newline at end of file
@@ -16,4 +16,14 @@ struct PerPassData
     float FarZ;
     float TotalTime;
     float DeltaTime;
+    float2 ViewportTopLeft;
+    float2 InvViewportSize;
+    uint ClusterCountX;
+    uint ClusterCountY;
+    uint ClusterCountZ;
+    float ClusterDepthScale;
+    float ClusterDepthBias;
+    float Pad2;
+    float Pad3;
+    float Pad4;
 };
\ No newline at end of file
@@ -0,0 +1,73 @@
+// Defaults for number of lights.
+#ifndef NUM_DIR_LIGHTS
+#define NUM_DIR_LIGHTS 3
+#endif
+
+#ifndef NUM_POINT_LIGHTS
+#define NUM_POINT_LIGHTS 0
+#endif
+
+#ifndef NUM_SPOT_LIGHTS
+#define NUM_SPOT_LIGHTS 0
+#endif
+
+#include "InstanceData.hlsli"
+#include "Lighting.hlsli"
+#include "PerPassData.hlsli"
+
+StructuredBuffer<AtomInstanceData> gAtomInstances : register(t0);
+
+cbuffer cbPass : register(b1)
+{
+    PerPassData gPerPassData;
+};
+
+cbuffer cbLighting : register(b2)
+{
+    SceneLighting gLighting;
+};
+
+cbuffer cbMaterial : register(b3)
+{
+    Material gMaterial[NUM_MATERIALS];
+};
+
+
+struct VertexIn
+{
+    float3 PosL : POSITION;
+    float3 NormalL : NORMAL;
+};
+
+struct VertexOut
+{
+    float4 PosH : SV_POSITION;
+    float3 PosW : POSITION;
+    float3 NormalW : NORMAL;
+    nointerpolation uint MaterialIndex : MATERIAL_INDEX;
+    nointerpolation float AmbientAccess : AMBIENT_ACCESS;
+};
+
+
+VertexOut main(VertexIn vin, uint instanceID : SV_InstanceID)
+{
+    VertexOut vout = (VertexOut) 0.0f;
+    
+    AtomInstanceData instance = gAtomInstances[instanceID];
+    float radius = UnpackAtomRadius(instance.RadiusAndMaterial);
+    
+    // The world transform of an atom is just a uniform scale by its radius followed by a translation
+    float3 posW = vin.PosL * radius + instance.Position;
+    vout.PosW = posW;
+
+    // Uniform scaling does not change the direction of the normal
+    vout.NormalW = vin.NormalL;
+
+    // Transform to homogeneous clip space.
+    vout.PosH = mul(float4(posW, 1.0f), gPerPassData.ViewProj);
+    
+    vout.MaterialIndex = UnpackAtomMaterialIndex(instance.RadiusAndMaterial);
+    vout.AmbientAccess = UnpackAtomAmbientAccess(instance.RadiusAndMaterial);
+
+    return vout;
+}
@@ -42,12 +42,31 @@ cbuffer cbMaterial : register(b3)
     Material gMaterial[NUM_MATERIALS];
 };
 
+// Clustered lighting: (offset, count) into gLightIndices for each cluster, and the point/spot light indices themselves
+StructuredBuffer<uint2> gLightClusters : register(t1);
+StructuredBuffer<uint> gLightIndices : register(t2);
+
+uint ClusterIndex(float4 posH)
+{
+    // SV_Position is relative to the render target, but the clusters only cover the viewport
+    float2 uv = saturate((posH.xy - gPerPassData.ViewportTopLeft) * gPerPassData.InvViewportSize);
+    uint x = min(uint(uv.x * gPerPassData.ClusterCountX), gPerPassData.ClusterCountX - 1);
+    uint y = min(uint(uv.y * gPerPassData.ClusterCountY), gPerPassData.ClusterCountY - 1);
+    
+    // For a perspective projection, SV_Position.w is the view space depth
+    float slice = log(max(posH.w, gPerPassData.NearZ)) * gPerPassData.ClusterDepthScale + gPerPassData.ClusterDepthBias;
+    uint z = min(uint(max(slice, 0.0f)), gPerPassData.ClusterCountZ - 1);
+    
+    return (z * gPerPassData.ClusterCountY + y) * gPerPassData.ClusterCountX + x;
+}
+
 struct VertexOut
 {
     float4 PosH : SV_POSITION;
     float3 PosW : POSITION;
     float3 NormalW : NORMAL;
     uint   MaterialIndex : MATERIAL_INDEX;
+    float  AmbientAccess : AMBIENT_ACCESS;
 };
 
 float4 main(VertexOut pin) : SV_Target
@@ -63,8 +82,8 @@ float4 main(VertexOut pin) : SV_Target
     Material material = gMaterial[pin.MaterialIndex];
     material.Shininess = 1.0f - material.Shininess;
 
-	// Indirect lighting.
-    float4 ambient = gLighting.AmbientLight * material.DiffuseAlbedo;
+	// Indirect lighting. The per-atom ambient occlusion (computed on the CPU) darkens atoms that are surrounded by others
+    float4 ambient = pin.AmbientAccess * gLighting.AmbientLight * material.DiffuseAlbedo;
     
     
     float3 directLight = 0.0f;
@@ -76,16 +95,17 @@ float4 main(VertexOut pin) : SV_Target
         directLight += ComputeDirectionalLight(gLighting.Lights[i], material, pin.NormalW, toEyeW);
     }
     
-    end = end + gLighting.NumPointLights;
-    for (i = gLighting.NumDirectionalLights; i < end; ++i)
-    {
-        directLight += ComputePointLight(gLighting.Lights[i], material, pin.PosW, pin.NormalW, toEyeW);
-    }
-
-    end = end + gLighting.NumSpotLights;
-    for (i = gLighting.NumDirectionalLights + gLighting.NumPointLights; i < end; ++i)
+    // Only the point/spot lights that were binned into this pixel's cluster can reach it. The lists are sorted by
+    // light index, so all of the point lights come before the spot lights
+    uint2 cluster = gLightClusters[ClusterIndex(pin.PosH)];
+    uint firstSpotLight = gLighting.NumDirectionalLights + gLighting.NumPointLights;
+    for (i = 0; i < cluster.y; ++i)
     {
-        directLight += ComputeSpotLight(gLighting.Lights[i], material, pin.PosW, pin.NormalW, toEyeW);
+        uint lightIndex = gLightIndices[cluster.x + i];
+        if (lightIndex < firstSpotLight)
+            directLight += ComputePointLight(gLighting.Lights[lightIndex], material, pin.PosW, pin.NormalW, toEyeW);
+        else
+            directLight += ComputeSpotLight(gLighting.Lights[lightIndex], material, pin.PosW, pin.NormalW, toEyeW);
     }
     
 
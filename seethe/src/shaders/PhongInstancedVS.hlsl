@@ -48,6 +48,7 @@ struct VertexOut
     float3 PosW : POSITION;
     float3 NormalW : NORMAL;
     nointerpolation uint MaterialIndex : MATERIAL_INDEX;
+    nointerpolation float AmbientAccess : AMBIENT_ACCESS;
 };
 
 
@@ -70,6 +71,9 @@ VertexOut main(VertexIn vin, uint instanceID : SV_InstanceID)
     
     //vout.MaterialIndex = vin.MaterialIndex;
     vout.MaterialIndex = gInstanceDataArray[instanceID].MaterialIndex;
+    
+    // Only atoms have ambient occlusion values
+    vout.AmbientAccess = 1.0f;
 
     return vout;
 }
\ No newline at end of file
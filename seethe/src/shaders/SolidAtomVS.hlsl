@@ -0,0 +1,50 @@
+// Include structures and functions for lighting.
+#include "InstanceData.hlsli"
+#include "Lighting.hlsli"
+#include "PerPassData.hlsli"
+
+
+StructuredBuffer<AtomInstanceData> gAtomInstances : register(t0);
+
+cbuffer cbPass : register(b1)
+{
+    PerPassData gPerPassData;
+};
+
+cbuffer cbLighting : register(b2)
+{
+    SceneLighting gLighting;
+};
+
+cbuffer cbMaterial : register(b3)
+{
+    Material gMaterial[NUM_MATERIALS];
+};
+
+struct VertexIn
+{
+    float4 PosL : POSITION;
+};
+
+struct VertexOut
+{
+    float4 PosH : SV_POSITION;
+    float4 Color : COLOR;
+};
+
+VertexOut main(VertexIn vin, uint instanceID : SV_InstanceID)
+{
+    VertexOut vout;
+	
+    AtomInstanceData instance = gAtomInstances[instanceID];
+    float radius = UnpackAtomRadius(instance.RadiusAndMaterial);
+    
+	// Transform to homogeneous clip space.
+    float3 posW = vin.PosL.xyz * radius + instance.Position;
+    vout.PosH = mul(float4(posW, 1.0f), gPerPassData.ViewProj);
+    
+    // When rendering as a solid color, we use the diffuse albedo as the color
+    uint matIndex = UnpackAtomMaterialIndex(instance.RadiusAndMaterial);
+    vout.Color = gMaterial[matIndex].DiffuseAlbedo;
+    return vout;
+}
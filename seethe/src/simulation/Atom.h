@@ -0,0 +1,87 @@
+#pragma once
+#include "pch.h"
+#include "utils/CowChunkedVector.h"
+
+namespace seethe
+{
+static constexpr unsigned int AtomTypeCount = 10;
+inline constexpr std::array AtomNames = { "Hydrogen", "Helium", "Lithium", "Beryllium", "Boron", 
+										  "Carbon", "Nitrogen", "Oxygen", "Flourine", "Neon" };
+
+static constexpr std::array<float, AtomTypeCount> AtomicRadii = {
+	0.5f,
+	0.6f,
+	0.7f,
+	0.8f,
+	0.9f,
+	1.0f,
+	1.1f,
+	1.2f,
+	1.3f,
+	1.4f
+};
+
+enum class AtomType
+{
+	HYDROGEN = 1,
+	HELIUM = 2,
+	LITHIUM = 3,
+	BERYLLIUM = 4,
+	BORON = 5,
+	CARBON = 6,
+	NITROGEN = 7,
+	OXYGEN = 8,
+	FLOURINE = 9,
+	NEON = 10
+};
+
+// Forward declare so that we can make Simulation a friend
+class Simulation;
+
+// This is a helper struct for grouping the pieces of data that are necessary when
+// adding/removing multiple atoms. Instead of having to all a method like 'AddAtom'
+// multiple times, we can call a method like 'AddAtoms' with a vector of AtomTPV
+struct AtomTPV
+{
+	constexpr AtomTPV() noexcept = default; 
+	constexpr AtomTPV(AtomType _type, const DirectX::XMFLOAT3& _position, const DirectX::XMFLOAT3& _velocity) noexcept :
+		type(_type), position(_position), velocity(_velocity)
+	{}
+	AtomType			type = AtomType::HYDROGEN;
+	DirectX::XMFLOAT3	position = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3	velocity = { 0.0f, 0.0f, 0.0f };
+};
+
+class Atom
+{
+public:
+	constexpr Atom(AtomType _type, const DirectX::XMFLOAT3& _position = {}, const DirectX::XMFLOAT3& _velocity = {}) noexcept :
+		position(_position),
+		velocity(_velocity),
+		radius(AtomicRadii[static_cast<int>(_type) - 1]),
+		type(_type)
+	{}
+	constexpr Atom(const Atom& rhs) noexcept = default;
+	constexpr Atom& operator=(const Atom&) noexcept = default;
+	constexpr Atom(Atom&&) noexcept = default;
+	constexpr Atom& operator=(Atom&&) noexcept = default;
+
+	ND static constexpr float RadiusOf(AtomType type) noexcept
+	{
+		return AtomicRadii[static_cast<size_t>(type) - 1];
+	}
+
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT3 velocity;
+	float radius;
+	AtomType type;
+
+private:
+	friend Simulation;
+};
+
+// Atoms are stored in fixed size, copy-on-write chunks. This makes taking a snapshot of the entire simulation
+// (undo/redo, saving while playing, etc.) only cost a pointer copy per chunk. Only the chunks that are modified 
+// after a snapshot is taken will ever be duplicated
+using AtomStore = CowChunkedVector<Atom, 1024>;
+}
\ No newline at end of file
@@ -0,0 +1,509 @@
+#include "AtomBVH.h"
+#include "utils/Log.h"
+
+using namespace DirectX;
+
+namespace seethe
+{
+namespace
+{
+constexpr unsigned int BinCount = 16;
+
+// If the tree gets deeper than this while building, we stop trusting SAH and just split down the middle. This
+// bounds the traversal stack size in Intersect()
+constexpr unsigned int MaxSAHDepth = 32;
+constexpr unsigned int TraversalStackSize = 64;
+
+// Refitting is much cheaper than rebuilding, but the tree loosens as atoms move. Once the total surface area
+// has grown this much relative to the freshly built tree, we rebuild
+constexpr float RebuildCostRatio = 1.5f;
+
+struct Aabb
+{
+	XMFLOAT3 min = { FLT_MAX, FLT_MAX, FLT_MAX };
+	XMFLOAT3 max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	constexpr void Grow(const XMFLOAT3& p, float r) noexcept
+	{
+		min.x = std::min(min.x, p.x - r); max.x = std::max(max.x, p.x + r);
+		min.y = std::min(min.y, p.y - r); max.y = std::max(max.y, p.y + r);
+		min.z = std::min(min.z, p.z - r); max.z = std::max(max.z, p.z + r);
+	}
+	constexpr void Grow(const Aabb& rhs) noexcept
+	{
+		min.x = std::min(min.x, rhs.min.x); max.x = std::max(max.x, rhs.max.x);
+		min.y = std::min(min.y, rhs.min.y); max.y = std::max(max.y, rhs.max.y);
+		min.z = std::min(min.z, rhs.min.z); max.z = std::max(max.z, rhs.max.z);
+	}
+	ND constexpr float Area() const noexcept
+	{
+		float dx = max.x - min.x;
+		float dy = max.y - min.y;
+		float dz = max.z - min.z;
+		return 2.0f * (dx * dy + dy * dz + dz * dx);
+	}
+};
+
+ND constexpr float Component(const XMFLOAT3& v, int axis) noexcept
+{
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+struct BuildPrim
+{
+	XMFLOAT3 center;
+	float radius;
+	std::uint32_t index;
+};
+
+struct BuildTask
+{
+	std::uint32_t node;
+	std::uint32_t first;
+	std::uint32_t count;
+	std::uint32_t depth;
+};
+
+struct Bin
+{
+	Aabb bounds;
+	std::uint32_t count = 0;
+};
+}
+
+void AtomBVH::Update(const AtomStore& atoms) noexcept
+{
+	if (atoms.StructureVersion() != m_structureVersion)
+	{
+		Build(atoms);
+	}
+	else if (atoms.Version() != m_version)
+	{
+		Refit(atoms);
+		if (ComputeCost() > RebuildCostRatio * m_buildCost)
+			Build(atoms);
+	}
+}
+
+void AtomBVH::Build(const AtomStore& atoms) noexcept
+{
+	m_nodes.clear();
+	m_packets.clear();
+	m_version = atoms.Version();
+	m_structureVersion = atoms.StructureVersion();
+	m_buildCost = 0.0f;
+
+	if (atoms.empty())
+		return;
+
+	// Gather the data we need from the atoms into a flat array that we are free to reorder
+	std::vector<BuildPrim> prims;
+	prims.reserve(atoms.size());
+	atoms.ForEachChunk([&prims](std::span<const Atom> chunk)
+		{
+			for (const Atom& atom : chunk)
+				prims.push_back({ atom.position, atom.radius, static_cast<std::uint32_t>(prims.size()) });
+		}
+	);
+
+	const std::uint32_t primCount = static_cast<std::uint32_t>(prims.size());
+	m_nodes.reserve(2 * (primCount / LeafSize + 1));
+	m_packets.reserve(primCount / LeafSize + 1);
+	m_nodes.emplace_back();
+
+	std::vector<BuildTask> tasks;
+	tasks.push_back({ 0, 0, primCount, 0 });
+
+	while (!tasks.empty())
+	{
+		BuildTask task = tasks.back();
+		tasks.pop_back();
+
+		auto begin = prims.begin() + task.first;
+		auto end = begin + task.count;
+
+		Aabb bounds;
+		Aabb centroidBounds;
+		for (auto iter = begin; iter != end; ++iter)
+		{
+			bounds.Grow(iter->center, iter->radius);
+			centroidBounds.Grow(iter->center, 0.0f);
+		}
+
+		m_nodes[task.node].boundsMin = bounds.min;
+		m_nodes[task.node].boundsMax = bounds.max;
+
+		// Leaf - copy the atoms into a SoA packet
+		if (task.count <= LeafSize)
+		{
+			SpherePacket packet = {};
+			for (std::uint32_t iii = 0; iii < task.count; ++iii)
+			{
+				const BuildPrim& prim = prims[task.first + iii];
+				packet.x[iii] = prim.center.x;
+				packet.y[iii] = prim.center.y;
+				packet.z[iii] = prim.center.z;
+				packet.r[iii] = prim.radius;
+				packet.index[iii] = prim.index;
+			}
+
+			m_nodes[task.node].leftFirst = static_cast<std::uint32_t>(m_packets.size());
+			m_nodes[task.node].count = task.count;
+			m_packets.push_back(packet);
+			continue;
+		}
+
+		// Binned SAH: drop the centroids into bins along each axis and sweep the bin boundaries looking for the
+		// split plane with the lowest (left area * left count + right area * right count)
+		int bestAxis = -1;
+		std::uint32_t bestSplit = 0;
+		float bestCost = FLT_MAX;
+
+		if (task.depth < MaxSAHDepth)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float lo = Component(centroidBounds.min, axis);
+				float hi = Component(centroidBounds.max, axis);
+				if (hi - lo < 1e-6f)
+					continue;
+
+				const float scale = BinCount / (hi - lo);
+
+				std::array<Bin, BinCount> bins = {};
+				for (auto iter = begin; iter != end; ++iter)
+				{
+					std::uint32_t b = std::min(BinCount - 1, static_cast<std::uint32_t>((Component(iter->center, axis) - lo) * scale));
+					bins[b].count++;
+					bins[b].bounds.Grow(iter->center, iter->radius);
+				}
+
+				std::array<float, BinCount - 1> leftArea = {};
+				std::array<std::uint32_t, BinCount - 1> leftCount = {};
+				Aabb accumulated;
+				std::uint32_t sum = 0;
+				for (unsigned int iii = 0; iii < BinCount - 1; ++iii)
+				{
+					sum += bins[iii].count;
+					accumulated.Grow(bins[iii].bounds);
+					leftCount[iii] = sum;
+					leftArea[iii] = accumulated.Area();
+				}
+
+				accumulated = {};
+				sum = 0;
+				for (unsigned int iii = BinCount - 1; iii > 0; --iii)
+				{
+					sum += bins[iii].count;
+					accumulated.Grow(bins[iii].bounds);
+
+					if (leftCount[iii - 1] == 0 || sum == 0)
+						continue;
+
+					float cost = leftCount[iii - 1] * leftArea[iii - 1] + sum * accumulated.Area();
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestSplit = iii;
+					}
+				}
+			}
+		}
+
+		auto middle = begin;
+		if (bestAxis >= 0)
+		{
+			const float lo = Component(centroidBounds.min, bestAxis);
+			const float scale = BinCount / (Component(centroidBounds.max, bestAxis) - lo);
+			middle = std::partition(begin, end, [&](const BuildPrim& prim)
+				{
+					return std::min(BinCount - 1, static_cast<std::uint32_t>((Component(prim.center, bestAxis) - lo) * scale)) < bestSplit;
+				}
+			);
+		}
+
+		// If SAH could not find a split (all centroids are in the same spot or we are too deep), just split the
+		// atoms in half along the longest axis. Leaves can only hold LeafSize atoms, so we must always split
+		if (middle == begin || middle == end)
+		{
+			XMFLOAT3 extent = { centroidBounds.max.x - centroidBounds.min.x, centroidBounds.max.y - centroidBounds.min.y, centroidBounds.max.z - centroidBounds.min.z };
+			int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+			middle = begin + task.count / 2;
+			std::nth_element(begin, middle, end, [axis](const BuildPrim& lhs, const BuildPrim& rhs)
+				{
+					return Component(lhs.center, axis) < Component(rhs.center, axis);
+				}
+			);
+		}
+
+		const std::uint32_t leftCount = static_cast<std::uint32_t>(std::distance(begin, middle));
+		const std::uint32_t left = static_cast<std::uint32_t>(m_nodes.size());
+		m_nodes.emplace_back();
+		m_nodes.emplace_back();
+
+		m_nodes[task.node].leftFirst = left;
+		m_nodes[task.node].count = 0;
+
+		tasks.push_back({ left + 1, task.first + leftCount, task.count - leftCount, task.depth + 1 });
+		tasks.push_back({ left, task.first, leftCount, task.depth + 1 });
+	}
+
+	m_buildCost = ComputeCost();
+}
+
+void AtomBVH::Refit(const AtomStore& atoms) noexcept
+{
+	ASSERT(atoms.StructureVersion() == m_structureVersion, "Refit can only be used when no atoms have been added/removed");
+	m_version = atoms.Version();
+
+	// Children are always allocated after their parent, so walking the nodes backwards guarantees both children
+	// have been refit before their parent
+	for (size_t iii = m_nodes.size(); iii-- > 0;)
+	{
+		Node& node = m_nodes[iii];
+		if (node.IsLeaf())
+		{
+			SpherePacket& packet = m_packets[node.leftFirst];
+			for (std::uint32_t lane = 0; lane < node.count; ++lane)
+			{
+				const Atom& atom = atoms[packet.index[lane]];
+				packet.x[lane] = atom.position.x;
+				packet.y[lane] = atom.position.y;
+				packet.z[lane] = atom.position.z;
+				packet.r[lane] = atom.radius;
+			}
+			UpdateLeafBounds(node);
+		}
+		else
+		{
+			const Node& left = m_nodes[node.leftFirst];
+			const Node& right = m_nodes[node.leftFirst + 1];
+			XMStoreFloat3(&node.boundsMin, XMVectorMin(XMLoadFloat3(&left.boundsMin), XMLoadFloat3(&right.boundsMin)));
+			XMStoreFloat3(&node.boundsMax, XMVectorMax(XMLoadFloat3(&left.boundsMax), XMLoadFloat3(&right.boundsMax)));
+		}
+	}
+}
+
+std::optional<AtomBVH::RayHit> AtomBVH::Intersect(FXMVECTOR origin, FXMVECTOR direction, float maxDistance) const noexcept
+{
+	if (m_nodes.empty())
+		return std::nullopt;
+
+	const XMVECTOR invDirection = XMVectorReciprocal(direction);
+
+	// Splatted ray for the 4-wide leaf tests
+	const XMVECTOR ox = XMVectorSplatX(origin);
+	const XMVECTOR oy = XMVectorSplatY(origin);
+	const XMVECTOR oz = XMVectorSplatZ(origin);
+	const XMVECTOR dx = XMVectorSplatX(direction);
+	const XMVECTOR dy = XMVectorSplatY(direction);
+	const XMVECTOR dz = XMVectorSplatZ(direction);
+	const XMVECTOR zero = XMVectorZero();
+
+	float closest = maxDistance;
+	std::optional<RayHit> hit = std::nullopt;
+
+	// Returns the entry distance of the ray into the node or FLT_MAX if the ray misses (or enters beyond the closest hit)
+	auto EntryDistance = [&](const Node& node) -> float
+		{
+			XMVECTOR t0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&node.boundsMin), origin), invDirection);
+			XMVECTOR t1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&node.boundsMax), origin), invDirection);
+			XMFLOAT3 tMin, tMax;
+			XMStoreFloat3(&tMin, XMVectorMin(t0, t1));
+			XMStoreFloat3(&tMax, XMVectorMax(t0, t1));
+
+			float enter = std::max(tMin.x, std::max(tMin.y, tMin.z));
+			float exit = std::min(tMax.x, std::min(tMax.y, tMax.z));
+			return (exit >= std::max(enter, 0.0f) && enter < closest) ? enter : FLT_MAX;
+		};
+
+	struct StackEntry
+	{
+		std::uint32_t node;
+		float entry;
+	};
+	std::array<StackEntry, TraversalStackSize> stack;
+	unsigned int stackSize = 0;
+
+	if (EntryDistance(m_nodes[0]) == FLT_MAX)
+		return std::nullopt;
+
+	std::uint32_t nodeIndex = 0;
+	while (true)
+	{
+		const Node& node = m_nodes[nodeIndex];
+
+		if (node.IsLeaf())
+		{
+			const SpherePacket& packet = m_packets[node.leftFirst];
+
+			XMVECTOR ocx = XMVectorSubtract(XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(packet.x)), ox);
+			XMVECTOR ocy = XMVectorSubtract(XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(packet.y)), oy);
+			XMVECTOR ocz = XMVectorSubtract(XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(packet.z)), oz);
+			XMVECTOR r = XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(packet.r));
+
+			// With a normalized direction, the hit distances are t = b +/- sqrt(b^2 - c) where b = dot(oc, d) and
+			// c = dot(oc, oc) - r^2
+			XMVECTOR b = XMVectorMultiplyAdd(ocz, dz, XMVectorMultiplyAdd(ocy, dy, XMVectorMultiply(ocx, dx)));
+			XMVECTOR c = XMVectorSubtract(
+				XMVectorMultiplyAdd(ocz, ocz, XMVectorMultiplyAdd(ocy, ocy, XMVectorMultiply(ocx, ocx))),
+				XMVectorMultiply(r, r));
+			XMVECTOR discriminant = XMVectorSubtract(XMVectorMultiply(b, b), c);
+			XMVECTOR root = XMVectorSqrt(XMVectorMax(discriminant, zero));
+			XMVECTOR tNear = XMVectorSubtract(b, root);
+			XMVECTOR tFar = XMVectorAdd(b, root);
+
+			// If the near hit is behind the origin, the origin is inside the sphere and the far hit is the one we want
+			XMVECTOR t = XMVectorSelect(tNear, tFar, XMVectorLess(tNear, zero));
+
+			XMVECTOR mask = XMVectorAndInt(
+				XMVectorAndInt(XMVectorGreaterOrEqual(discriminant, zero), XMVectorGreaterOrEqual(t, zero)),
+				XMVectorLess(t, XMVectorReplicate(closest)));
+
+			if (!XMVector4EqualInt(mask, XMVectorFalseInt()))
+			{
+				XMFLOAT4A distances;
+				std::array<std::uint32_t, LeafSize> hits;
+				XMStoreFloat4A(&distances, t);
+				XMStoreInt4(hits.data(), mask);
+
+				const float* d = &distances.x;
+				for (std::uint32_t lane = 0; lane < node.count; ++lane)
+				{
+					if (hits[lane] && d[lane] < closest)
+					{
+						closest = d[lane];
+						hit = RayHit{ packet.index[lane], d[lane] };
+					}
+				}
+			}
+		}
+		else
+		{
+			// NOTE: Can't use 'near'/'far' as names because windef.h defines them as macros
+			std::uint32_t closer = node.leftFirst;
+			std::uint32_t further = node.leftFirst + 1;
+			float closerEntry = EntryDistance(m_nodes[closer]);
+			float furtherEntry = EntryDistance(m_nodes[further]);
+
+			if (furtherEntry < closerEntry)
+			{
+				std::swap(closer, further);
+				std::swap(closerEntry, furtherEntry);
+			}
+
+			if (closerEntry != FLT_MAX)
+			{
+				if (furtherEntry != FLT_MAX)
+				{
+					ASSERT(stackSize < TraversalStackSize, "BVH traversal stack overflow");
+					stack[stackSize++] = { further, furtherEntry };
+				}
+
+				nodeIndex = closer;
+				continue;
+			}
+		}
+
+		// Pop the next node, skipping any that we now know are further away than the closest hit
+		while (stackSize > 0 && stack[stackSize - 1].entry >= closest)
+			--stackSize;
+
+		if (stackSize == 0)
+			break;
+
+		nodeIndex = stack[--stackSize].node;
+	}
+
+	return hit;
+}
+
+void AtomBVH::QueryFrustum(const Frustum& frustum, std::vector<size_t>& results) const noexcept
+{
+	if (m_nodes.empty())
+		return;
+
+	// 'inside' is set once an ancestor was found to be completely inside the frustum, in which case nothing below
+	// it needs to be tested anymore
+	struct StackEntry
+	{
+		std::uint32_t node;
+		bool inside;
+	};
+	std::array<StackEntry, TraversalStackSize> stack;
+	unsigned int stackSize = 0;
+	stack[stackSize++] = { 0, false };
+
+	while (stackSize > 0)
+	{
+		auto [nodeIndex, inside] = stack[--stackSize];
+		const Node& node = m_nodes[nodeIndex];
+
+		if (!inside)
+		{
+			ContainmentType containment = frustum.Classify(node.boundsMin, node.boundsMax);
+			if (containment == DISJOINT)
+				continue;
+			inside = containment == CONTAINS;
+		}
+
+		if (node.IsLeaf())
+		{
+			const SpherePacket& packet = m_packets[node.leftFirst];
+
+			unsigned int mask = (1u << node.count) - 1;
+			if (!inside)
+			{
+				mask &= frustum.Intersects4(
+					XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(packet.x)),
+					XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(packet.y)),
+					XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(packet.z)),
+					XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(packet.r)));
+			}
+
+			while (mask != 0)
+			{
+				results.push_back(packet.index[std::countr_zero(mask)]);
+				mask &= mask - 1;
+			}
+		}
+		else
+		{
+			ASSERT(stackSize + 2 <= TraversalStackSize, "BVH traversal stack overflow");
+			stack[stackSize++] = { node.leftFirst + 1, inside };
+			stack[stackSize++] = { node.leftFirst, inside };
+		}
+	}
+}
+
+void AtomBVH::UpdateLeafBounds(Node& node) const noexcept
+{
+	const SpherePacket& packet = m_packets[node.leftFirst];
+
+	Aabb bounds;
+	for (std::uint32_t lane = 0; lane < node.count; ++lane)
+		bounds.Grow({ packet.x[lane], packet.y[lane], packet.z[lane] }, packet.r[lane]);
+
+	node.boundsMin = bounds.min;
+	node.boundsMax = bounds.max;
+}
+
+float AtomBVH::ComputeCost() const noexcept
+{
+	if (m_nodes.empty())
+		return 0.0f;
+
+	// This is the SAH cost of the tree up to constant factors: the sum of the interior node areas relative to the root
+	float sum = 0.0f;
+	for (const Node& node : m_nodes)
+	{
+		if (!node.IsLeaf())
+			sum += Aabb{ node.boundsMin, node.boundsMax }.Area();
+	}
+
+	float rootArea = Aabb{ m_nodes[0].boundsMin, m_nodes[0].boundsMax }.Area();
+	return rootArea > 0.0f ? sum / rootArea : 0.0f;
+}
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "pch.h"
+#include "simulation/Atom.h"
+#include "utils/Frustum.h"
+
+namespace seethe
+{
+// AtomBVH is a bounding volume hierarchy over the atom bounding spheres. It is used for ray picking, so instead of
+// testing every atom against the mouse ray, we only have to walk ~log(N) nodes and then test the handful of atoms
+// in each leaf that the ray actually reaches.
+//
+//   * The tree is built with a binned SAH (surface area heuristic) which produces good trees in O(N log N)
+//   * When only positions have changed (i.e. the simulation played for a bit), the tree is refit instead of rebuilt,
+//     which is O(N) with no sorting. If refitting degrades the tree too much, it gets rebuilt.
+//   * Each leaf holds up to 4 atoms stored as a SoA packet so the leaf can be tested with a single 4-wide SIMD
+//     ray/sphere test (XMVECTOR maps to SSE/NEON)
+class AtomBVH
+{
+public:
+	static constexpr unsigned int LeafSize = 4;
+
+	struct RayHit
+	{
+		size_t atomIndex;
+		float distance;
+	};
+
+	AtomBVH() noexcept = default;
+	AtomBVH(const AtomBVH&) noexcept = default;
+	AtomBVH(AtomBVH&&) noexcept = default;
+	AtomBVH& operator=(const AtomBVH&) noexcept = default;
+	AtomBVH& operator=(AtomBVH&&) noexcept = default;
+	~AtomBVH() noexcept = default;
+
+	// Brings the tree up to date with the atoms. This compares the versions of the atom store against the versions the
+	// tree was last built/refit from, so it is essentially free to call when nothing has changed
+	void Update(const AtomStore& atoms) noexcept;
+	void Build(const AtomStore& atoms) noexcept;
+	void Refit(const AtomStore& atoms) noexcept;
+
+	// NOTE: 'direction' must be normalized. The distance in the returned hit is along the ray from 'origin'
+	ND std::optional<RayHit> Intersect(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, float maxDistance = FLT_MAX) const noexcept;
+	// Appends the index of every atom whose bounding sphere intersects the frustum. Subtrees that are entirely inside
+	// the frustum are added without testing the individual atoms
+	void QueryFrustum(const Frustum& frustum, std::vector<size_t>& results) const noexcept;
+
+	ND constexpr size_t NodeCount() const noexcept { return m_nodes.size(); }
+	ND constexpr bool Empty() const noexcept { return m_nodes.empty(); }
+
+private:
+	// 32 bytes so that two nodes fit in a single cache line
+	// For interior nodes, 'leftFirst' is the index of the left child (the right child always immediately follows it)
+	// For leaves, 'leftFirst' is the index of the leaf's packet and 'count' is the number of atoms in it (> 0)
+	struct Node
+	{
+		DirectX::XMFLOAT3 boundsMin;
+		std::uint32_t leftFirst;
+		DirectX::XMFLOAT3 boundsMax;
+		std::uint32_t count;
+
+		ND constexpr bool IsLeaf() const noexcept { return count > 0; }
+	};
+	static_assert(sizeof(Node) == 32);
+
+	// SoA data for the (up to) 4 atoms in a leaf
+	struct alignas(16) SpherePacket
+	{
+		float x[LeafSize];
+		float y[LeafSize];
+		float z[LeafSize];
+		float r[LeafSize];
+		std::uint32_t index[LeafSize];
+	};
+
+	void UpdateLeafBounds(Node& node) const noexcept;
+	ND float ComputeCost() const noexcept;
+
+	std::vector<Node> m_nodes;
+	std::vector<SpherePacket> m_packets;
+
+	// Sum of node surface areas relative to the root right after the last build. If refitting causes this to grow
+	// too much, the tree has become loose enough that we are better off rebuilding it
+	float m_buildCost = 0.0f;
+
+	std::uint64_t m_version = std::numeric_limits<std::uint64_t>::max();
+	std::uint64_t m_structureVersion = std::numeric_limits<std::uint64_t>::max();
+};
+}
@@ -0,0 +1,286 @@
+#include "AtomGrid.h"
+#include "utils/Metrics.h"
+#include "utils/ThreadPool.h"
+#include "utils/TuningParameters.h"
+
+using namespace DirectX;
+
+namespace seethe
+{
+namespace
+{
+// Atoms that all lie on a plane/line have (almost) no volume, which would otherwise produce a huge number of
+// tiny cells. If the grid would have more cells than this many per atom, the cells are made larger
+constexpr size_t MaxCellsPerAtom = 4;
+constexpr float MinCellSize = 1e-3f;
+
+// Number of queries handed to a thread at a time for the batched queries
+constexpr size_t QueryGrainSize = 64;
+
+ND inline float DistanceSquared(const XMFLOAT3& a, const XMFLOAT3& b) noexcept
+{
+	float dx = a.x - b.x;
+	float dy = a.y - b.y;
+	float dz = a.z - b.z;
+	return dx * dx + dy * dy + dz * dz;
+}
+}
+
+void AtomGrid::Update(const AtomStore& atoms) noexcept
+{
+	if (atoms.Version() != m_version)
+		Build(atoms);
+}
+
+void AtomGrid::Build(const AtomStore& atoms) noexcept
+{
+	Metrics::Get().AddGridRebuild();
+	m_version = atoms.Version();
+	m_cellStart.clear();
+	m_positions.clear();
+	m_indices.clear();
+	m_dims = { 0, 0, 0 };
+
+	if (atoms.empty())
+		return;
+
+	const size_t atomCount = atoms.size();
+
+	std::vector<XMFLOAT3>& positions = m_unsortedPositions;
+	positions.clear();
+	positions.reserve(atomCount);
+
+	XMFLOAT3 boundsMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	m_min = { FLT_MAX, FLT_MAX, FLT_MAX };
+	atoms.ForEachChunk([&](std::span<const Atom> chunk)
+		{
+			for (const Atom& atom : chunk)
+			{
+				const XMFLOAT3& p = atom.position;
+				positions.push_back(p);
+				m_min = { std::min(m_min.x, p.x), std::min(m_min.y, p.y), std::min(m_min.z, p.z) };
+				boundsMax = { std::max(boundsMax.x, p.x), std::max(boundsMax.y, p.y), std::max(boundsMax.z, p.z) };
+			}
+		}
+	);
+
+	const XMFLOAT3 extent = { boundsMax.x - m_min.x, boundsMax.y - m_min.y, boundsMax.z - m_min.z };
+	const float volume = std::max(extent.x, MinCellSize) * std::max(extent.y, MinCellSize) * std::max(extent.z, MinCellSize);
+
+	// On average, each cell holds about TuningParameters::gridAtomsPerCell atoms
+	m_cellSize = std::max(std::cbrt(TuningParameters::Current().gridAtomsPerCell * volume / atomCount), MinCellSize);
+	size_t cellCount = 0;
+	while (true)
+	{
+		m_dims = {
+			static_cast<int>(extent.x / m_cellSize) + 1,
+			static_cast<int>(extent.y / m_cellSize) + 1,
+			static_cast<int>(extent.z / m_cellSize) + 1
+		};
+		cellCount = static_cast<size_t>(m_dims[0]) * m_dims[1] * m_dims[2];
+		if (cellCount <= MaxCellsPerAtom * atomCount + 1)
+			break;
+		m_cellSize *= 1.5f;
+	}
+	m_inverseCellSize = 1.0f / m_cellSize;
+
+	// Counting sort: count the atoms in each cell, prefix sum the counts into cell start offsets, and then scatter
+	std::vector<std::uint32_t>& cellOfAtom = m_cellOfAtom;
+	cellOfAtom.resize(atomCount);
+	m_cellStart.assign(cellCount + 1, 0);
+	for (size_t iii = 0; iii < atomCount; ++iii)
+	{
+		const XMFLOAT3& p = positions[iii];
+		size_t cell = CellIndex(CellCoordinate(p.x, m_min.x, m_dims[0]), CellCoordinate(p.y, m_min.y, m_dims[1]), CellCoordinate(p.z, m_min.z, m_dims[2]));
+		cellOfAtom[iii] = static_cast<std::uint32_t>(cell);
+		++m_cellStart[cell + 1];
+	}
+
+	for (size_t iii = 1; iii < m_cellStart.size(); ++iii)
+		m_cellStart[iii] += m_cellStart[iii - 1];
+
+	std::vector<std::uint32_t>& cursor = m_cursor;
+	cursor.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+	m_positions.resize(atomCount);
+	m_indices.resize(atomCount);
+	for (size_t iii = 0; iii < atomCount; ++iii)
+	{
+		std::uint32_t slot = cursor[cellOfAtom[iii]]++;
+		m_positions[slot] = positions[iii];
+		m_indices[slot] = static_cast<std::uint32_t>(iii);
+	}
+}
+
+void AtomGrid::QueryRadius(const XMFLOAT3& center, float radius, std::vector<size_t>& results) const noexcept
+{
+	if (Empty())
+		return;
+
+	const float radiusSquared = radius * radius;
+
+	const int x0 = CellCoordinate(center.x - radius, m_min.x, m_dims[0]);
+	const int x1 = CellCoordinate(center.x + radius, m_min.x, m_dims[0]);
+	const int y0 = CellCoordinate(center.y - radius, m_min.y, m_dims[1]);
+	const int y1 = CellCoordinate(center.y + radius, m_min.y, m_dims[1]);
+	const int z0 = CellCoordinate(center.z - radius, m_min.z, m_dims[2]);
+	const int z1 = CellCoordinate(center.z + radius, m_min.z, m_dims[2]);
+
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int y = y0; y <= y1; ++y)
+		{
+			// Cells in a row along x are contiguous, so the whole row is a single range of atoms
+			const std::uint32_t begin = m_cellStart[CellIndex(x0, y, z)];
+			const std::uint32_t end = m_cellStart[CellIndex(x1, y, z) + 1];
+			for (std::uint32_t iii = begin; iii < end; ++iii)
+			{
+				if (DistanceSquared(m_positions[iii], center) <= radiusSquared)
+					results.push_back(m_indices[iii]);
+			}
+		}
+	}
+}
+
+void AtomGrid::QueryBox(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, std::vector<size_t>& results) const noexcept
+{
+	if (Empty())
+		return;
+
+	const int x0 = CellCoordinate(boxMin.x, m_min.x, m_dims[0]);
+	const int x1 = CellCoordinate(boxMax.x, m_min.x, m_dims[0]);
+	const int y0 = CellCoordinate(boxMin.y, m_min.y, m_dims[1]);
+	const int y1 = CellCoordinate(boxMax.y, m_min.y, m_dims[1]);
+	const int z0 = CellCoordinate(boxMin.z, m_min.z, m_dims[2]);
+	const int z1 = CellCoordinate(boxMax.z, m_min.z, m_dims[2]);
+
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int y = y0; y <= y1; ++y)
+		{
+			const std::uint32_t begin = m_cellStart[CellIndex(x0, y, z)];
+			const std::uint32_t end = m_cellStart[CellIndex(x1, y, z) + 1];
+			for (std::uint32_t iii = begin; iii < end; ++iii)
+			{
+				const XMFLOAT3& p = m_positions[iii];
+				if (p.x >= boxMin.x && p.x <= boxMax.x &&
+					p.y >= boxMin.y && p.y <= boxMax.y &&
+					p.z >= boxMin.z && p.z <= boxMax.z)
+				{
+					results.push_back(m_indices[iii]);
+				}
+			}
+		}
+	}
+}
+
+void AtomGrid::QueryKNearest(const XMFLOAT3& point, size_t k, std::vector<size_t>& results, std::optional<size_t> excludeIndex) const noexcept
+{
+	if (Empty() || k == 0)
+		return;
+
+	// Max heap on distance - the front is always the furthest of the current k best candidates
+	using Candidate = std::pair<float, std::uint32_t>;
+	std::vector<Candidate> heap;
+	heap.reserve(k + 1);
+
+	const int cx = CellCoordinate(point.x, m_min.x, m_dims[0]);
+	const int cy = CellCoordinate(point.y, m_min.y, m_dims[1]);
+	const int cz = CellCoordinate(point.z, m_min.z, m_dims[2]);
+	const int maxRing = std::max(m_dims[0], std::max(m_dims[1], m_dims[2]));
+
+	// Search outward one shell of cells at a time (all cells with Chebyshev distance == ring from the point's cell)
+	for (int ring = 0; ring <= maxRing; ++ring)
+	{
+		for (int z = std::max(0, cz - ring); z <= std::min(m_dims[2] - 1, cz + ring); ++z)
+		{
+			for (int y = std::max(0, cy - ring); y <= std::min(m_dims[1] - 1, cy + ring); ++y)
+			{
+				for (int x = std::max(0, cx - ring); x <= std::min(m_dims[0] - 1, cx + ring); ++x)
+				{
+					if (std::max(std::abs(x - cx), std::max(std::abs(y - cy), std::abs(z - cz))) != ring)
+						continue;
+
+					if (heap.size() == k && CellDistanceSquared(point, x, y, z) >= heap.front().first)
+						continue;
+
+					const size_t cell = CellIndex(x, y, z);
+					for (std::uint32_t iii = m_cellStart[cell]; iii < m_cellStart[cell + 1]; ++iii)
+					{
+						if (excludeIndex.has_value() && m_indices[iii] == excludeIndex.value())
+							continue;
+
+						float d = DistanceSquared(m_positions[iii], point);
+						if (heap.size() < k)
+						{
+							heap.emplace_back(d, m_indices[iii]);
+							std::push_heap(heap.begin(), heap.end());
+						}
+						else if (d < heap.front().first)
+						{
+							std::pop_heap(heap.begin(), heap.end());
+							heap.back() = { d, m_indices[iii] };
+							std::push_heap(heap.begin(), heap.end());
+						}
+					}
+				}
+			}
+		}
+
+		// Every cell in the next shell is at least 'ring' cells away, so once that is further than the k'th
+		// best candidate, nothing further out can improve the result
+		if (heap.size() == k)
+		{
+			float bound = ring * m_cellSize;
+			if (bound * bound >= heap.front().first)
+				break;
+		}
+	}
+
+	std::sort_heap(heap.begin(), heap.end());
+	for (const Candidate& candidate : heap)
+		results.push_back(candidate.second);
+}
+
+std::vector<std::vector<size_t>> AtomGrid::QueryRadius(std::span<const XMFLOAT3> centers, float radius) const noexcept
+{
+	std::vector<std::vector<size_t>> results(centers.size());
+	ThreadPool::Get().ParallelFor(centers.size(), QueryGrainSize, [&](size_t begin, size_t end)
+		{
+			for (size_t iii = begin; iii < end; ++iii)
+				QueryRadius(centers[iii], radius, results[iii]);
+		}
+	);
+	return results;
+}
+
+std::vector<std::vector<size_t>> AtomGrid::QueryKNearest(std::span<const XMFLOAT3> points, size_t k) const noexcept
+{
+	std::vector<std::vector<size_t>> results(points.size());
+	ThreadPool::Get().ParallelFor(points.size(), QueryGrainSize, [&](size_t begin, size_t end)
+		{
+			for (size_t iii = begin; iii < end; ++iii)
+			{
+				results[iii].reserve(k);
+				QueryKNearest(points[iii], k, results[iii]);
+			}
+		}
+	);
+	return results;
+}
+
+float AtomGrid::CellDistanceSquared(const XMFLOAT3& point, int x, int y, int z) const noexcept
+{
+	// Distance from the point to the closest point on the cell's box (0 if the point is inside the cell)
+	auto AxisDistance = [this](float p, float gridMin, int cell) -> float
+		{
+			float lo = gridMin + cell * m_cellSize;
+			float hi = lo + m_cellSize;
+			return p < lo ? lo - p : (p > hi ? p - hi : 0.0f);
+		};
+
+	float dx = AxisDistance(point.x, m_min.x, x);
+	float dy = AxisDistance(point.y, m_min.y, y);
+	float dz = AxisDistance(point.z, m_min.z, z);
+	return dx * dx + dy * dy + dz * dz;
+}
+}
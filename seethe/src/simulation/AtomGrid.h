@@ -0,0 +1,70 @@
+#pragma once
+#include "pch.h"
+#include "simulation/Atom.h"
+
+namespace seethe
+{
+// AtomGrid is a uniform grid over the atom centers used to answer spatial queries ("all atoms within r of this point",
+// "k nearest neighbors of this atom", "all atoms in this box") without having to scan every atom.
+//
+// The atoms are bucketed with a counting sort, so each cell's atoms are contiguous in memory (CSR layout) and a
+// rebuild is O(N) with no per-cell allocations. Like AtomBVH, the grid compares the version of the atom store
+// against the version it was built from, so Update() only rebuilds when something actually changed.
+//
+// NOTE: All queries are based on atom centers (atom radii are ignored)
+// NOTE: The batched queries use the shared ThreadPool. Each query in the batch is independent
+class AtomGrid
+{
+public:
+	AtomGrid() noexcept = default;
+	AtomGrid(const AtomGrid&) noexcept = default;
+	AtomGrid(AtomGrid&&) noexcept = default;
+	AtomGrid& operator=(const AtomGrid&) noexcept = default;
+	AtomGrid& operator=(AtomGrid&&) noexcept = default;
+	~AtomGrid() noexcept = default;
+
+	void Update(const AtomStore& atoms) noexcept;
+	void Build(const AtomStore& atoms) noexcept;
+
+	// Single queries - the results are appended to 'results'
+	void QueryRadius(const DirectX::XMFLOAT3& center, float radius, std::vector<size_t>& results) const noexcept;
+	void QueryBox(const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax, std::vector<size_t>& results) const noexcept;
+	// Results are sorted from nearest to furthest. 'excludeIndex' is useful for finding the neighbors of an atom without the atom itself
+	void QueryKNearest(const DirectX::XMFLOAT3& point, size_t k, std::vector<size_t>& results, std::optional<size_t> excludeIndex = std::nullopt) const noexcept;
+
+	// Batched queries - results[i] holds the result for the i'th point
+	ND std::vector<std::vector<size_t>> QueryRadius(std::span<const DirectX::XMFLOAT3> centers, float radius) const noexcept;
+	ND std::vector<std::vector<size_t>> QueryKNearest(std::span<const DirectX::XMFLOAT3> points, size_t k) const noexcept;
+
+	ND constexpr float GetCellSize() const noexcept { return m_cellSize; }
+	ND constexpr bool Empty() const noexcept { return m_indices.empty(); }
+
+private:
+	ND constexpr int CellCoordinate(float value, float gridMin, int dim) const noexcept
+	{
+		return std::clamp(static_cast<int>((value - gridMin) * m_inverseCellSize), 0, dim - 1);
+	}
+	ND constexpr size_t CellIndex(int x, int y, int z) const noexcept
+	{
+		return (static_cast<size_t>(z) * m_dims[1] + y) * m_dims[0] + x;
+	}
+	ND float CellDistanceSquared(const DirectX::XMFLOAT3& point, int x, int y, int z) const noexcept;
+
+	// Atom data sorted by cell. m_cellStart has one entry per cell plus one, so that cell c's atoms are [m_cellStart[c], m_cellStart[c + 1])
+	std::vector<std::uint32_t> m_cellStart;
+	std::vector<DirectX::XMFLOAT3> m_positions;
+	std::vector<std::uint32_t> m_indices;
+
+	// Scratch space for Build(), kept so that rebuilding every frame while the simulation plays does not allocate
+	std::vector<DirectX::XMFLOAT3> m_unsortedPositions;
+	std::vector<std::uint32_t> m_cellOfAtom;
+	std::vector<std::uint32_t> m_cursor;
+
+	DirectX::XMFLOAT3 m_min = { 0.0f, 0.0f, 0.0f };
+	std::array<int, 3> m_dims = { 0, 0, 0 };
+	float m_cellSize = 1.0f;
+	float m_inverseCellSize = 1.0f;
+
+	std::uint64_t m_version = std::numeric_limits<std::uint64_t>::max();
+};
+}
@@ -1,60 +1,77 @@
 #include "Simulation.h"
+#include "utils/AllocationTracker.h"
+#include "utils/FrameStats.h"
+#include "utils/Metrics.h"
+#include "utils/PerfCounters.h"
+#include "utils/ThreadPool.h"
+#include "utils/TuningParameters.h"
 
 using namespace DirectX;
 
 namespace seethe
 {
-void Simulation::Update(const seethe::Timer& timer)
+void Simulation::Update(float dt)
 {
 	if (!m_isPlaying) return;
 
-	float dt = timer.DeltaTime(); 
-	
-	for (auto& atom : m_atoms)
-	{
-		atom.position.x += atom.velocity.x * dt;
-		atom.position.y += atom.velocity.y * dt;
-		atom.position.z += atom.velocity.z * dt;
+	// One unit of work per atom, so the hardware counters are reported per atom-step
+	PROFILE_PHASE("Simulation::Update", m_atoms.size());
+	ALLOCATION_TAG("Simulation");
+	ALLOCATION_FREE_SCOPE("Simulation::Update");
+	FrameStatsTimer stepTimer(FrameMetric::SIMULATION_STEP_TIME);
 
-		// X
-		if (atom.position.x + atom.radius > m_boxMaxX)
+	// Iterate chunk by chunk so the copy-on-write check only happens once per chunk and not once per atom. Atoms do not
+	// interact, so the chunks are stepped in parallel
+	m_atoms.ParallelForEachChunk(ThreadPool::Get(), TuningParameters::Current().simulationGrainSize, [this, dt](std::span<Atom> chunk)
+	{
+		for (auto& atom : chunk)
 		{
-			atom.position.x -= (atom.position.x + atom.radius - m_boxMaxX);
-			atom.velocity.x *= -1;
-		}
+			atom.position.x += atom.velocity.x * dt;
+			atom.position.y += atom.velocity.y * dt;
+			atom.position.z += atom.velocity.z * dt;
 
-		if (atom.position.x - atom.radius < -m_boxMaxX)
-		{
-			atom.position.x -= (atom.position.x - atom.radius + m_boxMaxX);
-			atom.velocity.x *= -1; 
-		}
+			// X
+			if (atom.position.x + atom.radius > m_boxMaxX)
+			{
+				atom.position.x -= (atom.position.x + atom.radius - m_boxMaxX);
+				atom.velocity.x *= -1;
+			}
 
-		// Y
-		if (atom.position.y + atom.radius > m_boxMaxY)
-		{
-			atom.position.y -= (atom.position.y + atom.radius - m_boxMaxY);
-			atom.velocity.y *= -1;
-		}
+			if (atom.position.x - atom.radius < -m_boxMaxX)
+			{
+				atom.position.x -= (atom.position.x - atom.radius + m_boxMaxX);
+				atom.velocity.x *= -1; 
+			}
 
-		if (atom.position.y - atom.radius < -m_boxMaxY)
-		{
-			atom.position.y -= (atom.position.y - atom.radius + m_boxMaxY);
-			atom.velocity.y *= -1;
-		}
+			// Y
+			if (atom.position.y + atom.radius > m_boxMaxY)
+			{
+				atom.position.y -= (atom.position.y + atom.radius - m_boxMaxY);
+				atom.velocity.y *= -1;
+			}
 
-		// Z
-		if (atom.position.z + atom.radius > m_boxMaxZ)
-		{
-			atom.position.z -= (atom.position.z + atom.radius - m_boxMaxZ);
-			atom.velocity.z *= -1;
-		}
+			if (atom.position.y - atom.radius < -m_boxMaxY)
+			{
+				atom.position.y -= (atom.position.y - atom.radius + m_boxMaxY);
+				atom.velocity.y *= -1;
+			}
 
-		if (atom.position.z - atom.radius < -m_boxMaxZ)
-		{
-			atom.position.z -= (atom.position.z - atom.radius + m_boxMaxZ);
-			atom.velocity.z *= -1;
+			// Z
+			if (atom.position.z + atom.radius > m_boxMaxZ)
+			{
+				atom.position.z -= (atom.position.z + atom.radius - m_boxMaxZ);
+				atom.velocity.z *= -1;
+			}
+
+			if (atom.position.z - atom.radius < -m_boxMaxZ)
+			{
+				atom.position.z -= (atom.position.z - atom.radius + m_boxMaxZ);
+				atom.velocity.z *= -1;
+			}
 		}
-	}
+	});
+
+	Metrics::Get().AddStep(m_atoms.size());
 }
 
 
@@ -2,7 +2,11 @@
 #include "pch.h"
 #include "utils/Timer.h"
 #include "utils/Log.h"
+#include "utils/DirtyRangeTracker.h"
 #include "utils/Event.h"
+#include "simulation/Atom.h"
+#include "simulation/AtomBVH.h"
+#include "simulation/AtomGrid.h"
 
 // Windows defines an 'AddAtom' macro, so we undefine it here so we can use it for a member function
 #pragma push_macro("AddAtom")
@@ -10,92 +14,27 @@
 
 namespace seethe
 {
-static constexpr unsigned int AtomTypeCount = 10;
-static constexpr std::array AtomNames = { "Hydrogen", "Helium", "Lithium", "Beryllium", "Boron", 
-										  "Carbon", "Nitrogen", "Oxygen", "Flourine", "Neon" };
-
-static constexpr std::array<float, AtomTypeCount> AtomicRadii = {
-	0.5f,
-	0.6f,
-	0.7f,
-	0.8f,
-	0.9f,
-	1.0f,
-	1.1f,
-	1.2f,
-	1.3f,
-	1.4f
-};
-
-enum class AtomType
-{
-	HYDROGEN = 1,
-	HELIUM = 2,
-	LITHIUM = 3,
-	BERYLLIUM = 4,
-	BORON = 5,
-	CARBON = 6,
-	NITROGEN = 7,
-	OXYGEN = 8,
-	FLOURINE = 9,
-	NEON = 10
-};
-
-// Forward declare so that we can make Simulation a friend
-class Simulation;
+// All of the coalesced simulation events carry the range of atom indices that changed since the last dispatch
+using SimulationEvent = CoalescedEvent<ChangedRange>;
 
-// This is a helper struct for grouping the pieces of data that are necessary when
-// adding/removing multiple atoms. Instead of having to all a method like 'AddAtom'
-// multiple times, we can call a method like 'AddAtoms' with a vector of AtomTPV
-struct AtomTPV
-{
-	constexpr AtomTPV() noexcept = default; 
-	constexpr AtomTPV(AtomType _type, const DirectX::XMFLOAT3& _position, const DirectX::XMFLOAT3& _velocity) noexcept :
-		type(_type), position(_position), velocity(_velocity)
-	{}
-	AtomType			type = AtomType::HYDROGEN;
-	DirectX::XMFLOAT3	position = { 0.0f, 0.0f, 0.0f };
-	DirectX::XMFLOAT3	velocity = { 0.0f, 0.0f, 0.0f };
-};
-
-class Atom
+class Simulation
 {
 public:
-	constexpr Atom(AtomType _type, const DirectX::XMFLOAT3& _position = {}, const DirectX::XMFLOAT3& _velocity = {}) noexcept :
-		type(_type),
-		position(_position),
-		velocity(_velocity),
-		radius(AtomicRadii[static_cast<int>(_type) - 1])
-	{}
-	constexpr Atom(const Atom& rhs) noexcept = default;
-	constexpr Atom& operator=(const Atom&) noexcept = default;
-	constexpr Atom(Atom&&) noexcept = default;
-	constexpr Atom& operator=(Atom&&) noexcept = default;
+	void Update(const seethe::Timer& timer) { Update(timer.DeltaTime()); }
+	// Advances the simulation by 'dt' seconds. Same as above, but with a fixed time step (i.e. for benchmarks)
+	void Update(float dt);
 
-	ND static constexpr float RadiusOf(AtomType type) noexcept
+	constexpr void AddAtom(const Atom& atom) noexcept
 	{
-		return AtomicRadii[static_cast<size_t>(type) - 1];
+		const bool tracked = AtomChangesAreTracked();
+		m_atoms.push_back(atom);
+		RecordStructureChange(m_atomsAddedEvent, m_atoms.size() - 1, m_atoms.size(), tracked);
 	}
-
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT3 velocity;
-	float radius;
-	AtomType type;
-
-private:
-	friend Simulation;
-};
-
-class Simulation
-{
-public:
-	void Update(const seethe::Timer& timer);
-
-	constexpr void AddAtom(const Atom& atom) noexcept { m_atoms.push_back(atom); InvokeHandlers(m_atomsAddedHandlers); }
 	constexpr Atom& AddAtom(AtomType type, const DirectX::XMFLOAT3& position = {}, const DirectX::XMFLOAT3& velocity = {}) noexcept
 	{
+		const bool tracked = AtomChangesAreTracked();
 		Atom& atom = m_atoms.emplace_back(type, position, velocity);
-		InvokeHandlers(m_atomsAddedHandlers);
+		RecordStructureChange(m_atomsAddedEvent, m_atoms.size() - 1, m_atoms.size(), tracked);
 		return atom;
 	}
 	constexpr Atom& AddAtom(const AtomTPV& data) noexcept { return AddAtom(data.type, data.position, data.velocity); }
@@ -104,9 +43,11 @@ public:
 		if (index == m_atoms.size())
 			return AddAtom(data);
 
-		auto iter = m_atoms.insert(m_atoms.begin() + index, { data.type, data.position, data.velocity });
-		InvokeHandlers(m_atomsAddedHandlers);
-		return *iter;
+		// NOTE: Inserting shifts every atom beyond 'index', so all of them are part of the changed range
+		const bool tracked = AtomChangesAreTracked();
+		Atom& atom = m_atoms.insert(index, { data.type, data.position, data.velocity });
+		RecordStructureChange(m_atomsAddedEvent, index, m_atoms.size(), tracked);
+		return atom;
 	}
 	constexpr std::vector<Atom*> AddAtoms(const std::vector<std::tuple<size_t, AtomTPV>>& indicesAndData) noexcept
 	{
@@ -120,6 +61,8 @@ public:
 		std::vector<std::tuple<size_t, AtomTPV>> data = indicesAndData;
 		std::ranges::sort(data, [](const std::tuple<size_t, AtomTPV>& lhs, const std::tuple<size_t, AtomTPV>& rhs) { return std::get<0>(lhs) < std::get<0>(rhs); });
 
+		const bool tracked = AtomChangesAreTracked();
+
 		std::for_each(data.begin(), data.end(), [&atoms, this](const std::tuple<size_t, AtomTPV>& tup)
 			{
 				size_t index = std::get<0>(tup);
@@ -132,12 +75,14 @@ public:
 				}
 				else
 				{
-					auto iter = m_atoms.insert(m_atoms.begin() + index, { tpv.type, tpv.position, tpv.velocity });
-					atoms.push_back(&(*iter));
+					Atom& a = m_atoms.insert(index, { tpv.type, tpv.position, tpv.velocity });
+					atoms.push_back(&a);
 				}
 			});
 
-		InvokeHandlers(m_atomsAddedHandlers);
+		if (!data.empty())
+			RecordStructureChange(m_atomsAddedEvent, std::get<0>(data.front()), m_atoms.size(), tracked);
+
 		return atoms;
 	}
 	constexpr std::vector<Atom*> AddAtoms(const std::vector<AtomTPV>& data) noexcept
@@ -145,40 +90,35 @@ public:
 		std::vector<Atom*> atoms;
 		atoms.reserve(data.size());
 
+		// NOTE: Each call to AddAtom records the event, but they all get coalesced into a single dispatch
 		std::for_each(data.begin(), data.end(), [&atoms, this](const AtomTPV& d) { atoms.push_back(&AddAtom(d)); });
 
-		InvokeHandlers(m_atomsAddedHandlers);
 		return atoms;
 	}
-	constexpr void RemoveAtom(size_t index, bool invokeHandlers = true) noexcept
+	constexpr void RemoveAtom(size_t index) noexcept
 	{
 		ASSERT(index < m_atoms.size(), "Index too large");
 
 		// Remove the index from selected list (if it exists)
 		if (AtomIsSelected(index))
-			UnselectAtom(index, invokeHandlers);
+			UnselectAtom(index);
 
 		// Decrement all of the selected indices that lie beyond the atom being removed
 		DecrementSelectedIndicesBeyondIndex(index);
 
-		// Erase the atom
-		m_atoms.erase(m_atoms.begin() + index);
+		// The range covers every atom that was either removed or shifted, so it ends at the size before erasing
+		const bool tracked = AtomChangesAreTracked();
+		const size_t last = m_atoms.size();
 
-		// Invoke the handlers
-		if (invokeHandlers)
-			InvokeHandlers(m_atomsRemovedHandlers);
+		// Erase the atom
+		m_atoms.erase(index);
+		RecordStructureChange(m_atomsRemovedEvent, index, last, tracked);
 	}
 	constexpr void RemoveAtoms(std::vector<size_t>& indices) noexcept
 	{
-		bool oneIsSelected = AtLeastOneAtomWithIndexIsSelected(indices);
-
 		// Must first sort the indices because it is only safe to erase largest to smallest
 		std::sort(indices.begin(), indices.end(), std::greater<size_t>());
-		std::for_each(indices.begin(), indices.end(), [this](const size_t& index) { RemoveAtom(index, false); });
-
-		if (oneIsSelected)
-			InvokeHandlers(m_selectedAtomsChangedHandlers);
-		InvokeHandlers(m_atomsRemovedHandlers);
+		std::for_each(indices.begin(), indices.end(), [this](const size_t& index) { RemoveAtom(index); });
 	}
 	constexpr void RemoveAtoms(const std::vector<size_t>& indices) noexcept
 	{
@@ -190,11 +130,7 @@ public:
 		}
 		else
 		{
-			bool oneIsSelected = AtLeastOneAtomWithIndexIsSelected(indices);
-			std::for_each(indices.begin(), indices.end(), [this](const size_t& index) { RemoveAtom(index, false); });
-			if (oneIsSelected)
-				InvokeHandlers(m_selectedAtomsChangedHandlers);
-			InvokeHandlers(m_atomsRemovedHandlers);
+			std::for_each(indices.begin(), indices.end(), [this](const size_t& index) { RemoveAtom(index); });
 		}
 	}
 	constexpr void RemoveLastAtoms(size_t count) noexcept
@@ -224,6 +160,42 @@ public:
 	ND constexpr auto&& GetAtoms(this Self&& self) noexcept { return std::forward<Self>(self).m_atoms; }
 	template <class Self>
 	ND constexpr auto&& GetAtom(this Self&& self, size_t index) noexcept { return std::forward<Self>(self).m_atoms[index]; }
+	// Returns a frozen copy of the current atom state. This is O(#chunks) and is therefore safe to call every frame 
+	// NOTE: The snapshot can be read from another thread (i.e. for saving), but must be taken on the simulation thread
+	ND AtomStore SnapshotAtoms() const noexcept { return m_atoms.Snapshot(); }
+	// The BVH is rebuilt/refit lazily here, so it only costs anything the first time it is requested after the atoms change
+	ND const AtomBVH& GetBVH() noexcept { m_bvh.Update(m_atoms); return m_bvh; }
+	// Same idea for the spatial grid used for neighbor/radius/box queries. Use the batched queries on the grid itself
+	// when issuing many queries at once (they are spread across the thread pool)
+	ND const AtomGrid& GetSpatialIndex() noexcept { m_grid.Update(m_atoms); return m_grid; }
+	ND std::vector<size_t> AtomsWithinRadius(const DirectX::XMFLOAT3& center, float radius) noexcept
+	{
+		std::vector<size_t> results;
+		GetSpatialIndex().QueryRadius(center, radius, results);
+		return results;
+	}
+	ND std::vector<size_t> AtomsInBox(const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax) noexcept
+	{
+		std::vector<size_t> results;
+		GetSpatialIndex().QueryBox(boxMin, boxMax, results);
+		return results;
+	}
+	// Returns every atom whose bounding sphere intersects the frustum (uses the BVH)
+	ND std::vector<size_t> AtomsInFrustum(const Frustum& frustum) noexcept
+	{
+		std::vector<size_t> results;
+		GetBVH().QueryFrustum(frustum, results);
+		return results;
+	}
+	// Returns the k atoms closest to the atom at 'atomIndex' (not including the atom itself), nearest first
+	ND std::vector<size_t> NearestAtoms(size_t atomIndex, size_t k) noexcept
+	{
+		ASSERT(atomIndex < m_atoms.size(), "Index too large");
+		std::vector<size_t> results;
+		results.reserve(k);
+		GetSpatialIndex().QueryKNearest(std::as_const(m_atoms)[atomIndex].position, k, results, atomIndex);
+		return results;
+	}
 	template <class Self>
 	ND constexpr auto&& GetSelectedAtomIndices(this Self&& self) noexcept { return std::forward<Self>(self).m_selectedAtomIndices; }
 
@@ -275,7 +247,7 @@ public:
 		return bounds;
 	}
 
-	constexpr void SetAtoms(const std::vector<Atom>& atoms) noexcept
+	constexpr void SetAtoms(const AtomStore& atoms) noexcept
 	{
 		// In probably most cases, we are calling this function because of an undo/redo action and therefore,
 		// don't have to worry about atom selection because the atoms themselves are not changing (they are 
@@ -284,15 +256,12 @@ public:
 		// new number of atoms. To be safe, we are just going to clear the selected indices because the actual 
 		// selected indices probably wouldn't make sense anyways
 		if (atoms.size() != m_atoms.size())
-		{
-			m_selectedAtomIndices.clear();
-			InvokeHandlers(m_selectedAtomsChangedHandlers);
-		}
+			ClearSelectedAtoms();
 
 		m_atoms = atoms;
-		InvokeHandlers(m_atomsAddedHandlers);
+		RecordEvent(m_atomsAddedEvent, 0, m_atoms.size());
 	}
-	constexpr void SetAtoms(std::vector<Atom>&& atoms) noexcept
+	constexpr void SetAtoms(AtomStore&& atoms) noexcept
 	{
 		// In probably most cases, we are calling this function because of an undo/redo action and therefore,
 		// don't have to worry about atom selection because the atoms themselves are not changing (they are 
@@ -301,13 +270,10 @@ public:
 		// new number of atoms. To be safe, we are just going to clear the selected indices because the actual 
 		// selected indices probably wouldn't make sense anyways
 		if (atoms.size() != m_atoms.size())
-		{
-			m_selectedAtomIndices.clear();
-			InvokeHandlers(m_selectedAtomsChangedHandlers);
-		}
+			ClearSelectedAtoms();
 
 		m_atoms = std::move(atoms);
-		InvokeHandlers(m_atomsAddedHandlers);
+		RecordEvent(m_atomsAddedEvent, 0, m_atoms.size());
 	}
 	constexpr bool SetDimensions(float lengthXYZ, bool allowAtomsToRelocate = true) noexcept { return SetDimensions(lengthXYZ, lengthXYZ, lengthXYZ, allowAtomsToRelocate); }
 	constexpr bool SetDimensions(const DirectX::XMFLOAT3& lengths, bool allowAtomsToRelocate = true) noexcept { return SetDimensions(lengths.x, lengths.y, lengths.z, allowAtomsToRelocate); }
@@ -353,12 +319,16 @@ public:
 			}
 		}
 
+		// If the box got smaller in any dimension, atoms may have been relocated, so let listeners know that
+		// all atoms could have changed
+		bool boxShrunk = newMaxX < m_boxMaxX || newMaxY < m_boxMaxY || newMaxZ < m_boxMaxZ;
+
 		// At this point, any and all relocation should have already happened, so we can just update the box values
 		m_boxMaxX = newMaxX;
 		m_boxMaxY = newMaxY;
 		m_boxMaxZ = newMaxZ;
 
-		InvokeHandlers(m_boxSizeChangedHandlers);
+		RecordEvent(m_boxSizeChangedEvent, 0, boxShrunk && allowAtomsToRelocate ? m_atoms.size() : 0);
 		return true;
 	}
 
@@ -376,33 +346,74 @@ public:
 
 			m_selectedAtomIndices.push_back(index);
 			UpdateSelectedAtomsCenter();
-			InvokeHandlers(m_selectedAtomsChangedHandlers);
+			RecordEvent(m_selectedAtomsChangedEvent, index, index + 1);
 		}
 	}
 	constexpr void SelectAtom(const Atom& atom, bool unselectAllOthersFirst = false) noexcept { SelectAtom(IndexOf(atom), unselectAllOthersFirst); }
+	// Bulk version of SelectAtom() for when many atoms get selected at once (i.e. marquee selection). Only a single
+	// selection changed event is recorded no matter how many atoms are selected
+	// NOTE: AtomIsSelected() is a linear search, so we check against a sorted copy of the current selection instead.
+	//       Otherwise selecting thousands of atoms would be quadratic
+	// NOTE: 'indices' is expected to not contain duplicates (spatial queries never return any)
+	constexpr void SelectAtoms(std::span<const size_t> indices, bool unselectAllOthersFirst = false) noexcept
+	{
+		if (unselectAllOthersFirst)
+			ClearSelectedAtoms();
+
+		std::vector<size_t> alreadySelected = m_selectedAtomIndices;
+		std::ranges::sort(alreadySelected);
+
+		size_t first = std::numeric_limits<size_t>::max();
+		size_t last = 0;
+		for (size_t index : indices)
+		{
+			ASSERT(index < m_atoms.size(), "Index is too large");
+			if (!std::ranges::binary_search(alreadySelected, index))
+			{
+				m_selectedAtomIndices.push_back(index);
+				first = std::min(first, index);
+				last = std::max(last, index);
+			}
+		}
+
+		if (first <= last)
+		{
+			UpdateSelectedAtomsCenter();
+			RecordEvent(m_selectedAtomsChangedEvent, first, last + 1);
+		}
+	}
 	ND constexpr bool AtomIsSelected(const Atom& atom) const noexcept { return AtomIsSelected(IndexOf(atom)); }
 	ND constexpr bool AtomIsSelected(size_t index) const noexcept { return m_selectedAtomIndices.cend() != std::find(m_selectedAtomIndices.cbegin(), m_selectedAtomIndices.cend(), index); }
 	ND constexpr bool AtLeastOneAtomWithIndexIsSelected(const std::vector<size_t>& indices) const noexcept { return indices.cend() != std::find_if(indices.cbegin(), indices.cend(), [this](const size_t& index) { return AtomIsSelected(index); }); }
-	constexpr void ClearSelectedAtoms() noexcept { m_selectedAtomIndices.clear(); UpdateSelectedAtomsCenter(); InvokeHandlers(m_selectedAtomsChangedHandlers); }
-	constexpr void UnselectAtom(size_t index, bool invokeHandlers = true) noexcept
+	constexpr void ClearSelectedAtoms() noexcept 
+	{ 
+		if (!m_selectedAtomIndices.empty())
+		{
+			auto [minIter, maxIter] = std::ranges::minmax_element(m_selectedAtomIndices);
+			RecordEvent(m_selectedAtomsChangedEvent, *minIter, *maxIter + 1);
+		}
+		m_selectedAtomIndices.clear(); 
+		UpdateSelectedAtomsCenter(); 
+	}
+	constexpr void UnselectAtom(size_t index) noexcept
 	{
 		ASSERT(index < m_atoms.size(), "Index too large");
-		std::erase(m_selectedAtomIndices, index);
-		UpdateSelectedAtomsCenter();
-
-		if (invokeHandlers)
-			InvokeHandlers(m_selectedAtomsChangedHandlers);
+		if (std::erase(m_selectedAtomIndices, index) > 0)
+		{
+			UpdateSelectedAtomsCenter();
+			RecordEvent(m_selectedAtomsChangedEvent, index, index + 1);
+		}
 	}
-	constexpr void UnselectAtom(const Atom& atom, bool InvokeHandlers = true) noexcept { UnselectAtom(IndexOf(atom), InvokeHandlers); }
+	constexpr void UnselectAtom(const Atom& atom) noexcept { UnselectAtom(IndexOf(atom)); }
 	constexpr void UnselectAtoms(const std::vector<size_t> indices) noexcept
 	{
 		for (size_t index : indices)
 		{
 			ASSERT(index < m_atoms.size(), "Index too large");
-			std::erase(m_selectedAtomIndices, index);
+			if (std::erase(m_selectedAtomIndices, index) > 0)
+				RecordEvent(m_selectedAtomsChangedEvent, index, index + 1);
 		}
 		UpdateSelectedAtomsCenter();
-		InvokeHandlers(m_selectedAtomsChangedHandlers);
 	}
 
 	constexpr void UpdateSelectedAtomsCenter() noexcept
@@ -414,9 +425,11 @@ public:
 		{
 			const float factor = 1.0f / count;
 
+			// NOTE: Use const access so that simply reading the atoms does not bump the atom version or copy shared chunks
+			const AtomStore& atoms = m_atoms;
 			for (size_t iii : m_selectedAtomIndices)
 			{
-				const Atom& atom = m_atoms[iii];
+				const Atom& atom = atoms[iii];
 
 				m_selectedAtomsCenter.x += (atom.position.x * factor);
 				m_selectedAtomsCenter.y += (atom.position.y * factor);
@@ -429,7 +442,7 @@ public:
 	{
 		if (MoveSelectedAtomsXIsInBounds(delta))
 		{
-			std::for_each(m_selectedAtomIndices.begin(), m_selectedAtomIndices.end(), [this, delta](const size_t& index) { m_atoms[index].position.x += delta; });
+			MoveAtoms(m_selectedAtomIndices, [delta](Atom& atom) { atom.position.x += delta; });
 			UpdateSelectedAtomsCenter();
 		}
 	}
@@ -437,7 +450,7 @@ public:
 	{
 		if (MoveSelectedAtomsYIsInBounds(delta))
 		{
-			std::for_each(m_selectedAtomIndices.begin(), m_selectedAtomIndices.end(), [this, delta](const size_t& index) { m_atoms[index].position.y += delta; });
+			MoveAtoms(m_selectedAtomIndices, [delta](Atom& atom) { atom.position.y += delta; });
 			UpdateSelectedAtomsCenter();
 		}
 	}
@@ -445,7 +458,7 @@ public:
 	{
 		if (MoveSelectedAtomsZIsInBounds(delta))
 		{
-			std::for_each(m_selectedAtomIndices.begin(), m_selectedAtomIndices.end(), [this, delta](const size_t& index) { m_atoms[index].position.z += delta; });
+			MoveAtoms(m_selectedAtomIndices, [delta](Atom& atom) { atom.position.z += delta; });
 			UpdateSelectedAtomsCenter();
 		}
 	}
@@ -453,7 +466,7 @@ public:
 	{
 		if (MoveSelectedAtomsXIsInBounds(deltaX) && MoveSelectedAtomsYIsInBounds(deltaY))
 		{
-			std::for_each(m_selectedAtomIndices.begin(), m_selectedAtomIndices.end(), [this, deltaX, deltaY](const size_t& index) { m_atoms[index].position.x += deltaX; m_atoms[index].position.y += deltaY; });
+			MoveAtoms(m_selectedAtomIndices, [deltaX, deltaY](Atom& atom) { atom.position.x += deltaX; atom.position.y += deltaY; });
 			UpdateSelectedAtomsCenter();
 		}
 	}
@@ -461,7 +474,7 @@ public:
 	{
 		if (MoveSelectedAtomsXIsInBounds(deltaX) && MoveSelectedAtomsZIsInBounds(deltaZ))
 		{
-			std::for_each(m_selectedAtomIndices.begin(), m_selectedAtomIndices.end(), [this, deltaX, deltaZ](const size_t& index) { m_atoms[index].position.x += deltaX; m_atoms[index].position.z += deltaZ; });
+			MoveAtoms(m_selectedAtomIndices, [deltaX, deltaZ](Atom& atom) { atom.position.x += deltaX; atom.position.z += deltaZ; });
 			UpdateSelectedAtomsCenter();
 		}
 	}
@@ -469,35 +482,120 @@ public:
 	{
 		if (MoveSelectedAtomsYIsInBounds(deltaY) && MoveSelectedAtomsZIsInBounds(deltaZ))
 		{
-			std::for_each(m_selectedAtomIndices.begin(), m_selectedAtomIndices.end(), [this, deltaY, deltaZ](const size_t& index) { m_atoms[index].position.y += deltaY; m_atoms[index].position.z += deltaZ; });
+			MoveAtoms(m_selectedAtomIndices, [deltaY, deltaZ](Atom& atom) { atom.position.y += deltaY; atom.position.z += deltaZ; });
 			UpdateSelectedAtomsCenter();
 		}
 	}
 	constexpr void MoveAtom(size_t index, DirectX::XMFLOAT3 delta) noexcept
 	{
-		Atom& atom = m_atoms[index];
-		atom.position.x += delta.x;
-		atom.position.y += delta.y;
-		atom.position.z += delta.z;
+		MoveAtoms(std::span<const size_t>(&index, 1), [&delta](Atom& atom)
+			{
+				atom.position.x += delta.x;
+				atom.position.y += delta.y;
+				atom.position.z += delta.z;
+			}
+		);
+	}
+
+	// Editing a single atom. Only that atom is recorded as changed, and only if the value actually differs - writing
+	// the same value back (i.e. every frame while an edit control is shown) must not touch the store at all
+	constexpr void SetAtomPosition(size_t index, const DirectX::XMFLOAT3& position) noexcept
+	{
+		const DirectX::XMFLOAT3& current = std::as_const(m_atoms)[index].position;
+		if (current.x != position.x || current.y != position.y || current.z != position.z)
+			MoveAtoms(std::span<const size_t>(&index, 1), [&position](Atom& atom) { atom.position = position; });
 	}
+	constexpr void SetAtomVelocity(size_t index, const DirectX::XMFLOAT3& velocity) noexcept
+	{
+		const DirectX::XMFLOAT3& current = std::as_const(m_atoms)[index].velocity;
+		if (current.x != velocity.x || current.y != velocity.y || current.z != velocity.z)
+			MoveAtoms(std::span<const size_t>(&index, 1), [&velocity](Atom& atom) { atom.velocity = velocity; });
+	}
+
+	// Per-atom change tracking. Each call to DispatchEvents() commits the atoms that changed during the frame as a new
+	// version, so consumers (i.e. the renderer's instance buffers) can ask which atoms changed since the version they
+	// last synced to instead of re-processing every atom every frame.
+	// NOTE: Only moving atoms and the single atom setters are tracked per atom. Anything else that modifies the atom
+	//       store (playing the simulation, adding/removing atoms, resizing the box, non-const access to an atom, ...)
+	//       marks every atom as changed
+	ND constexpr const DirtyRangeTracker& GetAtomChanges() const noexcept { return m_atomChanges; }
 
 	// Handlers
-	constexpr void RegisterBoxSizeChangedHandler(const EventHandler& handler) noexcept { m_boxSizeChangedHandlers.push_back(handler); }
-	constexpr void RegisterBoxSizeChangedHandler(EventHandler&& handler) noexcept { m_boxSizeChangedHandlers.push_back(handler); }
-	constexpr void RegisterSelectedAtomsChangedHandler(const EventHandler& handler) noexcept { m_selectedAtomsChangedHandlers.push_back(handler); }
-	constexpr void RegisterSelectedAtomsChangedHandler(EventHandler&& handler) noexcept { m_selectedAtomsChangedHandlers.push_back(handler); }
-	constexpr void RegisterAtomsAddedHandler(const EventHandler& handler) noexcept { m_atomsAddedHandlers.push_back(handler); }
-	constexpr void RegisterAtomsAddedHandler(EventHandler&& handler) noexcept { m_atomsAddedHandlers.push_back(handler); }
-	constexpr void RegisterAtomsRemovedHandler(const EventHandler& handler) noexcept { m_atomsRemovedHandlers.push_back(handler); }
-	constexpr void RegisterAtomsRemovedHandler(EventHandler&& handler) noexcept { m_atomsRemovedHandlers.push_back(handler); }
+	// NOTE: Box size, selection, and atoms added/removed handlers are NOT invoked when the change happens. Instead,
+	//       all changes made during a frame are coalesced and each handler is invoked once in DispatchEvents().
+	//       The simulation started/stopped handlers are still invoked immediately.
+	constexpr void RegisterBoxSizeChangedHandler(const SimulationEvent::Handler& handler) noexcept { m_boxSizeChangedEvent.Register(handler); }
+	constexpr void RegisterBoxSizeChangedHandler(SimulationEvent::Handler&& handler) noexcept { m_boxSizeChangedEvent.Register(std::move(handler)); }
+	constexpr void RegisterSelectedAtomsChangedHandler(const SimulationEvent::Handler& handler) noexcept { m_selectedAtomsChangedEvent.Register(handler); }
+	constexpr void RegisterSelectedAtomsChangedHandler(SimulationEvent::Handler&& handler) noexcept { m_selectedAtomsChangedEvent.Register(std::move(handler)); }
+	constexpr void RegisterAtomsAddedHandler(const SimulationEvent::Handler& handler) noexcept { m_atomsAddedEvent.Register(handler); }
+	constexpr void RegisterAtomsAddedHandler(SimulationEvent::Handler&& handler) noexcept { m_atomsAddedEvent.Register(std::move(handler)); }
+	constexpr void RegisterAtomsRemovedHandler(const SimulationEvent::Handler& handler) noexcept { m_atomsRemovedEvent.Register(handler); }
+	constexpr void RegisterAtomsRemovedHandler(SimulationEvent::Handler&& handler) noexcept { m_atomsRemovedEvent.Register(std::move(handler)); }
 	constexpr void RegisterSimulationStartedHandler(const EventHandler& handler) noexcept { m_simulationStartedHandlers.push_back(handler); }
 	constexpr void RegisterSimulationStartedHandler(EventHandler&& handler) noexcept { m_simulationStartedHandlers.push_back(handler); }
 	constexpr void RegisterSimulationStoppedHandler(const EventHandler& handler) noexcept { m_simulationStoppedHandlers.push_back(handler); }
 	constexpr void RegisterSimulationStoppedHandler(EventHandler&& handler) noexcept { m_simulationStoppedHandlers.push_back(handler); }
 
-	ND constexpr size_t IndexOf(const Atom& atom) const noexcept { return static_cast<size_t>(std::distance(m_atoms.data(), &atom)); }
+	ND constexpr size_t IndexOf(const Atom& atom) const noexcept { return m_atoms.IndexOf(atom); }
+
+	// This is the per-frame sync point for the coalesced events. Removals are dispatched before additions so that
+	// listeners see instance counts shrink before they grow, and selection comes after both because selection 
+	// handlers may index into the atoms
+	constexpr void DispatchEvents() noexcept
+	{
+		CommitAtomChanges();
+
+		m_atomsRemovedEvent.Dispatch();
+		m_atomsAddedEvent.Dispatch();
+		m_selectedAtomsChangedEvent.Dispatch();
+		m_boxSizeChangedEvent.Dispatch();
+	}
 
 private:
+	static constexpr void RecordEvent(SimulationEvent& event, size_t first, size_t last) noexcept
+	{
+		event.Record([first, last](ChangedRange& range) { range.Include(first, last); });
+	}
+
+	// Adding/removing atoms records [first, last) both as the range of the event and as the atoms that changed, so
+	// consumers of the change tracker only have to look at the atoms that were added, removed or shifted. 'wasTracked'
+	// is whether the tracker was up to date before the atoms were added/removed (see MoveAtoms())
+	constexpr void RecordStructureChange(SimulationEvent& event, size_t first, size_t last, bool wasTracked) noexcept
+	{
+		RecordEvent(event, first, last);
+
+		if (!wasTracked)
+			m_atomChanges.MarkAllDirty();
+		m_atomChanges.MarkDirty(first, last);
+		m_trackedAtomsVersion = m_atoms.Version();
+	}
+	ND constexpr bool AtomChangesAreTracked() const noexcept { return m_atoms.Version() == m_trackedAtomsVersion; }
+
+	// Applies 'move' to each of the atoms in 'indices' and records them as changed
+	template <typename F>
+	constexpr void MoveAtoms(std::span<const size_t> indices, F&& move) noexcept
+	{
+		// If the atoms were modified without going through here, we no longer know exactly what changed
+		if (m_atoms.Version() != m_trackedAtomsVersion)
+			m_atomChanges.MarkAllDirty();
+
+		for (size_t index : indices)
+		{
+			move(m_atoms[index]);
+			m_atomChanges.MarkDirty(index);
+		}
+		m_trackedAtomsVersion = m_atoms.Version();
+	}
+	constexpr void CommitAtomChanges() noexcept
+	{
+		if (m_atoms.Version() != m_trackedAtomsVersion)
+			m_atomChanges.MarkAllDirty();
+
+		m_atomChanges.Commit();
+		m_trackedAtomsVersion = m_atoms.Version();
+	}
+
 	ND constexpr bool DimensionUpdateTryRelocation(float& position, float radius, float newMax, bool allowRelocation) noexcept
 	{
 		// Check positive max
@@ -563,15 +661,25 @@ private:
 		return true;
 	}
 
-	std::vector<Atom> m_atoms = {};
+	AtomStore m_atoms = {};
 	std::vector<size_t> m_selectedAtomIndices;
 	DirectX::XMFLOAT3 m_selectedAtomsCenter = { 0.0f, 0.0f, 0.0f };
 
-	// Event handlers
-	EventHandlers m_boxSizeChangedHandlers;
-	EventHandlers m_selectedAtomsChangedHandlers;
-	EventHandlers m_atomsAddedHandlers;
-	EventHandlers m_atomsRemovedHandlers;
+	// Spatial index used for ray picking. Don't access directly - use GetBVH() so that it is up to date
+	AtomBVH m_bvh;
+	// Spatial index used for neighbor queries. Don't access directly - use GetSpatialIndex() so that it is up to date
+	AtomGrid m_grid;
+
+	// Atoms that changed since the last DispatchEvents(). m_trackedAtomsVersion is the version of the atom store after the
+	// last change that was recorded, so any other change to the store can be detected
+	DirtyRangeTracker m_atomChanges;
+	std::uint64_t m_trackedAtomsVersion = 0;
+
+	// Events
+	SimulationEvent m_boxSizeChangedEvent;
+	SimulationEvent m_selectedAtomsChangedEvent;
+	SimulationEvent m_atomsAddedEvent;
+	SimulationEvent m_atomsRemovedEvent;
 	EventHandlers m_simulationStartedHandlers;
 	EventHandlers m_simulationStoppedHandlers;
 
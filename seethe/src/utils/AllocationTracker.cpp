@@ -0,0 +1,223 @@
+#include "AllocationTracker.h"
+#include "utils/Log.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+namespace seethe
+{
+constinit AllocationTracker AllocationTracker::s_tracker;
+thread_local std::uint32_t AllocationTracker::t_tag = AllocationTracker::UntaggedTag;
+thread_local std::uint64_t AllocationTracker::t_allocations = 0;
+
+AllocationTracker& AllocationTracker::Get() noexcept
+{
+	return s_tracker;
+}
+
+std::uint32_t AllocationTracker::RegisterTag(const char* name) noexcept
+{
+	std::lock_guard<std::mutex> lock(m_tagMutex);
+
+	for (std::uint32_t iii = 0; iii < m_tagCount; ++iii)
+	{
+		if (std::strcmp(m_tagNames[iii], name) == 0)
+			return iii;
+	}
+
+	if (m_tagCount == MaxTags)
+		return MaxTags - 1;
+
+	m_tagNames[m_tagCount] = name;
+	return m_tagCount++;
+}
+
+void AllocationTracker::EndFrame() noexcept
+{
+	m_lastFrameAllocations = 0;
+	m_lastFrameBytes = 0;
+	for (size_t iii = 0; iii < MaxTags; ++iii)
+	{
+		const std::uint64_t allocations = m_allocations[iii].load(std::memory_order_relaxed);
+		const std::uint64_t bytes = m_bytes[iii].load(std::memory_order_relaxed);
+		m_frameAllocations[iii] = allocations - m_previousAllocations[iii];
+		m_frameBytes[iii] = bytes - m_previousBytes[iii];
+		m_previousAllocations[iii] = allocations;
+		m_previousBytes[iii] = bytes;
+
+		if (iii != ExemptTag)
+		{
+			m_lastFrameAllocations += m_frameAllocations[iii];
+			m_lastFrameBytes += m_frameBytes[iii];
+		}
+	}
+
+	const std::uint64_t frees = m_frees.load(std::memory_order_relaxed);
+	m_lastFrameFrees = frees - m_previousFrees;
+	m_previousFrees = frees;
+
+	if (!IsCheckingSteadyState())
+		return;
+
+	// Logging allocates, so everything from here on is charged to the tracker's own tag
+	AllocationTagScope tag(ExemptTag);
+
+	if (m_warmupFramesLeft > 0)
+	{
+		if (--m_warmupFramesLeft == 0)
+			LOG_INFO("Allocation check: warm-up done, checking the next {} frames", m_checkFramesLeft);
+		return;
+	}
+
+	++m_checkedFrames;
+	if (m_lastFrameAllocations > 0)
+	{
+		++m_failedFrames;
+
+		std::string tags;
+		ForEachTag([this, &tags](const TagCounters& counters)
+			{
+				if (counters.frameAllocations > 0 && counters.name != m_tagNames[ExemptTag])
+					tags += std::format(" {} ({} / {} bytes)", counters.name, counters.frameAllocations, counters.frameBytes);
+			}
+		);
+		LOG_ERROR("Allocation check: frame {} made {} allocations ({} bytes):{}", m_checkedFrames, m_lastFrameAllocations, m_lastFrameBytes, tags);
+	}
+
+	if (--m_checkFramesLeft == 0)
+	{
+		m_checkResult = m_failedFrames == 0 && m_scopeViolations == 0 ? 0 : 1;
+		if (m_checkResult == 0)
+			LOG_INFO("Allocation check passed: {} steady state frames without a heap allocation", m_checkedFrames);
+		else
+			LOG_ERROR("Allocation check FAILED: {} of {} frames allocated, {} allocation free scopes allocated", m_failedFrames, m_checkedFrames, m_scopeViolations);
+	}
+}
+
+void AllocationTracker::StartSteadyStateCheck(unsigned int warmupFrames, unsigned int checkedFrames) noexcept
+{
+	m_warmupFramesLeft = std::max(1u, warmupFrames);
+	m_checkFramesLeft = std::max(1u, checkedFrames);
+	m_checkedFrames = 0;
+	m_failedFrames = 0;
+	m_scopeViolations = 0;
+	m_checkResult.reset();
+}
+
+void AllocationTracker::ReportAllocationFreeViolation(const char* scope, std::uint64_t allocations) noexcept
+{
+	AllocationTagScope tag(ExemptTag);
+
+	++m_scopeViolations;
+	LOG_ERROR("Allocation check: '{}' made {} allocations in the steady state", scope, allocations);
+}
+}
+
+#ifdef ENABLE_ALLOCATION_TRACKING
+
+namespace
+{
+// Size of the heap block behind 'p', which is the same when it is allocated and when it is freed
+size_t BlockSize(void* p) noexcept
+{
+#if defined(_WIN32)
+	return _msize(p);
+#elif defined(__APPLE__)
+	return malloc_size(p);
+#else
+	return malloc_usable_size(p);
+#endif
+}
+size_t AlignedBlockSize(void* p, [[maybe_unused]] size_t alignment) noexcept
+{
+#if defined(_WIN32)
+	return _aligned_msize(p, alignment, 0);
+#else
+	return BlockSize(p);
+#endif
+}
+
+// Every block is allocated one byte larger than asked for, and its last byte holds the tag it was allocated under. The
+// caller never writes that far, and the block size is the same when it is freed, so the free finds the tag there
+size_t WithTagByte(size_t size)
+{
+	if (size == std::numeric_limits<size_t>::max())
+		throw std::bad_alloc();
+	return size + 1;
+}
+void StoreTag(void* p, size_t blockBytes, std::uint32_t tag) noexcept
+{
+	static_cast<std::uint8_t*>(p)[blockBytes - 1] = static_cast<std::uint8_t>(tag);
+}
+std::uint32_t LoadTag(const void* p, size_t blockBytes) noexcept
+{
+	return static_cast<const std::uint8_t*>(p)[blockBytes - 1];
+}
+}
+
+// The standard library's array and nothrow forms forward to these. The sized deletes are replaced as well, since the
+// compiler calls them directly (and the defaults would not be counted everywhere)
+void* operator new(std::size_t size)
+{
+	if (void* p = std::malloc(WithTagByte(size)))
+	{
+		const size_t blockBytes = BlockSize(p);
+		StoreTag(p, blockBytes, seethe::AllocationTracker::OnAllocate(size, blockBytes));
+		return p;
+	}
+	throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept
+{
+	if (p == nullptr)
+		return;
+	const size_t blockBytes = BlockSize(p);
+	seethe::AllocationTracker::OnFree(LoadTag(p, blockBytes), blockBytes);
+	std::free(p);
+}
+void operator delete(void* p, [[maybe_unused]] std::size_t size) noexcept
+{
+	// The block size is measured the same way for every kind of delete, so the size that was asked for is not needed
+	operator delete(p);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	const size_t align = static_cast<size_t>(alignment);
+#if defined(_WIN32)
+	void* p = _aligned_malloc(WithTagByte(size), align);
+#else
+	// aligned_alloc() wants the size to be a multiple of the alignment
+	void* p = std::aligned_alloc(align, (WithTagByte(size) + align - 1) / align * align);
+#endif
+	if (p == nullptr)
+		throw std::bad_alloc();
+
+	const size_t blockBytes = AlignedBlockSize(p, align);
+	StoreTag(p, blockBytes, seethe::AllocationTracker::OnAllocate(size, blockBytes));
+	return p;
+}
+void operator delete(void* p, std::align_val_t alignment) noexcept
+{
+	if (p == nullptr)
+		return;
+	const size_t blockBytes = AlignedBlockSize(p, static_cast<size_t>(alignment));
+	seethe::AllocationTracker::OnFree(LoadTag(p, blockBytes), blockBytes);
+#if defined(_WIN32)
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+void operator delete(void* p, [[maybe_unused]] std::size_t size, std::align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
+
+#endif
@@ -0,0 +1,229 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+// AllocationTracker counts every heap allocation that goes through operator new (the replacements live in
+// AllocationTracker.cpp), so that allocation churn can be watched like any other performance budget:
+//
+//   - Each allocation is charged to the calling thread's current tag. ALLOCATION_TAG("name") sets the tag for the rest
+//     of the enclosing scope, and ThreadPool workers take on the tag of the thread that submitted the job. Anything
+//     outside a tag is "Untagged"
+//   - ALLOCATION_END_FRAME() (once per frame, on the main thread) turns the running totals into per-frame deltas
+//   - Frees are counted too, and GetLiveBytes() is the memory held by allocations that have not been freed yet, in
+//     total and by tag (each heap block ends with one extra byte that holds the tag it was allocated under, so a free
+//     is charged back to that tag). It is measured in heap block sizes (what _msize()/malloc_usable_size() report),
+//     because an unsized operator delete (i.e. delete[] of a trivially destructible type) is not told the size that
+//     was asked for
+//   - StartSteadyStateCheck() is a test mode (--check-allocations on the command line, and the headless frame loop in
+//     the unit tests). After the warm-up frames, every frame that allocates, and every ALLOCATION_FREE_SCOPE() that
+//     allocates, is logged as a failure along with the tags responsible. Once all of the checked frames have run,
+//     GetCheckResult() holds the exit code (0 = no allocations)
+//
+// NOTE: Only allocations made through this module's operator new are seen. ImGui (IM_ALLOC) and the D3D12 runtime use
+//       their own allocators
+//
+// NOTE: The operator new/delete replacements and all of the ALLOCATION_* macros only exist when
+//       ENABLE_ALLOCATION_TRACKING is defined. Without it every count simply stays at 0
+class AllocationTracker
+{
+public:
+	static constexpr size_t MaxTags = 32;
+	static constexpr std::uint32_t UntaggedTag = 0;
+	static constexpr std::uint32_t ExemptTag = 1;		// Never counts against a frame (the tracker's own reporting and the logging thread)
+	static_assert(MaxTags <= 256, "The tag is stored in a single byte of each heap block");
+
+	struct TagCounters
+	{
+		const char* name = nullptr;
+		std::uint64_t frameAllocations = 0;
+		std::uint64_t frameBytes = 0;
+		std::uint64_t totalAllocations = 0;
+		std::uint64_t totalBytes = 0;
+		std::uint64_t liveBytes = 0;
+	};
+
+	ND static AllocationTracker& Get() noexcept;
+
+	// Called by operator new/delete - must not allocate. 'blockBytes' is the size of the heap block that holds the
+	// allocation (at least 'bytes'). OnAllocate() returns the tag the allocation is charged to, which has to be passed
+	// to OnFree() when it is freed
+	ND static std::uint32_t OnAllocate(size_t bytes, size_t blockBytes) noexcept
+	{
+		AllocationTracker& tracker = Get();
+		const std::uint32_t tag = t_tag;
+		tracker.m_allocations[tag].fetch_add(1, std::memory_order_relaxed);
+		tracker.m_bytes[tag].fetch_add(bytes, std::memory_order_relaxed);
+		tracker.m_liveBytes[tag].fetch_add(blockBytes, std::memory_order_relaxed);
+		++t_allocations;
+		return tag;
+	}
+	static void OnFree(std::uint32_t tag, size_t blockBytes) noexcept
+	{
+		AllocationTracker& tracker = Get();
+		tracker.m_frees.fetch_add(1, std::memory_order_relaxed);
+		tracker.m_liveBytes[tag].fetch_sub(blockBytes, std::memory_order_relaxed);
+	}
+
+	// 'name' must be a string literal (or otherwise outlive the tracker). Once MaxTags are in use, further names share
+	// the last tag
+	ND std::uint32_t RegisterTag(const char* name) noexcept;
+	ND static std::uint32_t& CurrentTag() noexcept { return t_tag; }
+	ND static std::uint64_t ThreadAllocationCount() noexcept { return t_allocations; }
+
+	void EndFrame() noexcept;
+
+	// fn(const TagCounters&) is called for every tag that has allocated at some point, with its counts for the last
+	// frame and since startup. Nothing is allocated, so this is safe to call from a frame that is being checked
+	template <typename F>
+	void ForEachTag(F&& fn) const noexcept
+	{
+		std::lock_guard<std::mutex> lock(m_tagMutex);
+		for (std::uint32_t iii = 0; iii < m_tagCount; ++iii)
+		{
+			const TagCounters counters = {
+				m_tagNames[iii],
+				m_frameAllocations[iii],
+				m_frameBytes[iii],
+				m_allocations[iii].load(std::memory_order_relaxed),
+				m_bytes[iii].load(std::memory_order_relaxed),
+				m_liveBytes[iii].load(std::memory_order_relaxed)
+			};
+			if (counters.totalAllocations > 0)
+				fn(counters);
+		}
+	}
+	// Same as ForEachTag(), but only the counts since startup (the frame counts are left at 0). Those are atomic, so unlike
+	// ForEachTag() this is safe to call from any thread
+	template <typename F>
+	void ForEachTagTotal(F&& fn) const noexcept
+	{
+		std::lock_guard<std::mutex> lock(m_tagMutex);
+		for (std::uint32_t iii = 0; iii < m_tagCount; ++iii)
+		{
+			const TagCounters counters = {
+				m_tagNames[iii],
+				0,
+				0,
+				m_allocations[iii].load(std::memory_order_relaxed),
+				m_bytes[iii].load(std::memory_order_relaxed),
+				m_liveBytes[iii].load(std::memory_order_relaxed)
+			};
+			if (counters.totalAllocations > 0)
+				fn(counters);
+		}
+	}
+	ND constexpr std::uint64_t GetLastFrameAllocations() const noexcept { return m_lastFrameAllocations; }
+	ND constexpr std::uint64_t GetLastFrameBytes() const noexcept { return m_lastFrameBytes; }
+	ND constexpr std::uint64_t GetLastFrameFrees() const noexcept { return m_lastFrameFrees; }
+
+	// Bytes (in heap blocks) held by allocations that have not been freed yet. Safe to call from any thread
+	ND std::uint64_t GetLiveBytes() const noexcept
+	{
+		std::uint64_t bytes = 0;
+		for (const std::atomic<std::uint64_t>& tagBytes : m_liveBytes)
+			bytes += tagBytes.load(std::memory_order_relaxed);
+		return bytes;
+	}
+
+	// Steady state check (main thread only)
+	void StartSteadyStateCheck(unsigned int warmupFrames, unsigned int checkedFrames) noexcept;
+	ND constexpr bool IsCheckingSteadyState() const noexcept { return m_checkFramesLeft > 0 || m_warmupFramesLeft > 0; }
+	ND constexpr bool IsInSteadyState() const noexcept { return m_warmupFramesLeft == 0 && m_checkFramesLeft > 0; }
+	ND constexpr std::optional<int> GetCheckResult() const noexcept { return m_checkResult; }
+	void ReportAllocationFreeViolation(const char* scope, std::uint64_t allocations) noexcept;
+
+private:
+	constexpr AllocationTracker() noexcept = default;
+	AllocationTracker(const AllocationTracker&) = delete;
+	AllocationTracker(AllocationTracker&&) = delete;
+	AllocationTracker& operator=(const AllocationTracker&) = delete;
+	AllocationTracker& operator=(AllocationTracker&&) = delete;
+
+	// Constant initialized, so that allocations made during static initialization (before main) are safe to count
+	static AllocationTracker s_tracker;
+
+	static thread_local std::uint32_t t_tag;
+	static thread_local std::uint64_t t_allocations;
+
+	std::array<std::atomic<std::uint64_t>, MaxTags> m_allocations = {};
+	std::array<std::atomic<std::uint64_t>, MaxTags> m_bytes = {};
+	std::array<std::atomic<std::uint64_t>, MaxTags> m_liveBytes = {};
+	std::atomic<std::uint64_t> m_frees = 0;
+
+	mutable std::mutex m_tagMutex;
+	std::array<const char*, MaxTags> m_tagNames = { "Untagged", "Exempt" };
+	std::uint32_t m_tagCount = 2;
+
+	// Running totals as of the last EndFrame() and the deltas for the frame it ended
+	std::array<std::uint64_t, MaxTags> m_previousAllocations = {};
+	std::array<std::uint64_t, MaxTags> m_previousBytes = {};
+	std::array<std::uint64_t, MaxTags> m_frameAllocations = {};
+	std::array<std::uint64_t, MaxTags> m_frameBytes = {};
+	std::uint64_t m_previousFrees = 0;
+	std::uint64_t m_lastFrameAllocations = 0;
+	std::uint64_t m_lastFrameBytes = 0;
+	std::uint64_t m_lastFrameFrees = 0;
+
+	unsigned int m_warmupFramesLeft = 0;
+	unsigned int m_checkFramesLeft = 0;
+	unsigned int m_checkedFrames = 0;
+	unsigned int m_failedFrames = 0;
+	std::uint64_t m_scopeViolations = 0;
+	std::optional<int> m_checkResult;
+};
+
+// Sets the calling thread's allocation tag for its lifetime. Use ALLOCATION_TAG() rather than this directly
+class AllocationTagScope
+{
+public:
+	explicit AllocationTagScope(std::uint32_t tag) noexcept :
+		m_previous(std::exchange(AllocationTracker::CurrentTag(), tag))
+	{}
+	AllocationTagScope(const AllocationTagScope&) = delete;
+	AllocationTagScope(AllocationTagScope&&) = delete;
+	AllocationTagScope& operator=(const AllocationTagScope&) = delete;
+	AllocationTagScope& operator=(AllocationTagScope&&) = delete;
+	~AllocationTagScope() noexcept { AllocationTracker::CurrentTag() = m_previous; }
+
+private:
+	std::uint32_t m_previous;
+};
+
+// During the steady state check, reports any allocation the calling thread makes during its lifetime. Use
+// ALLOCATION_FREE_SCOPE() rather than this directly
+class AllocationFreeScope
+{
+public:
+	explicit AllocationFreeScope(const char* name) noexcept :
+		m_name(name),
+		m_start(AllocationTracker::ThreadAllocationCount())
+	{}
+	AllocationFreeScope(const AllocationFreeScope&) = delete;
+	AllocationFreeScope(AllocationFreeScope&&) = delete;
+	AllocationFreeScope& operator=(const AllocationFreeScope&) = delete;
+	AllocationFreeScope& operator=(AllocationFreeScope&&) = delete;
+	~AllocationFreeScope() noexcept
+	{
+		const std::uint64_t allocations = AllocationTracker::ThreadAllocationCount() - m_start;
+		if (allocations > 0 && AllocationTracker::Get().IsInSteadyState())
+			AllocationTracker::Get().ReportAllocationFreeViolation(m_name, allocations);
+	}
+
+private:
+	const char* m_name;
+	std::uint64_t m_start;
+};
+}
+
+#ifdef ENABLE_ALLOCATION_TRACKING
+#define ALLOCATION_TAG(name) \
+	static const std::uint32_t CAT(_allocationTagId, __LINE__) = seethe::AllocationTracker::Get().RegisterTag(name); \
+	seethe::AllocationTagScope CAT(_allocationTag, __LINE__)(CAT(_allocationTagId, __LINE__))
+#define ALLOCATION_FREE_SCOPE(name) seethe::AllocationFreeScope CAT(_allocationFreeScope, __LINE__)(name)
+#define ALLOCATION_END_FRAME() seethe::AllocationTracker::Get().EndFrame()
+#else
+#define ALLOCATION_TAG(name)
+#define ALLOCATION_FREE_SCOPE(name)
+#define ALLOCATION_END_FRAME()
+#endif
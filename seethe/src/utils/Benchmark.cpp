@@ -0,0 +1,122 @@
+#include "Benchmark.h"
+#include "Log.h"
+#include "ThreadPool.h"
+
+namespace seethe
+{
+namespace
+{
+BenchmarkResult Summarize(std::string_view name, std::uint64_t items, std::vector<double>& times) noexcept
+{
+	std::ranges::sort(times);
+
+	const double count = static_cast<double>(times.size());
+	const double mean = std::accumulate(times.begin(), times.end(), 0.0) / count;
+	double variance = 0.0;
+	for (double time : times)
+		variance += (time - mean) * (time - mean);
+	variance = times.size() > 1 ? variance / (count - 1.0) : 0.0;
+
+	// Nearest rank, so every percentile is a time that was actually measured
+	const auto percentile = [&times](double p) { return times[std::min(times.size() - 1, static_cast<size_t>(std::ceil(p / 100.0 * times.size())) - 1)]; };
+
+	return {
+		std::string(name),
+		items,
+		static_cast<unsigned int>(times.size()),
+		times.front(),
+		percentile(50.0),
+		mean,
+		std::sqrt(variance),
+		percentile(90.0),
+		percentile(95.0),
+		percentile(99.0),
+		times.back()
+	};
+}
+}
+
+void BenchmarkSuite::Run(std::string_view name, std::uint64_t items, const Function& setup, const Function& run) noexcept
+{
+	if (!Matches(name))
+		return;
+
+	for (unsigned int iii = 0; iii < WarmupRuns; ++iii)
+	{
+		setup();
+		run();
+	}
+
+	std::vector<double> times;
+	times.reserve(MaxRuns);
+	std::chrono::steady_clock::duration measured{ 0 };
+	while (times.size() < MaxRuns && (times.size() < MinRuns || measured < MinMeasuredTime))
+	{
+		setup();
+		const auto start = std::chrono::steady_clock::now();
+		run();
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+
+		measured += elapsed;
+		times.push_back(std::chrono::duration<double, std::milli>(elapsed).count());
+	}
+
+	const BenchmarkResult& result = m_results.emplace_back(Summarize(name, items, times));
+	LOG_INFO("  {:<48} {:>5} runs | median {:10.4f} ms | p95 {:10.4f} ms | p99 {:10.4f} ms | min {:10.4f} ms | stddev {:8.4f} ms | {:10.3e} items/s",
+		result.name, result.runs, result.medianMs, result.p95Ms, result.p99Ms, result.minMs, result.stddevMs, result.ItemsPerSecond());
+}
+
+json BenchmarkSuite::ToJson() const noexcept
+{
+	json benchmarks = json::array();
+	for (const BenchmarkResult& result : m_results)
+	{
+		benchmarks.push_back({
+			{ "Name", result.name },
+			{ "Items", result.items },
+			{ "Runs", result.runs },
+			{ "MinMs", result.minMs },
+			{ "MedianMs", result.medianMs },
+			{ "MeanMs", result.meanMs },
+			{ "StddevMs", result.stddevMs },
+			{ "P90Ms", result.p90Ms },
+			{ "P95Ms", result.p95Ms },
+			{ "P99Ms", result.p99Ms },
+			{ "MaxMs", result.maxMs },
+			{ "ItemsPerSecond", result.ItemsPerSecond() }
+		});
+	}
+
+	return {
+		{ "Context", {
+			{ "Date", std::format("{:%F %T}", std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now())) },
+#if defined(DEBUG)
+			{ "Build", "Debug" },
+#else
+			{ "Build", "Release" },
+#endif
+			{ "Threads", ThreadPool::Get().GetThreadCount() },
+			{ "Seed", Seed },
+			{ "WarmupRuns", WarmupRuns },
+			{ "MinRuns", MinRuns },
+			{ "MaxRuns", MaxRuns },
+			{ "MinMeasuredTimeMs", MinMeasuredTime.count() }
+		} },
+		{ "Benchmarks", benchmarks }
+	};
+}
+
+bool BenchmarkSuite::WriteJson(const std::filesystem::path& path) const noexcept
+{
+	std::ofstream file(path);
+	if (!file.is_open())
+	{
+		LOG_ERROR("Failed to open benchmark output file '{}'", path.string());
+		return false;
+	}
+
+	file << ToJson().dump(4) << '\n';
+	LOG_INFO("Benchmark results written to '{}'", path.string());
+	return true;
+}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+struct BenchmarkResult
+{
+	std::string name;
+	std::uint64_t items;		// Work done per run (atoms, queries, ...)
+	unsigned int runs;
+	double minMs;
+	double medianMs;
+	double meanMs;
+	double stddevMs;
+	double p90Ms;
+	double p95Ms;
+	double p99Ms;
+	double maxMs;
+
+	ND double ItemsPerSecond() const noexcept { return medianMs > 0.0 ? static_cast<double>(items) * 1000.0 / medianMs : 0.0; }
+};
+
+// A small benchmark harness. Run() does WarmupRuns untimed runs of a benchmark, then times runs until it has run for
+// at least MinMeasuredTime (and at least MinRuns, but never more than MaxRuns times). Each result is logged as it
+// finishes, and WriteJson() writes all of them so that runs from different versions can be compared by a script.
+//
+//   - 'setup' is called before every run (warm-up or timed) and is not timed, i.e. to undo what the last run changed
+//   - Use MakeRng() for random inputs - it is always seeded with Seed, so the inputs are the same on every run
+//   - Only benchmarks whose name contains the filter are run. Use Matches() to skip expensive shared setup (like
+//     building a simulation with 10 million atoms) when none of the benchmarks that need it will run
+class BenchmarkSuite
+{
+public:
+	static constexpr std::uint32_t Seed = 1234;
+	static constexpr unsigned int WarmupRuns = 3;
+	static constexpr unsigned int MinRuns = 5;
+	static constexpr unsigned int MaxRuns = 200;
+	static constexpr std::chrono::milliseconds MinMeasuredTime{ 500 };
+
+	using Function = std::function<void()>;
+
+	BenchmarkSuite(std::string_view filter) noexcept :
+		m_filter(filter)
+	{}
+	BenchmarkSuite(const BenchmarkSuite&) = delete;
+	BenchmarkSuite(BenchmarkSuite&&) = delete;
+	BenchmarkSuite& operator=(const BenchmarkSuite&) = delete;
+	BenchmarkSuite& operator=(BenchmarkSuite&&) = delete;
+	~BenchmarkSuite() noexcept = default;
+
+	void Run(std::string_view name, std::uint64_t items, const Function& setup, const Function& run) noexcept;
+	void Run(std::string_view name, std::uint64_t items, const Function& run) noexcept { Run(name, items, []() {}, run); }
+
+	ND bool Matches(std::string_view name) const noexcept { return name.find(m_filter) != std::string_view::npos; }
+	ND static std::mt19937 MakeRng() noexcept { return std::mt19937(Seed); }
+
+	ND constexpr const std::vector<BenchmarkResult>& GetResults() const noexcept { return m_results; }
+	ND json ToJson() const noexcept;
+	bool WriteJson(const std::filesystem::path& path) const noexcept;
+
+private:
+	std::string m_filter;
+	std::vector<BenchmarkResult> m_results;
+};
+}
@@ -0,0 +1,338 @@
+#pragma once
+#include "pch.h"
+#include "utils/Log.h"
+
+namespace seethe
+{
+// CowChunkedVector is a vector-like container that stores its elements in fixed size, reference counted
+// chunks. Copying the container only copies the chunk pointers (O(#chunks)), so it can be used to take cheap
+// snapshots of large arrays (undo/redo, saving while the simulation is running, etc.). Any non-const access
+// to an element first makes sure the chunk holding that element is not shared with any other container. If it
+// is, the chunk is duplicated (copy-on-write), so only the chunks that are actually modified ever get copied.
+//
+// NOTE: All chunks except for the last one are always full. This keeps index -> (chunk, offset) a simple divide.
+// NOTE: Each chunk reserves ChunkSize elements up front and never grows beyond that, so pointers/references to
+//       elements remain valid across push_back/emplace_back (unlike std::vector). Insert/erase still shift
+//       the elements that come after the insertion/removal point.
+// NOTE: Snapshots may be read (and released) on any thread, but taking a snapshot (i.e. copying the container) and
+//       mutating the container must happen on the same thread.
+// NOTE: The container keeps two version counters that are bumped on non-const access. Version() changes whenever an
+//       element may have been modified and StructureVersion() changes whenever elements are added/removed. Derived data
+//       (i.e. spatial indices) can compare these against the versions they were built from to know when to update.
+template <typename T, size_t ChunkSize = 1024>
+class CowChunkedVector
+{
+	static_assert(ChunkSize > 0, "ChunkSize must be greater than 0");
+
+	using Chunk = std::vector<T>;
+
+	template <typename Owner, typename Ref>
+	class IteratorBase
+	{
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type		= T;
+		using difference_type	= std::ptrdiff_t;
+		using reference			= Ref;
+		using pointer			= std::add_pointer_t<Ref>;
+
+		constexpr IteratorBase() noexcept = default;
+		constexpr IteratorBase(Owner* owner, size_t index) noexcept : m_owner(owner), m_index(index) {}
+		// iterator -> const_iterator, so erase()/insert() can be given the result of begin() like with std::vector
+		template <typename OtherOwner, typename OtherRef> requires std::is_convertible_v<OtherOwner*, Owner*>
+		constexpr IteratorBase(const IteratorBase<OtherOwner, OtherRef>& other) noexcept : m_owner(other.m_owner), m_index(other.m_index) {}
+
+		ND constexpr reference operator*() const noexcept { return (*m_owner)[m_index]; }
+		ND constexpr pointer operator->() const noexcept { return &(*m_owner)[m_index]; }
+		ND constexpr reference operator[](difference_type n) const noexcept { return (*m_owner)[m_index + n]; }
+
+		constexpr IteratorBase& operator++() noexcept { ++m_index; return *this; }
+		constexpr IteratorBase operator++(int) noexcept { IteratorBase tmp = *this; ++m_index; return tmp; }
+		constexpr IteratorBase& operator--() noexcept { --m_index; return *this; }
+		constexpr IteratorBase operator--(int) noexcept { IteratorBase tmp = *this; --m_index; return tmp; }
+		constexpr IteratorBase& operator+=(difference_type n) noexcept { m_index += n; return *this; }
+		constexpr IteratorBase& operator-=(difference_type n) noexcept { m_index -= n; return *this; }
+		ND constexpr IteratorBase operator+(difference_type n) const noexcept { return { m_owner, m_index + n }; }
+		ND constexpr IteratorBase operator-(difference_type n) const noexcept { return { m_owner, m_index - n }; }
+		ND friend constexpr IteratorBase operator+(difference_type n, const IteratorBase& it) noexcept { return it + n; }
+		ND constexpr difference_type operator-(const IteratorBase& rhs) const noexcept { return static_cast<difference_type>(m_index) - static_cast<difference_type>(rhs.m_index); }
+
+		ND constexpr bool operator==(const IteratorBase& rhs) const noexcept { return m_index == rhs.m_index; }
+		ND constexpr auto operator<=>(const IteratorBase& rhs) const noexcept { return m_index <=> rhs.m_index; }
+
+		ND constexpr size_t Index() const noexcept { return m_index; }
+
+	private:
+		template <typename, typename>
+		friend class IteratorBase;
+
+		Owner* m_owner = nullptr;
+		size_t m_index = 0;
+	};
+
+public:
+	using value_type		= T;
+	using size_type			= size_t;
+	using iterator			= IteratorBase<CowChunkedVector, T&>;
+	using const_iterator	= IteratorBase<const CowChunkedVector, const T&>;
+
+	static constexpr size_t ChunkCapacity = ChunkSize;
+
+	CowChunkedVector() noexcept = default;
+	CowChunkedVector(std::initializer_list<T> list) noexcept { for (const T& t : list) push_back(t); }
+	CowChunkedVector(const CowChunkedVector&) noexcept = default;
+	CowChunkedVector(CowChunkedVector&& rhs) noexcept : 
+		m_chunks(std::move(rhs.m_chunks)), m_size(rhs.m_size), m_version(rhs.m_version), m_structureVersion(rhs.m_structureVersion)
+	{ 
+		rhs.clear(); 
+	}
+	// NOTE: Assignment replaces the entire contents, so the versions must move forward (and never back to a value
+	//       that derived data may have already seen)
+	CowChunkedVector& operator=(const CowChunkedVector& rhs) noexcept
+	{
+		m_chunks = rhs.m_chunks;
+		m_size = rhs.m_size;
+		m_version = std::max(m_version, rhs.m_version) + 1;
+		m_structureVersion = std::max(m_structureVersion, rhs.m_structureVersion) + 1;
+		return *this;
+	}
+	CowChunkedVector& operator=(CowChunkedVector&& rhs) noexcept
+	{
+		m_chunks = std::move(rhs.m_chunks);
+		m_size = rhs.m_size;
+		m_version = std::max(m_version, rhs.m_version) + 1;
+		m_structureVersion = std::max(m_structureVersion, rhs.m_structureVersion) + 1;
+		rhs.clear();
+		return *this;
+	}
+	~CowChunkedVector() noexcept = default;
+
+	// A snapshot is simply a copy - it only copies the chunk pointers. This method exists to make the intent explicit
+	ND CowChunkedVector Snapshot() const noexcept { return *this; }
+
+	ND constexpr size_t size() const noexcept { return m_size; }
+	ND constexpr bool empty() const noexcept { return m_size == 0; }
+	ND constexpr size_t ChunkCount() const noexcept { return m_chunks.size(); }
+	// Bytes of chunk storage this container references (chunks shared with snapshots are counted by every holder)
+	ND constexpr size_t ChunkBytes() const noexcept { return m_chunks.size() * ChunkSize * sizeof(T); }
+	ND constexpr std::uint64_t Version() const noexcept { return m_version; }
+	ND constexpr std::uint64_t StructureVersion() const noexcept { return m_structureVersion; }
+
+	void clear() noexcept { m_chunks.clear(); m_size = 0; ++m_version; ++m_structureVersion; }
+	void reserve(size_t) noexcept {} // Chunks are allocated on demand - this only exists for drop-in compatibility with std::vector
+
+	ND const T& operator[](size_t index) const noexcept
+	{
+		ASSERT(index < m_size, "Index too large");
+		return (*m_chunks[index / ChunkSize])[index % ChunkSize];
+	}
+	ND T& operator[](size_t index) noexcept
+	{
+		ASSERT(index < m_size, "Index too large");
+		return MutableChunk(index / ChunkSize)[index % ChunkSize];
+	}
+	ND const T& front() const noexcept { return (*this)[0]; }
+	ND T& front() noexcept { return (*this)[0]; }
+	ND const T& back() const noexcept { return (*this)[m_size - 1]; }
+	ND T& back() noexcept { return (*this)[m_size - 1]; }
+
+	ND iterator begin() noexcept { return { this, 0 }; }
+	ND iterator end() noexcept { return { this, m_size }; }
+	ND const_iterator begin() const noexcept { return { this, 0 }; }
+	ND const_iterator end() const noexcept { return { this, m_size }; }
+	ND const_iterator cbegin() const noexcept { return { this, 0 }; }
+	ND const_iterator cend() const noexcept { return { this, m_size }; }
+
+	void push_back(const T& value) noexcept { emplace_back(value); }
+	void push_back(T&& value) noexcept { emplace_back(std::move(value)); }
+	template <typename... Args>
+	T& emplace_back(Args&&... args) noexcept
+	{
+		if (m_chunks.empty() || m_chunks.back()->size() == ChunkSize)
+			m_chunks.push_back(NewChunk());
+
+		T& t = MutableChunk(m_chunks.size() - 1).emplace_back(std::forward<Args>(args)...);
+		++m_size;
+		++m_structureVersion;
+		return t;
+	}
+	void pop_back() noexcept
+	{
+		ASSERT(m_size > 0, "Cannot pop_back on an empty container");
+		Chunk& chunk = MutableChunk(m_chunks.size() - 1);
+		chunk.pop_back();
+		if (chunk.empty())
+			m_chunks.pop_back();
+		--m_size;
+		++m_structureVersion;
+	}
+
+	// Inserts the value so that it ends up at 'index'. Every element beyond 'index' is shifted by one, which may
+	// cascade an element from the back of each (full) chunk to the front of the next one
+	T& insert(size_t index, const T& value) noexcept
+	{
+		ASSERT(index <= m_size, "Index too large");
+		if (index == m_size)
+			return emplace_back(value);
+
+		size_t chunkIndex = index / ChunkSize;
+		size_t offset = index % ChunkSize;
+
+		// Insert the value into its chunk. If the chunk was already full, this will bump its last element into 'carry'
+		T* inserted = nullptr;
+		std::optional<T> carry = InsertIntoChunk(chunkIndex, offset, value, inserted);
+
+		// Keep carrying the last element of each chunk into the front of the next chunk until one has room
+		while (carry.has_value())
+		{
+			++chunkIndex;
+			if (chunkIndex == m_chunks.size())
+				m_chunks.push_back(NewChunk());
+
+			T carried = std::move(*carry);
+			T* unused = nullptr;
+			carry = InsertIntoChunk(chunkIndex, 0, carried, unused);
+		}
+
+		++m_size;
+		++m_structureVersion;
+		return *inserted;
+	}
+	iterator insert(const_iterator pos, const T& value) noexcept
+	{
+		size_t index = pos.Index();
+		insert(index, value);
+		return { this, index };
+	}
+
+	// Erases the element at 'index'. Every element beyond 'index' is shifted down by one, which pulls the first
+	// element of each subsequent chunk into the back of the previous one
+	void erase(size_t index) noexcept
+	{
+		ASSERT(index < m_size, "Index too large");
+
+		size_t chunkIndex = index / ChunkSize;
+		Chunk* chunk = &MutableChunk(chunkIndex);
+		chunk->erase(chunk->begin() + (index % ChunkSize));
+
+		for (++chunkIndex; chunkIndex < m_chunks.size(); ++chunkIndex)
+		{
+			Chunk& next = MutableChunk(chunkIndex);
+			chunk->push_back(std::move(next.front()));
+			next.erase(next.begin());
+			chunk = &next;
+		}
+
+		if (m_chunks.back()->empty())
+			m_chunks.pop_back();
+
+		--m_size;
+		++m_structureVersion;
+	}
+	iterator erase(const_iterator pos) noexcept
+	{
+		size_t index = pos.Index();
+		erase(index);
+		return { this, index };
+	}
+
+	// Chunk-wise iteration. Prefer these over element-wise iteration in hot loops because the copy-on-write
+	// check only happens once per chunk instead of once per element
+	template <typename F>
+	void ForEachChunk(F&& fn) noexcept
+	{
+		for (size_t iii = 0; iii < m_chunks.size(); ++iii)
+			fn(std::span<T>(MutableChunk(iii)));
+	}
+	template <typename F>
+	void ForEachChunk(F&& fn) const noexcept
+	{
+		for (const auto& chunk : m_chunks)
+			fn(std::span<const T>(*chunk));
+	}
+	// Same as ForEachChunk(), but the chunks are spread across 'pool' (see ThreadPool), 'grainSize' chunks at a time.
+	// 'fn' is called concurrently for different chunks, so it must only touch the chunk it is given
+	template <typename Pool, typename F>
+	void ParallelForEachChunk(Pool& pool, size_t grainSize, F&& fn) noexcept
+	{
+		++m_version;
+		pool.ParallelFor(m_chunks.size(), grainSize, [this, &fn](size_t begin, size_t end)
+			{
+				for (size_t iii = begin; iii < end; ++iii)
+					fn(std::span<T>(UnshareChunk(iii)));
+			}
+		);
+	}
+	ND std::span<const T> GetChunk(size_t chunkIndex) const noexcept { return *m_chunks[chunkIndex]; }
+
+	// Returns the index of an element that lives in this container. If the element does not live in this container, size() is returned
+	// NOTE: The chunks are separate allocations, so this has to look at each chunk in turn - O(#chunks), i.e. ~100
+	//       pointer compares for 100k elements. Fine for UI code, but hot paths should keep the index around instead
+	ND size_t IndexOf(const T& element) const noexcept
+	{
+		const T* ptr = &element;
+		for (size_t iii = 0; iii < m_chunks.size(); ++iii)
+		{
+			const T* first = m_chunks[iii]->data();
+			if (ptr >= first && ptr < first + m_chunks[iii]->size())
+				return iii * ChunkSize + static_cast<size_t>(ptr - first);
+		}
+		return m_size;
+	}
+
+	// Returns true if the chunk is (still) shared with another container (i.e. a snapshot)
+	ND bool ChunkIsShared(size_t chunkIndex) const noexcept { return m_chunks[chunkIndex].use_count() > 1; }
+
+private:
+	ND static std::shared_ptr<Chunk> NewChunk() noexcept
+	{
+		auto chunk = std::make_shared<Chunk>();
+		chunk->reserve(ChunkSize);
+		return chunk;
+	}
+	ND Chunk& MutableChunk(size_t chunkIndex) noexcept
+	{
+		++m_version;
+		return UnshareChunk(chunkIndex);
+	}
+	// Copies the chunk if it is shared. Does not touch anything but the chunk's own slot, so different chunks can be
+	// unshared concurrently
+	ND Chunk& UnshareChunk(size_t chunkIndex) noexcept
+	{
+		std::shared_ptr<Chunk>& chunk = m_chunks[chunkIndex];
+		if (chunk.use_count() > 1)
+		{
+			auto copy = NewChunk();
+			copy->assign(chunk->begin(), chunk->end());
+			chunk = std::move(copy);
+		}
+		else
+		{
+			// use_count() is only a relaxed load. If the last snapshot holding this chunk was just released on another
+			// thread, that thread's reads of the chunk must happen before the writes the caller is about to make. The
+			// release half of the reference count decrement pairs with this fence to guarantee that
+			std::atomic_thread_fence(std::memory_order_acquire);
+		}
+		return *chunk;
+	}
+	std::optional<T> InsertIntoChunk(size_t chunkIndex, size_t offset, const T& value, T*& inserted) noexcept
+	{
+		Chunk& chunk = MutableChunk(chunkIndex);
+		std::optional<T> carry;
+
+		if (chunk.size() == ChunkSize)
+		{
+			carry.emplace(std::move(chunk.back()));
+			chunk.pop_back();
+		}
+
+		inserted = &(*chunk.insert(chunk.begin() + offset, value));
+		return carry;
+	}
+
+	std::vector<std::shared_ptr<Chunk>> m_chunks;
+	size_t m_size = 0;
+	std::uint64_t m_version = 0;
+	std::uint64_t m_structureVersion = 0;
+};
+}
@@ -0,0 +1,81 @@
+#include "DirtyRangeTracker.h"
+
+namespace seethe
+{
+void DirtyRangeTracker::MarkDirty(size_t begin, size_t end) noexcept
+{
+	if (m_pendingAll || begin >= end)
+		return;
+
+	// Consecutive indices are by far the most common case, so extend the last range when possible
+	if (!m_pending.empty() && begin <= m_pending.back().end && end >= m_pending.back().begin)
+	{
+		m_pending.back().begin = std::min(m_pending.back().begin, begin);
+		m_pending.back().end = std::max(m_pending.back().end, end);
+		return;
+	}
+
+	m_pending.emplace_back(begin, end);
+	if (m_pending.size() > MaxRangesPerCommit)
+		MarkAllDirty();
+}
+
+void DirtyRangeTracker::Commit() noexcept
+{
+	if (!HasPendingChanges())
+		return;
+
+	SortAndMerge(m_pending);
+
+	++m_version;
+	CommittedChanges& changes = m_history[m_version % m_history.size()];
+	changes.all = m_pendingAll;
+	changes.ranges.swap(m_pending);
+	m_historyCount = std::min(m_historyCount + 1, m_history.size());
+
+	m_pending.clear();
+	m_pendingAll = false;
+}
+
+bool DirtyRangeTracker::CollectSince(std::uint64_t version, std::vector<IndexRange>& ranges) const noexcept
+{
+	ranges.clear();
+
+	if (version == m_version)
+		return true;
+
+	// Either the consumer has never synced or it is too far behind for the history to cover it
+	if (version > m_version || m_version - version > m_historyCount)
+		return false;
+
+	for (std::uint64_t next = version + 1; next <= m_version; ++next)
+	{
+		const CommittedChanges& changes = m_history[next % m_history.size()];
+		if (changes.all)
+			return false;
+
+		ranges.insert(ranges.end(), changes.ranges.begin(), changes.ranges.end());
+	}
+
+	SortAndMerge(ranges);
+	return true;
+}
+
+void DirtyRangeTracker::SortAndMerge(std::vector<IndexRange>& ranges) noexcept
+{
+	if (ranges.size() < 2)
+		return;
+
+	std::sort(ranges.begin(), ranges.end(), [](const IndexRange& a, const IndexRange& b) { return a.begin < b.begin; });
+
+	size_t last = 0;
+	for (size_t iii = 1; iii < ranges.size(); ++iii)
+	{
+		if (ranges[iii].begin <= ranges[last].end)
+			ranges[last].end = std::max(ranges[last].end, ranges[iii].end);
+		else
+			ranges[++last] = ranges[iii];
+	}
+	ranges.resize(last + 1);
+}
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+struct IndexRange
+{
+	size_t begin = 0;
+	size_t end = 0;		// One past the last index
+
+	ND constexpr size_t Count() const noexcept { return end - begin; }
+};
+
+// DirtyRangeTracker records which indices of some array changed, batched into versions. Changes are accumulated with
+// MarkDirty() and Commit() turns everything marked since the previous commit into a new version (if nothing was
+// marked, the version does not change).
+//
+// Any number of consumers (i.e. one per frame resource) can remember the version they last synced to and ask for
+// the merged ranges that changed since then with CollectSince(). Only the last 'historyLength' versions are kept, so a
+// consumer that falls further behind than that (or any consumer after MarkAllDirty()) is told to resync everything.
+class DirtyRangeTracker
+{
+public:
+	// Once a single commit has more ranges than this, it is cheaper to just treat everything as dirty
+	static constexpr size_t MaxRangesPerCommit = 4096;
+
+	DirtyRangeTracker(size_t historyLength = 8) noexcept : m_history(std::max(historyLength, size_t{ 1 })) {}
+	DirtyRangeTracker(const DirtyRangeTracker&) noexcept = default;
+	DirtyRangeTracker(DirtyRangeTracker&&) noexcept = default;
+	DirtyRangeTracker& operator=(const DirtyRangeTracker&) noexcept = default;
+	DirtyRangeTracker& operator=(DirtyRangeTracker&&) noexcept = default;
+	~DirtyRangeTracker() noexcept = default;
+
+	void MarkDirty(size_t index) noexcept { MarkDirty(index, index + 1); }
+	void MarkDirty(size_t begin, size_t end) noexcept;
+	constexpr void MarkAllDirty() noexcept { m_pendingAll = true; m_pending.clear(); }
+
+	void Commit() noexcept;
+
+	// Fills 'ranges' with the (sorted, non-overlapping) ranges that changed after 'version' up to Version(). Returns
+	// false if that is not known, in which case everything must be treated as dirty
+	ND bool CollectSince(std::uint64_t version, std::vector<IndexRange>& ranges) const noexcept;
+
+	ND constexpr std::uint64_t Version() const noexcept { return m_version; }
+	ND constexpr bool HasPendingChanges() const noexcept { return m_pendingAll || !m_pending.empty(); }
+
+	// Starting version for a consumer that has never synced. CollectSince() always reports a full resync for it
+	static constexpr std::uint64_t NoVersion = std::numeric_limits<std::uint64_t>::max();
+
+private:
+	static void SortAndMerge(std::vector<IndexRange>& ranges) noexcept;
+
+	struct CommittedChanges
+	{
+		bool all = false;
+		std::vector<IndexRange> ranges;
+	};
+
+	// The last m_history.size() commits, where version v lives at index v % m_history.size(). Commit() swaps the pending
+	// ranges with the oldest entry's, so once the vectors have grown to what a frame needs, committing never allocates
+	std::vector<CommittedChanges> m_history;
+	size_t m_historyCount = 0;
+	std::uint64_t m_version = 0;
+
+	std::vector<IndexRange> m_pending;
+	bool m_pendingAll = false;
+};
+}
@@ -10,4 +10,69 @@ static constexpr void InvokeHandlers(const EventHandlers& handlers) noexcept
 {
 	std::for_each(handlers.begin(), handlers.end(), [](const EventHandler& h) { h(); });
 }
-}
\ No newline at end of file
+
+// ChangedRange is the payload for coalesced events that concern a range of indices (i.e. atoms). It is the 
+// union of the index ranges of every occurrence of the event since the last dispatch, so listeners only
+// need to look at [begin, end) instead of redoing all of their work
+struct ChangedRange
+{
+	size_t begin = std::numeric_limits<size_t>::max();
+	size_t end = 0;					// One past the last index that changed
+	unsigned int occurrences = 0;	// Number of times the event was recorded before being dispatched
+
+	// Add [first, last) to the range. An empty range is ignored, but still counts as an occurrence
+	constexpr void Include(size_t first, size_t last) noexcept
+	{
+		++occurrences;
+		if (first < last)
+		{
+			begin = std::min(begin, first);
+			end = std::max(end, last);
+		}
+	}
+	ND constexpr bool HasIndices() const noexcept { return begin < end; }
+	ND constexpr size_t Count() const noexcept { return HasIndices() ? end - begin : 0; }
+};
+
+// CoalescedEvent does not invoke its handlers when the event occurs. Instead, each occurrence is merged into a 
+// pending payload and the handlers are invoked exactly once (with the merged payload) when Dispatch() is called.
+// The idea is that Dispatch() is called once per frame at a well defined sync point, so that many mutations in
+// a single frame (i.e. selecting 1000 atoms) only trigger a single notification
+template <typename Payload>
+class CoalescedEvent
+{
+public:
+	using Handler = std::function<void(const Payload&)>;
+
+	constexpr void Register(const Handler& handler) noexcept { m_handlers.push_back(handler); }
+	constexpr void Register(Handler&& handler) noexcept { m_handlers.push_back(std::move(handler)); }
+
+	// Record an occurrence of the event. 'merge' receives the pending payload so it can add whatever changed
+	template <typename F>
+	constexpr void Record(F&& merge) noexcept
+	{
+		merge(m_pending);
+		m_isPending = true;
+	}
+
+	ND constexpr bool IsPending() const noexcept { return m_isPending; }
+
+	// NOTE: The payload is moved out before invoking the handlers, so any event that gets recorded from within
+	//       a handler will be dispatched on the next call to Dispatch() (and not lost)
+	constexpr void Dispatch() noexcept
+	{
+		if (!m_isPending)
+			return;
+
+		Payload payload = std::exchange(m_pending, Payload{});
+		m_isPending = false;
+
+		std::for_each(m_handlers.begin(), m_handlers.end(), [&payload](const Handler& h) { h(payload); });
+	}
+
+private:
+	std::vector<Handler> m_handlers;
+	Payload m_pending = {};
+	bool m_isPending = false;
+};
+}
@@ -0,0 +1,53 @@
+#include "FrameStats.h"
+#include "utils/Log.h"
+
+namespace seethe
+{
+FrameStats& FrameStats::Get() noexcept
+{
+	static FrameStats frameStats;
+	return frameStats;
+}
+
+void FrameStats::EndFrame() noexcept
+{
+	const std::uint64_t now = FrameStatsTimer::Now();
+	if (m_frameStart != 0)
+	{
+		Record(FrameMetric::FRAME_TIME, now - m_frameStart);
+		Record(FrameMetric::UPLOAD_BYTES, m_frameUploadBytes.exchange(0, std::memory_order_relaxed));
+	}
+	m_frameStart = now;
+}
+
+void FrameStats::Reset() noexcept
+{
+	for (Histogram& histogram : m_histograms)
+		histogram.Reset();
+}
+
+double FrameStats::ToDisplayUnits(FrameMetric metric, double value) noexcept
+{
+	return metric == FrameMetric::UPLOAD_BYTES ? value / 1024.0 : value / 1e6;
+}
+
+void FrameStats::LogReport() const noexcept
+{
+	for (size_t iii = 0; iii < FrameMetricCount; ++iii)
+	{
+		const FrameMetric metric = static_cast<FrameMetric>(iii);
+		const Histogram& histogram = m_histograms[iii];
+		if (histogram.GetCount() == 0)
+			continue;
+
+		auto Value = [metric](double value) { return ToDisplayUnits(metric, value); };
+		LOG_INFO("{}: {} samples, mean {:.3f} {}, p50 {:.3f}, p90 {:.3f}, p99 {:.3f}, p99.9 {:.3f}, max {:.3f}",
+			FrameMetricNames[iii], histogram.GetCount(), Value(histogram.GetMean()), GetDisplayUnits(metric),
+			Value(static_cast<double>(histogram.ValueAtPercentile(50.0))),
+			Value(static_cast<double>(histogram.ValueAtPercentile(90.0))),
+			Value(static_cast<double>(histogram.ValueAtPercentile(99.0))),
+			Value(static_cast<double>(histogram.ValueAtPercentile(99.9))),
+			Value(static_cast<double>(histogram.GetMax())));
+	}
+}
+}
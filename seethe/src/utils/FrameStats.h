@@ -0,0 +1,77 @@
+#pragma once
+#include "pch.h"
+#include "utils/Histogram.h"
+
+namespace seethe
+{
+enum class FrameMetric
+{
+	FRAME_TIME,				// ns between the start of consecutive frames
+	SIMULATION_STEP_TIME,	// ns spent in Simulation::Update() while the simulation is playing
+	UPLOAD_BYTES,			// Bytes written to upload heaps per frame (VersionedUploadBuffer copies)
+	COUNT
+};
+static constexpr size_t FrameMetricCount = static_cast<size_t>(FrameMetric::COUNT);
+inline constexpr std::array FrameMetricNames = { "Frame time", "Simulation step", "Upload bytes" };
+
+// FrameStats keeps a Histogram per FrameMetric, so that stutter shows up as p99/p99.9 numbers rather than being averaged
+// away. Each histogram covers everything since startup (or the last Reset()).
+//
+// NOTE: Recording is lock free, so AddUploadBytes() and Record() can be called from any thread
+class FrameStats
+{
+public:
+	ND static FrameStats& Get() noexcept;
+
+	void Record(FrameMetric metric, std::uint64_t value) noexcept { m_histograms[static_cast<size_t>(metric)].Record(value); }
+	void AddUploadBytes(size_t bytes) noexcept { m_frameUploadBytes.fetch_add(bytes, std::memory_order_relaxed); }
+
+	// Once per frame, on the main thread: records the frame time and the bytes uploaded during the frame that just ended
+	void EndFrame() noexcept;
+
+	ND const Histogram& GetHistogram(FrameMetric metric) const noexcept { return m_histograms[static_cast<size_t>(metric)]; }
+	void Reset() noexcept;
+
+	// One line per metric: count, mean, p50, p90, p99, p99.9 and max
+	void LogReport() const noexcept;
+
+	// Values as they are shown to a person (times in ms, sizes in KB)
+	ND static double ToDisplayUnits(FrameMetric metric, double value) noexcept;
+	ND static constexpr const char* GetDisplayUnits(FrameMetric metric) noexcept { return metric == FrameMetric::UPLOAD_BYTES ? "KB" : "ms"; }
+
+private:
+	FrameStats() noexcept = default;
+	FrameStats(const FrameStats&) = delete;
+	FrameStats(FrameStats&&) = delete;
+	FrameStats& operator=(const FrameStats&) = delete;
+	FrameStats& operator=(FrameStats&&) = delete;
+
+	std::array<Histogram, FrameMetricCount> m_histograms;
+	std::atomic<std::uint64_t> m_frameUploadBytes = 0;
+	std::uint64_t m_frameStart = 0;
+};
+
+// Records its own lifetime (in ns) into one of the FrameStats histograms
+class FrameStatsTimer
+{
+public:
+	explicit FrameStatsTimer(FrameMetric metric) noexcept :
+		m_metric(metric),
+		m_start(Now())
+	{}
+	FrameStatsTimer(const FrameStatsTimer&) = delete;
+	FrameStatsTimer(FrameStatsTimer&&) = delete;
+	FrameStatsTimer& operator=(const FrameStatsTimer&) = delete;
+	FrameStatsTimer& operator=(FrameStatsTimer&&) = delete;
+	~FrameStatsTimer() noexcept { FrameStats::Get().Record(m_metric, Now() - m_start); }
+
+	ND static std::uint64_t Now() noexcept
+	{
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+private:
+	FrameMetric m_metric;
+	std::uint64_t m_start;
+};
+}
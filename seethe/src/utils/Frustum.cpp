@@ -0,0 +1,78 @@
+#include "Frustum.h"
+
+using namespace DirectX;
+
+namespace seethe
+{
+Frustum::Frustum(FXMMATRIX viewProjection, const NdcRect& rect) noexcept
+{
+	// DirectXMath uses row vectors, so clip = [x y z 1] * M and each clip coordinate is the dot product of the point
+	// with a column of M. Transposing turns those columns into rows we can work with directly
+	const XMMATRIX m = XMMatrixTranspose(viewProjection);
+	const XMVECTOR cx = m.r[0];
+	const XMVECTOR cy = m.r[1];
+	const XMVECTOR cz = m.r[2];
+	const XMVECTOR cw = m.r[3];
+
+	// A point is inside when rect.left * w <= x <= rect.right * w (same for y) and 0 <= z <= w (D3D depth range)
+	const std::array<XMVECTOR, PlaneCount> planes = {
+		XMVectorSubtract(cx, XMVectorScale(cw, rect.left)),
+		XMVectorSubtract(XMVectorScale(cw, rect.right), cx),
+		XMVectorSubtract(cy, XMVectorScale(cw, rect.bottom)),
+		XMVectorSubtract(XMVectorScale(cw, rect.top), cy),
+		cz,
+		XMVectorSubtract(cw, cz)
+	};
+
+	for (size_t iii = 0; iii < PlaneCount; ++iii)
+		XMStoreFloat4(&m_planes[iii], XMPlaneNormalize(planes[iii]));
+}
+
+bool Frustum::Intersects(const XMFLOAT3& center, float radius) const noexcept
+{
+	for (const XMFLOAT4& plane : m_planes)
+	{
+		if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
+
+ContainmentType Frustum::Classify(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax) const noexcept
+{
+	ContainmentType result = CONTAINS;
+	for (const XMFLOAT4& plane : m_planes)
+	{
+		// The corner furthest along the plane normal decides whether the box is outside and the corner furthest
+		// against it decides whether the box is completely inside
+		XMFLOAT3 positive = { plane.x >= 0.0f ? boxMax.x : boxMin.x, plane.y >= 0.0f ? boxMax.y : boxMin.y, plane.z >= 0.0f ? boxMax.z : boxMin.z };
+		XMFLOAT3 negative = { plane.x >= 0.0f ? boxMin.x : boxMax.x, plane.y >= 0.0f ? boxMin.y : boxMax.y, plane.z >= 0.0f ? boxMin.z : boxMax.z };
+
+		if (plane.x * positive.x + plane.y * positive.y + plane.z * positive.z + plane.w < 0.0f)
+			return DISJOINT;
+
+		if (plane.x * negative.x + plane.y * negative.y + plane.z * negative.z + plane.w < 0.0f)
+			result = INTERSECTS;
+	}
+	return result;
+}
+
+unsigned int Frustum::Intersects4(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, GXMVECTOR radius) const noexcept
+{
+	const XMVECTOR negativeRadius = XMVectorNegate(radius);
+	XMVECTOR inside = XMVectorTrueInt();
+
+	for (const XMFLOAT4& plane : m_planes)
+	{
+		XMVECTOR distance = XMVectorMultiplyAdd(x, XMVectorReplicate(plane.x),
+			XMVectorMultiplyAdd(y, XMVectorReplicate(plane.y),
+				XMVectorMultiplyAdd(z, XMVectorReplicate(plane.z), XMVectorReplicate(plane.w))));
+
+		inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(distance, negativeRadius));
+	}
+
+	std::array<std::uint32_t, 4> lanes;
+	XMStoreInt4(lanes.data(), inside);
+	return (lanes[0] & 1u) | (lanes[1] & 2u) | (lanes[2] & 4u) | (lanes[3] & 8u);
+}
+}
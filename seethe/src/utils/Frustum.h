@@ -0,0 +1,86 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+// Frustum holds the 6 planes of a view frustum in world space. The planes are normalized and point inwards, so the
+// signed distance from a point to a plane is simply dot(plane.xyz, point) + plane.w (positive == inside).
+//
+// The planes are extracted directly from the combined view-projection matrix (Gribb/Hartmann). Optionally, a
+// rectangle in normalized device coordinates can be passed in, in which case the side planes are pulled in to only
+// enclose that part of the screen. This is what marquee selection uses to turn a screen rectangle into a sub-frustum.
+//
+// NOTE: The sphere/box tests are conservative - something just outside a corner of the frustum can be reported as
+//       intersecting. That is exactly what we want for culling and is close enough for selection
+class Frustum
+{
+public:
+	static constexpr size_t PlaneCount = 6;
+
+	// Rectangle in normalized device coordinates. The default covers the entire screen
+	struct NdcRect
+	{
+		float left = -1.0f;
+		float bottom = -1.0f;
+		float right = 1.0f;
+		float top = 1.0f;
+	};
+
+	Frustum() noexcept = default;
+	Frustum(DirectX::FXMMATRIX viewProjection) noexcept : Frustum(viewProjection, NdcRect{}) {}
+	Frustum(DirectX::FXMMATRIX viewProjection, const NdcRect& rect) noexcept;
+	Frustum(const Frustum&) noexcept = default;
+	Frustum(Frustum&&) noexcept = default;
+	Frustum& operator=(const Frustum&) noexcept = default;
+	Frustum& operator=(Frustum&&) noexcept = default;
+	~Frustum() noexcept = default;
+
+	ND bool Intersects(const DirectX::XMFLOAT3& center, float radius) const noexcept;
+	// Returns DISJOINT if the box is entirely outside, CONTAINS if it is entirely inside, and INTERSECTS otherwise
+	ND DirectX::ContainmentType Classify(const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax) const noexcept;
+
+	// Tests 4 spheres at once (SoA). Bit 'i' of the returned mask is set if sphere 'i' intersects the frustum
+	ND unsigned int Intersects4(DirectX::FXMVECTOR x, DirectX::FXMVECTOR y, DirectX::FXMVECTOR z, DirectX::GXMVECTOR radius) const noexcept;
+
+	// Appends 'baseIndex + i' to 'visible' for every item i that intersects the frustum. T just needs to have a
+	// 'position' (XMFLOAT3) and a 'radius' member, so this works directly on a chunk of atoms
+	template <typename T, typename IndexType>
+	void CullSpheres(std::span<const T> items, size_t baseIndex, std::vector<IndexType>& visible) const noexcept
+	{
+		using namespace DirectX;
+
+		size_t iii = 0;
+		for (; iii + 4 <= items.size(); iii += 4)
+		{
+			const T& a = items[iii];
+			const T& b = items[iii + 1];
+			const T& c = items[iii + 2];
+			const T& d = items[iii + 3];
+
+			unsigned int mask = Intersects4(
+				XMVectorSet(a.position.x, b.position.x, c.position.x, d.position.x),
+				XMVectorSet(a.position.y, b.position.y, c.position.y, d.position.y),
+				XMVectorSet(a.position.z, b.position.z, c.position.z, d.position.z),
+				XMVectorSet(a.radius, b.radius, c.radius, d.radius));
+
+			while (mask != 0)
+			{
+				visible.push_back(static_cast<IndexType>(baseIndex + iii + std::countr_zero(mask)));
+				mask &= mask - 1;
+			}
+		}
+
+		for (; iii < items.size(); ++iii)
+		{
+			if (Intersects(items[iii].position, items[iii].radius))
+				visible.push_back(static_cast<IndexType>(baseIndex + iii));
+		}
+	}
+
+	ND constexpr const std::array<DirectX::XMFLOAT4, PlaneCount>& GetPlanes() const noexcept { return m_planes; }
+
+private:
+	// Order: left, right, bottom, top, near, far
+	std::array<DirectX::XMFLOAT4, PlaneCount> m_planes = {};
+};
+}
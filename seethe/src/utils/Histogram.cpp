@@ -0,0 +1,76 @@
+#include "Histogram.h"
+
+namespace seethe
+{
+void Histogram::Record(std::uint64_t value) noexcept
+{
+	m_counts[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_relaxed);
+	m_sum.fetch_add(value, std::memory_order_relaxed);
+
+	std::uint64_t current = m_min.load(std::memory_order_relaxed);
+	while (value < current && !m_min.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+
+	current = m_max.load(std::memory_order_relaxed);
+	while (value > current && !m_max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+}
+
+void Histogram::Merge(const Histogram& other) noexcept
+{
+	if (other.GetCount() == 0)
+		return;
+
+	for (size_t iii = 0; iii < BucketCount; ++iii)
+	{
+		const std::uint64_t count = other.m_counts[iii].load(std::memory_order_relaxed);
+		if (count > 0)
+			m_counts[iii].fetch_add(count, std::memory_order_relaxed);
+	}
+	m_count.fetch_add(other.m_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	m_sum.fetch_add(other.m_sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+	const std::uint64_t otherMin = other.m_min.load(std::memory_order_relaxed);
+	std::uint64_t current = m_min.load(std::memory_order_relaxed);
+	while (otherMin < current && !m_min.compare_exchange_weak(current, otherMin, std::memory_order_relaxed)) {}
+
+	const std::uint64_t otherMax = other.m_max.load(std::memory_order_relaxed);
+	current = m_max.load(std::memory_order_relaxed);
+	while (otherMax > current && !m_max.compare_exchange_weak(current, otherMax, std::memory_order_relaxed)) {}
+}
+
+void Histogram::Reset() noexcept
+{
+	for (std::atomic<std::uint64_t>& count : m_counts)
+		count.store(0, std::memory_order_relaxed);
+	m_count.store(0, std::memory_order_relaxed);
+	m_sum.store(0, std::memory_order_relaxed);
+	m_min.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+	m_max.store(0, std::memory_order_relaxed);
+}
+
+double Histogram::GetMean() const noexcept
+{
+	const std::uint64_t count = GetCount();
+	return count > 0 ? static_cast<double>(m_sum.load(std::memory_order_relaxed)) / static_cast<double>(count) : 0.0;
+}
+
+std::uint64_t Histogram::ValueAtPercentile(double percentile) const noexcept
+{
+	const std::uint64_t count = GetCount();
+	if (count == 0)
+		return 0;
+
+	// Rank of the value we are after (1-based), i.e. p50 of 10 values is the 5th smallest
+	const double fraction = std::clamp(percentile, 0.0, 100.0) / 100.0;
+	const std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(fraction * static_cast<double>(count))));
+
+	std::uint64_t seen = 0;
+	for (size_t iii = 0; iii < BucketCount; ++iii)
+	{
+		seen += m_counts[iii].load(std::memory_order_relaxed);
+		if (seen >= rank)
+			return std::min(BucketHighest(iii), GetMax());
+	}
+	return GetMax();
+}
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+// Histogram is an HDR (high dynamic range) histogram of unsigned integer values, i.e. nanoseconds or bytes. Values below
+// 128 each get their own bucket. Above that, every power of two is split into 64 linear sub-buckets, so every value is
+// reported to within 1/64 (~1.6%) of its true value across the whole 64-bit range. That makes it possible to ask for
+// p99.9 of something that is usually 2 ms but sometimes 200 ms, which an average or a fixed-width histogram would hide.
+//
+//   - Memory is constant (BucketCount counters, ~30 KB) no matter how many values are recorded
+//   - Record() is lock free (relaxed atomics), so any number of threads can record into the same histogram
+//   - Histograms are mergeable (Merge() adds the counts), so per-thread histograms can be combined for reporting
+//
+// NOTE: Reads are not synchronized with concurrent Record() calls - a percentile taken while other threads are still
+//       recording reflects some of their values and not others, which is fine for reporting
+class Histogram
+{
+public:
+	static constexpr unsigned int SubBucketBits = 7;
+	static constexpr std::uint64_t SubBucketCount = 1ull << SubBucketBits;
+	static constexpr std::uint64_t HalfSubBucketCount = SubBucketCount / 2;
+	static constexpr size_t BucketCount = (64 - SubBucketBits) * HalfSubBucketCount + SubBucketCount;
+
+	Histogram() noexcept = default;
+	Histogram(const Histogram&) = delete;
+	Histogram(Histogram&&) = delete;
+	Histogram& operator=(const Histogram&) = delete;
+	Histogram& operator=(Histogram&&) = delete;
+	~Histogram() noexcept = default;
+
+	void Record(std::uint64_t value) noexcept;
+	void Merge(const Histogram& other) noexcept;
+	void Reset() noexcept;
+
+	ND std::uint64_t GetCount() const noexcept { return m_count.load(std::memory_order_relaxed); }
+	ND std::uint64_t GetMin() const noexcept { return GetCount() > 0 ? m_min.load(std::memory_order_relaxed) : 0; }
+	ND std::uint64_t GetMax() const noexcept { return m_max.load(std::memory_order_relaxed); }
+	ND double GetMean() const noexcept;
+
+	// Smallest value that 'percentile' percent (0 - 100) of the recorded values are less than or equal to, rounded up to
+	// the top of its bucket (but never above the largest value recorded)
+	ND std::uint64_t ValueAtPercentile(double percentile) const noexcept;
+
+	ND static constexpr size_t BucketIndex(std::uint64_t value) noexcept
+	{
+		if (value < SubBucketCount)
+			return static_cast<size_t>(value);
+
+		// value >> shift lands in [HalfSubBucketCount, SubBucketCount), so consecutive powers of two line up
+		const unsigned int shift = static_cast<unsigned int>(std::bit_width(value)) - SubBucketBits;
+		return static_cast<size_t>(shift * HalfSubBucketCount + (value >> shift));
+	}
+	ND static constexpr std::uint64_t BucketLowest(size_t index) noexcept
+	{
+		if (index < SubBucketCount)
+			return index;
+
+		const std::uint64_t shift = index / HalfSubBucketCount - 1;
+		return (index - shift * HalfSubBucketCount) << shift;
+	}
+	ND static constexpr std::uint64_t BucketHighest(size_t index) noexcept
+	{
+		// The last bucket runs all the way to the largest 64-bit value
+		return index + 1 < BucketCount ? BucketLowest(index + 1) - 1 : std::numeric_limits<std::uint64_t>::max();
+	}
+
+private:
+	std::array<std::atomic<std::uint64_t>, BucketCount> m_counts = {};
+	std::atomic<std::uint64_t> m_count = 0;
+	std::atomic<std::uint64_t> m_sum = 0;
+	std::atomic<std::uint64_t> m_min = std::numeric_limits<std::uint64_t>::max();
+	std::atomic<std::uint64_t> m_max = 0;
+};
+}
@@ -1,80 +1,423 @@
 #include "Log.h"
+#include "utils/AllocationTracker.h"
 
-
+#if defined(_WIN32)
 #ifdef DEBUG
 #include <iostream>
 #endif
+#else
+#include <ctime>
+#include <unistd.h>
+#endif
 
 namespace seethe
 {
 namespace log
 {
-std::string app_current_time_and_date()
+namespace
+{
+constexpr size_t RingCapacity = 64 * 1024;
+constexpr size_t MaxMessageBytes = RingCapacity / 8;		// Anything larger is written synchronously
+
+constexpr unsigned int RateLimit = 20;						// Messages per call site per second
+constexpr std::uint64_t RateWindowNs = 1'000'000'000;
+constexpr size_t RateSlotCount = 256;
+
+constexpr std::uint32_t PaddingFlag = 1;					// Marks the unused space at the end of the ring before it wraps
+
+std::uint64_t NowNs() noexcept
+{
+	return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// FNV-1a over the file name, line and column. The file name is hashed by value because the same file can be named by
+// a different string in every translation unit (i.e. a LOG_* call in a header)
+std::uint64_t CallSiteKey(const std::source_location& location) noexcept
+{
+	std::uint64_t hash = 14695981039346656037ull;
+	auto Mix = [&hash](std::uint64_t value) { hash = (hash ^ value) * 1099511628211ull; };
+
+	for (const char* c = location.file_name(); *c != '\0'; ++c)
+		Mix(static_cast<unsigned char>(*c));
+	Mix(location.line());
+	Mix(location.column());
+	return hash == 0 ? 1 : hash;
+}
+
+// Every message in a ring starts with this, followed by the encoded arguments. Entries are padded to a multiple of 8
+// bytes, so the header is always aligned
+struct EntryHeader
+{
+	std::uint32_t size;				// Including the header and padding
+	std::uint32_t flags;
+	detail::DecodeFunction decode;
+	const char* format;
+	std::uint32_t formatSize;
+	std::uint32_t suppressed;		// Messages from the same call site that were rate limited since the last one
+	std::uint64_t time;
+	Level level;
+};
+static_assert(sizeof(EntryHeader) % 8 == 0);
+
+struct alignas(64) ThreadRing
+{
+	alignas(8) std::array<std::byte, RingCapacity> data;
+	std::atomic<std::uint64_t> head = 0;		// Only written by the owning thread
+	std::atomic<std::uint64_t> tail = 0;		// Only written by the logging thread
+	std::uint64_t pendingHead = 0;				// Head once the entry between Begin() and Commit() is published
+};
+
+// Rate limiting is per call site, identified by a hash of its source location (0 marks an unused slot). A collision
+// just means two call sites share a budget
+struct RateSlot
+{
+	std::atomic<std::uint64_t> key = 0;
+	std::atomic<std::uint64_t> windowStart = 0;
+	std::atomic<std::uint32_t> count = 0;
+	std::atomic<std::uint32_t> suppressed = 0;
+};
+
+constexpr std::string_view LevelName(Level level) noexcept
+{
+	switch (level)
+	{
+	case Level::TRACE:	return "TRACE";
+	case Level::INFO:	return "INFO ";
+	case Level::WARN:	return "WARN ";
+	case Level::ERR:	return "ERROR";
+	}
+	return "?????";
+}
+
+std::string FormatTime(std::uint64_t timeNs)
 {
+	const std::chrono::system_clock::time_point time{ std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(timeNs)) };
+#if defined(_WIN32)
 	try
 	{
-		auto const time = std::chrono::current_zone()->to_local(std::chrono::system_clock::now());
-		return std::format("{:%X}", time);
+		// current_zone() is a lookup, so only do it once
+		static const std::chrono::time_zone* zone = std::chrono::current_zone();
+		return std::format("{:%X}", std::chrono::floor<std::chrono::seconds>(zone->to_local(time)));
 	}
 	catch (const std::runtime_error& e)
 	{
 		return std::format("Caught runtime error: {}", e.what());
 	}
+#else
+	const std::time_t t = std::chrono::system_clock::to_time_t(time);
+	std::tm local;
+	localtime_r(&t, &local);
+	return std::format("{:02}:{:02}:{:02}", local.tm_hour, local.tm_min, local.tm_sec);
+#endif
 }
 
-#if defined DEBUG
-
-void error(std::string_view msg) noexcept
+// Sinks
+#if defined(_WIN32) && defined(DEBUG)
+void Sink(Level level, std::string_view time, std::string_view message) noexcept
 {
-	SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), 4);
-	std::cout << "[ERROR " << app_current_time_and_date() << "] " << msg << '\n';
+	WORD color = 7;
+	switch (level)
+	{
+	case Level::ERR:	color = 4; break;
+	case Level::WARN:	color = 6; break;
+	case Level::INFO:	color = 10; break;
+	case Level::TRACE:	color = 7; break;
+	}
+	SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), color);
+	std::cout << '[' << LevelName(level) << ' ' << time << "] " << message << '\n';
 }
-void warn(std::string_view msg) noexcept
+#elif defined(_WIN32)
+void Sink(Level level, std::string_view time, std::string_view message) noexcept
 {
-	SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), 6);
-	std::cout << "[WARN  " << app_current_time_and_date() << "] " << msg << '\n';
+	const std::string line = std::format("[{} {}] {}\n", LevelName(level), time, message);
+	OutputDebugStringA(line.c_str());
 }
-void info(std::string_view msg) noexcept
+#else
+// Linux (and anything else with POSIX write()): colored lines on stderr, written with a single write() so that lines from
+// other processes sharing the terminal do not interleave with ours
+void Sink(Level level, std::string_view time, std::string_view message) noexcept
 {
-	SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), 10);
-	std::cout << "[INFO  " << app_current_time_and_date() << "] " << msg << '\n';
+	std::string_view color = "\033[0m";
+	switch (level)
+	{
+	case Level::ERR:	color = "\033[31m"; break;
+	case Level::WARN:	color = "\033[33m"; break;
+	case Level::INFO:	color = "\033[32m"; break;
+	case Level::TRACE:	color = "\033[0m"; break;
+	}
+	const std::string line = std::format("{}[{} {}] {}\033[0m\n", color, LevelName(level), time, message);
+	for (size_t written = 0; written < line.size(); )
+	{
+		const ssize_t result = ::write(STDERR_FILENO, line.data() + written, line.size() - written);
+		if (result <= 0)
+			break;
+		written += static_cast<size_t>(result);
+	}
 }
-void trace(std::string_view msg) noexcept
+#endif
+
+class Logger
 {
-	SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), 7);
-	std::cout << "[TRACE " << app_current_time_and_date() << "] " << msg << '\n';
+public:
+	Logger() noexcept :
+		m_thread([this]() { Run(); })
+	{}
+	Logger(const Logger&) = delete;
+	Logger(Logger&&) = delete;
+	Logger& operator=(const Logger&) = delete;
+	Logger& operator=(Logger&&) = delete;
+	~Logger() noexcept
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_wakeCV.notify_all();
+		m_thread.join();
+		s_destroyed = true;
+	}
 
-}
+	ND static Logger* Get() noexcept
+	{
+		// Messages logged during static destruction (after the logger is gone) are written synchronously
+		static Logger logger;
+		return s_destroyed ? nullptr : &logger;
+	}
+
+	ND std::byte* Begin(Level level, const std::source_location& location, std::string_view format, detail::DecodeFunction decode, size_t argumentBytes, bool& writeNow) noexcept
+	{
+		// Errors always get through - a burst of them is exactly what someone will want to read afterwards
+		std::uint32_t suppressed = 0;
+		if (level != Level::ERR && !Accept(CallSiteKey(location), suppressed))
+			return nullptr;
+
+		const size_t size = (sizeof(EntryHeader) + argumentBytes + 7) & ~size_t{ 7 };
+		if (size > MaxMessageBytes)
+		{
+			writeNow = true;
+			return nullptr;
+		}
+
+		ThreadRing& ring = GetThreadRing();
+		std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+		const std::uint64_t tail = ring.tail.load(std::memory_order_acquire);
+
+		// Entries never wrap - if this one does not fit before the end of the ring, the rest of the ring is skipped
+		const size_t offset = static_cast<size_t>(head % RingCapacity);
+		const size_t padding = offset + size > RingCapacity ? RingCapacity - offset : 0;
+		if (head + padding + size - tail > RingCapacity)
+		{
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		if (padding > 0)
+		{
+			EntryHeader marker = {};
+			marker.size = static_cast<std::uint32_t>(padding);
+			marker.flags = PaddingFlag;
+			std::memcpy(ring.data.data() + offset, &marker, sizeof(std::uint32_t) * 2);
+			head += padding;
+		}
 
-#elif defined RELEASE
+		const EntryHeader header = {
+			static_cast<std::uint32_t>(size), 0, decode, format.data(), static_cast<std::uint32_t>(format.size()), suppressed, NowNs(), level
+		};
+		std::byte* entry = ring.data.data() + head % RingCapacity;
+		std::memcpy(entry, &header, sizeof(header));
+		ring.pendingHead = head + size;
+		return entry + sizeof(header);
+	}
+	void Commit() noexcept
+	{
+		ThreadRing& ring = GetThreadRing();
+		ring.head.store(ring.pendingHead, std::memory_order_release);
+	}
+
+	void Flush() noexcept
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		const std::uint64_t target = ++m_flushRequested;
+		m_wakeCV.notify_all();
+		m_flushedCV.wait(lock, [this, target]() { return m_flushed >= target || m_stop; });
+	}
+
+private:
+	struct Message
+	{
+		std::uint64_t time;
+		Level level;
+		std::string text;
+	};
+
+	ND ThreadRing& GetThreadRing() noexcept
+	{
+		thread_local ThreadRing* t_ring = nullptr;
+		if (t_ring == nullptr)
+		{
+			// First message from this thread - its ring lives as long as the logger, so messages logged by a thread
+			// that has since exited are still written
+			AllocationTagScope allocationTag(AllocationTracker::ExemptTag);
+			auto ring = std::make_unique<ThreadRing>();
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			t_ring = ring.get();
+			m_rings.push_back(std::move(ring));
+		}
+		return *t_ring;
+	}
+
+	ND bool Accept(std::uint64_t key, std::uint32_t& suppressed) noexcept
+	{
+		for (size_t probe = 0; probe < 4; ++probe)
+		{
+			RateSlot& slot = m_rateSlots[(key + probe) % RateSlotCount];
+
+			std::uint64_t current = slot.key.load(std::memory_order_relaxed);
+			if (current == 0 && slot.key.compare_exchange_strong(current, key, std::memory_order_relaxed))
+				current = key;
+			if (current != key)
+				continue;
+
+			const std::uint64_t now = NowNs();
+			std::uint64_t windowStart = slot.windowStart.load(std::memory_order_relaxed);
+			if (now - windowStart >= RateWindowNs && slot.windowStart.compare_exchange_strong(windowStart, now, std::memory_order_relaxed))
+				slot.count.store(0, std::memory_order_relaxed);
+
+			if (slot.count.fetch_add(1, std::memory_order_relaxed) >= RateLimit)
+			{
+				slot.suppressed.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			suppressed = slot.suppressed.exchange(0, std::memory_order_relaxed);
+			return true;
+		}
+
+		// Every slot nearby belongs to some other call site - let it through unlimited
+		return true;
+	}
+
+	void Run() noexcept
+	{
+		// Formatting allocates, but it happens here, not on the frame
+		AllocationTagScope allocationTag(AllocationTracker::ExemptTag);
+
+		std::vector<Message> messages;
+		std::vector<ThreadRing*> rings;
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true)
+		{
+			m_wakeCV.wait_for(lock, std::chrono::milliseconds(10), [this]() { return m_stop || m_flushRequested > m_flushed; });
+			const bool stop = m_stop;
+			const std::uint64_t flushTarget = m_flushRequested;
+
+			// Take everything that has been committed. m_rings may grow (and reallocate) as soon as we unlock, so drain a
+			// copy of it. The rings themselves are never freed before the logger. Rings that are added while we are
+			// unlocked are picked up next time
+			messages.clear();
+			rings.clear();
+			for (const std::unique_ptr<ThreadRing>& ring : m_rings)
+				rings.push_back(ring.get());
+			lock.unlock();
 
-void error(std::string_view msg) noexcept
+			for (ThreadRing* ring : rings)
+				Drain(*ring, messages);
+
+			const std::uint64_t dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+			if (dropped > 0)
+				messages.push_back({ NowNs(), Level::WARN, std::format("Log: {} messages were dropped because a log ring was full", dropped) });
+
+			// Each ring is in order, but messages from different threads have to be merged
+			std::stable_sort(messages.begin(), messages.end(), [](const Message& a, const Message& b) { return a.time < b.time; });
+			for (const Message& message : messages)
+				Sink(message.level, FormatTime(message.time), message.text);
+
+			lock.lock();
+			m_flushed = std::max(m_flushed, flushTarget);
+			m_flushedCV.notify_all();
+			if (stop)
+				return;
+		}
+	}
+
+	void Drain(ThreadRing& ring, std::vector<Message>& messages) noexcept
+	{
+		std::uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+		const std::uint64_t head = ring.head.load(std::memory_order_acquire);
+		while (tail < head)
+		{
+			const std::byte* entry = ring.data.data() + tail % RingCapacity;
+
+			std::uint32_t sizeAndFlags[2];
+			std::memcpy(sizeAndFlags, entry, sizeof(sizeAndFlags));
+			if ((sizeAndFlags[1] & PaddingFlag) == 0)
+			{
+				EntryHeader header;
+				std::memcpy(&header, entry, sizeof(header));
+
+				std::string text = header.decode(std::string_view(header.format, header.formatSize), entry + sizeof(header));
+				if (header.suppressed > 0)
+					text += std::format(" [{} similar messages suppressed]", header.suppressed);
+				messages.push_back({ header.time, header.level, std::move(text) });
+			}
+			tail += sizeAndFlags[0];
+		}
+		ring.tail.store(tail, std::memory_order_release);
+	}
+
+	static inline bool s_destroyed = false;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCV;
+	std::condition_variable m_flushedCV;
+	std::vector<std::unique_ptr<ThreadRing>> m_rings;
+	std::array<RateSlot, RateSlotCount> m_rateSlots;
+	std::atomic<std::uint64_t> m_dropped = 0;
+	std::uint64_t m_flushRequested = 0;
+	std::uint64_t m_flushed = 0;
+	bool m_stop = false;
+
+	// Last, so that everything above exists before the thread starts
+	std::thread m_thread;
+};
+}
+
+namespace detail
+{
+std::string DecodePreformatted(std::string_view, const std::byte* arguments)
 {
-	std::string time = app_current_time_and_date();
-	std::wstring w = std::format(L"[ERROR {}] {}\n", std::wstring(time.begin(), time.end()), std::wstring(msg.begin(), msg.end()));
-	OutputDebugString(w.c_str());
+	return std::string(Decode<std::string_view>(arguments));
 }
-void warn(std::string_view msg) noexcept
+
+std::byte* Begin(Level level, const std::source_location& location, std::string_view format, DecodeFunction decode, size_t argumentBytes, bool& writeNow) noexcept
 {
-	std::string time = app_current_time_and_date();
-	std::wstring w = std::format(L"[WARN  {}] {}\n", std::wstring(time.begin(), time.end()), std::wstring(msg.begin(), msg.end()));
-	OutputDebugString(w.c_str());
+	Logger* logger = Logger::Get();
+	if (logger == nullptr)
+	{
+		writeNow = true;
+		return nullptr;
+	}
+	return logger->Begin(level, location, format, decode, argumentBytes, writeNow);
 }
-void info(std::string_view msg) noexcept
+void Commit() noexcept
 {
-	std::string time = app_current_time_and_date();
-	std::wstring w = std::format(L"[INFO  {}] {}\n", std::wstring(time.begin(), time.end()), std::wstring(msg.begin(), msg.end()));
-	OutputDebugString(w.c_str());
+	if (Logger* logger = Logger::Get())
+		logger->Commit();
 }
-void trace(std::string_view msg) noexcept
+void WriteNow(Level level, std::string_view message) noexcept
 {
-	std::string time = app_current_time_and_date();
-	std::wstring w = std::format(L"[TRACE {}] {}\n", std::wstring(time.begin(), time.end()), std::wstring(msg.begin(), msg.end()));
-	OutputDebugString(w.c_str());
+	// Write whatever is already queued first, so that messages stay in order
+	if (Logger* logger = Logger::Get())
+		logger->Flush();
+	Sink(level, FormatTime(NowNs()), message);
+}
 }
 
-#else
-#error Need to define log functions
-#endif
+void Flush() noexcept
+{
+	if (Logger* logger = Logger::Get())
+		logger->Flush();
+}
+}
 }
-}
\ No newline at end of file
@@ -1,20 +1,177 @@
 #pragma once
 #include "pch.h"
 
+#include <cstring>
+#include <source_location>
 
+// Logging is asynchronous. LOG_*(fmt, args...) does not format anything on the calling thread. It copies the arguments
+// into a ring buffer that belongs to the calling thread (single producer/single consumer, so no locks), and a
+// background thread formats, timestamps and writes the messages:
+//
+//   - Arithmetic (and other trivially copyable) arguments are copied as is. Strings are copied by value, so a
+//     temporary std::string is fine. If any argument is neither, the message is formatted on the calling thread
+//     instead (still written in the background)
+//   - The format string is checked at compile time, just like std::format
+//   - Each call site (its std::source_location) may write at most RateLimit messages per second. Anything more is
+//     dropped and counted, and the count is appended to the next message from that call site that gets through.
+//     Errors are never rate limited
+//   - If a ring is full, the message is dropped and counted. A message that is too large for the ring is written
+//     synchronously
+//   - Levels below SEETHE_LOG_LEVEL are compiled out entirely (their arguments are never evaluated)
+//
+// Sinks: the console (Debug) or OutputDebugString (Release) on Windows, stderr everywhere else.
+//
+// NOTE: Call seethe::log::Flush() before anything that could stop the process (i.e. a debug break), so that messages
+//       that are still queued are not lost
+
+// 0 = trace, 1 = info, 2 = warn, 3 = error
+#ifndef SEETHE_LOG_LEVEL
+#if defined(DEBUG)
+#define SEETHE_LOG_LEVEL 0
+#else
+#define SEETHE_LOG_LEVEL 1
+#endif
+#endif
 
 namespace seethe
 {
 namespace log
 {
-	void error(std::string_view msg) noexcept;
-	void warn(std::string_view msg) noexcept;
-	void info(std::string_view msg) noexcept;
-	void trace(std::string_view msg) noexcept;
+enum class Level : std::uint8_t
+{
+	TRACE,
+	INFO,
+	WARN,
+	ERR			// 'ERROR' is a macro in the Windows headers
+};
+
+ND constexpr bool IsCompiledIn(Level level) noexcept { return level >= static_cast<Level>(SEETHE_LOG_LEVEL); }
+
+namespace detail
+{
+template <typename T>
+concept StringArgument = std::convertible_to<const T&, std::string_view>;
+
+template <typename T>
+concept CopyableArgument = StringArgument<T> || (std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>);
+
+// How an argument is stored in the ring (and what is handed to std::vformat when the message is formatted)
+template <typename T>
+using Stored = std::conditional_t<StringArgument<std::remove_cvref_t<T>>, std::string_view, std::remove_cvref_t<T>>;
+
+// Turns the bytes written by Encode() back into a message
+using DecodeFunction = std::string(*)(std::string_view format, const std::byte* arguments);
+
+template <typename T>
+ND constexpr size_t EncodedSize(const T& argument) noexcept
+{
+	if constexpr (StringArgument<T>)
+		return sizeof(std::uint32_t) + std::string_view(argument).size();
+	else
+		return sizeof(T);
 }
+
+template <typename T>
+void Encode(std::byte*& out, const T& argument) noexcept
+{
+	if constexpr (StringArgument<T>)
+	{
+		const std::string_view s(argument);
+		const std::uint32_t size = static_cast<std::uint32_t>(s.size());
+		std::memcpy(out, &size, sizeof(size));
+		std::memcpy(out + sizeof(size), s.data(), s.size());
+		out += sizeof(size) + s.size();
+	}
+	else
+	{
+		std::memcpy(out, &argument, sizeof(T));
+		out += sizeof(T);
+	}
+}
+
+template <typename T>
+ND T Decode(const std::byte*& in) noexcept
+{
+	if constexpr (std::same_as<T, std::string_view>)
+	{
+		std::uint32_t size;
+		std::memcpy(&size, in, sizeof(size));
+		const std::string_view s(reinterpret_cast<const char*>(in + sizeof(size)), size);
+		in += sizeof(size) + size;
+		return s;
+	}
+	else
+	{
+		T value;
+		std::memcpy(&value, in, sizeof(T));
+		in += sizeof(T);
+		return value;
+	}
 }
 
-#define LOG_ERROR(fmt, ...) seethe::log::error(std::format(fmt, __VA_ARGS__))
-#define LOG_WARN(fmt, ...) seethe::log::warn(std::format(fmt, __VA_ARGS__))
-#define LOG_INFO(fmt, ...) seethe::log::info(std::format(fmt, __VA_ARGS__))
-#define LOG_TRACE(fmt, ...) seethe::log::trace(std::format(fmt, __VA_ARGS__))
\ No newline at end of file
+template <typename... Args>
+ND std::string DecodeAndFormat(std::string_view format, const std::byte* arguments)
+{
+	// Braced initialization evaluates left to right, so the arguments are read back in the order they were written
+	std::tuple<Stored<Args>...> values = { Decode<Stored<Args>>(arguments)... };
+	return std::apply([format](auto&... value) { return std::vformat(format, std::make_format_args(value...)); }, values);
+}
+
+ND std::string DecodePreformatted(std::string_view format, const std::byte* arguments);
+
+// Reserves room for a message in the calling thread's ring, and Commit() (which must follow a non-null Begin()) publishes
+// it. Begin() returns nullptr if the message is dropped (rate limited or ring full), or if it has to be written right
+// away with WriteNow() instead, in which case 'writeNow' is set
+ND std::byte* Begin(Level level, const std::source_location& location, std::string_view format, DecodeFunction decode, size_t argumentBytes, bool& writeNow) noexcept;
+void Commit() noexcept;
+void WriteNow(Level level, std::string_view message) noexcept;
+}
+
+template <typename... Args>
+void Write(Level level, const std::source_location& location, std::format_string<Args...> format, Args&&... args) noexcept
+{
+	const std::string_view fmt = format.get();
+
+	if constexpr ((detail::CopyableArgument<std::remove_cvref_t<Args>> && ...))
+	{
+		bool writeNow = false;
+		const size_t size = (size_t{ 0 } + ... + detail::EncodedSize(args));
+		if (std::byte* out = detail::Begin(level, location, fmt, &detail::DecodeAndFormat<Args...>, size, writeNow))
+		{
+			(detail::Encode(out, args), ...);
+			detail::Commit();
+		}
+		else if (writeNow)
+		{
+			detail::WriteNow(level, std::format(format, std::forward<Args>(args)...));
+		}
+	}
+	else
+	{
+		// Something that cannot be copied into the ring - format it here, while the arguments are still alive
+		bool writeNow = false;
+		const std::string message = std::format(format, std::forward<Args>(args)...);
+		if (std::byte* out = detail::Begin(level, location, fmt, &detail::DecodePreformatted, detail::EncodedSize(message), writeNow))
+		{
+			detail::Encode(out, message);
+			detail::Commit();
+		}
+		else if (writeNow)
+		{
+			detail::WriteNow(level, message);
+		}
+	}
+}
+
+// Blocks until every message logged so far has been written
+void Flush() noexcept;
+}
+}
+
+#define SEETHE_LOG(level, fmt, ...) \
+	do { if constexpr (seethe::log::IsCompiledIn(level)) { seethe::log::Write(level, std::source_location::current(), fmt, __VA_ARGS__); } } while (false)
+
+#define LOG_ERROR(fmt, ...) SEETHE_LOG(seethe::log::Level::ERR, fmt, __VA_ARGS__)
+#define LOG_WARN(fmt, ...) SEETHE_LOG(seethe::log::Level::WARN, fmt, __VA_ARGS__)
+#define LOG_INFO(fmt, ...) SEETHE_LOG(seethe::log::Level::INFO, fmt, __VA_ARGS__)
+#define LOG_TRACE(fmt, ...) SEETHE_LOG(seethe::log::Level::TRACE, fmt, __VA_ARGS__)
@@ -38,7 +38,6 @@ float MathHelper::AngleFromXY(float x, float y)
 XMVECTOR MathHelper::RandUnitVec3()
 {
 	XMVECTOR One = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
-	XMVECTOR Zero = XMVectorZero();
 
 	// Keep trying until we get a point on/in the hemisphere.
 	while (true)
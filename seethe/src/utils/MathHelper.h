@@ -1,8 +1,9 @@
 #pragma once
 
-#include <Windows.h>
 #include <DirectXMath.h>
+#include <cmath>
 #include <cstdint>
+#include <cstdlib>
 
 namespace seethe
 {
@@ -0,0 +1,97 @@
+#include "Metrics.h"
+#include "AllocationTracker.h"
+#include "FrameStats.h"
+
+namespace seethe
+{
+namespace
+{
+void AppendHeader(std::string& out, std::string_view name, std::string_view type, std::string_view help) noexcept
+{
+	std::format_to(std::back_inserter(out), "# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+}
+
+// Prometheus wants seconds, the histograms hold nanoseconds
+void AppendSummary(std::string& out, std::string_view name, std::string_view help, const Histogram& histogram) noexcept
+{
+	AppendHeader(out, name, "summary", help);
+	for (double quantile : { 0.5, 0.9, 0.99, 0.999 })
+		std::format_to(std::back_inserter(out), "{}{{quantile=\"{}\"}} {}\n", name, quantile, static_cast<double>(histogram.ValueAtPercentile(quantile * 100.0)) / 1e9);
+
+	const std::uint64_t count = histogram.GetCount();
+	std::format_to(std::back_inserter(out), "{}_sum {}\n{}_count {}\n", name, histogram.GetMean() * static_cast<double>(count) / 1e9, name, count);
+}
+}
+
+Metrics& Metrics::Get() noexcept
+{
+	static Metrics metrics;
+	return metrics;
+}
+
+std::string Metrics::ToPrometheusText() noexcept
+{
+	std::string out;
+	out.reserve(4096);
+
+	const std::uint64_t atomSteps = m_atomSteps.load(std::memory_order_relaxed);
+	double atomStepsPerSecond = 0.0;
+	{
+		std::lock_guard<std::mutex> lock(m_rateMutex);
+		const auto now = std::chrono::steady_clock::now();
+		const double seconds = std::chrono::duration<double>(now - m_previousTime).count();
+		if (seconds > 0.0)
+			atomStepsPerSecond = static_cast<double>(atomSteps - m_previousAtomSteps) / seconds;
+		m_previousTime = now;
+		m_previousAtomSteps = atomSteps;
+	}
+
+	AppendHeader(out, "seethe_atoms", "gauge", "Number of atoms in the simulation");
+	std::format_to(std::back_inserter(out), "seethe_atoms {}\n", m_atomCount.load(std::memory_order_relaxed));
+
+	AppendHeader(out, "seethe_steps_total", "counter", "Simulation steps taken");
+	std::format_to(std::back_inserter(out), "seethe_steps_total {}\n", m_steps.load(std::memory_order_relaxed));
+
+	AppendHeader(out, "seethe_atom_steps_total", "counter", "Atoms advanced, summed over every step");
+	std::format_to(std::back_inserter(out), "seethe_atom_steps_total {}\n", atomSteps);
+
+	AppendHeader(out, "seethe_atom_steps_per_second", "gauge", "Atom-steps per second since the previous scrape");
+	std::format_to(std::back_inserter(out), "seethe_atom_steps_per_second {}\n", atomStepsPerSecond);
+
+	AppendHeader(out, "seethe_grid_rebuilds_total", "counter", "Rebuilds of the atom grid used for neighbor searches");
+	std::format_to(std::back_inserter(out), "seethe_grid_rebuilds_total {}\n", m_gridRebuilds.load(std::memory_order_relaxed));
+
+	const FrameStats& frameStats = FrameStats::Get();
+	AppendSummary(out, "seethe_step_duration_seconds", "Time spent in Simulation::Update() per step", frameStats.GetHistogram(FrameMetric::SIMULATION_STEP_TIME));
+	AppendSummary(out, "seethe_frame_duration_seconds", "Time between the start of consecutive frames", frameStats.GetHistogram(FrameMetric::FRAME_TIME));
+
+	AppendHeader(out, "seethe_undo_stack_bytes", "gauge", "Approximate bytes held by the undo and redo stacks");
+	std::format_to(std::back_inserter(out), "seethe_undo_stack_bytes{{stack=\"undo\"}} {}\nseethe_undo_stack_bytes{{stack=\"redo\"}} {}\n",
+		m_undoBytes.load(std::memory_order_relaxed), m_redoBytes.load(std::memory_order_relaxed));
+
+	// NOTE: The memory each subsystem holds right now is the live bytes, the other two are totals since startup. They
+	//       are all 0 without ENABLE_ALLOCATION_TRACKING
+	const AllocationTracker& tracker = AllocationTracker::Get();
+	AppendHeader(out, "seethe_allocated_live_bytes", "gauge", "Bytes held by operator new allocations that have not been freed (heap block sizes), by allocation tag");
+	tracker.ForEachTagTotal([&out](const AllocationTracker::TagCounters& counters)
+		{
+			std::format_to(std::back_inserter(out), "seethe_allocated_live_bytes{{tag=\"{}\"}} {}\n", counters.name, counters.liveBytes);
+		}
+	);
+
+	AppendHeader(out, "seethe_allocated_bytes_total", "counter", "Bytes allocated with operator new, by allocation tag");
+	tracker.ForEachTagTotal([&out](const AllocationTracker::TagCounters& counters)
+		{
+			std::format_to(std::back_inserter(out), "seethe_allocated_bytes_total{{tag=\"{}\"}} {}\n", counters.name, counters.totalBytes);
+		}
+	);
+	AppendHeader(out, "seethe_allocations_total", "counter", "Allocations made with operator new, by allocation tag");
+	tracker.ForEachTagTotal([&out](const AllocationTracker::TagCounters& counters)
+		{
+			std::format_to(std::back_inserter(out), "seethe_allocations_total{{tag=\"{}\"}} {}\n", counters.name, counters.totalAllocations);
+		}
+	);
+
+	return out;
+}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+// Metrics holds the live counters behind the metrics endpoint (see MetricsServer), for watching a long running
+// simulation from outside the process. Every counter is a relaxed atomic, so updating one from the hot loop is a
+// single uncontended atomic add (once per step, not once per atom) and reading them from the server thread needs
+// no locks. ToPrometheusText() adds the step/frame time percentiles from FrameStats and the per tag allocation totals
+// from AllocationTracker.
+class Metrics
+{
+public:
+	ND static Metrics& Get() noexcept;
+
+	// Hot loop updates
+	void AddStep(std::uint64_t atomCount) noexcept
+	{
+		m_steps.fetch_add(1, std::memory_order_relaxed);
+		m_atomSteps.fetch_add(atomCount, std::memory_order_relaxed);
+	}
+	void AddGridRebuild() noexcept { m_gridRebuilds.fetch_add(1, std::memory_order_relaxed); }
+
+	// Once per frame, from the main thread
+	void SetAtomCount(std::uint64_t atomCount) noexcept { m_atomCount.store(atomCount, std::memory_order_relaxed); }
+	void SetUndoBytes(std::uint64_t undoBytes, std::uint64_t redoBytes) noexcept
+	{
+		m_undoBytes.store(undoBytes, std::memory_order_relaxed);
+		m_redoBytes.store(redoBytes, std::memory_order_relaxed);
+	}
+
+	// Set while a MetricsServer is running, so that values which take some work to gather (i.e. the undo stack size)
+	// are only gathered when someone can read them
+	void SetServed(bool served) noexcept { m_served.store(served, std::memory_order_relaxed); }
+	ND bool IsServed() const noexcept { return m_served.load(std::memory_order_relaxed); }
+
+	// Every metric in the Prometheus text exposition format (version 0.0.4). The atom-steps per second gauge is the
+	// rate since the previous call
+	ND std::string ToPrometheusText() noexcept;
+
+private:
+	Metrics() noexcept = default;
+	Metrics(const Metrics&) = delete;
+	Metrics(Metrics&&) = delete;
+	Metrics& operator=(const Metrics&) = delete;
+	Metrics& operator=(Metrics&&) = delete;
+
+	std::atomic<std::uint64_t> m_steps = 0;
+	std::atomic<std::uint64_t> m_atomSteps = 0;
+	std::atomic<std::uint64_t> m_gridRebuilds = 0;
+	std::atomic<std::uint64_t> m_atomCount = 0;
+	std::atomic<std::uint64_t> m_undoBytes = 0;
+	std::atomic<std::uint64_t> m_redoBytes = 0;
+	std::atomic<bool> m_served = false;
+
+	// For the rate since the previous ToPrometheusText()
+	std::mutex m_rateMutex;
+	std::chrono::steady_clock::time_point m_previousTime = std::chrono::steady_clock::now();
+	std::uint64_t m_previousAtomSteps = 0;
+};
+}
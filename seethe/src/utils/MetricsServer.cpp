@@ -0,0 +1,207 @@
+#include "MetricsServer.h"
+#include "AllocationTracker.h"
+#include "Log.h"
+#include "Metrics.h"
+#include "Profiler.h"
+
+#if defined(_WIN32)
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace seethe
+{
+namespace
+{
+// How often the serving thread wakes up to check whether it should stop
+constexpr int PollTimeoutMs = 200;
+
+// Requests are tiny (a request line and a few headers), anything bigger is not a scrape
+constexpr size_t MaxRequestBytes = 8192;
+constexpr int ReceiveTimeoutMs = 1000;
+
+#if defined(_WIN32)
+constexpr int SendFlags = 0;
+std::string LastSocketError() noexcept { return std::format("error {}", WSAGetLastError()); }
+void CloseSocket(UINT_PTR socket) noexcept { closesocket(static_cast<SOCKET>(socket)); }
+int PollReadable(UINT_PTR socket, int timeoutMs) noexcept
+{
+	WSAPOLLFD fd = { static_cast<SOCKET>(socket), POLLRDNORM, 0 };
+	return WSAPoll(&fd, 1, timeoutMs);
+}
+#else
+constexpr int SendFlags = MSG_NOSIGNAL;		// A scraper that hangs up early must not raise SIGPIPE
+std::string LastSocketError() noexcept { return std::strerror(errno); }
+void CloseSocket(int socket) noexcept { close(socket); }
+int PollReadable(int socket, int timeoutMs) noexcept
+{
+	pollfd fd = { socket, POLLIN, 0 };
+	return poll(&fd, 1, timeoutMs);
+}
+#endif
+
+std::string Response(std::string_view status, std::string_view contentType, std::string_view body) noexcept
+{
+	return std::format("HTTP/1.1 {}\r\nContent-Type: {}\r\nContent-Length: {}\r\nConnection: close\r\n\r\n{}", status, contentType, body.size(), body);
+}
+}
+
+MetricsServer::~MetricsServer() noexcept
+{
+	Stop();
+}
+
+bool MetricsServer::Start(std::uint16_t port) noexcept
+{
+	if (m_running)
+		return true;
+
+#if defined(_WIN32)
+	WSADATA wsaData = {};
+	if (const int result = WSAStartup(MAKEWORD(2, 2), &wsaData); result != 0)
+	{
+		LOG_ERROR("Metrics server: WSAStartup failed (error {})", result);
+		return false;
+	}
+#endif
+
+	auto Fail = [this](std::string_view what) -> bool
+		{
+			LOG_ERROR("Metrics server: {} failed: {}", what, LastSocketError());
+			if (m_listenSocket != static_cast<Socket>(-1))
+				CloseSocket(m_listenSocket);
+			m_listenSocket = static_cast<Socket>(-1);
+#if defined(_WIN32)
+			WSACleanup();
+#endif
+			return false;
+		};
+
+	m_listenSocket = static_cast<Socket>(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+	if (m_listenSocket == static_cast<Socket>(-1))
+		return Fail("socket()");
+
+	// Restarting right after a previous run must not fail because of connections in TIME_WAIT. On Windows, SO_REUSEADDR
+	// would let another process take the port over, so the port is claimed exclusively instead
+	int option = 1;
+#if defined(_WIN32)
+	setsockopt(m_listenSocket, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, reinterpret_cast<const char*>(&option), sizeof(option));
+#else
+	setsockopt(m_listenSocket, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
+#endif
+
+	// Loopback only
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(m_listenSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+		return Fail(std::format("bind() to 127.0.0.1:{}", port));
+	if (listen(m_listenSocket, 4) != 0)
+		return Fail("listen()");
+
+	socklen_t addressLength = sizeof(address);
+	getsockname(m_listenSocket, reinterpret_cast<sockaddr*>(&address), &addressLength);
+	m_port = ntohs(address.sin_port);
+
+	m_stop = false;
+	m_thread = std::thread([this]() { ServeLoop(); });
+	m_running = true;
+	Metrics::Get().SetServed(true);
+
+	LOG_INFO("Metrics server listening on http://127.0.0.1:{}/metrics", m_port);
+	return true;
+}
+
+void MetricsServer::Stop() noexcept
+{
+	if (!m_running)
+		return;
+
+	m_stop = true;
+	if (m_thread.joinable())
+		m_thread.join();
+
+	CloseSocket(m_listenSocket);
+	m_listenSocket = static_cast<Socket>(-1);
+#if defined(_WIN32)
+	WSACleanup();
+#endif
+
+	m_running = false;
+	Metrics::Get().SetServed(false);
+}
+
+void MetricsServer::ServeLoop() noexcept
+{
+	PROFILE_THREAD("Metrics server");
+
+	// Serving happens whenever a scrape comes in, so it must never count against a frame
+	AllocationTagScope allocationTag(AllocationTracker::ExemptTag);
+
+	while (!m_stop.load(std::memory_order_relaxed))
+	{
+		if (PollReadable(m_listenSocket, PollTimeoutMs) <= 0)
+			continue;
+
+		const Socket client = static_cast<Socket>(accept(m_listenSocket, nullptr, nullptr));
+		if (client == static_cast<Socket>(-1))
+			continue;
+
+		HandleConnection(client);
+		CloseSocket(client);
+	}
+}
+
+void MetricsServer::HandleConnection(Socket client) noexcept
+{
+	// Read until the end of the headers (a GET has no body)
+	std::string request;
+	std::array<char, 1024> buffer;
+	while (request.size() < MaxRequestBytes && request.find("\r\n\r\n") == std::string::npos)
+	{
+		if (PollReadable(client, ReceiveTimeoutMs) <= 0)
+			return;
+
+		const int received = static_cast<int>(recv(client, buffer.data(), static_cast<int>(buffer.size()), 0));
+		if (received <= 0)
+			return;
+		request.append(buffer.data(), static_cast<size_t>(received));
+	}
+
+	// Request line: <method> <target> <version>
+	const std::string_view line = std::string_view(request).substr(0, request.find("\r\n"));
+	const size_t methodEnd = line.find(' ');
+	const size_t targetEnd = line.find(' ', methodEnd + 1);
+	const std::string_view method = line.substr(0, methodEnd);
+	const std::string_view target = methodEnd == std::string_view::npos ? std::string_view{} : line.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+	const std::string_view path = target.substr(0, target.find('?'));
+
+	std::string response;
+	if (method != "GET")
+		response = Response("405 Method Not Allowed", "text/plain", "Only GET is supported\n");
+	else if (path == "/metrics")
+		response = Response("200 OK", "text/plain; version=0.0.4; charset=utf-8", Metrics::Get().ToPrometheusText());
+	else if (path == "/")
+		response = Response("200 OK", "text/plain", "seethe metrics are at /metrics\n");
+	else
+		response = Response("404 Not Found", "text/plain", "Not found\n");
+
+	for (size_t sent = 0; sent < response.size();)
+	{
+		const int result = static_cast<int>(send(client, response.data() + sent, static_cast<int>(response.size() - sent), SendFlags));
+		if (result <= 0)
+			return;
+		sent += static_cast<size_t>(result);
+	}
+}
+}
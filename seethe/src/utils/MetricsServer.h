@@ -0,0 +1,47 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+// MetricsServer serves Metrics::ToPrometheusText() over HTTP at http://127.0.0.1:<port>/metrics, for Prometheus (or
+// curl) to scrape. It only binds the loopback interface, so nothing outside this machine can reach it. A single
+// background thread handles one request at a time and closes the connection after each response, which is plenty
+// for a scrape every few seconds.
+//
+// Run the application or seethe-bench (i.e. with --benchmark/--scaling-test) with --metrics-port [port] to start it
+class MetricsServer
+{
+public:
+	static constexpr std::uint16_t DefaultPort = 9464;
+
+	MetricsServer() noexcept = default;
+	MetricsServer(const MetricsServer&) = delete;
+	MetricsServer(MetricsServer&&) = delete;
+	MetricsServer& operator=(const MetricsServer&) = delete;
+	MetricsServer& operator=(MetricsServer&&) = delete;
+	~MetricsServer() noexcept;
+
+	// Returns false (and logs why) if the port cannot be bound. Port 0 picks any free port (see GetPort())
+	bool Start(std::uint16_t port = DefaultPort) noexcept;
+	void Stop() noexcept;
+
+	ND constexpr bool IsRunning() const noexcept { return m_running; }
+	ND constexpr std::uint16_t GetPort() const noexcept { return m_port; }
+
+private:
+#if defined(_WIN32)
+	using Socket = UINT_PTR;	// SOCKET
+#else
+	using Socket = int;
+#endif
+
+	void ServeLoop() noexcept;
+	void HandleConnection(Socket client) noexcept;
+
+	Socket m_listenSocket = static_cast<Socket>(-1);
+	std::thread m_thread;
+	std::atomic<bool> m_stop = false;
+	bool m_running = false;
+	std::uint16_t m_port = 0;
+};
+}
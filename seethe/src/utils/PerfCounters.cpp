@@ -0,0 +1,257 @@
+#include "PerfCounters.h"
+#include "utils/Log.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace seethe
+{
+thread_local std::uint32_t PhaseCounters::t_phase = PhaseCounters::NoPhase;
+
+PerfCounterGroup::PerfCounterGroup() noexcept
+{
+	m_fds.fill(-1);
+
+#if defined(__linux__)
+	auto Open = [](std::uint32_t type, std::uint64_t config, int groupFd) -> int
+		{
+			perf_event_attr attr = {};
+			attr.size = sizeof(attr);
+			attr.type = type;
+			attr.config = config;
+			attr.disabled = groupFd == -1 ? 1 : 0;		// The leader enables the whole group at once
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+			// pid = 0, cpu = -1: the calling thread, on whichever CPU it runs
+			return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+		};
+
+	constexpr std::uint64_t l1dReadMiss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	constexpr std::array<std::pair<std::uint32_t, std::uint64_t>, PerfCounterCount> events = { {
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HW_CACHE, l1dReadMiss },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+	} };
+
+	m_fds[0] = Open(events[0].first, events[0].second, -1);
+	if (m_fds[0] == -1)
+	{
+		m_unavailableReason = std::format("perf_event_open failed: {} (check /proc/sys/kernel/perf_event_paranoid)", std::strerror(errno));
+		return;
+	}
+
+	for (size_t iii = 1; iii < PerfCounterCount; ++iii)
+		m_fds[iii] = Open(events[iii].first, events[iii].second, m_fds[0]);
+
+	// Group reads identify the members by id
+	for (size_t iii = 0; iii < PerfCounterCount; ++iii)
+	{
+		if (m_fds[iii] != -1)
+			ioctl(m_fds[iii], PERF_EVENT_IOC_ID, &m_ids[iii]);
+	}
+
+	ioctl(m_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	m_available = true;
+#else
+	m_unavailableReason = "Hardware counters are only implemented with Linux perf_event - timing only";
+#endif
+}
+PerfCounterGroup::~PerfCounterGroup() noexcept
+{
+#if defined(__linux__)
+	for (int fd : m_fds)
+	{
+		if (fd != -1)
+			close(fd);
+	}
+#endif
+}
+
+PerfCounterGroup& PerfCounterGroup::ForThisThread() noexcept
+{
+	thread_local PerfCounterGroup group;
+	return group;
+}
+
+bool PerfCounterGroup::Read(Reading& reading) const noexcept
+{
+#if defined(__linux__)
+	if (!m_available)
+		return false;
+
+	// Group read layout: nr, time_enabled, time_running, then { value, id } for each member that was opened
+	std::array<std::uint64_t, 3 + 2 * PerfCounterCount> buffer = {};
+	if (read(m_fds[0], buffer.data(), sizeof(buffer)) <= 0)
+		return false;
+
+	const std::uint64_t count = buffer[0];
+	const double scale = buffer[2] > 0 ? static_cast<double>(buffer[1]) / static_cast<double>(buffer[2]) : 0.0;
+
+	reading.valid.fill(false);
+	for (std::uint64_t member = 0; member < count && member < PerfCounterCount; ++member)
+	{
+		const std::uint64_t value = buffer[3 + 2 * member];
+		const std::uint64_t id = buffer[4 + 2 * member];
+		for (size_t iii = 0; iii < PerfCounterCount; ++iii)
+		{
+			if (m_fds[iii] != -1 && m_ids[iii] == id)
+			{
+				reading.values[iii] = static_cast<std::uint64_t>(static_cast<double>(value) * scale);
+				reading.valid[iii] = true;
+			}
+		}
+	}
+	return true;
+#else
+	(void)reading;
+	return false;
+#endif
+}
+
+double PhaseCounters::Phase::IPC() const noexcept
+{
+	const size_t cycles = static_cast<size_t>(PerfCounter::CYCLES);
+	const size_t instructions = static_cast<size_t>(PerfCounter::INSTRUCTIONS);
+	if (!valid[cycles] || !valid[instructions] || counters[cycles] == 0)
+		return 0.0;
+	return static_cast<double>(counters[instructions]) / static_cast<double>(counters[cycles]);
+}
+double PhaseCounters::Phase::PerWork(PerfCounter counter) const noexcept
+{
+	const size_t index = static_cast<size_t>(counter);
+	if (!valid[index] || work == 0)
+		return 0.0;
+	return static_cast<double>(counters[index]) / static_cast<double>(work);
+}
+
+PhaseCounters& PhaseCounters::Get() noexcept
+{
+	static PhaseCounters phaseCounters;
+	return phaseCounters;
+}
+
+std::uint32_t PhaseCounters::Register(std::string_view name) noexcept
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (size_t iii = 0; iii < m_phases.size(); ++iii)
+	{
+		if (m_phases[iii].name == name)
+			return static_cast<std::uint32_t>(iii);
+	}
+
+	m_phases.emplace_back().name = name;
+
+	const PerfCounterGroup& group = PerfCounterGroup::ForThisThread();
+	if (!group.IsAvailable())
+		LOG_INFO("Phase '{}' will only be timed: {}", name, group.GetUnavailableReason());
+
+	return static_cast<std::uint32_t>(m_phases.size() - 1);
+}
+
+void PhaseCounters::Add(std::uint32_t phase, std::uint64_t work, std::uint64_t ns, const PerfCounterGroup::Reading* start, const PerfCounterGroup::Reading* end) noexcept
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Phase& p = m_phases[phase];
+	++p.calls;
+	p.work += work;
+	p.ns += ns;
+
+	if (start != nullptr && end != nullptr)
+		AddCounterDeltas(p, *start, *end);
+}
+void PhaseCounters::AddCounters(std::uint32_t phase, const PerfCounterGroup::Reading& start, const PerfCounterGroup::Reading& end) noexcept
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	AddCounterDeltas(m_phases[phase], start, end);
+}
+void PhaseCounters::AddCounterDeltas(Phase& phase, const PerfCounterGroup::Reading& start, const PerfCounterGroup::Reading& end) noexcept
+{
+	for (size_t iii = 0; iii < PerfCounterCount; ++iii)
+	{
+		// Multiplexing scales each reading separately, so a delta can come out slightly negative
+		if (start.valid[iii] && end.valid[iii])
+		{
+			phase.counters[iii] += end.values[iii] > start.values[iii] ? end.values[iii] - start.values[iii] : 0;
+			phase.valid[iii] = true;
+		}
+	}
+}
+
+void PhaseCounters::Reset() noexcept
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (Phase& phase : m_phases)
+	{
+		const std::string name = std::move(phase.name);
+		phase = {};
+		phase.name = name;
+	}
+}
+
+void PhaseCounters::LogReport() const noexcept
+{
+	ForEachPhase([](const Phase& phase)
+	{
+		if (phase.calls == 0)
+			return;
+
+		std::string line = std::format("{}: {} calls, {:.3f} ms/call", phase.name, phase.calls, static_cast<double>(phase.ns) / 1e6 / static_cast<double>(phase.calls));
+		if (phase.valid[static_cast<size_t>(PerfCounter::CYCLES)])
+		{
+			line += std::format(", IPC {:.2f}, per atom-step: {:.3f} L1D misses, {:.3f} LLC misses, {:.3f} branch misses",
+				phase.IPC(), phase.PerWork(PerfCounter::L1D_MISSES), phase.PerWork(PerfCounter::LLC_MISSES), phase.PerWork(PerfCounter::BRANCH_MISSES));
+		}
+		LOG_INFO("{}", line);
+	});
+}
+
+PhaseCounterScope::PhaseCounterScope(std::uint32_t phase, std::uint64_t work) noexcept :
+	m_phase(phase),
+	m_work(work),
+	m_group(PerfCounterGroup::ForThisThread()),
+	m_previousPhase(std::exchange(PhaseCounters::CurrentPhase(), phase))
+{
+	// Timestamp last, so the time does not include reading the counters
+	m_hasCounters = m_group.Read(m_start);
+	m_startNs = Profiler::Now();
+}
+PhaseCounterScope::~PhaseCounterScope() noexcept
+{
+	const std::uint64_t endNs = Profiler::Now();
+
+	PerfCounterGroup::Reading end;
+	const bool hasCounters = m_hasCounters && m_group.Read(end);
+
+	PhaseCounters::Get().Add(m_phase, m_work, endNs - m_startNs, hasCounters ? &m_start : nullptr, hasCounters ? &end : nullptr);
+	PhaseCounters::CurrentPhase() = m_previousPhase;
+}
+
+PhaseCounterShareScope::PhaseCounterShareScope(std::uint32_t phase) noexcept :
+	m_phase(phase),
+	m_previousPhase(std::exchange(PhaseCounters::CurrentPhase(), phase))
+{
+	if (m_phase != PhaseCounters::NoPhase)
+		m_hasCounters = PerfCounterGroup::ForThisThread().Read(m_start);
+}
+PhaseCounterShareScope::~PhaseCounterShareScope() noexcept
+{
+	PerfCounterGroup::Reading end;
+	if (m_hasCounters && PerfCounterGroup::ForThisThread().Read(end))
+		PhaseCounters::Get().AddCounters(m_phase, m_start, end);
+
+	PhaseCounters::CurrentPhase() = m_previousPhase;
+}
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include "pch.h"
+#include "utils/Profiler.h"
+
+namespace seethe
+{
+enum class PerfCounter
+{
+	CYCLES,
+	INSTRUCTIONS,
+	L1D_MISSES,
+	LLC_MISSES,
+	BRANCH_MISSES,
+	COUNT
+};
+static constexpr size_t PerfCounterCount = static_cast<size_t>(PerfCounter::COUNT);
+inline constexpr std::array PerfCounterNames = { "Cycles", "Instructions", "L1D misses", "LLC misses", "Branch misses" };
+
+// PerfCounterGroup is a group of hardware counters (cycles, instructions, L1D read misses, last level cache misses
+// and branch misses) for the calling thread. On Linux it is backed by perf_event_open(), opened as a single group so
+// that every counter covers exactly the same instructions. User space only (exclude_kernel), so it works with the
+// default perf_event_paranoid setting.
+//
+// If the counters cannot be opened (no permission, no PMU in a VM, or any platform other than Linux) the group is
+// simply unavailable and GetUnavailableReason() says why. Counters that the CPU does not support are left out
+// individually.
+//
+// NOTE: perf counts per thread, so each thread needs its own group (see ForThisThread()). Work that a phase hands to
+//       the ThreadPool is not included in the calling thread's counts - the workers count their share separately
+//       (see PhaseCounterShareScope)
+class PerfCounterGroup
+{
+public:
+	struct Reading
+	{
+		std::array<std::uint64_t, PerfCounterCount> values = {};
+		std::array<bool, PerfCounterCount> valid = {};
+	};
+
+	PerfCounterGroup() noexcept;
+	PerfCounterGroup(const PerfCounterGroup&) = delete;
+	PerfCounterGroup(PerfCounterGroup&&) = delete;
+	PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+	PerfCounterGroup& operator=(PerfCounterGroup&&) = delete;
+	~PerfCounterGroup() noexcept;
+
+	ND static PerfCounterGroup& ForThisThread() noexcept;
+
+	ND constexpr bool IsAvailable() const noexcept { return m_available; }
+	ND constexpr const std::string& GetUnavailableReason() const noexcept { return m_unavailableReason; }
+
+	// Running totals since the group was opened. When the kernel had to multiplex the counters, the values are scaled
+	// up to the full time the group was enabled
+	ND bool Read(Reading& reading) const noexcept;
+
+private:
+	std::array<int, PerfCounterCount> m_fds;
+	std::array<std::uint64_t, PerfCounterCount> m_ids = {};
+	bool m_available = false;
+	std::string m_unavailableReason;
+};
+
+// PhaseCounters accumulates time and hardware counter deltas per named phase (i.e. "Simulation::Update"), along with
+// the amount of work done in it (atom-steps), so that each phase can be reported as IPC and misses per atom-step. A
+// phase that is memory bound shows a low IPC and a high LLC miss rate, a compute bound phase a high IPC.
+//
+// Use PROFILE_PHASE(name, work), which also opens a PROFILE_SCOPE with the same name. The time is the calling
+// thread's, but the counters also include what the ThreadPool workers did for the phase, so IPC and the misses per
+// atom-step cover all of the phase's work.
+class PhaseCounters
+{
+public:
+	static constexpr std::uint32_t NoPhase = std::numeric_limits<std::uint32_t>::max();
+
+	struct Phase
+	{
+		std::string name;
+		std::uint64_t calls = 0;
+		std::uint64_t work = 0;
+		std::uint64_t ns = 0;
+		std::array<std::uint64_t, PerfCounterCount> counters = {};
+		std::array<bool, PerfCounterCount> valid = {};
+
+		ND double IPC() const noexcept;
+		ND double PerWork(PerfCounter counter) const noexcept;
+	};
+
+	ND static PhaseCounters& Get() noexcept;
+
+	ND std::uint32_t Register(std::string_view name) noexcept;
+	void Add(std::uint32_t phase, std::uint64_t work, std::uint64_t ns, const PerfCounterGroup::Reading* start, const PerfCounterGroup::Reading* end) noexcept;
+	// Counters only (no call, work or time), for a share of the phase's work that ran on another thread
+	void AddCounters(std::uint32_t phase, const PerfCounterGroup::Reading& start, const PerfCounterGroup::Reading& end) noexcept;
+
+	// The innermost phase the calling thread is in, or NoPhase. The ThreadPool hands it to its workers
+	ND static std::uint32_t& CurrentPhase() noexcept { return t_phase; }
+
+	// fn(const Phase&) is called for every phase while the phases are locked (so nothing is copied)
+	template <typename F>
+	void ForEachPhase(F&& fn) const noexcept
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (const Phase& phase : m_phases)
+			fn(phase);
+	}
+	void Reset() noexcept;
+	void LogReport() const noexcept;
+
+private:
+	PhaseCounters() noexcept = default;
+
+	// Expects m_mutex to be held
+	void AddCounterDeltas(Phase& phase, const PerfCounterGroup::Reading& start, const PerfCounterGroup::Reading& end) noexcept;
+
+	static thread_local std::uint32_t t_phase;
+
+	mutable std::mutex m_mutex;
+	std::vector<Phase> m_phases;
+};
+
+// Measures its own lifetime for PhaseCounters. Use PROFILE_PHASE() rather than this directly
+class PhaseCounterScope
+{
+public:
+	PhaseCounterScope(std::uint32_t phase, std::uint64_t work) noexcept;
+	PhaseCounterScope(const PhaseCounterScope&) = delete;
+	PhaseCounterScope(PhaseCounterScope&&) = delete;
+	PhaseCounterScope& operator=(const PhaseCounterScope&) = delete;
+	PhaseCounterScope& operator=(PhaseCounterScope&&) = delete;
+	~PhaseCounterScope() noexcept;
+
+private:
+	std::uint32_t m_phase;
+	std::uint64_t m_work;
+	PerfCounterGroup& m_group;
+	PerfCounterGroup::Reading m_start;
+	bool m_hasCounters;
+	std::uint64_t m_startNs;
+	std::uint32_t m_previousPhase;
+};
+
+// Adds the calling thread's counters over its lifetime to 'phase', which was opened on another thread. The ThreadPool
+// wraps each worker's share of a ParallelFor() in one, so that the submitting thread's phase covers the whole job.
+// Does nothing for PhaseCounters::NoPhase
+class PhaseCounterShareScope
+{
+public:
+	PhaseCounterShareScope(std::uint32_t phase) noexcept;
+	PhaseCounterShareScope(const PhaseCounterShareScope&) = delete;
+	PhaseCounterShareScope(PhaseCounterShareScope&&) = delete;
+	PhaseCounterShareScope& operator=(const PhaseCounterShareScope&) = delete;
+	PhaseCounterShareScope& operator=(PhaseCounterShareScope&&) = delete;
+	~PhaseCounterShareScope() noexcept;
+
+private:
+	std::uint32_t m_phase;
+	std::uint32_t m_previousPhase;
+	PerfCounterGroup::Reading m_start;
+	bool m_hasCounters = false;
+};
+}
+
+#ifdef ENABLE_PROFILING
+#define PROFILE_PHASE(name, work) \
+	PROFILE_SCOPE(name); \
+	static const std::uint32_t CAT(_profilePhaseId, __LINE__) = seethe::PhaseCounters::Get().Register(name); \
+	seethe::PhaseCounterScope CAT(_profilePhase, __LINE__)(CAT(_profilePhaseId, __LINE__), static_cast<std::uint64_t>(work))
+#else
+#define PROFILE_PHASE(name, work)
+#endif
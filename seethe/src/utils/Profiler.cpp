@@ -0,0 +1,228 @@
+#include "Profiler.h"
+#include "utils/Log.h"
+
+namespace seethe
+{
+thread_local Profiler::ThreadBuffer* Profiler::t_buffer = nullptr;
+thread_local std::uint32_t Profiler::t_depth = 0;
+
+Profiler& Profiler::Get() noexcept
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+std::uint32_t Profiler::Intern(std::string_view name) noexcept
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto [it, inserted] = m_nameIds.try_emplace(std::string(name), static_cast<std::uint32_t>(m_names.size()));
+	if (inserted)
+		m_names.emplace_back(name);
+	return it->second;
+}
+const std::string& Profiler::GetName(std::uint32_t nameId) const noexcept
+{
+	static const std::string unknown = "<unknown>";
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return nameId < m_names.size() ? m_names[nameId] : unknown;
+}
+
+Profiler::ThreadBuffer& Profiler::GetThreadBuffer() noexcept
+{
+	if (t_buffer == nullptr)
+	{
+		// First record from this thread - its buffer lives until the profiler is destroyed, so the records of a
+		// thread that has exited can still be drained
+		auto buffer = std::make_unique<ThreadBuffer>();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		buffer->name = std::format("Thread {}", m_threads.size());
+		t_buffer = buffer.get();
+		m_threads.push_back(std::move(buffer));
+	}
+	return *t_buffer;
+}
+void Profiler::SetThreadName(std::string_view name) noexcept
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	buffer.name = name;
+}
+
+void Profiler::Record(std::uint32_t nameId, std::uint64_t start, std::uint64_t end, std::uint32_t depth) noexcept
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	const std::uint64_t head = buffer.head.load(std::memory_order_relaxed);
+	if (head - buffer.tail.load(std::memory_order_acquire) >= RingCapacity)
+	{
+		buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	buffer.records[head % RingCapacity] = { start, end, nameId, depth };
+	buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::EndFrame() noexcept
+{
+	const std::uint64_t now = Now();
+	const std::uint64_t frameDuration = m_frameStart == 0 ? 0 : now - m_frameStart;
+	m_frameStart = now;
+
+	std::vector<ThreadFrame>& frame = m_building;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_drained.resize(m_threads.size());
+		frame.resize(m_threads.size());
+
+		for (size_t iii = 0; iii < m_threads.size(); ++iii)
+		{
+			ThreadBuffer& buffer = *m_threads[iii];
+			std::vector<ScopeRecord>& records = m_drained[iii];
+			records.clear();
+
+			const std::uint64_t tail = buffer.tail.load(std::memory_order_relaxed);
+			const std::uint64_t head = buffer.head.load(std::memory_order_acquire);
+			for (std::uint64_t jjj = tail; jjj < head; ++jjj)
+				records.push_back(buffer.records[jjj % RingCapacity]);
+			buffer.tail.store(head, std::memory_order_release);
+
+			m_dropped += buffer.dropped.exchange(0, std::memory_order_relaxed);
+			frame[iii].threadName = buffer.name;
+		}
+	}
+
+	if (m_captureFramesLeft > 0)
+	{
+		for (size_t iii = 0; iii < m_drained.size(); ++iii)
+		{
+			for (const ScopeRecord& record : m_drained[iii])
+				m_capture.push_back({ record, static_cast<std::uint32_t>(iii) });
+		}
+
+		if (--m_captureFramesLeft == 0)
+			WriteCapture();
+	}
+
+	if (m_paused)
+		return;
+
+	for (size_t iii = 0; iii < m_drained.size(); ++iii)
+	{
+		BuildTree(m_drained[iii], frame[iii]);
+		frame[iii].nodes[0].totalNs = frameDuration;
+	}
+
+	std::swap(m_lastFrame, m_building);
+	m_lastFrameDuration = frameDuration;
+}
+
+void Profiler::BuildTree(std::vector<ScopeRecord>& records, ThreadFrame& frame) noexcept
+{
+	frame.nodes.clear();
+	frame.nodes.emplace_back();
+
+	// Records are written when scopes close, so children come before their parents. Sorted by start time (and depth,
+	// for scopes that start on the same tick), every scope comes right after the scope that encloses it
+	std::sort(records.begin(), records.end(), [](const ScopeRecord& a, const ScopeRecord& b)
+		{
+			return a.start < b.start || (a.start == b.start && a.depth < b.depth);
+		});
+
+	// path[d] is the node of the currently open scope at depth d - 1 (path[0] is the root)
+	std::vector<std::uint32_t>& path = m_path;
+	path.assign(1, 0);
+	for (const ScopeRecord& record : records)
+	{
+		// Scopes that were opened in an earlier frame have lost their parents, so they hang off the deepest open node
+		const size_t depth = std::min<size_t>(record.depth, path.size() - 1);
+		path.resize(depth + 1);
+
+		const std::uint32_t parent = path.back();
+		std::uint32_t node = frame.nodes[parent].firstChild;
+		while (node != NoNode && frame.nodes[node].nameId != record.nameId)
+			node = frame.nodes[node].nextSibling;
+
+		if (node == NoNode)
+		{
+			node = static_cast<std::uint32_t>(frame.nodes.size());
+			frame.nodes.emplace_back().nameId = record.nameId;
+
+			FrameNode& parentNode = frame.nodes[parent];
+			if (parentNode.firstChild == NoNode)
+				parentNode.firstChild = node;
+			else
+				frame.nodes[parentNode.lastChild].nextSibling = node;
+			parentNode.lastChild = node;
+		}
+
+		++frame.nodes[node].count;
+		frame.nodes[node].totalNs += record.end - record.start;
+		path.push_back(node);
+	}
+}
+
+void Profiler::CaptureFrames(unsigned int frameCount, const std::filesystem::path& file) noexcept
+{
+	m_capture.clear();
+	m_captureFile = file;
+	m_captureFramesLeft = frameCount;
+}
+
+void Profiler::WriteCapture() noexcept
+{
+	if (m_capture.empty())
+	{
+		LOG_WARN("Profiler capture '{}' is empty - nothing was written", m_captureFile.string());
+		return;
+	}
+
+	std::uint64_t origin = std::numeric_limits<std::uint64_t>::max();
+	for (const CapturedRecord& captured : m_capture)
+		origin = std::min(origin, captured.record.start);
+
+	// Chrome's trace_event format: one complete ("X") event per scope, with microsecond timestamps, plus metadata
+	// events that name the threads
+	json events = json::array();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (size_t iii = 0; iii < m_threads.size(); ++iii)
+		{
+			events.push_back({ {"name", "thread_name"}, {"ph", "M"}, {"pid", 0}, {"tid", iii},
+				{"args", { {"name", m_threads[iii]->name} }} });
+		}
+		for (const CapturedRecord& captured : m_capture)
+		{
+			const ScopeRecord& record = captured.record;
+			events.push_back({
+				{"name", m_names[record.nameId]},
+				{"cat", "seethe"},
+				{"ph", "X"},
+				{"ts", static_cast<double>(record.start - origin) / 1000.0},
+				{"dur", static_cast<double>(record.end - record.start) / 1000.0},
+				{"pid", 0},
+				{"tid", captured.thread}
+			});
+		}
+	}
+
+	json trace;
+	trace["traceEvents"] = std::move(events);
+	trace["displayTimeUnit"] = "ms";
+
+	std::ofstream file(m_captureFile);
+	if (!file)
+	{
+		LOG_ERROR("Failed to open '{}' for writing the profiler capture", m_captureFile.string());
+		return;
+	}
+	file << trace.dump() << '\n';
+
+	LOG_INFO("Wrote {} profiler events to '{}'", m_capture.size(), m_captureFile.string());
+	m_capture.clear();
+}
+}
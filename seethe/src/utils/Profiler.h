@@ -0,0 +1,170 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+// Profiler is a low overhead hierarchical CPU profiler. Code is instrumented with PROFILE_SCOPE("name"), which
+// times the enclosing scope:
+//
+//   - Each name is interned once per call site (into a function local static), so a scope only carries a 32-bit id
+//   - When a scope closes, a single record (start, end, name id, nesting depth) is written into a ring buffer that
+//     belongs to the current thread. The rings are single producer/single consumer, so recording takes no locks. If
+//     a ring is full (the frame was never ended), the record is dropped and counted instead
+//   - Once per frame, PROFILE_END_FRAME() (on the main thread) drains every ring and rebuilds the per-thread scope
+//     tree for the frame that just ended. Scopes with the same name under the same parent are merged
+//   - CaptureFrames() also keeps the raw records for the next N frames and writes them out as a Chrome trace_event
+//     JSON file (open it with chrome://tracing or https://ui.perfetto.dev)
+//
+// Timestamps come from std::chrono::steady_clock (QueryPerformanceCounter on Windows) in nanoseconds.
+//
+// NOTE: All of the PROFILE_* macros compile to nothing unless ENABLE_PROFILING is defined (see the project's
+//       preprocessor definitions), so instrumentation can be left in place at no cost
+class Profiler
+{
+public:
+	static constexpr size_t RingCapacity = 8192;
+
+	struct ScopeRecord
+	{
+		std::uint64_t start;
+		std::uint64_t end;
+		std::uint32_t nameId;
+		std::uint32_t depth;
+	};
+
+	// Scope tree for one thread in one frame. nodes[0] is the root (the whole frame). Children are linked through
+	// firstChild/nextSibling (NoNode ends a list), so rebuilding the tree every frame reuses the same storage
+	static constexpr std::uint32_t NoNode = std::numeric_limits<std::uint32_t>::max();
+	struct FrameNode
+	{
+		std::uint32_t nameId = 0;
+		std::uint32_t count = 0;
+		std::uint64_t totalNs = 0;
+		std::uint32_t firstChild = NoNode;
+		std::uint32_t lastChild = NoNode;
+		std::uint32_t nextSibling = NoNode;
+	};
+	struct ThreadFrame
+	{
+		std::string threadName;
+		std::vector<FrameNode> nodes;		// Only the root if the thread recorded nothing this frame
+	};
+
+	ND static Profiler& Get() noexcept;
+	ND static std::uint64_t Now() noexcept
+	{
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	ND std::uint32_t Intern(std::string_view name) noexcept;
+	ND const std::string& GetName(std::uint32_t nameId) const noexcept;
+
+	// Names the calling thread in the UI and in traces (threads that never call this are "Thread N")
+	void SetThreadName(std::string_view name) noexcept;
+
+	void Record(std::uint32_t nameId, std::uint64_t start, std::uint64_t end, std::uint32_t depth) noexcept;
+	void EndFrame() noexcept;
+
+	// Records the next 'frameCount' frames and writes them to 'file' as a Chrome trace
+	void CaptureFrames(unsigned int frameCount, const std::filesystem::path& file) noexcept;
+	ND bool IsCapturing() const noexcept { return m_captureFramesLeft > 0; }
+
+	// While paused, the last frame's tree is kept as is (so it can be inspected in the UI)
+	void SetPaused(bool paused) noexcept { m_paused = paused; }
+	ND constexpr bool IsPaused() const noexcept { return m_paused; }
+
+	ND constexpr const std::vector<ThreadFrame>& GetLastFrame() const noexcept { return m_lastFrame; }
+	ND constexpr std::uint64_t GetLastFrameDurationNs() const noexcept { return m_lastFrameDuration; }
+	ND constexpr std::uint64_t GetDroppedCount() const noexcept { return m_dropped; }
+
+	// Depth of the calling thread's innermost open scope (used by ProfileScope)
+	ND static std::uint32_t& ThreadDepth() noexcept { return t_depth; }
+
+private:
+	Profiler() noexcept = default;
+	Profiler(const Profiler&) = delete;
+	Profiler(Profiler&&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+	Profiler& operator=(Profiler&&) = delete;
+
+	struct ThreadBuffer
+	{
+		std::string name;
+		std::array<ScopeRecord, RingCapacity> records;
+		std::atomic<std::uint64_t> head = 0;		// Only written by the owning thread
+		std::atomic<std::uint64_t> tail = 0;		// Only written by EndFrame()
+		std::atomic<std::uint64_t> dropped = 0;
+	};
+
+	ThreadBuffer& GetThreadBuffer() noexcept;
+	void BuildTree(std::vector<ScopeRecord>& records, ThreadFrame& frame) noexcept;
+	void WriteCapture() noexcept;
+
+	static thread_local ThreadBuffer* t_buffer;
+	static thread_local std::uint32_t t_depth;
+
+	mutable std::mutex m_mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+	std::unordered_map<std::string, std::uint32_t> m_nameIds;
+	std::deque<std::string> m_names;		// A deque, so references to names stay valid as more are interned
+
+	// All reused every frame, so that ending a frame does not allocate once every thread has been seen
+	std::vector<std::vector<ScopeRecord>> m_drained;		// One per thread
+	std::vector<ThreadFrame> m_building;
+	std::vector<ThreadFrame> m_lastFrame;
+	std::vector<std::uint32_t> m_path;
+	std::uint64_t m_frameStart = 0;
+	std::uint64_t m_lastFrameDuration = 0;
+	std::uint64_t m_dropped = 0;
+	bool m_paused = false;
+
+	struct CapturedRecord
+	{
+		ScopeRecord record;
+		std::uint32_t thread;
+	};
+	std::vector<CapturedRecord> m_capture;
+	std::filesystem::path m_captureFile;
+	unsigned int m_captureFramesLeft = 0;
+};
+
+// Times its own lifetime. Use PROFILE_SCOPE() rather than this directly, so that it compiles away when profiling is off
+class ProfileScope
+{
+public:
+	explicit ProfileScope(std::uint32_t nameId) noexcept :
+		m_nameId(nameId),
+		m_depth(Profiler::ThreadDepth()++),
+		m_start(Profiler::Now())
+	{}
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope(ProfileScope&&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+	ProfileScope& operator=(ProfileScope&&) = delete;
+	~ProfileScope() noexcept
+	{
+		const std::uint64_t end = Profiler::Now();
+		--Profiler::ThreadDepth();
+		Profiler::Get().Record(m_nameId, m_start, end, m_depth);
+	}
+
+private:
+	std::uint32_t m_nameId;
+	std::uint32_t m_depth;
+	std::uint64_t m_start;
+};
+}
+
+#ifdef ENABLE_PROFILING
+#define PROFILE_SCOPE(name) \
+	static const std::uint32_t CAT(_profileNameId, __LINE__) = seethe::Profiler::Get().Intern(name); \
+	seethe::ProfileScope CAT(_profileScope, __LINE__)(CAT(_profileNameId, __LINE__))
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_THREAD(name) seethe::Profiler::Get().SetThreadName(name)
+#define PROFILE_END_FRAME() seethe::Profiler::Get().EndFrame()
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD(name)
+#define PROFILE_END_FRAME()
+#endif
@@ -0,0 +1,167 @@
+#include "RadixSort.h"
+#include "Log.h"
+#include "ThreadPool.h"
+
+namespace seethe
+{
+void RadixSorter::Sort(std::span<std::uint32_t> keys, std::span<std::uint32_t> values, unsigned int keyBits) noexcept
+{
+	ASSERT(keys.size() == values.size(), "Keys and values must be the same size");
+	ASSERT(keyBits > 0 && keyBits <= 32, "Invalid key size");
+
+	m_lastPassCount = 0;
+
+	// Count how many keys are smaller than the one before them. Zero means there is nothing to do, and a handful
+	// means the input is still mostly in last frame's order
+	size_t descents = 0;
+	for (size_t iii = 1; iii < keys.size(); ++iii)
+		descents += keys[iii] < keys[iii - 1];
+
+	if (descents == 0)
+	{
+		m_lastStrategy = Strategy::ALREADY_SORTED;
+		return;
+	}
+
+	// NOTE: A single descent can still mean one element has to travel across the whole array, which is why the
+	//       insertion sort also has a budget on the total distance moved
+	if (descents <= keys.size() / 16 && InsertionSort(keys, values, keys.size() * InsertionMovesPerElement))
+	{
+		m_lastStrategy = Strategy::INSERTION;
+		return;
+	}
+
+	m_lastStrategy = Strategy::RADIX;
+	RadixSort(keys, values, keyBits);
+}
+
+bool RadixSorter::InsertionSort(std::span<std::uint32_t> keys, std::span<std::uint32_t> values, size_t moveBudget) noexcept
+{
+	// NOTE: If this gives up part way through, keys/values still hold a valid (partially sorted) permutation, so the
+	//       radix sort can simply pick up from there
+	size_t moves = 0;
+	for (size_t iii = 1; iii < keys.size(); ++iii)
+	{
+		const std::uint32_t key = keys[iii];
+		if (key >= keys[iii - 1])
+			continue;
+
+		const std::uint32_t value = values[iii];
+		size_t jjj = iii;
+		do
+		{
+			keys[jjj] = keys[jjj - 1];
+			values[jjj] = values[jjj - 1];
+			--jjj;
+		} while (jjj > 0 && keys[jjj - 1] > key);
+
+		keys[jjj] = key;
+		values[jjj] = value;
+
+		moves += iii - jjj;
+		if (moves > moveBudget)
+			return false;
+	}
+	return true;
+}
+
+void RadixSorter::Reserve(size_t count) noexcept
+{
+	if (m_keyScratch.size() < count)
+	{
+		m_keyScratch.resize(count);
+		m_valueScratch.resize(count);
+	}
+
+	const size_t blockCount = (count + BlockSize(count) - 1) / BlockSize(count);
+	if (m_histograms.size() < blockCount)
+		m_histograms.resize(blockCount);
+}
+
+size_t RadixSorter::BlockSize(size_t count) noexcept
+{
+	const size_t threadCount = ThreadPool::Get().GetThreadCount();
+	return std::max(MinimumBlockSize, (count + threadCount - 1) / threadCount);
+}
+
+void RadixSorter::RadixSort(std::span<std::uint32_t> keys, std::span<std::uint32_t> values, unsigned int keyBits) noexcept
+{
+	const size_t count = keys.size();
+	Reserve(count);
+
+	ThreadPool& pool = ThreadPool::Get();
+	const size_t blockSize = BlockSize(count);
+	const size_t blockCount = (count + blockSize - 1) / blockSize;
+
+	std::uint32_t* srcKeys = keys.data();
+	std::uint32_t* srcValues = values.data();
+	std::uint32_t* dstKeys = m_keyScratch.data();
+	std::uint32_t* dstValues = m_valueScratch.data();
+
+	for (unsigned int shift = 0; shift < keyBits; shift += DigitBits)
+	{
+		// Histogram each block
+		pool.ParallelFor(blockCount, 1, [&](size_t begin, size_t end)
+			{
+				for (size_t block = begin; block < end; ++block)
+				{
+					std::array<std::uint32_t, BucketCount>& histogram = m_histograms[block];
+					histogram.fill(0);
+
+					const size_t last = std::min(count, (block + 1) * blockSize);
+					for (size_t iii = block * blockSize; iii < last; ++iii)
+						++histogram[(srcKeys[iii] >> shift) & (BucketCount - 1)];
+				}
+			}
+		);
+
+		// Turn the histograms into output offsets: bucket by bucket, and within a bucket block by block, which is
+		// what keeps the sort stable. If every key has the same digit, this pass would not move anything
+		std::uint32_t offset = 0;
+		bool allSameDigit = false;
+		for (size_t bucket = 0; bucket < BucketCount; ++bucket)
+		{
+			std::uint32_t bucketCount = 0;
+			for (size_t block = 0; block < blockCount; ++block)
+			{
+				const std::uint32_t n = m_histograms[block][bucket];
+				m_histograms[block][bucket] = offset;
+				offset += n;
+				bucketCount += n;
+			}
+			allSameDigit |= bucketCount == count;
+		}
+
+		if (allSameDigit)
+			continue;
+
+		pool.ParallelFor(blockCount, 1, [&](size_t begin, size_t end)
+			{
+				for (size_t block = begin; block < end; ++block)
+				{
+					std::array<std::uint32_t, BucketCount>& offsets = m_histograms[block];
+
+					const size_t last = std::min(count, (block + 1) * blockSize);
+					for (size_t iii = block * blockSize; iii < last; ++iii)
+					{
+						const std::uint32_t position = offsets[(srcKeys[iii] >> shift) & (BucketCount - 1)]++;
+						dstKeys[position] = srcKeys[iii];
+						dstValues[position] = srcValues[iii];
+					}
+				}
+			}
+		);
+
+		std::swap(srcKeys, dstKeys);
+		std::swap(srcValues, dstValues);
+		++m_lastPassCount;
+	}
+
+	// After an odd number of passes the result is sitting in the scratch buffers
+	if (srcKeys != keys.data())
+	{
+		memcpy(keys.data(), srcKeys, count * sizeof(std::uint32_t));
+		memcpy(values.data(), srcValues, count * sizeof(std::uint32_t));
+	}
+}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+// RadixSorter sorts (key, value) pairs by key, ascending and stable. It is meant for data that is re-sorted every
+// frame (i.e. instances sorted by quantized depth), so it is built to take advantage of the input already being in
+// (roughly) last frame's order:
+//
+//   1. If the keys are already sorted, nothing is done beyond a single scan
+//   2. If only a few keys are out of place, an insertion sort fixes them up. This is linear in the number of elements
+//      plus the distance each one has to move, and it gives up (falling through to 3) once that exceeds a budget
+//   3. Otherwise an LSD radix sort with 8 bit digits is used. The input is split into blocks that are histogrammed and
+//      scattered in parallel on the shared ThreadPool, and digits that are the same for every key are skipped
+//
+// 'keyBits' is how many low bits the keys use, so 16 bit keys only take (at most) two passes. The keys must be zero
+// above that: the last radix pass still uses a full 8 bit digit, and steps 1 and 2 compare whole keys.
+//
+// NOTE: The scratch buffers are kept between calls, so steady state sorting does not allocate
+class RadixSorter
+{
+public:
+	enum class Strategy
+	{
+		NONE,
+		ALREADY_SORTED,
+		INSERTION,
+		RADIX
+	};
+
+	static constexpr unsigned int DigitBits = 8;
+	static constexpr size_t BucketCount = size_t{ 1 } << DigitBits;
+
+	// Each parallel block gets at least this many elements - below that the thread handoff costs more than it saves
+	static constexpr size_t MinimumBlockSize = 16384;
+
+	// The insertion sort is abandoned once the elements have been moved this many positions per element (in total)
+	static constexpr size_t InsertionMovesPerElement = 4;
+
+	RadixSorter() noexcept = default;
+	RadixSorter(const RadixSorter&) noexcept = default;
+	RadixSorter(RadixSorter&&) noexcept = default;
+	RadixSorter& operator=(const RadixSorter&) noexcept = default;
+	RadixSorter& operator=(RadixSorter&&) noexcept = default;
+	~RadixSorter() noexcept = default;
+
+	// Sorts 'keys' and applies the same permutation to 'values' (which must be the same size). Every key must be less
+	// than 2^keyBits
+	void Sort(std::span<std::uint32_t> keys, std::span<std::uint32_t> values, unsigned int keyBits = 32) noexcept;
+
+	// Grows the scratch buffers to fit 'count' elements, so that sorting up to that many does not allocate even the
+	// first time
+	void Reserve(size_t count) noexcept;
+
+	// How the most recent Sort() was done (for the benchmark/stats)
+	ND constexpr Strategy GetLastStrategy() const noexcept { return m_lastStrategy; }
+	ND constexpr unsigned int GetLastPassCount() const noexcept { return m_lastPassCount; }
+
+private:
+	ND static size_t BlockSize(size_t count) noexcept;
+	ND static bool InsertionSort(std::span<std::uint32_t> keys, std::span<std::uint32_t> values, size_t moveBudget) noexcept;
+	void RadixSort(std::span<std::uint32_t> keys, std::span<std::uint32_t> values, unsigned int keyBits) noexcept;
+
+	std::vector<std::uint32_t> m_keyScratch;
+	std::vector<std::uint32_t> m_valueScratch;
+
+	// One histogram per block. The scatter pass turns each one into that block's output offsets
+	std::vector<std::array<std::uint32_t, BucketCount>> m_histograms;
+
+	Strategy m_lastStrategy = Strategy::NONE;
+	unsigned int m_lastPassCount = 0;
+};
+}
@@ -0,0 +1,132 @@
+#include "RadixSortBenchmark.h"
+#include "Benchmark.h"
+#include "Log.h"
+#include "RadixSort.h"
+#include "ThreadPool.h"
+
+namespace seethe
+{
+namespace
+{
+enum class InputOrder
+{
+	RANDOM,
+	NEARLY_SORTED,
+	SORTED
+};
+
+constexpr std::string_view ToString(InputOrder order) noexcept
+{
+	switch (order)
+	{
+	case InputOrder::RANDOM:		return "random";
+	case InputOrder::NEARLY_SORTED:	return "nearly sorted";
+	case InputOrder::SORTED:		return "sorted";
+	}
+	return "unknown";
+}
+
+constexpr std::string_view ToString(RadixSorter::Strategy strategy) noexcept
+{
+	switch (strategy)
+	{
+	case RadixSorter::Strategy::NONE:			return "none";
+	case RadixSorter::Strategy::ALREADY_SORTED:	return "already sorted";
+	case RadixSorter::Strategy::INSERTION:		return "insertion";
+	case RadixSorter::Strategy::RADIX:			return "radix";
+	}
+	return "unknown";
+}
+
+// 16 bit keys, like the quantized depths. "Nearly sorted" nudges a sorted sequence the way a small camera move does:
+// most keys keep their place and a few percent move a short distance
+std::vector<std::uint32_t> MakeKeys(size_t count, InputOrder order, std::mt19937& rng)
+{
+	std::uniform_int_distribution<std::uint32_t> keyDist(0, 0xFFFF);
+	std::vector<std::uint32_t> keys(count);
+	for (std::uint32_t& key : keys)
+		key = keyDist(rng);
+
+	if (order == InputOrder::RANDOM)
+		return keys;
+
+	std::sort(keys.begin(), keys.end());
+
+	if (order == InputOrder::NEARLY_SORTED)
+	{
+		std::uniform_int_distribution<size_t> indexDist(0, count - 1);
+		std::uniform_int_distribution<int> deltaDist(-64, 64);
+		for (size_t iii = 0; iii < count / 50; ++iii)
+		{
+			std::uint32_t& key = keys[indexDist(rng)];
+			key = static_cast<std::uint32_t>(std::clamp(static_cast<int>(key) + deltaDist(rng), 0, 0xFFFF));
+		}
+	}
+	return keys;
+}
+}
+
+void BenchmarkRadixSort(BenchmarkSuite& suite) noexcept
+{
+	constexpr std::array<size_t, 4> counts = { 10'000, 100'000, 1'000'000, 4'000'000 };
+	constexpr std::array<InputOrder, 3> orders = { InputOrder::RANDOM, InputOrder::NEARLY_SORTED, InputOrder::SORTED };
+
+	std::mt19937 rng = BenchmarkSuite::MakeRng();
+	RadixSorter sorter;
+
+	for (size_t count : counts)
+	{
+		for (InputOrder order : orders)
+		{
+			// NOTE: Generate the inputs even if the benchmark is filtered out, so the inputs of the ones after it do not change
+			const std::string radixName = std::format("RadixSorter::Sort ({})/{}", ToString(order), count);
+			const std::string stdName = std::format("std::stable_sort ({})/{}", ToString(order), count);
+			const std::vector<std::uint32_t> inputKeys = MakeKeys(count, order, rng);
+			if (!suite.Matches(radixName) && !suite.Matches(stdName))
+				continue;
+
+			std::vector<std::uint32_t> inputValues(count);
+			std::iota(inputValues.begin(), inputValues.end(), 0u);
+
+			std::vector<std::uint32_t> keys;
+			std::vector<std::uint32_t> values;
+			suite.Run(radixName, count,
+				[&]() { keys = inputKeys; values = inputValues; },
+				[&]() { sorter.Sort(keys, values, 16); }
+			);
+
+			if (suite.Matches(radixName))
+			{
+				if (!std::is_sorted(keys.begin(), keys.end()))
+					LOG_ERROR("RadixSorter produced unsorted output (count = {}, input = {})", count, ToString(order));
+				LOG_INFO("    {}, {} passes", ToString(sorter.GetLastStrategy()), sorter.GetLastPassCount());
+			}
+
+			std::vector<std::pair<std::uint32_t, std::uint32_t>> pairs(count);
+			suite.Run(stdName, count,
+				[&]()
+				{
+					for (size_t iii = 0; iii < count; ++iii)
+						pairs[iii] = { inputKeys[iii], inputValues[iii] };
+				},
+				[&]() { std::stable_sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) { return a.first < b.first; }); }
+			);
+		}
+	}
+}
+
+int RunRadixSortBenchmarks(std::string_view filter, const std::filesystem::path& outputPath) noexcept
+{
+	LOG_INFO("Running RadixSorter benchmarks matching '{}' ({} threads, seed {})", filter, ThreadPool::Get().GetThreadCount(), BenchmarkSuite::Seed);
+
+	BenchmarkSuite suite(filter);
+	BenchmarkRadixSort(suite);
+
+	if (suite.GetResults().empty())
+	{
+		LOG_ERROR("No RadixSorter benchmark matches '{}'", filter);
+		return 1;
+	}
+	return suite.WriteJson(outputPath) ? 0 : 1;
+}
+}
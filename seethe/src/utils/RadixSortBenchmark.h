@@ -0,0 +1,17 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+class BenchmarkSuite;
+
+// Times RadixSorter against std::stable_sort for a few element counts and input orders (random, nearly sorted as
+// when the camera moves slowly, and already sorted). The benchmarks are part of the --benchmark suite, and
+//     --benchmark-radix-sort [filter] [--benchmark-out <path>]
+// runs only these
+void BenchmarkRadixSort(BenchmarkSuite& suite) noexcept;
+
+// Runs the RadixSorter benchmarks whose name contains 'filter' and writes the results as JSON to 'outputPath'. Returns
+// the process exit code
+ND int RunRadixSortBenchmarks(std::string_view filter, const std::filesystem::path& outputPath) noexcept;
+}
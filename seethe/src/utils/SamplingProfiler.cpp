@@ -0,0 +1,514 @@
+#include "SamplingProfiler.h"
+#include "utils/Log.h"
+
+#include <map>
+
+#if defined(_WIN32)
+#include <DbgHelp.h>
+#include <TlHelp32.h>
+#pragma comment(lib, "dbghelp.lib")
+#elif defined(__linux__)
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <ucontext.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace seethe
+{
+namespace
+{
+// The profiler that is sampling right now (read by the signal handler/sampler thread, so it never has to call Get())
+std::atomic<SamplingProfiler*> s_active = nullptr;
+
+#if defined(_WIN32)
+#if defined(_M_X64)
+// Walks the stack of a suspended thread. Only reads memory and the unwind tables - the thread may hold any lock
+// (including the heap's), so this must not allocate
+size_t Unwind(CONTEXT& context, std::uintptr_t* frames) noexcept
+{
+	size_t depth = 0;
+	while (depth < SamplingProfiler::MaxDepth && context.Rip != 0)
+	{
+		frames[depth++] = static_cast<std::uintptr_t>(context.Rip);
+
+		DWORD64 imageBase = 0;
+		PRUNTIME_FUNCTION function = RtlLookupFunctionEntry(context.Rip, &imageBase, nullptr);
+		if (function == nullptr)
+		{
+			// A leaf function has no unwind data and does not touch rsp, so the return address is on top of the stack
+			context.Rip = *reinterpret_cast<const DWORD64*>(context.Rsp);
+			context.Rsp += sizeof(DWORD64);
+		}
+		else
+		{
+			void* handlerData = nullptr;
+			DWORD64 establisherFrame = 0;
+			RtlVirtualUnwind(UNW_FLAG_NHANDLER, imageBase, context.Rip, function, &context, &handlerData, &establisherFrame, nullptr);
+		}
+	}
+	return depth;
+}
+
+void SamplerLoop(std::chrono::microseconds interval, const std::atomic<bool>& stop) noexcept
+{
+	struct SampledThread
+	{
+		DWORD id;
+		HANDLE handle;
+		ULONG64 cycles;
+	};
+	std::vector<SampledThread> threads;
+	const DWORD processId = GetCurrentProcessId();
+	const DWORD samplerId = GetCurrentThreadId();
+
+	// Picks up threads that started since the last refresh (and lets go of the ones that exited)
+	auto RefreshThreads = [&]()
+		{
+			HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+			if (snapshot == INVALID_HANDLE_VALUE)
+				return;
+
+			std::vector<SampledThread> current;
+			THREADENTRY32 entry = {};
+			entry.dwSize = sizeof(entry);
+			for (BOOL found = Thread32First(snapshot, &entry); found; found = Thread32Next(snapshot, &entry))
+			{
+				if (entry.th32OwnerProcessID != processId || entry.th32ThreadID == samplerId)
+					continue;
+
+				auto existing = std::ranges::find(threads, entry.th32ThreadID, &SampledThread::id);
+				if (existing != threads.end())
+				{
+					current.push_back(*existing);
+					existing->handle = nullptr;
+					continue;
+				}
+
+				HANDLE handle = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_LIMITED_INFORMATION, FALSE, entry.th32ThreadID);
+				if (handle != nullptr)
+					current.push_back({ entry.th32ThreadID, handle, 0 });
+			}
+			CloseHandle(snapshot);
+
+			for (const SampledThread& thread : threads)
+			{
+				if (thread.handle != nullptr)
+					CloseHandle(thread.handle);
+			}
+			threads = std::move(current);
+		};
+
+	// Sleep() only has the resolution of the system timer (15.6 ms by default), so wait on a high resolution timer
+	HANDLE timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+
+	std::array<std::uintptr_t, SamplingProfiler::MaxDepth> frames;
+	for (unsigned int sweep = 0; !stop.load(std::memory_order_relaxed); ++sweep)
+	{
+		if (sweep % 256 == 0)
+			RefreshThreads();
+
+		for (SampledThread& thread : threads)
+		{
+			// Only threads that ran since the last sample, so the profile is of CPU time like on Linux
+			ULONG64 cycles = 0;
+			if (!QueryThreadCycleTime(thread.handle, &cycles) || cycles == thread.cycles)
+				continue;
+			thread.cycles = cycles;
+
+			if (SuspendThread(thread.handle) == static_cast<DWORD>(-1))
+				continue;
+
+			CONTEXT context = {};
+			context.ContextFlags = CONTEXT_CONTROL | CONTEXT_INTEGER;
+			const size_t depth = GetThreadContext(thread.handle, &context) ? Unwind(context, frames.data()) : 0;
+			ResumeThread(thread.handle);
+
+			if (SamplingProfiler* profiler = s_active.load(std::memory_order_acquire))
+				profiler->Record(frames.data(), depth);
+		}
+
+		if (timer != nullptr)
+		{
+			LARGE_INTEGER dueTime = {};
+			dueTime.QuadPart = -static_cast<LONGLONG>(interval.count()) * 10;	// Relative, in 100 ns units
+			SetWaitableTimer(timer, &dueTime, 0, nullptr, nullptr, FALSE);
+			WaitForSingleObject(timer, INFINITE);
+		}
+		else
+		{
+			Sleep(1);
+		}
+	}
+
+	for (const SampledThread& thread : threads)
+		CloseHandle(thread.handle);
+	if (timer != nullptr)
+		CloseHandle(timer);
+}
+#endif
+
+class Symbolizer
+{
+public:
+	Symbolizer() noexcept : m_process(GetCurrentProcess())
+	{
+		SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS);
+		m_initialized = SymInitialize(m_process, nullptr, TRUE) == TRUE;
+	}
+	Symbolizer(const Symbolizer&) = delete;
+	Symbolizer(Symbolizer&&) = delete;
+	Symbolizer& operator=(const Symbolizer&) = delete;
+	Symbolizer& operator=(Symbolizer&&) = delete;
+	~Symbolizer() noexcept
+	{
+		if (m_initialized)
+			SymCleanup(m_process);
+	}
+
+	ND std::string Name(std::uintptr_t address) const noexcept
+	{
+		if (m_initialized)
+		{
+			alignas(SYMBOL_INFO) std::array<char, sizeof(SYMBOL_INFO) + MAX_SYM_NAME> storage = {};
+			SYMBOL_INFO* symbol = reinterpret_cast<SYMBOL_INFO*>(storage.data());
+			symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+			symbol->MaxNameLen = MAX_SYM_NAME;
+
+			DWORD64 displacement = 0;
+			if (SymFromAddr(m_process, address, &displacement, symbol))
+				return std::string(symbol->Name, symbol->NameLen);
+
+			IMAGEHLP_MODULE64 module = {};
+			module.SizeOfStruct = sizeof(module);
+			if (SymGetModuleInfo64(m_process, address, &module))
+				return std::format("{}+0x{:x}", module.ModuleName, address - module.BaseOfImage);
+		}
+		return std::format("0x{:x}", address);
+	}
+
+private:
+	HANDLE m_process;
+	bool m_initialized = false;
+};
+
+#elif defined(__linux__)
+// The calling thread's stack as [low, high), set by RegisterThread() and 0 until then. Read by the signal handler,
+// which is fine because it is trivially constructed (no lazy initialization) and seethe-core is linked statically
+// (so accessing it never allocates)
+struct StackBounds
+{
+	std::uintptr_t low;
+	std::uintptr_t high;
+};
+thread_local StackBounds t_stackBounds = {};
+
+#if defined(__x86_64__)
+void OnSigProf(int, siginfo_t*, void* ucontext) noexcept
+{
+	SamplingProfiler* profiler = s_active.load(std::memory_order_acquire);
+	if (profiler == nullptr)
+		return;
+
+	const int savedErrno = errno;
+	const mcontext_t& context = static_cast<const ucontext_t*>(ucontext)->uc_mcontext;
+
+	std::array<std::uintptr_t, SamplingProfiler::MaxDepth> frames;
+	size_t depth = 0;
+	frames[depth++] = static_cast<std::uintptr_t>(context.gregs[REG_RIP]);
+
+	// Each frame starts with the caller's frame pointer, followed by the return address. Anything outside the part of
+	// the stack that is in use is not a frame pointer (the code was built without them, or was in its prologue or
+	// epilogue), and reading it could fault. If the thread never registered, or is running on some other stack (i.e.
+	// a sigaltstack), there are no bounds to check against, so only the interrupted function is recorded
+	const StackBounds bounds = t_stackBounds;
+	const std::uintptr_t stackPointer = static_cast<std::uintptr_t>(context.gregs[REG_RSP]);
+	const bool onStack = stackPointer >= bounds.low && stackPointer < bounds.high;
+	std::uintptr_t framePointer = static_cast<std::uintptr_t>(context.gregs[REG_RBP]);
+	while (onStack && depth < SamplingProfiler::MaxDepth)
+	{
+		if (framePointer < stackPointer || framePointer > bounds.high - 2 * sizeof(std::uintptr_t) || framePointer % alignof(std::uintptr_t) != 0)
+			break;
+
+		const std::uintptr_t* frame = reinterpret_cast<const std::uintptr_t*>(framePointer);
+		if (frame[1] == 0)
+			break;
+		frames[depth++] = frame[1];
+
+		// The chain only ever goes up the stack
+		if (frame[0] <= framePointer)
+			break;
+		framePointer = frame[0];
+	}
+
+	profiler->Record(frames.data(), depth);
+	errno = savedErrno;
+}
+#endif
+
+class Symbolizer
+{
+public:
+	ND std::string Name(std::uintptr_t address) const noexcept
+	{
+		Dl_info info = {};
+		if (dladdr(reinterpret_cast<void*>(address), &info) == 0)
+			return std::format("0x{:x}", address);
+
+		if (info.dli_sname != nullptr)
+		{
+			int status = 0;
+			char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+			std::string name = status == 0 && demangled != nullptr ? demangled : info.dli_sname;
+			std::free(demangled);
+			return name;
+		}
+
+		// No symbol (e.g. a static function, or an executable linked without -rdynamic)
+		const std::string module = info.dli_fname != nullptr ? std::filesystem::path(info.dli_fname).filename().string() : "?";
+		return std::format("{}+0x{:x}", module, address - reinterpret_cast<std::uintptr_t>(info.dli_fbase));
+	}
+};
+
+#else
+class Symbolizer
+{
+public:
+	ND std::string Name(std::uintptr_t address) const noexcept { return std::format("0x{:x}", address); }
+};
+#endif
+}
+
+SamplingProfiler::~SamplingProfiler() noexcept
+{
+	Stop();
+}
+
+SamplingProfiler& SamplingProfiler::Get() noexcept
+{
+	static SamplingProfiler profiler;
+	return profiler;
+}
+
+bool SamplingProfiler::Start(std::chrono::microseconds interval) noexcept
+{
+	if (m_running)
+		return true;
+
+	RegisterThread();
+
+	if (m_buffer == nullptr)
+		m_buffer = std::make_unique<std::uintptr_t[]>(BufferCapacity);
+	else
+		std::fill_n(m_buffer.get(), BufferCapacity, std::uintptr_t{ 0 });
+	m_used = 0;
+	m_sampleCount = 0;
+	m_dropped = 0;
+
+	s_active.store(this, std::memory_order_release);
+	m_running = StartPlatform(std::max(interval, std::chrono::microseconds{ 100 }));
+	if (!m_running)
+	{
+		s_active.store(nullptr, std::memory_order_release);
+		LOG_WARN("Sampling profiler is not available: {}", m_unavailableReason);
+		return false;
+	}
+
+	LOG_INFO("Sampling profiler started ({} us interval)", interval.count());
+	return true;
+}
+
+void SamplingProfiler::Stop() noexcept
+{
+	if (!m_running)
+		return;
+
+	StopPlatform();
+	s_active.store(nullptr, std::memory_order_release);
+	m_running = false;
+}
+
+void SamplingProfiler::RegisterThread() noexcept
+{
+#if defined(__linux__)
+	if (t_stackBounds.high != 0)
+		return;
+
+	// NOTE: For the main thread this reads /proc/self/maps, which is why it is looked up here and not in the handler
+	pthread_attr_t attributes;
+	if (pthread_getattr_np(pthread_self(), &attributes) != 0)
+		return;
+
+	void* stack = nullptr;
+	size_t size = 0;
+	if (pthread_attr_getstack(&attributes, &stack, &size) == 0)
+	{
+		// A signal can land in between, so 'high' is set last: until then the handler sees an empty range
+		t_stackBounds.low = reinterpret_cast<std::uintptr_t>(stack);
+		std::atomic_signal_fence(std::memory_order_release);
+		t_stackBounds.high = t_stackBounds.low + size;
+	}
+	pthread_attr_destroy(&attributes);
+#endif
+}
+
+void SamplingProfiler::Record(const std::uintptr_t* frames, size_t depth) noexcept
+{
+	depth = std::min(depth, MaxDepth);
+	if (depth == 0)
+		return;
+
+	// Claim the header and the frames in one go. A sample that does not fit leaves its header at 0, which ends the
+	// reader's walk (everything claimed after it does not fit either)
+	const size_t start = m_used.fetch_add(depth + 1, std::memory_order_relaxed);
+	if (start + depth + 1 > BufferCapacity)
+	{
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	std::atomic_ref<std::uintptr_t> header(m_buffer[start]);
+	header.store(depth, std::memory_order_relaxed);
+	std::copy_n(frames, depth, m_buffer.get() + start + 1);
+	header.store(depth | CompleteBit, std::memory_order_release);
+	m_sampleCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool SamplingProfiler::WriteCollapsedStacks(const std::filesystem::path& path) const noexcept
+{
+	ASSERT(!m_running, "Stop the sampling profiler before writing its samples");
+
+	// Identical stacks are merged, and std::map keeps the output sorted (which is what flamegraph.pl expects)
+	Symbolizer symbolizer;
+	std::unordered_map<std::uintptr_t, std::string> names;
+	std::map<std::string, std::uint64_t> stacks;
+
+	const size_t used = m_buffer != nullptr ? std::min(m_used.load(std::memory_order_acquire), BufferCapacity) : 0;
+	std::string stack;
+	for (size_t offset = 0; offset < used;)
+	{
+		const std::uintptr_t header = std::atomic_ref<std::uintptr_t>(m_buffer[offset]).load(std::memory_order_acquire);
+		const size_t depth = static_cast<size_t>(header & ~CompleteBit);
+		if (depth == 0 || offset + 1 + depth > used)
+			break;
+
+		// A sample that was still being written when the profiler stopped is skipped
+		if ((header & CompleteBit) != 0)
+		{
+			stack.clear();
+			for (size_t iii = depth; iii-- > 0;)
+			{
+				// Every frame but the innermost is a return address, which points just past the call
+				const std::uintptr_t address = m_buffer[offset + 1 + iii] - (iii > 0 ? 1 : 0);
+				auto [it, inserted] = names.try_emplace(address);
+				if (inserted)
+				{
+					it->second = symbolizer.Name(address);
+					std::ranges::replace(it->second, ';', ':');
+				}
+
+				if (!stack.empty())
+					stack += ';';
+				stack += it->second;
+			}
+			++stacks[stack];
+		}
+		offset += 1 + depth;
+	}
+
+	std::ofstream file(path);
+	if (!file.is_open())
+	{
+		LOG_ERROR("Failed to open sampling profile output file '{}'", path.string());
+		return false;
+	}
+	for (const auto& [collapsed, count] : stacks)
+		file << collapsed << ' ' << count << '\n';
+
+	LOG_INFO("Sampling profile ({} samples, {} dropped) written to '{}'", GetSampleCount(), GetDroppedCount(), path.string());
+	return true;
+}
+
+#if defined(_WIN32)
+bool SamplingProfiler::StartPlatform(std::chrono::microseconds interval) noexcept
+{
+#if defined(_M_X64)
+	m_stopSampler = false;
+	m_sampler = std::thread([this, interval]() { SamplerLoop(interval, m_stopSampler); });
+	return true;
+#else
+	m_unavailableReason = "Stack sampling is only implemented for x64";
+	return false;
+#endif
+}
+void SamplingProfiler::StopPlatform() noexcept
+{
+	m_stopSampler = true;
+	if (m_sampler.joinable())
+		m_sampler.join();
+}
+
+#elif defined(__linux__)
+bool SamplingProfiler::StartPlatform(std::chrono::microseconds interval) noexcept
+{
+#if defined(__x86_64__)
+	struct sigaction action = {};
+	action.sa_sigaction = &OnSigProf;
+	action.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	if (sigaction(SIGPROF, &action, nullptr) != 0)
+	{
+		m_unavailableReason = std::format("sigaction(SIGPROF) failed: {}", std::strerror(errno));
+		return false;
+	}
+
+	// CPU time of the whole process, so the signal lands on whichever thread is running when the timer expires
+	sigevent event = {};
+	event.sigev_notify = SIGEV_SIGNAL;
+	event.sigev_signo = SIGPROF;
+	timer_t timer = {};
+	if (timer_create(CLOCK_PROCESS_CPUTIME_ID, &event, &timer) != 0)
+	{
+		m_unavailableReason = std::format("timer_create failed: {}", std::strerror(errno));
+		signal(SIGPROF, SIG_IGN);
+		return false;
+	}
+
+	itimerspec spec = {};
+	spec.it_interval.tv_sec = static_cast<time_t>(interval.count() / 1'000'000);
+	spec.it_interval.tv_nsec = static_cast<long>(interval.count() % 1'000'000 * 1'000);
+	spec.it_value = spec.it_interval;
+	timer_settime(timer, 0, &spec, nullptr);
+
+	m_timer = timer;
+	return true;
+#else
+	(void)interval;
+	m_unavailableReason = "Stack sampling is only implemented for x86-64";
+	return false;
+#endif
+}
+void SamplingProfiler::StopPlatform() noexcept
+{
+	timer_delete(static_cast<timer_t>(m_timer));
+	m_timer = nullptr;
+
+	// NOTE: Not the default action - a SIGPROF that is already pending would terminate the process
+	signal(SIGPROF, SIG_IGN);
+}
+
+#else
+bool SamplingProfiler::StartPlatform(std::chrono::microseconds) noexcept
+{
+	m_unavailableReason = "Stack sampling is only implemented for Windows and Linux";
+	return false;
+}
+void SamplingProfiler::StopPlatform() noexcept
+{
+}
+#endif
+}
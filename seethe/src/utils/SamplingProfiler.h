@@ -0,0 +1,109 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+// SamplingProfiler is a statistical CPU profiler for finding the hotspots that PROFILE_SCOPE() instrumentation does not
+// cover. While it is running, the call stack of whatever the process is doing is captured about once per 'interval'
+// of CPU time and appended to a preallocated, lock-free buffer:
+//
+//   - Linux (x86-64): a timer_create(CLOCK_PROCESS_CPUTIME_ID) timer raises SIGPROF in the thread that is using the
+//     CPU, and the signal handler walks the frame pointer chain from the interrupted context. Build with
+//     -fno-omit-frame-pointer (and -rdynamic so the executable's own functions get names), otherwise the stacks end
+//     early. The CMake build does both. The walk never leaves the stack of the interrupted thread, whose bounds are
+//     looked up once by RegisterThread(). A thread that never registered only gets the function it was in
+//   - Windows (x64): a sampler thread suspends each thread that used CPU time since the last sample, reads its context
+//     and unwinds it with RtlVirtualUnwind() (the x64 unwind data is always there, so no frame pointers are needed)
+//
+// Recording only stores raw return addresses. They are symbolized (dladdr() / DbgHelp) after the run, when the
+// samples are written out as collapsed stacks ("root;caller;callee count" per line) for flamegraph.pl or
+// https://www.speedscope.app. If the buffer fills up, further samples are dropped and counted.
+//
+// NOTE: Start()/Stop()/WriteCollapsedStacks() are meant to be called from one thread (the main thread). On other
+//       platforms Start() simply fails and GetUnavailableReason() says why
+class SamplingProfiler
+{
+public:
+	static constexpr size_t MaxDepth = 128;
+
+	// Size of the sample buffer, in stack frames (plus one header per sample). 32 MB on 64-bit
+	static constexpr size_t BufferCapacity = size_t{ 1 } << 22;
+
+	SamplingProfiler() noexcept = default;
+	SamplingProfiler(const SamplingProfiler&) = delete;
+	SamplingProfiler(SamplingProfiler&&) = delete;
+	SamplingProfiler& operator=(const SamplingProfiler&) = delete;
+	SamplingProfiler& operator=(SamplingProfiler&&) = delete;
+	~SamplingProfiler() noexcept;
+
+	ND static SamplingProfiler& Get() noexcept;
+
+	// Discards the previous samples and starts sampling. Returns false if sampling is not available
+	bool Start(std::chrono::microseconds interval = std::chrono::microseconds{ 1'000 }) noexcept;
+
+	// Stops sampling. The samples are kept until the next Start()
+	void Stop() noexcept;
+
+	ND constexpr bool IsRunning() const noexcept { return m_running; }
+	ND constexpr const std::string& GetUnavailableReason() const noexcept { return m_unavailableReason; }
+	ND size_t GetSampleCount() const noexcept { return m_sampleCount.load(std::memory_order_relaxed); }
+	ND std::uint64_t GetDroppedCount() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+
+	// Symbolizes the samples taken so far and writes them as collapsed stacks. Must not be called while running
+	bool WriteCollapsedStacks(const std::filesystem::path& path) const noexcept;
+
+	// Makes the calling thread's callers show up in its samples (see above). Start() registers the thread it is called
+	// from, and the ThreadPool workers register themselves. Does nothing on Windows, which does not need it
+	static void RegisterThread() noexcept;
+
+	// Appends one stack (frames[0] is the innermost) to the buffer. Async-signal-safe: no locks and no allocations
+	void Record(const std::uintptr_t* frames, size_t depth) noexcept;
+
+private:
+	ND bool StartPlatform(std::chrono::microseconds interval) noexcept;
+	void StopPlatform() noexcept;
+
+	// Each sample is a header (its depth, with CompleteBit set once the frames are written) followed by its frames
+	static constexpr std::uintptr_t CompleteBit = std::uintptr_t{ 1 } << (sizeof(std::uintptr_t) * 8 - 1);
+	std::unique_ptr<std::uintptr_t[]> m_buffer = nullptr;
+	std::atomic<size_t> m_used = 0;
+	std::atomic<size_t> m_sampleCount = 0;
+	std::atomic<std::uint64_t> m_dropped = 0;
+
+	bool m_running = false;
+	std::string m_unavailableReason;
+
+#if defined(_WIN32)
+	std::thread m_sampler;
+	std::atomic<bool> m_stopSampler = false;
+#elif defined(__linux__)
+	void* m_timer = nullptr;	// timer_t
+#endif
+};
+
+// Samples from construction until destruction, then writes the collapsed stacks to 'path' (used for --sample-profile)
+class ScopedSamplingProfile
+{
+public:
+	ScopedSamplingProfile(std::filesystem::path path) noexcept : m_path(std::move(path))
+	{
+		SamplingProfiler::Get().Start();
+	}
+	ScopedSamplingProfile(const ScopedSamplingProfile&) = delete;
+	ScopedSamplingProfile(ScopedSamplingProfile&&) = delete;
+	ScopedSamplingProfile& operator=(const ScopedSamplingProfile&) = delete;
+	ScopedSamplingProfile& operator=(ScopedSamplingProfile&&) = delete;
+	~ScopedSamplingProfile() noexcept
+	{
+		SamplingProfiler& profiler = SamplingProfiler::Get();
+		if (profiler.IsRunning())
+		{
+			profiler.Stop();
+			profiler.WriteCollapsedStacks(m_path);
+		}
+	}
+
+private:
+	std::filesystem::path m_path;
+};
+}
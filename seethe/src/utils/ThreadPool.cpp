@@ -0,0 +1,135 @@
+#include "ThreadPool.h"
+#include "utils/AllocationTracker.h"
+#include "utils/PerfCounters.h"
+#include "utils/Profiler.h"
+#include "utils/SamplingProfiler.h"
+
+namespace seethe
+{
+thread_local bool ThreadPool::t_inJob = false;
+
+ThreadPool::ThreadPool(unsigned int threadCount) noexcept
+{
+	StartWorkers(std::max(1u, threadCount) - 1);
+}
+ThreadPool::~ThreadPool() noexcept
+{
+	StopWorkers();
+}
+ThreadPool& ThreadPool::Get() noexcept
+{
+	static ThreadPool pool;
+	return pool;
+}
+void ThreadPool::SetThreadCount(unsigned int threadCount) noexcept
+{
+	std::lock_guard<std::mutex> submitLock(m_submitMutex);
+	StopWorkers();
+	StartWorkers(std::max(1u, threadCount) - 1);
+}
+void ThreadPool::StartWorkers(unsigned int workerCount) noexcept
+{
+	m_stop = false;
+	m_workers.reserve(workerCount);
+	for (unsigned int iii = 0; iii < workerCount; ++iii)
+	{
+		m_workers.emplace_back([this, iii]()
+			{
+				PROFILE_THREAD(std::format("ThreadPool worker {}", iii));
+				SamplingProfiler::RegisterThread();
+				WorkerLoop();
+			}
+		);
+	}
+}
+void ThreadPool::StopWorkers() noexcept
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wakeCV.notify_all();
+
+	for (std::thread& worker : m_workers)
+		worker.join();
+	m_workers.clear();
+}
+void ThreadPool::WorkerLoop() noexcept
+{
+	t_inJob = true;
+
+	std::uint64_t lastJobId = 0;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	lastJobId = m_jobId;
+
+	while (true)
+	{
+		m_wakeCV.wait(lock, [this, &lastJobId]() { return m_stop || m_jobId != lastJobId; });
+		if (m_stop)
+			return;
+
+		// Copy the job description while holding the lock. The submitting thread will not touch any of this
+		// until m_activeWorkers drops back to 0
+		lastJobId = m_jobId;
+		const RangeFunction* job = m_job;
+		size_t count = m_count;
+		size_t grainSize = m_grainSize;
+		std::uint32_t allocationTag = m_allocationTag;
+		std::uint32_t phase = m_phase;
+		++m_activeWorkers;
+
+		lock.unlock();
+		{
+			PROFILE_SCOPE("ThreadPool::Drain");
+			AllocationTagScope tag(allocationTag);
+			PhaseCounterShareScope phaseCounters(phase);
+			Drain(*job, count, grainSize);
+		}
+		lock.lock();
+
+		if (--m_activeWorkers == 0)
+			m_doneCV.notify_all();
+	}
+}
+void ThreadPool::Run(size_t count, size_t grainSize, const RangeFunction& fn) noexcept
+{
+	std::lock_guard<std::mutex> submitLock(m_submitMutex);
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		// A worker that woke up late for the previous job may still be (trivially) draining it
+		m_doneCV.wait(lock, [this]() { return m_activeWorkers == 0; });
+
+		m_job = &fn;
+		m_count = count;
+		m_grainSize = grainSize;
+		m_allocationTag = AllocationTracker::CurrentTag();
+		m_phase = PhaseCounters::CurrentPhase();
+		m_next.store(0, std::memory_order_relaxed);
+		++m_jobId;
+	}
+	m_wakeCV.notify_all();
+
+	// The calling thread works on the job as well
+	t_inJob = true;
+	Drain(fn, count, grainSize);
+	t_inJob = false;
+
+	// Every chunk has been claimed at this point, so we only need to wait for the workers still processing theirs.
+	// A worker that wakes up after this will find no chunks left and never call 'fn'
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCV.wait(lock, [this]() { return m_activeWorkers == 0; });
+}
+void ThreadPool::Drain(const RangeFunction& fn, size_t count, size_t grainSize) noexcept
+{
+	while (true)
+	{
+		size_t begin = m_next.fetch_add(grainSize, std::memory_order_relaxed);
+		if (begin >= count)
+			return;
+
+		fn(begin, std::min(begin + grainSize, count));
+	}
+}
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+// ThreadPool is a minimal fork/join pool for data parallel loops. ParallelFor() splits [0, count) into chunks of
+// 'grainSize' which the workers (and the calling thread) pull from a shared atomic counter until the range is
+// exhausted. ParallelFor() does not return until every chunk has been processed.
+//
+// NOTE: A ParallelFor() issued from inside another ParallelFor() (from a worker or from the calling thread's share of
+//       the work) simply runs inline
+// NOTE: Only one ParallelFor() runs on the pool at a time - concurrent callers are serialized
+class ThreadPool
+{
+public:
+	// Non-owning reference to the caller's fn(begin, end). ParallelFor() does not return until the job is done, so fn
+	// outlives every call and never has to be copied (a std::function would heap allocate for larger captures)
+	struct RangeFunction
+	{
+		void* callable;
+		void (*invoke)(void* callable, size_t begin, size_t end);
+
+		void operator()(size_t begin, size_t end) const { invoke(callable, begin, end); }
+	};
+
+	// 'threadCount' is the total number of threads that work on a ParallelFor(), including the calling thread
+	ThreadPool(unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency())) noexcept;
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool(ThreadPool&&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	ThreadPool& operator=(ThreadPool&&) = delete;
+	~ThreadPool() noexcept;
+
+	// Shared pool used by the simulation/rendering code
+	ND static ThreadPool& Get() noexcept;
+
+	void SetThreadCount(unsigned int threadCount) noexcept;
+	ND unsigned int GetThreadCount() const noexcept { return static_cast<unsigned int>(m_workers.size()) + 1; }
+
+	// fn(begin, end) is invoked for disjoint sub-ranges that together cover [0, count)
+	template <typename F>
+	void ParallelFor(size_t count, size_t grainSize, F&& fn) noexcept
+	{
+		if (count == 0)
+			return;
+
+		grainSize = std::max<size_t>(1, grainSize);
+		if (m_workers.empty() || count <= grainSize || t_inJob)
+		{
+			fn(size_t{ 0 }, count);
+			return;
+		}
+
+		using Callable = std::remove_reference_t<F>;
+		const RangeFunction job = {
+			const_cast<void*>(static_cast<const void*>(std::addressof(fn))),
+			[](void* callable, size_t begin, size_t end) { (*static_cast<Callable*>(callable))(begin, end); }
+		};
+		Run(count, grainSize, job);
+	}
+
+private:
+	void StartWorkers(unsigned int workerCount) noexcept;
+	void StopWorkers() noexcept;
+	void WorkerLoop() noexcept;
+	void Run(size_t count, size_t grainSize, const RangeFunction& fn) noexcept;
+	void Drain(const RangeFunction& fn, size_t count, size_t grainSize) noexcept;
+
+	// Set on the workers, and on the calling thread while it works on its share of a job. A nested ParallelFor() must
+	// not call Run() again, because the calling thread still holds m_submitMutex
+	static thread_local bool t_inJob;
+
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_submitMutex;
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCV;
+	std::condition_variable m_doneCV;
+
+	// Current job - these are only written while holding m_mutex and while no worker is active
+	const RangeFunction* m_job = nullptr;
+	size_t m_count = 0;
+	size_t m_grainSize = 1;
+	std::uint32_t m_allocationTag = 0;		// The submitting thread's tag, so the workers' allocations are charged to it
+	std::uint32_t m_phase = std::numeric_limits<std::uint32_t>::max();	// The submitting thread's PROFILE_PHASE(), so the workers' counters are added to it
+	std::atomic<size_t> m_next = 0;
+	std::uint64_t m_jobId = 0;
+	unsigned int m_activeWorkers = 0;
+	bool m_stop = false;
+};
+}
@@ -2,23 +2,46 @@
 
 namespace seethe
 {
+namespace
+{
+// QueryPerformanceCounter() on Windows, std::chrono::steady_clock everywhere else
+std::int64_t CountsPerSecond() noexcept
+{
+#if defined(_WIN32)
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	return frequency.QuadPart;
+#else
+	return std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num;
+#endif
+}
+std::int64_t CurrentCount() noexcept
+{
+#if defined(_WIN32)
+	LARGE_INTEGER count;
+	QueryPerformanceCounter(&count);
+	return count.QuadPart;
+#else
+	return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+}
+
 Timer::Timer() :
 	m_secondsPerCount(0.0),
 	m_deltaTime(-1.0),
 	m_baseTime(0),
 	m_pausedTime(0),
+	m_stopTime(0),
 	m_prevTime(0),
 	m_currTime(0),
-	m_stopped(false),
-	m_stopTime(0)
+	m_stopped(false)
 {
 	// NOTE: I was going to check the return value of QueryPerformanceFrequency and throw an exception if it
 	// had failed, but the docs say "On systems that run Windows XP or later, the function will always succeed 
 	// and will thus never return zero". I don't think it is necessary to do this check as I doubt we will support
 	// machines pre-dating Windows XP
-	__int64 countsPerSec;
-	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
-	m_secondsPerCount = 1.0 / (double)countsPerSec;
+	m_secondsPerCount = 1.0 / (double)CountsPerSecond();
 }
 
 // Returns the total time elapsed since Reset() was called, NOT counting any
@@ -66,8 +89,7 @@ void Timer::Reset()
 	// had failed, but the docs say "On systems that run Windows XP or later, the function will always succeed 
 	// and will thus never return zero". I don't think it is necessary to do this check as I doubt we will support
 	// machines pre-dating Windows XP
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	std::int64_t currTime = CurrentCount();
 
 	m_baseTime = currTime;
 	m_prevTime = currTime;
@@ -81,8 +103,7 @@ void Timer::Start()
 	// had failed, but the docs say "On systems that run Windows XP or later, the function will always succeed 
 	// and will thus never return zero". I don't think it is necessary to do this check as I doubt we will support
 	// machines pre-dating Windows XP
-	__int64 startTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+	std::int64_t startTime = CurrentCount();
 
 
 	// Accumulate the time elapsed between stop and start pairs.
@@ -109,8 +130,7 @@ void Timer::Stop()
 	// machines pre-dating Windows XP
 	if (!m_stopped)
 	{
-		__int64 currTime;
-		QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+		std::int64_t currTime = CurrentCount();
 
 		m_stopTime = currTime;
 		m_stopped = true;
@@ -130,8 +150,7 @@ void Timer::Tick()
 		return;
 	}
 
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	std::int64_t currTime = CurrentCount();
 	m_currTime = currTime;
 
 	// Time difference between this frame and the previous.
@@ -24,11 +24,11 @@ private:
 	double m_secondsPerCount;
 	double m_deltaTime;
 
-	__int64 m_baseTime;
-	__int64 m_pausedTime;
-	__int64 m_stopTime;
-	__int64 m_prevTime;
-	__int64 m_currTime;
+	std::int64_t m_baseTime;
+	std::int64_t m_pausedTime;
+	std::int64_t m_stopTime;
+	std::int64_t m_prevTime;
+	std::int64_t m_currTime;
 
 	bool m_stopped;
 };
@@ -0,0 +1,25 @@
+#include "TuningParameters.h"
+#include "ThreadPool.h"
+
+namespace seethe
+{
+namespace
+{
+TuningParameters s_current;
+}
+
+const TuningParameters& TuningParameters::Current() noexcept
+{
+	return s_current;
+}
+
+void TuningParameters::Apply(const TuningParameters& parameters) noexcept
+{
+	s_current = parameters;
+
+	// Restarting the workers is not free, so only do it when the count actually changes
+	ThreadPool& pool = ThreadPool::Get();
+	if (pool.GetThreadCount() != parameters.threadCount)
+		pool.SetThreadCount(parameters.threadCount);
+}
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "pch.h"
+
+namespace seethe
+{
+// Knobs of the parallel code whose best values depend on the machine and the scene. AutoTuner picks them by timing
+// trial steps (see application/AutoTuner.h). The defaults are the values the code used before they were tunable.
+//
+// NOTE: Only change them from the main thread, between frames - the code that reads them does so without locking
+struct TuningParameters
+{
+	// Total number of threads of the shared ThreadPool, including the calling thread
+	unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	// The AtomGrid cell size is chosen so that, on average, each cell holds about this many atoms
+	float gridAtomsPerCell = 2.0f;
+
+	// Number of atom chunks (of AtomStore::ChunkCapacity atoms) a thread takes at a time in Simulation::Update()
+	size_t simulationGrainSize = 1;
+
+	// Number of atoms a thread takes at a time when recomputing the ambient occlusion
+	size_t ambientOcclusionGrainSize = 256;
+
+	ND bool operator==(const TuningParameters&) const noexcept = default;
+
+	ND static const TuningParameters& Current() noexcept;
+
+	// Makes 'parameters' the current parameters and resizes the shared ThreadPool to match
+	static void Apply(const TuningParameters& parameters) noexcept;
+};
+}
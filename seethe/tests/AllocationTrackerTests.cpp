@@ -0,0 +1,143 @@
+#include "application/HeadlessFrame.h"
+#include "application/ScalingTest.h"
+#include "simulation/Simulation.h"
+#include "utils/AllocationTracker.h"
+
+#include <gtest/gtest.h>
+
+namespace seethe
+{
+#ifdef ENABLE_ALLOCATION_TRACKING
+namespace
+{
+constexpr size_t AtomCount = 5000;
+constexpr unsigned int WarmupFrames = 10;
+constexpr unsigned int CheckedFrames = 60;
+constexpr float Dt = 1.0f / 60.0f;
+
+class AllocationTrackerTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		std::mt19937 rng(7);
+		GenerateScene(m_simulation, SyntheticScene::UNIFORM_GAS, AtomCount, rng);
+		m_simulation.StartPlaying();
+	}
+
+	// Runs 'frame' through the warm-up frames and then checks that none of the next frames allocate, both on this thread
+	// and through the tracker's steady state check (--check-allocations), which also sees the thread pool's workers
+	template <typename F>
+	void ExpectSteadyStateWithoutAllocations(F&& frame)
+	{
+		AllocationTracker& tracker = AllocationTracker::Get();
+		tracker.StartSteadyStateCheck(WarmupFrames, CheckedFrames);
+
+		for (unsigned int iii = 0; iii < WarmupFrames; ++iii)
+		{
+			frame();
+			ALLOCATION_END_FRAME();
+		}
+		ASSERT_TRUE(tracker.IsInSteadyState());
+
+		const std::uint64_t allocations = AllocationTracker::ThreadAllocationCount();
+		for (unsigned int iii = 0; iii < CheckedFrames; ++iii)
+		{
+			frame();
+			ASSERT_EQ(AllocationTracker::ThreadAllocationCount(), allocations) << "Steady state frame " << iii << " allocated";
+			ALLOCATION_END_FRAME();
+		}
+
+		EXPECT_FALSE(tracker.IsCheckingSteadyState());
+		EXPECT_EQ(tracker.GetCheckResult(), 0);
+	}
+
+	Simulation m_simulation;
+};
+}
+
+TEST_F(AllocationTrackerTest, SimulationStepsWithoutAllocating)
+{
+	ExpectSteadyStateWithoutAllocations([this]()
+	{
+		m_simulation.Update(Dt);
+		m_simulation.DispatchEvents();
+	});
+}
+
+TEST_F(AllocationTrackerTest, FramePipelineRunsWithoutAllocating)
+{
+	HeadlessFrame frame(m_simulation);
+	ExpectSteadyStateWithoutAllocations([this, &frame]() { frame.Step(m_simulation, Dt); });
+}
+
+TEST_F(AllocationTrackerTest, LiveBytesGoBackDownWhenMemoryIsFreed)
+{
+	// Other threads (i.e. the logger) allocate now and then too, so only large changes are checked
+	constexpr size_t size = 8 * 1024 * 1024;
+	const AllocationTracker& tracker = AllocationTracker::Get();
+
+	struct alignas(256) Aligned
+	{
+		std::array<std::byte, 256> data;
+	};
+
+	const std::uint64_t before = tracker.GetLiveBytes();
+	{
+		std::vector<std::byte> sized(size);										// Sized operator delete
+		auto unsized = std::make_unique<std::byte[]>(size);						// delete[] of a trivial type is unsized
+		auto aligned = std::make_unique<Aligned[]>(size / sizeof(Aligned));		// Aligned operator new/delete
+		EXPECT_GE(tracker.GetLiveBytes(), before + 3 * size);
+	}
+	EXPECT_LT(tracker.GetLiveBytes(), before + size / 2);
+}
+
+TEST_F(AllocationTrackerTest, SizedDeletesAreCounted)
+{
+	const AllocationTracker& tracker = AllocationTracker::Get();
+	const std::uint64_t before = tracker.GetLiveBytes();
+
+	void* p = ::operator new(1024 * 1024);
+	EXPECT_GE(tracker.GetLiveBytes(), before + 1024 * 1024);
+	::operator delete(p, 1024 * 1024);
+	EXPECT_LT(tracker.GetLiveBytes(), before + 1024 * 1024);
+
+	p = ::operator new(1024 * 1024, std::align_val_t{ 4096 });
+	EXPECT_GE(tracker.GetLiveBytes(), before + 1024 * 1024);
+	::operator delete(p, 1024 * 1024, std::align_val_t{ 4096 });
+	EXPECT_LT(tracker.GetLiveBytes(), before + 1024 * 1024);
+}
+
+TEST_F(AllocationTrackerTest, LiveBytesAreChargedToTheTagThatAllocated)
+{
+	constexpr size_t size = 8 * 1024 * 1024;
+	auto LiveBytes = []()
+		{
+			std::uint64_t bytes = 0;
+			AllocationTracker::Get().ForEachTagTotal([&bytes](const AllocationTracker::TagCounters& counters)
+				{
+					if (std::string_view(counters.name) == "AllocationTrackerTest")
+						bytes = counters.liveBytes;
+				}
+			);
+			return bytes;
+		};
+
+	std::unique_ptr<std::byte[]> plain;
+	std::unique_ptr<std::byte[]> aligned;
+	{
+		ALLOCATION_TAG("AllocationTrackerTest");
+		plain = std::make_unique<std::byte[]>(size);
+		aligned.reset(static_cast<std::byte*>(::operator new[](size, std::align_val_t{ 4096 })));
+	}
+	const std::uint64_t held = LiveBytes();
+	EXPECT_GE(held, 2 * size);
+
+	// Freed outside of the tag, and on another thread, which still gives the bytes back to the tag
+	std::thread([&plain]() { plain.reset(); }).join();
+	EXPECT_LT(LiveBytes(), held - size / 2);
+	::operator delete[](aligned.release(), std::align_val_t{ 4096 });
+	EXPECT_LT(LiveBytes(), held - size - size / 2);
+}
+#endif
+}
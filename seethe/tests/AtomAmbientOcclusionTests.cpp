@@ -0,0 +1,144 @@
+#include "rendering/AtomAmbientOcclusion.h"
+#include "simulation/Simulation.h"
+
+#include <gtest/gtest.h>
+
+using namespace DirectX;
+
+namespace seethe
+{
+namespace
+{
+constexpr size_t AtomCount = 1500;
+constexpr float BoxHalfSize = 20.0f;
+constexpr float SpawnHalfSize = 18.0f;
+
+// Keeps an AtomAmbientOcclusion in sync with a simulation the way SimulationWindow does (only the atom ranges the
+// simulation reports as changed), and checks after every edit that the result matches computing everything again
+class AtomAmbientOcclusionTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		// Dense enough that most atoms have neighbors within reach, but sparse enough that some have none
+		m_simulation.SetDimensions(2.0f * BoxHalfSize);
+		std::uniform_real_distribution<float> position(-SpawnHalfSize, SpawnHalfSize);
+		std::uniform_int_distribution<int> type(1, static_cast<int>(AtomTypeCount));
+		std::vector<AtomTPV> atoms;
+		for (size_t iii = 0; iii < AtomCount; ++iii)
+			atoms.emplace_back(static_cast<AtomType>(type(m_rng)), XMFLOAT3{ position(m_rng), position(m_rng), position(m_rng) }, XMFLOAT3{});
+		m_simulation.AddAtoms(atoms);
+
+		SyncAndExpectFullRecompute();
+		const std::vector<std::uint8_t>& values = m_ambientOcclusion.GetValues();
+		ASSERT_GT(std::ranges::count_if(values, [](std::uint8_t value) { return value < 128; }), 0);
+		ASSERT_GT(std::ranges::count(values, std::uint8_t{ 255 }), 0);
+	}
+
+	// Returns how many atoms the incremental update recomputed
+	size_t SyncAndExpectFullRecompute()
+	{
+		m_simulation.DispatchEvents();
+		const DirtyRangeTracker& changes = m_simulation.GetAtomChanges();
+		const bool allChanged = !changes.CollectSince(m_version, m_ranges);
+		m_version = changes.Version();
+
+		const AtomStore& atoms = std::as_const(m_simulation).GetAtoms();
+		const AtomGrid& grid = m_simulation.GetSpatialIndex();
+		const std::vector<std::uint8_t> before = m_ambientOcclusion.GetValues();
+		m_ambientOcclusion.Update(atoms, grid, m_ranges, allChanged);
+
+		AtomAmbientOcclusion full;
+		full.Update(atoms, grid, {}, true);
+		EXPECT_EQ(m_ambientOcclusion.GetValues(), full.GetValues());
+
+		// The changed indices are exactly the atoms whose value is different from before (new atoms start out at 255)
+		const std::vector<std::uint8_t>& after = m_ambientOcclusion.GetValues();
+		std::vector<std::uint32_t> expectedChanged;
+		for (std::uint32_t iii = 0; iii < after.size(); ++iii)
+		{
+			if (after[iii] != (iii < before.size() ? before[iii] : 255))
+				expectedChanged.push_back(iii);
+		}
+		std::vector<std::uint32_t> changed = m_ambientOcclusion.GetChangedIndices();
+		std::ranges::sort(changed);
+		EXPECT_EQ(changed, expectedChanged);
+
+		return m_ambientOcclusion.GetLastRecomputedCount();
+	}
+
+	ND size_t AtomCountNow() const noexcept { return std::as_const(m_simulation).GetAtoms().size(); }
+
+	ND XMFLOAT3 RandomPosition() noexcept
+	{
+		std::uniform_real_distribution<float> position(-SpawnHalfSize, SpawnHalfSize);
+		return { position(m_rng), position(m_rng), position(m_rng) };
+	}
+
+	std::mt19937 m_rng{ 51 };
+	Simulation m_simulation;
+	AtomAmbientOcclusion m_ambientOcclusion;
+	std::uint64_t m_version = DirtyRangeTracker::NoVersion;
+	std::vector<IndexRange> m_ranges;
+};
+}
+
+TEST_F(AtomAmbientOcclusionTest, MovingAtomsMatchesAFullRecompute)
+{
+	// A few atoms nudged a little
+	for (size_t index : { 10u, 500u, 501u, 1200u, 1499u })
+		m_simulation.MoveAtom(index, { 0.3f, -0.2f, 0.1f });
+	EXPECT_LT(SyncAndExpectFullRecompute(), AtomCount / 4);
+
+	// One atom carried across the box, so both the neighborhood it left and the one it joined change
+	m_simulation.SetAtomPosition(1234, { -SpawnHalfSize, -SpawnHalfSize, -SpawnHalfSize });
+	EXPECT_LT(SyncAndExpectFullRecompute(), AtomCount / 4);
+	m_simulation.SetAtomPosition(1234, { SpawnHalfSize, SpawnHalfSize, SpawnHalfSize });
+	EXPECT_LT(SyncAndExpectFullRecompute(), AtomCount / 4);
+
+	// Many atoms at once, which takes the full update path
+	std::vector<size_t> indices(AtomCount / 2);
+	std::iota(indices.begin(), indices.end(), size_t{ 0 });
+	m_simulation.SelectAtoms(indices, true);
+	m_simulation.MoveSelectedAtomsX(-0.1f);
+	EXPECT_EQ(SyncAndExpectFullRecompute(), AtomCount);
+}
+
+TEST_F(AtomAmbientOcclusionTest, AddingAtomsMatchesAFullRecompute)
+{
+	m_simulation.AddAtom(AtomType::CARBON, RandomPosition());
+	m_simulation.AddAtom(AtomType::OXYGEN, RandomPosition());
+	EXPECT_LT(SyncAndExpectFullRecompute(), AtomCount / 4);
+
+	// Inserting shifts the atoms after it, which are then part of the changed range
+	m_simulation.AddAtom(AtomTPV(AtomType::HYDROGEN, RandomPosition(), {}), AtomCountNow() - 20);
+	EXPECT_LT(SyncAndExpectFullRecompute(), AtomCount / 4);
+
+	// Right next to an existing atom, which darkens it
+	const XMFLOAT3 position = std::as_const(m_simulation).GetAtom(42).position;
+	m_simulation.AddAtom(AtomType::NITROGEN, { position.x + 1.0f, position.y, position.z });
+	EXPECT_LT(SyncAndExpectFullRecompute(), AtomCount / 4);
+}
+
+TEST_F(AtomAmbientOcclusionTest, RemovingAtomsMatchesAFullRecompute)
+{
+	// From the end, so nothing shifts and only the neighbors of where the atoms were change
+	m_simulation.RemoveAtom(AtomCountNow() - 1);
+	m_simulation.RemoveAtom(AtomCountNow() - 1);
+	EXPECT_LT(SyncAndExpectFullRecompute(), AtomCount / 4);
+
+	// Close to the end, which shifts the atoms after it
+	m_simulation.RemoveAtom(AtomCountNow() - 5);
+	EXPECT_LT(SyncAndExpectFullRecompute(), AtomCount / 4);
+
+	// Removing and adding in the same frame, so the atom count stays the same but the last atom is a different one
+	m_simulation.RemoveAtom(AtomCountNow() - 10);
+	m_simulation.AddAtom(AtomType::NITROGEN, RandomPosition());
+	EXPECT_LT(SyncAndExpectFullRecompute(), AtomCount / 4);
+
+	// Most of the atoms at once, which takes the full update path
+	while (AtomCountNow() > AtomCount / 3)
+		m_simulation.RemoveAtom(AtomCountNow() - 1);
+	SyncAndExpectFullRecompute();
+}
+}
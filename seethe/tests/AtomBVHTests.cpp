@@ -0,0 +1,246 @@
+#include "simulation/AtomBVH.h"
+
+#include <gtest/gtest.h>
+
+using namespace DirectX;
+
+namespace seethe
+{
+namespace
+{
+AtomStore RandomAtoms(size_t count, std::mt19937& rng) noexcept
+{
+	std::uniform_real_distribution<float> position(-30.0f, 30.0f);
+	std::uniform_int_distribution<int> type(1, static_cast<int>(AtomTypeCount));
+
+	AtomStore atoms;
+	for (size_t iii = 0; iii < count; ++iii)
+		atoms.emplace_back(static_cast<AtomType>(type(rng)), XMFLOAT3{ position(rng), position(rng), position(rng) });
+	return atoms;
+}
+
+// Same hit rule as the BVH: the first hit in front of the origin, or the exit point if the origin is inside the atom
+std::optional<AtomBVH::RayHit> IntersectByBruteForce(const AtomStore& atoms, const XMFLOAT3& origin, const XMFLOAT3& direction) noexcept
+{
+	std::optional<AtomBVH::RayHit> closest;
+	for (size_t iii = 0; iii < atoms.size(); ++iii)
+	{
+		const Atom& atom = atoms[iii];
+		const XMFLOAT3 oc = { atom.position.x - origin.x, atom.position.y - origin.y, atom.position.z - origin.z };
+		const float b = oc.x * direction.x + oc.y * direction.y + oc.z * direction.z;
+		const float c = oc.x * oc.x + oc.y * oc.y + oc.z * oc.z - atom.radius * atom.radius;
+		const float discriminant = b * b - c;
+		if (discriminant < 0.0f)
+			continue;
+
+		const float root = std::sqrt(discriminant);
+		const float t = b - root >= 0.0f ? b - root : b + root;
+		if (t >= 0.0f && (!closest || t < closest->distance))
+			closest = AtomBVH::RayHit{ iii, t };
+	}
+	return closest;
+}
+
+std::vector<size_t> QueryFrustumByBruteForce(const AtomStore& atoms, const Frustum& frustum) noexcept
+{
+	std::vector<size_t> results;
+	for (size_t iii = 0; iii < atoms.size(); ++iii)
+	{
+		if (frustum.Intersects(atoms[iii].position, atoms[iii].radius))
+			results.push_back(iii);
+	}
+	return results;
+}
+
+std::vector<size_t> QueryFrustum(const AtomBVH& bvh, const Frustum& frustum) noexcept
+{
+	std::vector<size_t> results;
+	bvh.QueryFrustum(frustum, results);
+	std::ranges::sort(results);
+	return results;
+}
+
+Frustum MakeFrustum(const XMFLOAT3& eye, const XMFLOAT3& target) noexcept
+{
+	const XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	const XMMATRIX projection = XMMatrixPerspectiveFovLH(0.3f * XM_PI, 1.5f, 1.0f, 200.0f);
+	return Frustum(XMMatrixMultiply(view, projection));
+}
+
+// Random rays from outside and inside the atoms' box, in random directions. Half of them aim roughly at the middle
+// so that more of them hit something
+void ExpectRaysMatchBruteForce(const AtomBVH& bvh, const AtomStore& atoms, std::mt19937& rng, int rayCount = 500)
+{
+	std::uniform_real_distribution<float> coordinate(-50.0f, 50.0f);
+	std::normal_distribution<float> gaussian;
+
+	int hits = 0;
+	for (int iii = 0; iii < rayCount; ++iii)
+	{
+		const XMFLOAT3 origin = { coordinate(rng), coordinate(rng), coordinate(rng) };
+		XMVECTOR direction = iii % 2 == 0 ?
+			XMVectorSet(gaussian(rng), gaussian(rng), gaussian(rng), 0.0f) :
+			XMVectorAdd(XMVectorNegate(XMLoadFloat3(&origin)), XMVectorSet(5.0f * gaussian(rng), 5.0f * gaussian(rng), 5.0f * gaussian(rng), 0.0f));
+		direction = XMVector3Normalize(direction);
+		XMFLOAT3 d;
+		XMStoreFloat3(&d, direction);
+
+		const std::optional<AtomBVH::RayHit> expected = IntersectByBruteForce(atoms, origin, d);
+		const std::optional<AtomBVH::RayHit> actual = bvh.Intersect(XMLoadFloat3(&origin), direction);
+		ASSERT_EQ(actual.has_value(), expected.has_value()) << "ray " << iii;
+		if (!expected)
+			continue;
+
+		++hits;
+		EXPECT_NEAR(actual->distance, expected->distance, 1e-3f) << "ray " << iii;
+		if (std::abs(actual->distance - expected->distance) > 1e-4f)
+		{
+			EXPECT_EQ(actual->atomIndex, expected->atomIndex) << "ray " << iii;
+		}
+
+		// The closest hit is beyond a shorter maximum distance, so then there is nothing to report
+		EXPECT_FALSE(bvh.Intersect(XMLoadFloat3(&origin), direction, 0.999f * expected->distance)) << "ray " << iii;
+	}
+
+	// A sparse cloud is mostly missed, but a dense one has to be hit often for the comparison to mean much
+	if (atoms.size() >= 1000)
+	{
+		EXPECT_GT(hits, rayCount / 4);
+	}
+}
+
+void ExpectFrustumsMatchBruteForce(const AtomBVH& bvh, const AtomStore& atoms)
+{
+	// From far away (everything inside), from inside the cloud, and looking past it
+	for (const auto& [eye, target] : { std::pair{ XMFLOAT3{ 0.0f, 0.0f, -150.0f }, XMFLOAT3{ 0.0f, 0.0f, 0.0f } },
+		std::pair{ XMFLOAT3{ 5.0f, -3.0f, 2.0f }, XMFLOAT3{ 20.0f, 10.0f, 30.0f } },
+		std::pair{ XMFLOAT3{ -60.0f, 0.0f, -60.0f }, XMFLOAT3{ -10.0f, 0.0f, 40.0f } } })
+	{
+		const Frustum frustum = MakeFrustum(eye, target);
+		EXPECT_EQ(QueryFrustum(bvh, frustum), QueryFrustumByBruteForce(atoms, frustum)) << eye.x << ", " << eye.y << ", " << eye.z;
+	}
+}
+}
+
+TEST(AtomBVHTest, EmptyTreeFindsNothing)
+{
+	AtomStore atoms;
+	AtomBVH bvh;
+	bvh.Build(atoms);
+
+	EXPECT_TRUE(bvh.Empty());
+	EXPECT_FALSE(bvh.Intersect(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f)));
+	EXPECT_TRUE(QueryFrustum(bvh, MakeFrustum({ 0.0f, 0.0f, -10.0f }, {})).empty());
+}
+
+TEST(AtomBVHTest, SingleAtom)
+{
+	AtomStore atoms;
+	atoms.emplace_back(AtomType::CARBON, XMFLOAT3{ 0.0f, 0.0f, 10.0f });
+	const float radius = atoms[0].radius;
+
+	AtomBVH bvh;
+	bvh.Build(atoms);
+	EXPECT_EQ(bvh.NodeCount(), 1u);
+
+	const std::optional<AtomBVH::RayHit> hit = bvh.Intersect(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f));
+	ASSERT_TRUE(hit);
+	EXPECT_EQ(hit->atomIndex, 0u);
+	EXPECT_NEAR(hit->distance, 10.0f - radius, 1e-5f);
+
+	EXPECT_FALSE(bvh.Intersect(XMVectorZero(), XMVectorSet(0.0f, 0.0f, -1.0f, 0.0f)));
+	EXPECT_FALSE(bvh.Intersect(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), 5.0f));
+
+	// From inside the atom, the hit is where the ray leaves it
+	const std::optional<AtomBVH::RayHit> inside = bvh.Intersect(XMVectorSet(0.0f, 0.0f, 10.0f, 0.0f), XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f));
+	ASSERT_TRUE(inside);
+	EXPECT_NEAR(inside->distance, radius, 1e-5f);
+
+	EXPECT_EQ(QueryFrustum(bvh, MakeFrustum({ 0.0f, 0.0f, -10.0f }, { 0.0f, 0.0f, 10.0f })), std::vector<size_t>{ 0 });
+	EXPECT_TRUE(QueryFrustum(bvh, MakeFrustum({ 0.0f, 0.0f, -10.0f }, { 0.0f, 0.0f, -20.0f })).empty());
+}
+
+// Picking hits an atom anywhere within the radius it is drawn with (the unit sphere mesh scaled by 'radius'). Before the
+// BVH, picking only tested half of that radius, so a click near the edge of a drawn atom missed it
+TEST(AtomBVHTest, HitsAnywhereWithinTheDrawnRadius)
+{
+	AtomStore atoms;
+	atoms.emplace_back(AtomType::CARBON, XMFLOAT3{ 0.0f, 0.0f, 10.0f });
+	const float radius = atoms[0].radius;
+
+	AtomBVH bvh;
+	bvh.Build(atoms);
+
+	const XMVECTOR forward = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+	EXPECT_TRUE(bvh.Intersect(XMVectorSet(0.75f * radius, 0.0f, 0.0f, 0.0f), forward));
+	EXPECT_TRUE(bvh.Intersect(XMVectorSet(0.0f, -0.99f * radius, 0.0f, 0.0f), forward));
+	EXPECT_FALSE(bvh.Intersect(XMVectorSet(1.01f * radius, 0.0f, 0.0f, 0.0f), forward));
+}
+
+TEST(AtomBVHTest, MatchesBruteForceOnRandomAtoms)
+{
+	std::mt19937 rng(3);
+	for (size_t count : { 2u, 5u, 17u, 300u, 5000u })
+	{
+		SCOPED_TRACE(count);
+		const AtomStore atoms = RandomAtoms(count, rng);
+
+		AtomBVH bvh;
+		bvh.Build(atoms);
+		ExpectRaysMatchBruteForce(bvh, atoms, rng, count < 100 ? 100 : 500);
+		ExpectFrustumsMatchBruteForce(bvh, atoms);
+	}
+}
+
+TEST(AtomBVHTest, RefitAfterMovementMatchesBruteForce)
+{
+	std::mt19937 rng(4);
+	AtomStore atoms = RandomAtoms(2000, rng);
+
+	AtomBVH bvh;
+	bvh.Build(atoms);
+	const size_t nodeCount = bvh.NodeCount();
+
+	// Move every atom a little and some of them a lot, without adding or removing any
+	std::normal_distribution<float> jitter(0.0f, 1.0f);
+	std::uniform_real_distribution<float> position(-30.0f, 30.0f);
+	for (size_t iii = 0; iii < atoms.size(); ++iii)
+	{
+		Atom& atom = atoms[iii];
+		if (iii % 50 == 0)
+			atom.position = { position(rng), position(rng), position(rng) };
+		else
+			atom.position = { atom.position.x + jitter(rng), atom.position.y + jitter(rng), atom.position.z + jitter(rng) };
+	}
+
+	bvh.Refit(atoms);
+	EXPECT_EQ(bvh.NodeCount(), nodeCount);
+	ExpectRaysMatchBruteForce(bvh, atoms, rng);
+	ExpectFrustumsMatchBruteForce(bvh, atoms);
+}
+
+TEST(AtomBVHTest, UpdateRefitsOrRebuildsAsNeeded)
+{
+	std::mt19937 rng(5);
+	AtomStore atoms = RandomAtoms(1000, rng);
+
+	AtomBVH bvh;
+	bvh.Update(atoms);
+	ExpectRaysMatchBruteForce(bvh, atoms, rng, 100);
+
+	// Scrambling every position makes the refit tree far worse than a new one, which Update() has to notice
+	std::uniform_real_distribution<float> position(-30.0f, 30.0f);
+	for (Atom& atom : atoms)
+		atom.position = { position(rng), position(rng), position(rng) };
+	bvh.Update(atoms);
+	ExpectRaysMatchBruteForce(bvh, atoms, rng, 100);
+	ExpectFrustumsMatchBruteForce(bvh, atoms);
+
+	// Adding and removing atoms always rebuilds
+	atoms.emplace_back(AtomType::OXYGEN, XMFLOAT3{ 0.0f, 0.0f, 0.0f });
+	atoms.erase(10);
+	bvh.Update(atoms);
+	ExpectRaysMatchBruteForce(bvh, atoms, rng, 100);
+	ExpectFrustumsMatchBruteForce(bvh, atoms);
+}
+}
@@ -0,0 +1,140 @@
+#include "rendering/AtomCuller.h"
+
+#include <gtest/gtest.h>
+
+using namespace DirectX;
+
+namespace seethe
+{
+namespace
+{
+// Camera at the origin looking down +z with a 90 degree field of view, so the side planes are x = +-z and y = +-z
+Frustum MakeFrustum(const Frustum::NdcRect& rect = {}) noexcept
+{
+	const XMMATRIX view = XMMatrixLookAtLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	const XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, 1.0f, 100.0f);
+	return Frustum(XMMatrixMultiply(view, projection), rect);
+}
+
+AtomStore RandomAtoms(size_t count, std::mt19937& rng) noexcept
+{
+	std::uniform_real_distribution<float> lateral(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> depth(-20.0f, 120.0f);
+	std::uniform_int_distribution<int> type(1, static_cast<int>(AtomTypeCount));
+
+	AtomStore atoms;
+	for (size_t iii = 0; iii < count; ++iii)
+		atoms.emplace_back(static_cast<AtomType>(type(rng)), XMFLOAT3{ lateral(rng), lateral(rng), depth(rng) });
+	return atoms;
+}
+
+std::vector<std::uint32_t> VisibleByBruteForce(const AtomStore& atoms, const Frustum& frustum) noexcept
+{
+	std::vector<std::uint32_t> visible;
+	for (size_t iii = 0; iii < atoms.size(); ++iii)
+	{
+		if (frustum.Intersects(atoms[iii].position, atoms[iii].radius))
+			visible.push_back(static_cast<std::uint32_t>(iii));
+	}
+	return visible;
+}
+}
+
+TEST(FrustumTest, ClassifiesSpheresAgainstEachPlane)
+{
+	const Frustum frustum = MakeFrustum();
+
+	EXPECT_TRUE(frustum.Intersects({ 0.0f, 0.0f, 10.0f }, 1.0f));
+	EXPECT_FALSE(frustum.Intersects({ 0.0f, 0.0f, -10.0f }, 1.0f));		// Behind the camera
+	EXPECT_FALSE(frustum.Intersects({ 0.0f, 0.0f, 0.0f }, 0.5f));		// In front of the near plane
+	EXPECT_TRUE(frustum.Intersects({ 0.0f, 0.0f, 0.5f }, 1.0f));		// Straddles the near plane
+	EXPECT_FALSE(frustum.Intersects({ 0.0f, 0.0f, 102.0f }, 1.0f));		// Beyond the far plane
+	EXPECT_TRUE(frustum.Intersects({ 0.0f, 0.0f, 100.5f }, 1.0f));		// Straddles the far plane
+
+	// 1 unit outside of each side plane, measured along its normal. A radius of 1.1 reaches back in, 0.9 does not
+	const float offset = std::sqrt(2.0f);
+	for (const XMFLOAT3& center : { XMFLOAT3{ -10.0f - offset, 0.0f, 10.0f }, XMFLOAT3{ 10.0f + offset, 0.0f, 10.0f },
+		XMFLOAT3{ 0.0f, -10.0f - offset, 10.0f }, XMFLOAT3{ 0.0f, 10.0f + offset, 10.0f } })
+	{
+		EXPECT_FALSE(frustum.Intersects(center, 0.9f)) << center.x << ", " << center.y;
+		EXPECT_TRUE(frustum.Intersects(center, 1.1f)) << center.x << ", " << center.y;
+	}
+}
+
+TEST(FrustumTest, NdcRectShrinksTheSidePlanes)
+{
+	// Only the right half of the screen
+	const Frustum frustum = MakeFrustum({ 0.0f, -1.0f, 1.0f, 1.0f });
+
+	EXPECT_TRUE(frustum.Intersects({ 5.0f, 0.0f, 10.0f }, 0.5f));
+	EXPECT_FALSE(frustum.Intersects({ -5.0f, 0.0f, 10.0f }, 0.5f));
+}
+
+TEST(FrustumTest, ClassifiesBoxes)
+{
+	const Frustum frustum = MakeFrustum();
+
+	EXPECT_EQ(frustum.Classify({ -1.0f, -1.0f, 10.0f }, { 1.0f, 1.0f, 12.0f }), CONTAINS);
+	EXPECT_EQ(frustum.Classify({ -20.0f, -1.0f, 10.0f }, { 0.0f, 1.0f, 12.0f }), INTERSECTS);
+	EXPECT_EQ(frustum.Classify({ -1.0f, -1.0f, -12.0f }, { 1.0f, 1.0f, -10.0f }), DISJOINT);
+}
+
+TEST(FrustumTest, Intersects4MatchesTheScalarTest)
+{
+	const Frustum frustum = MakeFrustum();
+	std::mt19937 rng(1234);
+	const AtomStore atoms = RandomAtoms(4 * 256, rng);
+
+	for (size_t iii = 0; iii < atoms.size(); iii += 4)
+	{
+		const Atom& a = atoms[iii];
+		const Atom& b = atoms[iii + 1];
+		const Atom& c = atoms[iii + 2];
+		const Atom& d = atoms[iii + 3];
+
+		const unsigned int mask = frustum.Intersects4(
+			XMVectorSet(a.position.x, b.position.x, c.position.x, d.position.x),
+			XMVectorSet(a.position.y, b.position.y, c.position.y, d.position.y),
+			XMVectorSet(a.position.z, b.position.z, c.position.z, d.position.z),
+			XMVectorSet(a.radius, b.radius, c.radius, d.radius));
+
+		for (unsigned int lane = 0; lane < 4; ++lane)
+			EXPECT_EQ((mask >> lane) & 1u, frustum.Intersects(atoms[iii + lane].position, atoms[iii + lane].radius) ? 1u : 0u);
+	}
+}
+
+TEST(AtomCullerTest, CompactsVisibleAtomsInAscendingOrder)
+{
+	const Frustum frustum = MakeFrustum();
+	std::mt19937 rng(42);
+
+	// Several chunks, and a last chunk whose size is not a multiple of 4 (so the scalar tail is used as well)
+	const AtomStore atoms = RandomAtoms(3 * AtomStore::ChunkCapacity + 7, rng);
+	const std::vector<std::uint32_t> expected = VisibleByBruteForce(atoms, frustum);
+	ASSERT_FALSE(expected.empty());
+	ASSERT_LT(expected.size(), atoms.size());
+
+	AtomCuller culler;
+	culler.Cull(atoms, frustum);
+
+	EXPECT_EQ(culler.GetVisibleIndices(), expected);
+	EXPECT_EQ(culler.GetVisibleCount(), expected.size());
+}
+
+TEST(AtomCullerTest, DoesNotKeepResultsFromLargerStores)
+{
+	const Frustum frustum = MakeFrustum();
+	std::mt19937 rng(7);
+
+	AtomCuller culler;
+	culler.Cull(RandomAtoms(2 * AtomStore::ChunkCapacity, rng), frustum);
+	ASSERT_GT(culler.GetVisibleCount(), 0u);
+
+	const AtomStore atoms = RandomAtoms(10, rng);
+	culler.Cull(atoms, frustum);
+	EXPECT_EQ(culler.GetVisibleIndices(), VisibleByBruteForce(atoms, frustum));
+
+	culler.Cull(AtomStore{}, frustum);
+	EXPECT_EQ(culler.GetVisibleCount(), 0u);
+}
+}
@@ -0,0 +1,123 @@
+#include "rendering/AtomDepthSorter.h"
+
+#include <gtest/gtest.h>
+
+using namespace DirectX;
+
+namespace seethe
+{
+namespace
+{
+constexpr float NearZ = 1.0f;
+constexpr float FarZ = 101.0f;
+
+// View space depth of an atom, the same way AtomDepthSorter computes it
+float Depth(const AtomStore& atoms, std::uint32_t index, FXMMATRIX view) noexcept
+{
+	return XMVectorGetZ(XMVector3TransformCoord(XMLoadFloat3(&atoms[index].position), view));
+}
+
+// The sorted indices have to be exactly the visible ones, with non-decreasing depth (clamped to [near, far], which is
+// all the 16 bit keys can tell apart). Within 1/65535 of the depth range, atoms may come in either order
+void ExpectSortedByDepth(const AtomDepthSorter& sorter, const AtomStore& atoms, std::span<const std::uint32_t> visible, FXMMATRIX view)
+{
+	const std::vector<std::uint32_t>& sorted = sorter.GetSortedIndices();
+	std::vector<std::uint32_t> expected(visible.begin(), visible.end());
+	std::vector<std::uint32_t> actual = sorted;
+	std::ranges::sort(expected);
+	std::ranges::sort(actual);
+	ASSERT_EQ(actual, expected);
+
+	const float tolerance = (FarZ - NearZ) / 65535.0f;
+	for (size_t iii = 1; iii < sorted.size(); ++iii)
+	{
+		const float previous = std::clamp(Depth(atoms, sorted[iii - 1], view), NearZ, FarZ);
+		const float current = std::clamp(Depth(atoms, sorted[iii], view), NearZ, FarZ);
+		ASSERT_LE(previous, current + tolerance) << "position " << iii;
+	}
+}
+
+XMMATRIX LookAt(const XMFLOAT3& eye, const XMFLOAT3& target) noexcept
+{
+	return XMMatrixLookAtLH(XMLoadFloat3(&eye), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+}
+}
+
+TEST(AtomDepthSorterTest, SortsNearestFirstAndKeepsTheOrderOfEqualDepths)
+{
+	// Looking down +z from the origin, so the depth is z
+	AtomStore atoms;
+	for (float z : { 50.0f, 10.0f, 30.0f, 10.0f, 90.0f, 10.0f })
+		atoms.emplace_back(AtomType::CARBON, XMFLOAT3{ 0.0f, 0.0f, z });
+
+	const std::array<std::uint32_t, 6> visible = { 0, 1, 2, 3, 4, 5 };
+	AtomDepthSorter sorter;
+	sorter.Sort(atoms, visible, XMMatrixIdentity(), NearZ, FarZ);
+	EXPECT_EQ(sorter.GetSortedIndices(), (std::vector<std::uint32_t>{ 1, 3, 5, 2, 0, 4 }));
+
+	// Only the visible atoms are sorted, and the next sort starts from the last order (which is why the atoms at z = 10
+	// keep the order they ended up in rather than the order they are passed in)
+	const std::array<std::uint32_t, 4> fewer = { 5, 4, 3, 1 };
+	sorter.Sort(atoms, fewer, XMMatrixIdentity(), NearZ, FarZ);
+	EXPECT_EQ(sorter.GetSortedIndices(), (std::vector<std::uint32_t>{ 1, 3, 5, 4 }));
+}
+
+TEST(AtomDepthSorterTest, DepthsOutsideTheRangeAndInfinitiesClampToTheEnds)
+{
+	// Behind the camera (negative depth), between the camera and the near plane, beyond the far plane and at +-infinity
+	constexpr float infinity = std::numeric_limits<float>::infinity();
+	AtomStore atoms;
+	for (float z : { 20.0f, -5.0f, infinity, 0.5f, 500.0f, -infinity, 60.0f, -1e30f, 1e30f })
+		atoms.emplace_back(AtomType::CARBON, XMFLOAT3{ 0.0f, 0.0f, z });
+
+	std::vector<std::uint32_t> visible(atoms.size());
+	std::iota(visible.begin(), visible.end(), 0u);
+
+	AtomDepthSorter sorter;
+	sorter.Sort(atoms, visible, XMMatrixIdentity(), NearZ, FarZ);
+
+	// Everything in front of the near plane shares the smallest key and everything beyond the far plane the largest,
+	// so those keep the order they came in
+	EXPECT_EQ(sorter.GetSortedIndices(), (std::vector<std::uint32_t>{ 1, 3, 5, 7, 0, 6, 2, 4, 8 }));
+	EXPECT_EQ(sorter.GetSorter().GetLastStrategy(), RadixSorter::Strategy::RADIX);
+}
+
+TEST(AtomDepthSorterTest, StaysSortedWhileTheCameraAndTheVisibleSetChange)
+{
+	std::mt19937 rng(31);
+	std::uniform_real_distribution<float> coordinate(-40.0f, 40.0f);
+	AtomStore atoms;
+	for (int iii = 0; iii < 20'000; ++iii)
+		atoms.emplace_back(AtomType::OXYGEN, XMFLOAT3{ coordinate(rng), coordinate(rng), coordinate(rng) });
+
+	AtomDepthSorter sorter;
+	std::bernoulli_distribution isVisible(0.7);
+	for (int frame = 0; frame < 20; ++frame)
+	{
+		SCOPED_TRACE(frame);
+
+		// The camera circles the atoms a little further every frame, and a different subset is visible each time
+		const float angle = 0.02f * frame;
+		const XMMATRIX view = LookAt({ 80.0f * std::sin(angle), 10.0f, -80.0f * std::cos(angle) }, { 0.0f, 0.0f, 0.0f });
+
+		std::vector<std::uint32_t> visible;
+		for (std::uint32_t iii = 0; iii < atoms.size(); ++iii)
+		{
+			if (frame % 5 != 0 || isVisible(rng))
+				visible.push_back(iii);
+		}
+
+		sorter.Sort(atoms, visible, view, NearZ, FarZ);
+		ExpectSortedByDepth(sorter, atoms, visible, view);
+	}
+
+	// Removing atoms leaves old indices in the remembered order, which must not end up in the result
+	atoms.erase(0);
+	atoms.pop_back();
+	std::vector<std::uint32_t> visible(atoms.size());
+	std::iota(visible.begin(), visible.end(), 0u);
+	const XMMATRIX view = LookAt({ 0.0f, 80.0f, -10.0f }, { 0.0f, 0.0f, 0.0f });
+	sorter.Sort(atoms, visible, view, NearZ, FarZ);
+	ExpectSortedByDepth(sorter, atoms, visible, view);
+}
+}
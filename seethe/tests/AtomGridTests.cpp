@@ -0,0 +1,279 @@
+#include "simulation/AtomGrid.h"
+
+#include <gtest/gtest.h>
+
+using namespace DirectX;
+
+namespace seethe
+{
+namespace
+{
+float DistanceSquared(const XMFLOAT3& a, const XMFLOAT3& b) noexcept
+{
+	const float dx = a.x - b.x;
+	const float dy = a.y - b.y;
+	const float dz = a.z - b.z;
+	return dx * dx + dy * dy + dz * dz;
+}
+
+AtomStore AtomsAt(std::span<const XMFLOAT3> positions) noexcept
+{
+	AtomStore atoms;
+	for (const XMFLOAT3& position : positions)
+		atoms.emplace_back(AtomType::HYDROGEN, position);
+	return atoms;
+}
+
+std::vector<XMFLOAT3> RandomPositions(size_t count, std::mt19937& rng) noexcept
+{
+	std::uniform_real_distribution<float> coordinate(-20.0f, 20.0f);
+	std::vector<XMFLOAT3> positions(count);
+	for (XMFLOAT3& position : positions)
+		position = { coordinate(rng), coordinate(rng), coordinate(rng) };
+	return positions;
+}
+
+// Every point of an n x n x n lattice with a spacing of 1
+std::vector<XMFLOAT3> Lattice(int n) noexcept
+{
+	std::vector<XMFLOAT3> positions;
+	for (int z = 0; z < n; ++z)
+		for (int y = 0; y < n; ++y)
+			for (int x = 0; x < n; ++x)
+				positions.push_back({ static_cast<float>(x), static_cast<float>(y), static_cast<float>(z) });
+	return positions;
+}
+
+std::vector<size_t> Sorted(std::vector<size_t> indices) noexcept
+{
+	std::ranges::sort(indices);
+	return indices;
+}
+
+std::vector<size_t> QueryRadius(const AtomGrid& grid, const XMFLOAT3& center, float radius)
+{
+	std::vector<size_t> results;
+	grid.QueryRadius(center, radius, results);
+	return Sorted(std::move(results));
+}
+
+std::vector<size_t> QueryRadiusByBruteForce(std::span<const XMFLOAT3> positions, const XMFLOAT3& center, float radius)
+{
+	std::vector<size_t> results;
+	for (size_t iii = 0; iii < positions.size(); ++iii)
+	{
+		if (DistanceSquared(positions[iii], center) <= radius * radius)
+			results.push_back(iii);
+	}
+	return results;
+}
+
+std::vector<size_t> QueryBox(const AtomGrid& grid, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+{
+	std::vector<size_t> results;
+	grid.QueryBox(boxMin, boxMax, results);
+	return Sorted(std::move(results));
+}
+
+std::vector<size_t> QueryBoxByBruteForce(std::span<const XMFLOAT3> positions, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+{
+	std::vector<size_t> results;
+	for (size_t iii = 0; iii < positions.size(); ++iii)
+	{
+		const XMFLOAT3& p = positions[iii];
+		if (p.x >= boxMin.x && p.x <= boxMax.x && p.y >= boxMin.y && p.y <= boxMax.y && p.z >= boxMin.z && p.z <= boxMax.z)
+			results.push_back(iii);
+	}
+	return results;
+}
+
+// Ties make the order (and which of the tied atoms make the cut) ambiguous, so the k nearest are compared by their
+// distances, which have to be the k smallest ones in ascending order
+void ExpectKNearestMatchesBruteForce(const AtomGrid& grid, std::span<const XMFLOAT3> positions, const XMFLOAT3& point, size_t k, std::optional<size_t> excludeIndex = std::nullopt)
+{
+	std::vector<size_t> results;
+	grid.QueryKNearest(point, k, results, excludeIndex);
+
+	std::vector<float> expected;
+	for (size_t iii = 0; iii < positions.size(); ++iii)
+	{
+		if (iii != excludeIndex)
+			expected.push_back(DistanceSquared(positions[iii], point));
+	}
+	std::ranges::sort(expected);
+	expected.resize(std::min(k, expected.size()));
+
+	std::vector<float> actual;
+	for (size_t index : results)
+		actual.push_back(DistanceSquared(positions[index], point));
+	EXPECT_EQ(actual, expected) << "k = " << k << " around " << point.x << ", " << point.y << ", " << point.z;
+
+	const std::vector<size_t> sorted = Sorted(results);
+	EXPECT_EQ(std::ranges::adjacent_find(sorted), sorted.end()) << "duplicate index";
+	if (excludeIndex)
+	{
+		EXPECT_EQ(std::ranges::find(results, *excludeIndex), results.end()) << "the excluded atom was returned";
+	}
+}
+}
+
+TEST(AtomGridTest, EmptyGridFindsNothing)
+{
+	AtomGrid grid;
+	grid.Build(AtomStore{});
+	EXPECT_TRUE(grid.Empty());
+
+	std::vector<size_t> results;
+	grid.QueryRadius({}, 100.0f, results);
+	grid.QueryBox({ -100.0f, -100.0f, -100.0f }, { 100.0f, 100.0f, 100.0f }, results);
+	grid.QueryKNearest({}, 5, results);
+	EXPECT_TRUE(results.empty());
+
+	const std::array<XMFLOAT3, 3> points = {};
+	for (const std::vector<size_t>& batch : grid.QueryRadius(points, 100.0f))
+		EXPECT_TRUE(batch.empty());
+	for (const std::vector<size_t>& batch : grid.QueryKNearest(points, 5))
+		EXPECT_TRUE(batch.empty());
+
+	// Emptying a grid that held atoms
+	const std::vector<XMFLOAT3> positions = Lattice(3);
+	AtomStore atoms = AtomsAt(positions);
+	grid.Update(atoms);
+	EXPECT_FALSE(grid.Empty());
+	atoms.clear();
+	grid.Update(atoms);
+	EXPECT_TRUE(grid.Empty());
+	EXPECT_TRUE(QueryRadius(grid, {}, 100.0f).empty());
+}
+
+TEST(AtomGridTest, SingleAtomAndCoincidentAtoms)
+{
+	// A grid without any extent has a single cell
+	const std::vector<XMFLOAT3> positions(5, XMFLOAT3{ 1.0f, 2.0f, 3.0f });
+	AtomGrid grid;
+	grid.Build(AtomsAt(std::span(positions).first(1)));
+	EXPECT_EQ(QueryRadius(grid, { 1.0f, 2.0f, 3.0f }, 0.0f), std::vector<size_t>{ 0 });
+	EXPECT_TRUE(QueryRadius(grid, { 1.0f, 2.0f, 4.0f }, 0.5f).empty());
+
+	grid.Build(AtomsAt(positions));
+	EXPECT_EQ(QueryRadius(grid, { 1.0f, 2.0f, 3.0f }, 0.0f), (std::vector<size_t>{ 0, 1, 2, 3, 4 }));
+	EXPECT_EQ(QueryBox(grid, { 1.0f, 2.0f, 3.0f }, { 1.0f, 2.0f, 3.0f }), (std::vector<size_t>{ 0, 1, 2, 3, 4 }));
+	ExpectKNearestMatchesBruteForce(grid, positions, { 0.0f, 0.0f, 0.0f }, 3);
+	ExpectKNearestMatchesBruteForce(grid, positions, { 0.0f, 0.0f, 0.0f }, 10, 2);
+}
+
+TEST(AtomGridTest, MatchesBruteForceOnRandomAtoms)
+{
+	std::mt19937 rng(11);
+	for (size_t count : { 1u, 7u, 100u, 3000u })
+	{
+		SCOPED_TRACE(count);
+		const std::vector<XMFLOAT3> positions = RandomPositions(count, rng);
+		AtomGrid grid;
+		grid.Build(AtomsAt(positions));
+
+		// Query points inside and well outside the atoms' bounds, and radii from a fraction of a cell to all of it
+		std::uniform_real_distribution<float> coordinate(-30.0f, 30.0f);
+		std::uniform_real_distribution<float> radius(0.0f, 15.0f);
+		std::uniform_int_distribution<size_t> k(1, 40);
+		for (int iii = 0; iii < 100; ++iii)
+		{
+			const XMFLOAT3 point = { coordinate(rng), coordinate(rng), coordinate(rng) };
+			const float r = iii == 0 ? 100.0f : radius(rng);
+			EXPECT_EQ(QueryRadius(grid, point, r), QueryRadiusByBruteForce(positions, point, r));
+
+			const XMFLOAT3 corner = { coordinate(rng), coordinate(rng), coordinate(rng) };
+			const XMFLOAT3 boxMin = { std::min(point.x, corner.x), std::min(point.y, corner.y), std::min(point.z, corner.z) };
+			const XMFLOAT3 boxMax = { std::max(point.x, corner.x), std::max(point.y, corner.y), std::max(point.z, corner.z) };
+			EXPECT_EQ(QueryBox(grid, boxMin, boxMax), QueryBoxByBruteForce(positions, boxMin, boxMax));
+
+			ExpectKNearestMatchesBruteForce(grid, positions, point, k(rng));
+		}
+
+		// The neighbors of the atoms themselves, which is how the grid is used
+		for (size_t iii = 0; iii < count; iii += std::max<size_t>(1, count / 50))
+			ExpectKNearestMatchesBruteForce(grid, positions, positions[iii], 8, iii);
+
+		// Asking for more neighbors than there are atoms returns all of them
+		ExpectKNearestMatchesBruteForce(grid, positions, {}, count + 5);
+	}
+}
+
+TEST(AtomGridTest, AtomsAndQueriesOnCellBoundaries)
+{
+	// The cell size only depends on the atom count and the bounds, so a second set of atoms with the same count and
+	// bounds as the lattice gets the same cells, and can be put exactly on their faces, edges and corners
+	constexpr int n = 10;
+	std::vector<XMFLOAT3> positions = Lattice(n);
+	AtomGrid grid;
+	grid.Build(AtomsAt(positions));
+	const float cellSize = grid.GetCellSize();
+	const int cells = static_cast<int>((n - 1) / cellSize);
+	ASSERT_GE(cells, 2);
+
+	std::mt19937 rng(12);
+	std::uniform_int_distribution<int> cell(0, cells);
+	std::uniform_real_distribution<float> coordinate(0.0f, n - 1.0f);
+	for (size_t iii = 2; iii < positions.size(); ++iii)
+	{
+		const float boundary = cell(rng) * cellSize;
+		switch (iii % 4)
+		{
+		case 0: positions[iii] = { boundary, coordinate(rng), coordinate(rng) }; break;
+		case 1: positions[iii] = { coordinate(rng), boundary, boundary }; break;
+		case 2: positions[iii] = { boundary, cell(rng) * cellSize, cell(rng) * cellSize }; break;
+		default: positions[iii] = { coordinate(rng), coordinate(rng), boundary }; break;
+		}
+	}
+	positions[0] = { 0.0f, 0.0f, 0.0f };
+	positions[1] = { n - 1.0f, n - 1.0f, n - 1.0f };
+	grid.Build(AtomsAt(positions));
+	ASSERT_EQ(grid.GetCellSize(), cellSize);
+
+	// Queries centered on the boundaries, with radii and boxes that end exactly on other boundaries and atoms
+	for (int iii = 0; iii < 200; ++iii)
+	{
+		const XMFLOAT3 point = { cell(rng) * cellSize, cell(rng) * cellSize, cell(rng) * cellSize };
+		const float radius = std::uniform_int_distribution<int>(0, 3)(rng) * cellSize;
+		EXPECT_EQ(QueryRadius(grid, point, radius), QueryRadiusByBruteForce(positions, point, radius));
+
+		const XMFLOAT3 boxMax = { point.x + radius, point.y + cellSize, point.z + 2.0f * radius };
+		EXPECT_EQ(QueryBox(grid, point, boxMax), QueryBoxByBruteForce(positions, point, boxMax));
+
+		ExpectKNearestMatchesBruteForce(grid, positions, point, 1 + iii % 20);
+	}
+
+	// The lattice itself, where a radius of 1 ends exactly on the neighboring atoms
+	const std::vector<XMFLOAT3> lattice = Lattice(n);
+	grid.Build(AtomsAt(lattice));
+	for (const XMFLOAT3& point : { lattice[0], lattice[111], lattice[555], lattice[999] })
+	{
+		EXPECT_EQ(QueryRadius(grid, point, 1.0f), QueryRadiusByBruteForce(lattice, point, 1.0f));
+		EXPECT_EQ(QueryBox(grid, point, { point.x + 1.0f, point.y + 1.0f, point.z + 1.0f }),
+			QueryBoxByBruteForce(lattice, point, { point.x + 1.0f, point.y + 1.0f, point.z + 1.0f }));
+		ExpectKNearestMatchesBruteForce(grid, lattice, point, 7);
+	}
+}
+
+TEST(AtomGridTest, BatchedQueriesMatchSingleQueries)
+{
+	std::mt19937 rng(13);
+	const std::vector<XMFLOAT3> positions = RandomPositions(2000, rng);
+	const std::vector<XMFLOAT3> points = RandomPositions(500, rng);
+	AtomGrid grid;
+	grid.Build(AtomsAt(positions));
+
+	const std::vector<std::vector<size_t>> radius = grid.QueryRadius(points, 4.0f);
+	const std::vector<std::vector<size_t>> nearest = grid.QueryKNearest(points, 6);
+	ASSERT_EQ(radius.size(), points.size());
+	ASSERT_EQ(nearest.size(), points.size());
+	for (size_t iii = 0; iii < points.size(); ++iii)
+	{
+		EXPECT_EQ(Sorted(radius[iii]), QueryRadiusByBruteForce(positions, points[iii], 4.0f));
+
+		std::vector<size_t> single;
+		grid.QueryKNearest(points[iii], 6, single);
+		EXPECT_EQ(nearest[iii], single);
+	}
+}
+}
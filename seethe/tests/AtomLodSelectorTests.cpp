@@ -0,0 +1,95 @@
+#include "rendering/AtomLodSelector.h"
+
+#include <gtest/gtest.h>
+
+using namespace DirectX;
+
+namespace seethe
+{
+namespace
+{
+constexpr unsigned int NoPreviousLod = AtomLodSelector::LodCount;
+
+// With an identity view matrix the view space depth is just z, so a hydrogen atom (radius 0.5) at depth 'z' has a
+// projected radius of 0.5 * PixelsPerUnit / z
+constexpr float PixelsPerUnit = 100.0f;
+
+AtomStore HydrogenAtomsAtDepths(std::initializer_list<float> depths) noexcept
+{
+	AtomStore atoms;
+	for (float z : depths)
+		atoms.emplace_back(AtomType::HYDROGEN, XMFLOAT3{ 0.0f, 0.0f, z });
+	return atoms;
+}
+}
+
+TEST(AtomLodSelectorTest, PicksTheMostDetailedLodAtOrAboveItsThreshold)
+{
+	const auto& thresholds = AtomLodSelector::LodThresholds;
+
+	EXPECT_EQ(AtomLodSelector::LodForRadius(1000.0f, NoPreviousLod), 0u);
+	for (unsigned int lod = 0; lod + 1 < AtomLodSelector::LodCount; ++lod)
+	{
+		EXPECT_EQ(AtomLodSelector::LodForRadius(thresholds[lod], NoPreviousLod), lod);
+		EXPECT_EQ(AtomLodSelector::LodForRadius(std::nextafter(thresholds[lod], 0.0f), NoPreviousLod), lod + 1);
+	}
+	EXPECT_EQ(AtomLodSelector::LodForRadius(0.0f, NoPreviousLod), AtomLodSelector::LodCount - 1);
+}
+
+TEST(AtomLodSelectorTest, HysteresisKeepsTheLodNearABandEdge)
+{
+	constexpr float hysteresis = AtomLodSelector::Hysteresis;
+	const float edge = AtomLodSelector::LodThresholds[0];
+
+	// Coming from LOD 1, the radius has to pass the edge by the hysteresis factor before LOD 0 is used
+	EXPECT_EQ(AtomLodSelector::LodForRadius(edge * 1.01f, 1), 1u);
+	EXPECT_EQ(AtomLodSelector::LodForRadius(edge * (1.0f + hysteresis) * 0.99f, 1), 1u);
+	EXPECT_EQ(AtomLodSelector::LodForRadius(edge * (1.0f + hysteresis), 1), 0u);
+
+	// And the other way around
+	EXPECT_EQ(AtomLodSelector::LodForRadius(edge * 0.99f, 0), 0u);
+	EXPECT_EQ(AtomLodSelector::LodForRadius(edge * (1.0f - hysteresis), 0), 0u);
+	EXPECT_EQ(AtomLodSelector::LodForRadius(edge * (1.0f - hysteresis) * 0.99f, 0), 1u);
+
+	// Hysteresis only applies at the edge - a large change still jumps straight to the right LOD
+	EXPECT_EQ(AtomLodSelector::LodForRadius(1000.0f, AtomLodSelector::LodCount - 1), 0u);
+	EXPECT_EQ(AtomLodSelector::LodForRadius(0.0f, 0), AtomLodSelector::LodCount - 1);
+}
+
+TEST(AtomLodSelectorTest, BucketsVisibleAtomsByProjectedRadius)
+{
+	// Projected radii of 50, 25, 10 and 2.5 pixels, plus one atom behind the camera (treated as full detail)
+	const AtomStore atoms = HydrogenAtomsAtDepths({ 1.0f, 2.0f, 5.0f, 20.0f, -1.0f, 2.0f });
+	const std::vector<std::uint32_t> visible = { 0, 1, 2, 3, 4 };
+
+	AtomLodSelector selector;
+	selector.Select(atoms, visible, XMMatrixIdentity(), PixelsPerUnit);
+
+	EXPECT_EQ(selector.GetInstances(0), (std::vector<std::uint32_t>{ 0, 4 }));
+	EXPECT_EQ(selector.GetInstances(1), (std::vector<std::uint32_t>{ 1 }));		// Atom 5 is not visible
+	EXPECT_EQ(selector.GetInstances(2), (std::vector<std::uint32_t>{ 2 }));
+	EXPECT_EQ(selector.GetInstances(3), (std::vector<std::uint32_t>{ 3 }));
+}
+
+TEST(AtomLodSelectorTest, RemembersTheLodOfEachAtomBetweenFrames)
+{
+	// Both atoms end up just below the LOD 0 edge (38 pixels), but only atom 0 was drawn at LOD 0 last frame
+	const float below = 0.5f * PixelsPerUnit / 38.0f;
+	const std::vector<std::uint32_t> visible = { 0, 1 };
+
+	AtomLodSelector selector;
+	selector.Select(HydrogenAtomsAtDepths({ 1.0f, 2.0f }), visible, XMMatrixIdentity(), PixelsPerUnit);
+	ASSERT_EQ(selector.GetInstances(0), (std::vector<std::uint32_t>{ 0 }));
+	ASSERT_EQ(selector.GetInstances(1), (std::vector<std::uint32_t>{ 1 }));
+
+	selector.Select(HydrogenAtomsAtDepths({ below, below }), visible, XMMatrixIdentity(), PixelsPerUnit);
+	EXPECT_EQ(selector.GetInstances(0), (std::vector<std::uint32_t>{ 0 }));
+	EXPECT_EQ(selector.GetInstances(1), (std::vector<std::uint32_t>{ 1 }));
+
+	// Once it is well past the edge, atom 0 switches as well
+	const float farBelow = 0.5f * PixelsPerUnit / 30.0f;
+	selector.Select(HydrogenAtomsAtDepths({ farBelow, farBelow }), visible, XMMatrixIdentity(), PixelsPerUnit);
+	EXPECT_EQ(selector.GetInstanceCount(0), 0u);
+	EXPECT_EQ(selector.GetInstances(1), (std::vector<std::uint32_t>{ 0, 1 }));
+}
+}
@@ -0,0 +1,224 @@
+#include "rendering/AtomOcclusionCuller.h"
+
+#include <gtest/gtest.h>
+
+using namespace DirectX;
+
+namespace seethe
+{
+namespace
+{
+// Camera at the origin looking down +z (an identity view matrix), with a 90 degree vertical field of view and the
+// aspect ratio of the default buffer. That makes a pixel 1/72 of a unit wide in tan space, in both directions
+constexpr float FovY = XM_PIDIV2;
+constexpr float Aspect = static_cast<float>(AtomOcclusionCuller::DefaultWidth) / AtomOcclusionCuller::DefaultHeight;
+constexpr float NearZ = 0.1f;
+constexpr float PixelsPerTan = 0.5f * AtomOcclusionCuller::DefaultHeight;
+
+XMFLOAT2 PixelToTan(float x, float y) noexcept
+{
+	return { (x - 0.5f * AtomOcclusionCuller::DefaultWidth) / PixelsPerTan, (0.5f * AtomOcclusionCuller::DefaultHeight - y) / PixelsPerTan };
+}
+
+// Depth at which the ray through (tanX, tanY, 1) first hits the sphere, or nothing if it misses
+std::optional<float> RayHitDepth(float tanX, float tanY, const XMFLOAT3& c, float radius) noexcept
+{
+	const float a = tanX * tanX + tanY * tanY + 1.0f;
+	const float b = tanX * c.x + tanY * c.y + c.z;
+	const float discriminant = b * b - a * (c.x * c.x + c.y * c.y + c.z * c.z - radius * radius);
+	if (discriminant < 0.0f)
+		return std::nullopt;
+	return (b - std::sqrt(discriminant)) / a;
+}
+
+Atom MakeAtom(const XMFLOAT3& position, float radius) noexcept
+{
+	Atom atom(AtomType::HYDROGEN, position);
+	atom.radius = radius;
+	return atom;
+}
+
+// The culler draws the first atoms it is given as occluders, so hand it the indices front to back like the renderer does
+std::vector<std::uint32_t> FrontToBack(const AtomStore& atoms) noexcept
+{
+	std::vector<std::uint32_t> indices(atoms.size());
+	std::iota(indices.begin(), indices.end(), 0u);
+	std::ranges::stable_sort(indices, {}, [&atoms](std::uint32_t index) { return atoms[index].position.z; });
+	return indices;
+}
+
+void Cull(AtomOcclusionCuller& culler, const AtomStore& atoms, std::span<const std::uint32_t> indices) noexcept
+{
+	culler.Cull(atoms, indices, XMMatrixIdentity(), FovY, Aspect, NearZ);
+}
+}
+
+TEST(AtomOcclusionCullerTest, RasterizesOnlyPixelsTheOccluderFullyCovers)
+{
+	AtomStore atoms;
+	atoms.push_back(MakeAtom({ 1.0f, -0.5f, 10.0f }, 2.0f));
+	const std::vector<std::uint32_t> indices = { 0 };
+
+	AtomOcclusionCuller culler;
+	Cull(culler, atoms, indices);
+	ASSERT_EQ(culler.GetOccluderCount(), 1u);
+
+	const Atom& atom = atoms[0];
+	const float farDepth = atom.position.z + atom.radius;
+	size_t covered = 0;
+
+	for (unsigned int y = 0; y < culler.GetLevelHeight(0); ++y)
+	{
+		for (unsigned int x = 0; x < culler.GetLevelWidth(0); ++x)
+		{
+			const float depth = culler.GetDepth(0, x, y);
+			if (depth == FLT_MAX)
+				continue;
+			++covered;
+			ASSERT_EQ(depth, farDepth) << x << ", " << y;
+
+			// Every ray through the pixel, including the ones through its corners, must hit the atom no further away
+			for (const XMFLOAT2& corner : { XMFLOAT2{ 0.0f, 0.0f }, XMFLOAT2{ 1.0f, 0.0f }, XMFLOAT2{ 0.0f, 1.0f }, XMFLOAT2{ 1.0f, 1.0f } })
+			{
+				const XMFLOAT2 tan = PixelToTan(x + corner.x, y + corner.y);
+				const std::optional<float> hit = RayHitDepth(tan.x, tan.y, atom.position, atom.radius);
+				ASSERT_TRUE(hit) << x << ", " << y;
+				EXPECT_LE(*hit, depth);
+			}
+		}
+	}
+
+	// The disc is shrunk to stay conservative, but it should still claim most of the pixels inside the silhouette
+	const float projectedRadius = atom.radius / std::sqrt(1.0f + 0.25f + 100.0f) * PixelsPerTan;
+	EXPECT_GT(static_cast<float>(covered), 0.75f * XM_PI * projectedRadius * projectedRadius);
+
+	// Including the pixel under the center
+	const XMFLOAT2 center = { 0.5f * AtomOcclusionCuller::DefaultWidth + atom.position.x / atom.position.z * PixelsPerTan,
+							  0.5f * AtomOcclusionCuller::DefaultHeight - atom.position.y / atom.position.z * PixelsPerTan };
+	EXPECT_EQ(culler.GetDepth(0, static_cast<unsigned int>(center.x), static_cast<unsigned int>(center.y)), farDepth);
+}
+
+TEST(AtomOcclusionCullerTest, HierarchyHoldsTheFarthestDepthBelowEachTexel)
+{
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> lateral(-8.0f, 8.0f);
+	std::uniform_real_distribution<float> depth(5.0f, 30.0f);
+	std::uniform_real_distribution<float> radius(0.5f, 2.0f);
+
+	AtomStore atoms;
+	for (int iii = 0; iii < 300; ++iii)
+		atoms.push_back(MakeAtom({ lateral(rng), lateral(rng), depth(rng) }, radius(rng)));
+
+	AtomOcclusionCuller culler;
+	Cull(culler, atoms, FrontToBack(atoms));
+	ASSERT_GT(culler.GetOccluderCount(), 0u);
+
+	const unsigned int top = culler.GetLevelCount() - 1;
+	EXPECT_EQ(culler.GetLevelWidth(top), 1u);
+	EXPECT_EQ(culler.GetLevelHeight(top), 1u);
+
+	for (unsigned int level = 1; level < culler.GetLevelCount(); ++level)
+	{
+		for (unsigned int y = 0; y < culler.GetLevelHeight(level); ++y)
+		{
+			for (unsigned int x = 0; x < culler.GetLevelWidth(level); ++x)
+			{
+				float farthest = 0.0f;
+				for (unsigned int sy = 2 * y; sy < std::min(2 * y + 2, culler.GetLevelHeight(level - 1)); ++sy)
+					for (unsigned int sx = 2 * x; sx < std::min(2 * x + 2, culler.GetLevelWidth(level - 1)); ++sx)
+						farthest = std::max(farthest, culler.GetDepth(level - 1, sx, sy));
+				ASSERT_EQ(culler.GetDepth(level, x, y), farthest) << "level " << level << ": " << x << ", " << y;
+			}
+		}
+	}
+}
+
+TEST(AtomOcclusionCullerTest, CullsAtomsBehindAnOccluderButNotTheOnesPeekingOut)
+{
+	AtomStore atoms;
+	atoms.push_back(MakeAtom({ 0.0f, 0.0f, 5.0f }, 2.0f));		// Occluder
+	atoms.push_back(MakeAtom({ 0.0f, 0.0f, 20.0f }, 0.5f));		// Straight behind it
+	atoms.push_back(MakeAtom({ 8.5f, 0.0f, 20.0f }, 0.5f));		// Across the edge of its silhouette (~8.7 units out at z = 20)
+	atoms.push_back(MakeAtom({ 0.0f, 0.0f, 6.0f }, 0.5f));		// Behind its center, but in front of its far side
+	atoms.push_back(MakeAtom({ 0.0f, 30.0f, 20.0f }, 0.5f));	// Off screen
+
+	AtomOcclusionCuller culler;
+	Cull(culler, atoms, FrontToBack(atoms));
+
+	EXPECT_EQ(culler.GetVisibleIndices(), (std::vector<std::uint32_t>{ 0, 3, 2, 4 }));
+	EXPECT_EQ(culler.GetOccludedCount(), 1u);
+}
+
+TEST(AtomOcclusionCullerTest, NeverCullsAVisibleAtom)
+{
+	std::mt19937 rng(21);
+
+	// A wall of overlapping atoms with a few holes in it, and a crowd of smaller atoms on both sides of it. Plenty of
+	// atoms are hidden, and plenty are only partly hidden behind the edges of the wall or the holes
+	AtomStore atoms;
+	std::bernoulli_distribution hole(0.08);
+	for (int y = -8; y <= 8; ++y)
+		for (int x = -10; x <= 10; ++x)
+			if (!hole(rng))
+				atoms.push_back(MakeAtom({ 1.2f * x, 1.2f * y, 15.0f }, 1.0f));
+
+	std::uniform_real_distribution<float> lateral(-16.0f, 16.0f);
+	std::uniform_real_distribution<float> depth(8.0f, 40.0f);
+	std::uniform_real_distribution<float> radius(0.2f, 1.2f);
+	for (int iii = 0; iii < 1500; ++iii)
+		atoms.push_back(MakeAtom({ lateral(rng), lateral(rng), depth(rng) }, radius(rng)));
+
+	const std::vector<std::uint32_t> indices = FrontToBack(atoms);
+	AtomOcclusionCuller culler;
+	Cull(culler, atoms, indices);
+
+	// Anything the culler dropped has to be hidden along every ray that hits it. The rays are 4x denser than the
+	// buffer's pixels, which is plenty to catch an atom that peeks out by a pixel
+	const std::vector<std::uint32_t>& visible = culler.GetVisibleIndices();
+	std::vector<std::uint8_t> isVisible(atoms.size(), 0);
+	for (std::uint32_t index : visible)
+		isVisible[index] = 1;
+
+	constexpr float step = 0.25f / PixelsPerTan;
+	size_t occluded = 0;
+	for (std::uint32_t index : indices)
+	{
+		if (isVisible[index])
+			continue;
+		++occluded;
+
+		const Atom& atom = atoms[index];
+		const XMFLOAT3& c = atom.position;
+		const float extent = atom.radius / (c.z - atom.radius);
+
+		for (float tanY = c.y / c.z - extent; tanY <= c.y / c.z + extent; tanY += step)
+		{
+			for (float tanX = c.x / c.z - extent; tanX <= c.x / c.z + extent; tanX += step)
+			{
+				const std::optional<float> hit = RayHitDepth(tanX, tanY, c, atom.radius);
+				if (!hit)
+					continue;
+
+				bool hidden = false;
+				for (size_t other = 0; other < atoms.size() && !hidden; ++other)
+				{
+					if (other == index)
+						continue;
+					const std::optional<float> otherHit = RayHitDepth(tanX, tanY, atoms[other].position, atoms[other].radius);
+					hidden = otherHit && *otherHit < *hit;
+				}
+				ASSERT_TRUE(hidden) << "atom " << index << " is visible through " << tanX << ", " << tanY;
+			}
+		}
+	}
+
+	EXPECT_EQ(occluded, culler.GetOccludedCount());
+	EXPECT_EQ(visible.size() + occluded, atoms.size());
+	EXPECT_GT(occluded, atoms.size() / 6);		// Otherwise this would not test much
+
+	// The visible atoms keep the front to back order they came in
+	std::vector<std::uint32_t> expected;
+	std::ranges::copy_if(indices, std::back_inserter(expected), [&isVisible](std::uint32_t index) { return isVisible[index] != 0; });
+	EXPECT_EQ(visible, expected);
+}
+}
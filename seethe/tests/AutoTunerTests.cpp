@@ -0,0 +1,109 @@
+#include "application/AutoTuner.h"
+#include "application/ScalingTest.h"
+#include "simulation/Simulation.h"
+#include "utils/ThreadPool.h"
+
+#include <gtest/gtest.h>
+
+namespace seethe
+{
+namespace
+{
+class AutoTunerTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		m_cachePath = std::filesystem::temp_directory_path() / std::format("seethe-autotuner-{}.json", ::testing::UnitTest::GetInstance()->current_test_info()->name());
+		m_threadCount = ThreadPool::Get().GetThreadCount();
+
+		std::mt19937 rng(1);
+		GenerateScene(m_simulation, SyntheticScene::UNIFORM_GAS, AutoTuner::MinAtomCount, rng);
+	}
+	void TearDown() override
+	{
+		TuningParameters::Apply(TuningParameters{});
+		ThreadPool::Get().SetThreadCount(m_threadCount);
+		std::filesystem::remove(m_cachePath);
+	}
+
+	void WriteCache(const json& cache) const
+	{
+		std::ofstream(m_cachePath) << cache.dump();
+	}
+	json ReadCache() const
+	{
+		std::ifstream file(m_cachePath);
+		return json::parse(file);
+	}
+
+	static json Parameters(unsigned int threadCount)
+	{
+		return { { "ThreadCount", threadCount }, { "GridAtomsPerCell", 2.0f }, { "SimulationGrainSize", 4 }, { "AmbientOcclusionGrainSize", 256 }, { "StepMs", 1.0 } };
+	}
+
+	std::filesystem::path m_cachePath;
+	unsigned int m_threadCount = 1;
+	Simulation m_simulation;
+};
+}
+
+TEST_F(AutoTunerTest, AppliesCachedParameters)
+{
+	const std::string hardware = AutoTuner::HardwareSignature();
+	const std::string scene = AutoTuner::SceneSignature(m_simulation);
+	WriteCache({ { hardware, { { scene, Parameters(1) } } } });
+
+	AutoTuner tuner(m_cachePath);
+	tuner.OnSimulationStarted(m_simulation);
+
+	EXPECT_EQ(ThreadPool::Get().GetThreadCount(), 1u);
+	EXPECT_EQ(TuningParameters::Current().simulationGrainSize, 4u);
+	EXPECT_EQ(TuningParameters::Current().ambientOcclusionGrainSize, 256u);
+}
+
+TEST_F(AutoTunerTest, ClampsTheCachedThreadCountToTheHardware)
+{
+	WriteCache({ { AutoTuner::HardwareSignature(), { { AutoTuner::SceneSignature(m_simulation), Parameters(100'000) } } } });
+
+	AutoTuner tuner(m_cachePath);
+	tuner.OnSimulationStarted(m_simulation);
+
+	EXPECT_EQ(ThreadPool::Get().GetThreadCount(), std::max(1u, std::thread::hardware_concurrency()));
+	EXPECT_EQ(TuningParameters::Current().simulationGrainSize, 4u);
+}
+
+TEST_F(AutoTunerTest, SurvivesACacheWithTheWrongShape)
+{
+	// Both levels above the parameters are indexed as objects, so neither may be anything else
+	const std::string hardware = AutoTuner::HardwareSignature();
+	const std::string scene = AutoTuner::SceneSignature(m_simulation);
+
+	for (const json& cache : { json{ { hardware, 5 } }, json{ { hardware, { { scene, "fast" } } } }, json{ { hardware, { { scene, { { "ThreadCount", "many" } } } } } } })
+	{
+		WriteCache(cache);
+
+		AutoTuner tuner(m_cachePath);
+		tuner.OnSimulationStarted(m_simulation);
+
+		// The scene was tuned instead, and the result replaced the bad entry
+		const json saved = ReadCache();
+		ASSERT_TRUE(saved.contains(hardware)) << cache.dump();
+		ASSERT_TRUE(saved[hardware].is_object()) << cache.dump();
+		ASSERT_TRUE(saved[hardware].contains(scene)) << cache.dump();
+		EXPECT_TRUE(saved[hardware][scene].contains("ThreadCount")) << cache.dump();
+		EXPECT_TRUE(saved[hardware][scene]["ThreadCount"].is_number_unsigned()) << cache.dump();
+	}
+}
+
+TEST_F(AutoTunerTest, KeepsTheValidPartsOfACache)
+{
+	const std::string hardware = AutoTuner::HardwareSignature();
+	const std::string scene = AutoTuner::SceneSignature(m_simulation);
+	WriteCache({ { "Some other CPU", 5 }, { hardware, { { "some other scene", 7 }, { scene, Parameters(1) } } } });
+
+	AutoTuner tuner(m_cachePath);
+	tuner.OnSimulationStarted(m_simulation);
+	EXPECT_EQ(ThreadPool::Get().GetThreadCount(), 1u);
+}
+}
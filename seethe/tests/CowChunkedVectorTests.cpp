@@ -0,0 +1,241 @@
+#include "utils/CowChunkedVector.h"
+#include "utils/ThreadPool.h"
+
+#include <gtest/gtest.h>
+
+namespace seethe
+{
+namespace
+{
+// Small chunks, so a handful of elements already spans several of them
+using Vector = CowChunkedVector<int, 4>;
+
+Vector Iota(int count) noexcept
+{
+	Vector vector;
+	for (int iii = 0; iii < count; ++iii)
+		vector.push_back(iii);
+	return vector;
+}
+
+std::vector<int> Elements(const Vector& vector)
+{
+	return std::vector<int>(vector.begin(), vector.end());
+}
+
+// Every chunk but the last one must be full
+void ExpectPackedChunks(const Vector& vector)
+{
+	ASSERT_EQ(vector.ChunkCount(), (vector.size() + Vector::ChunkCapacity - 1) / Vector::ChunkCapacity);
+	for (size_t iii = 0; iii + 1 < vector.ChunkCount(); ++iii)
+		EXPECT_EQ(vector.GetChunk(iii).size(), Vector::ChunkCapacity) << "chunk " << iii;
+}
+}
+
+TEST(CowChunkedVectorTest, InsertCarriesElementsIntoTheFollowingChunks)
+{
+	Vector vector = Iota(12);
+	ASSERT_EQ(vector.ChunkCount(), 3u);
+
+	// Every chunk is full, so the insert pushes the last element of each one into the next, and adds a new chunk
+	EXPECT_EQ(vector.insert(1, 100), 100);
+	EXPECT_EQ(Elements(vector), (std::vector<int>{ 0, 100, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 }));
+	ExpectPackedChunks(vector);
+	EXPECT_EQ(vector.ChunkCount(), 4u);
+
+	vector.insert(vector.size(), 200);
+	vector.insert(vector.cbegin() + 8, 300);
+	EXPECT_EQ(Elements(vector), (std::vector<int>{ 0, 100, 1, 2, 3, 4, 5, 6, 300, 7, 8, 9, 10, 11, 200 }));
+	ExpectPackedChunks(vector);
+}
+
+TEST(CowChunkedVectorTest, EraseDrawsElementsBackFromTheFollowingChunks)
+{
+	Vector vector = Iota(9);
+	ASSERT_EQ(vector.ChunkCount(), 3u);
+
+	// The last chunk only holds one element, so pulling it forward leaves it empty and it is dropped
+	vector.erase(2);
+	EXPECT_EQ(Elements(vector), (std::vector<int>{ 0, 1, 3, 4, 5, 6, 7, 8 }));
+	ExpectPackedChunks(vector);
+	EXPECT_EQ(vector.ChunkCount(), 2u);
+
+	vector.erase(vector.size() - 1);
+	vector.erase(0);
+	EXPECT_EQ(Elements(vector), (std::vector<int>{ 1, 3, 4, 5, 6, 7 }));
+	ExpectPackedChunks(vector);
+}
+
+TEST(CowChunkedVectorTest, IteratesOverWhatIsLeftAfterErasing)
+{
+	Vector vector = Iota(20);
+
+	// Erase the even elements the way one would with a std::vector
+	for (auto it = vector.begin(); it != vector.end();)
+	{
+		if (*it % 2 == 0)
+			it = vector.erase(it);
+		else
+			++it;
+	}
+
+	EXPECT_EQ(Elements(vector), (std::vector<int>{ 1, 3, 5, 7, 9, 11, 13, 15, 17, 19 }));
+	EXPECT_EQ(vector.end() - vector.begin(), 10);
+	EXPECT_EQ(std::as_const(vector).cbegin()[3], 7);
+	EXPECT_EQ(vector.back(), 19);
+	ExpectPackedChunks(vector);
+}
+
+TEST(CowChunkedVectorTest, MatchesAStdVectorUnderRandomEdits)
+{
+	std::mt19937 rng(5);
+	Vector vector;
+	std::vector<int> expected;
+
+	for (int iii = 0; iii < 2000; ++iii)
+	{
+		const int operation = std::uniform_int_distribution<int>(0, 3)(rng);
+		if (operation <= 1 || expected.empty())
+		{
+			const size_t index = std::uniform_int_distribution<size_t>(0, expected.size())(rng);
+			vector.insert(index, iii);
+			expected.insert(expected.begin() + index, iii);
+		}
+		else if (operation == 2)
+		{
+			const size_t index = std::uniform_int_distribution<size_t>(0, expected.size() - 1)(rng);
+			vector.erase(index);
+			expected.erase(expected.begin() + index);
+		}
+		else
+		{
+			vector.pop_back();
+			expected.pop_back();
+		}
+	}
+
+	EXPECT_EQ(Elements(vector), expected);
+	ExpectPackedChunks(vector);
+}
+
+TEST(CowChunkedVectorTest, WritesOnlyCopyTheChunksTheyTouch)
+{
+	Vector vector = Iota(12);
+	const Vector snapshot = vector.Snapshot();
+	for (size_t iii = 0; iii < vector.ChunkCount(); ++iii)
+		EXPECT_TRUE(vector.ChunkIsShared(iii));
+
+	// Reading does not unshare anything
+	EXPECT_EQ(std::as_const(vector)[5], 5);
+	EXPECT_TRUE(vector.ChunkIsShared(1));
+
+	vector[5] = 50;
+	EXPECT_TRUE(vector.ChunkIsShared(0));
+	EXPECT_FALSE(vector.ChunkIsShared(1));
+	EXPECT_TRUE(vector.ChunkIsShared(2));
+	EXPECT_EQ(snapshot[5], 5);
+	EXPECT_EQ(vector[5], 50);
+
+	// The untouched chunks are still the same memory
+	EXPECT_EQ(vector.GetChunk(0).data(), snapshot.GetChunk(0).data());
+	EXPECT_NE(vector.GetChunk(1).data(), snapshot.GetChunk(1).data());
+
+	// Structural edits behave the same way
+	vector.erase(0);
+	EXPECT_EQ(Elements(snapshot), (std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 }));
+	EXPECT_EQ(Elements(vector), (std::vector<int>{ 1, 2, 3, 4, 50, 6, 7, 8, 9, 10, 11 }));
+}
+
+TEST(CowChunkedVectorTest, ChunksAreWrittenInPlaceOnceTheSnapshotIsGone)
+{
+	Vector vector = Iota(8);
+	const int* first = vector.GetChunk(0).data();
+
+	// Released on another thread, like a save that finished in the background
+	std::optional<Vector> snapshot = vector.Snapshot();
+	std::thread([&snapshot]() { EXPECT_EQ(Elements(*snapshot).size(), 8u); snapshot.reset(); }).join();
+
+	EXPECT_FALSE(vector.ChunkIsShared(0));
+	vector[0] = 10;
+	EXPECT_EQ(vector.GetChunk(0).data(), first);
+}
+
+TEST(CowChunkedVectorTest, ParallelChunkWritesUnshareEachChunk)
+{
+	Vector vector = Iota(4000);
+	const Vector snapshot = vector.Snapshot();
+
+	vector.ParallelForEachChunk(ThreadPool::Get(), 8, [](std::span<int> chunk)
+	{
+		for (int& value : chunk)
+			value = -value;
+	});
+
+	for (size_t iii = 0; iii < vector.size(); ++iii)
+	{
+		ASSERT_EQ(vector[iii], -static_cast<int>(iii));
+		ASSERT_EQ(snapshot[iii], static_cast<int>(iii));
+	}
+}
+
+TEST(CowChunkedVectorTest, VersionsMoveForwardOnEveryMutation)
+{
+	Vector vector = Iota(10);
+	std::uint64_t version = vector.Version();
+	std::uint64_t structure = vector.StructureVersion();
+
+	auto ExpectBumped = [&](bool elements, bool structural)
+		{
+			EXPECT_EQ(vector.Version() != version, elements);
+			EXPECT_EQ(vector.StructureVersion() != structure, structural);
+			EXPECT_GE(vector.Version(), version);
+			EXPECT_GE(vector.StructureVersion(), structure);
+			version = vector.Version();
+			structure = vector.StructureVersion();
+		};
+
+	[[maybe_unused]] int read = std::as_const(vector)[3] + std::as_const(vector).front();
+	for ([[maybe_unused]] int value : std::as_const(vector)) {}
+	ExpectBumped(false, false);
+
+	vector[3] = 30;
+	ExpectBumped(true, false);
+
+	vector.ForEachChunk([](std::span<int>) {});
+	ExpectBumped(true, false);
+
+	vector.ParallelForEachChunk(ThreadPool::Get(), 1, [](std::span<int>) {});
+	ExpectBumped(true, false);
+
+	vector.push_back(10);
+	ExpectBumped(true, true);
+
+	vector.insert(0, -1);
+	ExpectBumped(true, true);
+
+	vector.erase(4);
+	ExpectBumped(true, true);
+
+	vector.pop_back();
+	ExpectBumped(true, true);
+
+	// Assigning an older container must not take the versions back to values derived data may have seen already
+	const Vector older = Iota(3);
+	vector = older;
+	ExpectBumped(true, true);
+
+	vector.clear();
+	ExpectBumped(true, true);
+}
+
+TEST(CowChunkedVectorTest, FindsTheIndexOfItsOwnElements)
+{
+	Vector vector = Iota(10);
+	EXPECT_EQ(vector.IndexOf(std::as_const(vector)[0]), 0u);
+	EXPECT_EQ(vector.IndexOf(std::as_const(vector)[6]), 6u);
+	EXPECT_EQ(vector.IndexOf(std::as_const(vector)[9]), 9u);
+
+	const int elsewhere = 6;
+	EXPECT_EQ(vector.IndexOf(elsewhere), vector.size());
+}
+}
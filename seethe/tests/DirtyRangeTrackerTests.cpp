@@ -0,0 +1,146 @@
+#include "utils/DirtyRangeTracker.h"
+#include "simulation/Simulation.h"
+
+#include <gtest/gtest.h>
+
+using namespace DirectX;
+
+namespace seethe
+{
+namespace
+{
+using Ranges = std::vector<std::pair<size_t, size_t>>;
+
+// The ranges that changed since 'version', or nothing if the tracker says to resync everything
+std::optional<Ranges> Collect(const DirtyRangeTracker& tracker, std::uint64_t version)
+{
+	std::vector<IndexRange> ranges;
+	if (!tracker.CollectSince(version, ranges))
+		return std::nullopt;
+
+	Ranges result;
+	for (const IndexRange& range : ranges)
+		result.emplace_back(range.begin, range.end);
+	return result;
+}
+}
+
+TEST(DirtyRangeTrackerTest, MergesOverlappingAndAdjacentRanges)
+{
+	DirtyRangeTracker tracker;
+	tracker.MarkDirty(10);
+	tracker.MarkDirty(11);				// Extends the last range
+	tracker.MarkDirty(30, 40);
+	tracker.MarkDirty(5, 10);			// Touches [10, 12) but is not the last range
+	tracker.MarkDirty(35, 50);
+	tracker.MarkDirty(20);
+	tracker.MarkDirty(7, 7);			// Empty
+	tracker.Commit();
+
+	EXPECT_EQ(tracker.Version(), 1u);
+	EXPECT_EQ(Collect(tracker, 0), (Ranges{ { 5, 12 }, { 20, 21 }, { 30, 50 } }));
+	EXPECT_EQ(Collect(tracker, 1), Ranges{});
+}
+
+TEST(DirtyRangeTrackerTest, CommitsOnlyWhenSomethingChanged)
+{
+	DirtyRangeTracker tracker;
+	EXPECT_FALSE(tracker.HasPendingChanges());
+	tracker.Commit();
+	EXPECT_EQ(tracker.Version(), 0u);
+
+	tracker.MarkDirty(3);
+	EXPECT_TRUE(tracker.HasPendingChanges());
+	tracker.Commit();
+	EXPECT_FALSE(tracker.HasPendingChanges());
+	tracker.Commit();
+	EXPECT_EQ(tracker.Version(), 1u);
+}
+
+TEST(DirtyRangeTrackerTest, CollectsTheChangesOfEveryVersionSinceTheConsumers)
+{
+	DirtyRangeTracker tracker(4);
+	tracker.MarkDirty(0, 4);
+	tracker.Commit();
+	tracker.MarkDirty(100);
+	tracker.Commit();
+	tracker.MarkDirty(2, 6);
+	tracker.Commit();
+	ASSERT_EQ(tracker.Version(), 3u);
+
+	EXPECT_EQ(Collect(tracker, 0), (Ranges{ { 0, 6 }, { 100, 101 } }));
+	EXPECT_EQ(Collect(tracker, 1), (Ranges{ { 2, 6 }, { 100, 101 } }));
+	EXPECT_EQ(Collect(tracker, 2), (Ranges{ { 2, 6 } }));
+	EXPECT_EQ(Collect(tracker, 3), Ranges{});
+
+	// A consumer that never synced, or one from the future, resyncs everything
+	EXPECT_EQ(Collect(tracker, DirtyRangeTracker::NoVersion), std::nullopt);
+	EXPECT_EQ(Collect(tracker, 4), std::nullopt);
+}
+
+TEST(DirtyRangeTrackerTest, FallsBackToEverythingOnceTheHistoryOverflows)
+{
+	DirtyRangeTracker tracker(3);
+	for (size_t iii = 0; iii < 5; ++iii)
+	{
+		tracker.MarkDirty(iii);
+		tracker.Commit();
+	}
+	ASSERT_EQ(tracker.Version(), 5u);
+
+	// Only versions 3, 4 and 5 are still known
+	EXPECT_EQ(Collect(tracker, 2), (Ranges{ { 2, 5 } }));
+	EXPECT_EQ(Collect(tracker, 1), std::nullopt);
+	EXPECT_EQ(Collect(tracker, 0), std::nullopt);
+}
+
+TEST(DirtyRangeTrackerTest, MarkingEverythingForcesAResyncForOlderConsumers)
+{
+	DirtyRangeTracker tracker;
+	tracker.MarkDirty(1);
+	tracker.Commit();
+	tracker.MarkDirty(2);
+	tracker.MarkAllDirty();
+	tracker.MarkDirty(3);				// Already covered
+	tracker.Commit();
+	tracker.MarkDirty(4);
+	tracker.Commit();
+
+	EXPECT_EQ(Collect(tracker, 0), std::nullopt);
+	EXPECT_EQ(Collect(tracker, 1), std::nullopt);
+	EXPECT_EQ(Collect(tracker, 2), (Ranges{ { 4, 5 } }));
+}
+
+TEST(DirtyRangeTrackerTest, TooManyRangesInOneCommitMarkEverything)
+{
+	DirtyRangeTracker tracker;
+	for (size_t iii = 0; iii <= DirtyRangeTracker::MaxRangesPerCommit; ++iii)
+		tracker.MarkDirty(2 * iii);
+	tracker.Commit();
+
+	EXPECT_EQ(Collect(tracker, 0), std::nullopt);
+}
+
+TEST(SimulationAtomChangesTest, EditingOneAtomOnlyMarksThatAtom)
+{
+	Simulation simulation;
+	for (int iii = 0; iii < 100; ++iii)
+		simulation.AddAtom(AtomType::HYDROGEN, { static_cast<float>(iii % 10), static_cast<float>(iii / 10), 0.0f });
+	simulation.DispatchEvents();
+	const std::uint64_t synced = simulation.GetAtomChanges().Version();
+
+	// Reading the atoms, or writing back the values they already have, is not a change
+	const Atom atom = std::as_const(simulation).GetAtom(42);
+	simulation.SetAtomPosition(42, atom.position);
+	simulation.SetAtomVelocity(42, atom.velocity);
+	simulation.DispatchEvents();
+	EXPECT_EQ(simulation.GetAtomChanges().Version(), synced);
+
+	simulation.SetAtomPosition(42, { 1.0f, 2.0f, 3.0f });
+	simulation.SetAtomVelocity(57, { 0.0f, 1.0f, 0.0f });
+	simulation.DispatchEvents();
+	EXPECT_EQ(Collect(simulation.GetAtomChanges(), synced), (Ranges{ { 42, 43 }, { 57, 58 } }));
+	EXPECT_EQ(std::as_const(simulation).GetAtom(42).position.z, 3.0f);
+	EXPECT_EQ(std::as_const(simulation).GetAtom(57).velocity.y, 1.0f);
+}
+}
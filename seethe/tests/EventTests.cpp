@@ -0,0 +1,99 @@
+#include "utils/Event.h"
+#include "simulation/Simulation.h"
+
+#include <gtest/gtest.h>
+
+namespace seethe
+{
+TEST(EventTest, ChangedRangeMergesIndicesAndCountsOccurrences)
+{
+	ChangedRange range;
+	EXPECT_FALSE(range.HasIndices());
+	EXPECT_EQ(range.Count(), 0u);
+
+	range.Include(10, 12);
+	range.Include(3, 4);
+	range.Include(7, 7);				// Empty, but still an occurrence
+	EXPECT_EQ(range.begin, 3u);
+	EXPECT_EQ(range.end, 12u);
+	EXPECT_EQ(range.Count(), 9u);
+	EXPECT_EQ(range.occurrences, 3u);
+}
+
+TEST(EventTest, CoalescesEveryRecordIntoOneDispatch)
+{
+	CoalescedEvent<ChangedRange> event;
+	std::vector<ChangedRange> dispatched;
+	event.Register([&dispatched](const ChangedRange& range) { dispatched.push_back(range); });
+
+	EXPECT_FALSE(event.IsPending());
+	event.Record([](ChangedRange& range) { range.Include(5, 6); });
+	event.Record([](ChangedRange& range) { range.Include(20, 25); });
+	event.Record([](ChangedRange& range) { range.Include(1, 2); });
+	EXPECT_TRUE(event.IsPending());
+	EXPECT_TRUE(dispatched.empty());
+
+	event.Dispatch();
+	ASSERT_EQ(dispatched.size(), 1u);
+	EXPECT_EQ(dispatched[0].begin, 1u);
+	EXPECT_EQ(dispatched[0].end, 25u);
+	EXPECT_EQ(dispatched[0].occurrences, 3u);
+
+	// The payload was reset, so an idle frame dispatches nothing and the next one starts from scratch
+	EXPECT_FALSE(event.IsPending());
+	event.Dispatch();
+	EXPECT_EQ(dispatched.size(), 1u);
+
+	event.Record([](ChangedRange& range) { range.Include(40, 41); });
+	event.Dispatch();
+	ASSERT_EQ(dispatched.size(), 2u);
+	EXPECT_EQ(dispatched[1].begin, 40u);
+	EXPECT_EQ(dispatched[1].end, 41u);
+	EXPECT_EQ(dispatched[1].occurrences, 1u);
+}
+
+TEST(EventTest, RecordsFromAHandlerGoToTheNextDispatch)
+{
+	CoalescedEvent<ChangedRange> event;
+	int calls = 0;
+	event.Register([&](const ChangedRange&)
+	{
+		if (++calls == 1)
+			event.Record([](ChangedRange& range) { range.Include(0, 1); });
+	});
+
+	event.Record([](ChangedRange& range) { range.Include(0, 1); });
+	event.Dispatch();
+	EXPECT_EQ(calls, 1);
+	EXPECT_TRUE(event.IsPending());
+
+	event.Dispatch();
+	EXPECT_EQ(calls, 2);
+	EXPECT_FALSE(event.IsPending());
+}
+
+TEST(EventTest, SimulationDispatchesOneSelectionEventPerFrame)
+{
+	Simulation simulation;
+	for (int iii = 0; iii < 50; ++iii)
+		simulation.AddAtom(AtomType::HYDROGEN, { static_cast<float>(iii % 10), static_cast<float>(iii / 10), 0.0f });
+	simulation.DispatchEvents();
+
+	std::vector<ChangedRange> dispatched;
+	simulation.RegisterSelectedAtomsChangedHandler([&dispatched](const ChangedRange& range) { dispatched.push_back(range); });
+
+	simulation.SelectAtom(12);
+	simulation.SelectAtom(30);
+	simulation.SelectAtom(7);
+	EXPECT_TRUE(dispatched.empty());
+
+	simulation.DispatchEvents();
+	ASSERT_EQ(dispatched.size(), 1u);
+	EXPECT_EQ(dispatched[0].begin, 7u);
+	EXPECT_EQ(dispatched[0].end, 31u);
+	EXPECT_EQ(dispatched[0].occurrences, 3u);
+
+	simulation.DispatchEvents();
+	EXPECT_EQ(dispatched.size(), 1u);
+}
+}
@@ -0,0 +1,97 @@
+#include "rendering/FrameFence.h"
+
+#include <gtest/gtest.h>
+
+namespace seethe
+{
+namespace
+{
+// Stands in for a GPU resource - the weak_ptr tells whether it is still being kept alive
+using Resource = std::shared_ptr<int>;
+}
+
+TEST(FrameFenceTest, ManualFenceOnlyMovesForward)
+{
+	ManualFrameFence fence;
+	EXPECT_EQ(fence.GetPendingValue(), 1u);
+	EXPECT_EQ(fence.GetCompletedValue(), 0u);
+
+	fence.Submit();
+	fence.Submit();
+	EXPECT_EQ(fence.GetPendingValue(), 3u);
+
+	fence.Complete(2);
+	fence.Complete(1);
+	EXPECT_EQ(fence.GetCompletedValue(), 2u);
+}
+
+TEST(FrameFenceTest, RetiredResourcesLiveUntilTheirFrameCompletes)
+{
+	ManualFrameFence fence;
+	RetiredResources<Resource> retired;
+
+	// Retired while frame 1 is being recorded, so frame 1 may still use it
+	Resource first = std::make_shared<int>(1);
+	std::weak_ptr<int> firstAlive = first;
+	retired.Retire(std::move(first), fence);
+	fence.Submit();
+
+	// Retired while frame 2 is being recorded
+	Resource second = std::make_shared<int>(2);
+	std::weak_ptr<int> secondAlive = second;
+	retired.Retire(std::move(second), fence);
+	fence.Submit();
+
+	EXPECT_EQ(retired.Release(fence), 0u);
+	EXPECT_FALSE(firstAlive.expired());
+	EXPECT_EQ(retired.GetCount(), 2u);
+
+	fence.Complete(1);
+	EXPECT_EQ(retired.Release(fence), 1u);
+	EXPECT_TRUE(firstAlive.expired());
+	EXPECT_FALSE(secondAlive.expired());
+
+	// Nothing new completed
+	EXPECT_EQ(retired.Release(fence), 0u);
+	EXPECT_FALSE(secondAlive.expired());
+
+	fence.Complete(2);
+	EXPECT_EQ(retired.Release(fence), 1u);
+	EXPECT_TRUE(secondAlive.expired());
+	EXPECT_TRUE(retired.IsEmpty());
+}
+
+TEST(FrameFenceTest, RetiringSeveralTimesInOneFrameReleasesThemTogether)
+{
+	ManualFrameFence fence;
+	RetiredResources<Resource> retired;
+
+	// A buffer that grows twice in the same frame
+	for (int iii = 0; iii < 3; ++iii)
+		retired.Retire(std::make_shared<int>(iii), fence);
+	fence.Submit();
+	fence.Submit();
+
+	fence.Complete(1);
+	EXPECT_EQ(retired.Release(fence), 3u);
+	EXPECT_TRUE(retired.IsEmpty());
+}
+
+TEST(FrameFenceTest, ReleaseAllHandsOverEverythingRegardlessOfTheFence)
+{
+	ManualFrameFence fence;
+	RetiredResources<Resource> retired;
+	retired.Retire(std::make_shared<int>(1), fence);
+	fence.Submit();
+	retired.Retire(std::make_shared<int>(2), fence);
+
+	std::vector<Resource> handedOver;
+	retired.ReleaseAll([&handedOver](Resource resource) { handedOver.push_back(std::move(resource)); });
+
+	ASSERT_EQ(handedOver.size(), 2u);
+	EXPECT_EQ(*handedOver[0], 1);
+	EXPECT_EQ(*handedOver[1], 2);
+	EXPECT_TRUE(retired.IsEmpty());
+	EXPECT_EQ(retired.Release(fence), 0u);
+}
+}
@@ -0,0 +1,173 @@
+#include "utils/Histogram.h"
+
+#include <gtest/gtest.h>
+
+namespace seethe
+{
+TEST(HistogramTest, BucketsTileTheWholeRange)
+{
+	// Small values each get their own bucket
+	for (std::uint64_t value = 0; value < Histogram::SubBucketCount; ++value)
+	{
+		EXPECT_EQ(Histogram::BucketIndex(value), value);
+		EXPECT_EQ(Histogram::BucketLowest(value), value);
+		EXPECT_EQ(Histogram::BucketHighest(value), value);
+	}
+
+	// Every bucket starts right after the previous one ends, and none is wider than 1/64 of the values in it
+	EXPECT_EQ(Histogram::BucketLowest(0), 0u);
+	for (size_t iii = 0; iii + 1 < Histogram::BucketCount; ++iii)
+	{
+		ASSERT_EQ(Histogram::BucketLowest(iii + 1), Histogram::BucketHighest(iii) + 1) << "bucket " << iii;
+		const std::uint64_t width = Histogram::BucketHighest(iii) - Histogram::BucketLowest(iii) + 1;
+		ASSERT_LE(width * Histogram::HalfSubBucketCount, std::max<std::uint64_t>(Histogram::HalfSubBucketCount, Histogram::BucketLowest(iii))) << "bucket " << iii;
+	}
+	EXPECT_EQ(Histogram::BucketIndex(std::numeric_limits<std::uint64_t>::max()), Histogram::BucketCount - 1);
+	EXPECT_EQ(Histogram::BucketHighest(Histogram::BucketCount - 1), std::numeric_limits<std::uint64_t>::max());
+}
+
+TEST(HistogramTest, ValuesLandInTheBucketThatCoversThem)
+{
+	// Both sides of every power of two, and of the sub-bucket edges just above the linear range
+	std::vector<std::uint64_t> values = { 127, 128, 129, 130, 131, 255, 256, 257, 1000, 1007, 1008 };
+	for (unsigned int bit = 8; bit < 64; ++bit)
+	{
+		const std::uint64_t power = 1ull << bit;
+		values.insert(values.end(), { power - 1, power, power + 1, power + (power >> 6) - 1, power + (power >> 6) });
+	}
+	values.push_back(std::numeric_limits<std::uint64_t>::max());
+
+	for (std::uint64_t value : values)
+	{
+		const size_t index = Histogram::BucketIndex(value);
+		ASSERT_LT(index, Histogram::BucketCount) << value;
+		EXPECT_LE(Histogram::BucketLowest(index), value);
+		EXPECT_GE(Histogram::BucketHighest(index), value);
+	}
+
+	EXPECT_EQ(Histogram::BucketIndex(128), Histogram::BucketIndex(129));
+	EXPECT_NE(Histogram::BucketIndex(129), Histogram::BucketIndex(130));
+	EXPECT_EQ(Histogram::BucketIndex(1000), Histogram::BucketIndex(1007));
+	EXPECT_NE(Histogram::BucketIndex(1007), Histogram::BucketIndex(1008));
+}
+
+TEST(HistogramTest, PercentilesUseTheNearestRank)
+{
+	Histogram histogram;
+	EXPECT_EQ(histogram.ValueAtPercentile(50.0), 0u);
+	EXPECT_EQ(histogram.GetMin(), 0u);
+	EXPECT_EQ(histogram.GetMean(), 0.0);
+
+	// Below 128 every value is exact
+	for (std::uint64_t value = 1; value <= 100; ++value)
+		histogram.Record(value);
+
+	EXPECT_EQ(histogram.GetCount(), 100u);
+	EXPECT_EQ(histogram.GetMin(), 1u);
+	EXPECT_EQ(histogram.GetMax(), 100u);
+	EXPECT_DOUBLE_EQ(histogram.GetMean(), 50.5);
+	EXPECT_EQ(histogram.ValueAtPercentile(0.0), 1u);
+	EXPECT_EQ(histogram.ValueAtPercentile(1.0), 1u);
+	EXPECT_EQ(histogram.ValueAtPercentile(50.0), 50u);
+	EXPECT_EQ(histogram.ValueAtPercentile(50.5), 51u);
+	EXPECT_EQ(histogram.ValueAtPercentile(99.0), 99u);
+	EXPECT_EQ(histogram.ValueAtPercentile(99.9), 100u);
+	EXPECT_EQ(histogram.ValueAtPercentile(100.0), 100u);
+	EXPECT_EQ(histogram.ValueAtPercentile(250.0), 100u);
+	EXPECT_EQ(histogram.ValueAtPercentile(-5.0), 1u);
+}
+
+TEST(HistogramTest, LargeValuesRoundUpToTheirBucketButNotPastTheMax)
+{
+	// 1000 is the bottom of the bucket [1000, 1007]
+	Histogram histogram;
+	histogram.Record(1000);
+	EXPECT_EQ(histogram.ValueAtPercentile(50.0), 1000u);
+
+	histogram.Record(2000);
+	EXPECT_EQ(histogram.ValueAtPercentile(50.0), 1007u);
+	EXPECT_EQ(histogram.ValueAtPercentile(100.0), 2000u);
+
+	// Every percentile is within 1/64 above the value it stands for
+	Histogram spread;
+	std::mt19937_64 rng(9);
+	std::vector<std::uint64_t> values(10'000);
+	for (std::uint64_t& value : values)
+	{
+		value = rng() >> std::uniform_int_distribution<int>(0, 60)(rng);
+		spread.Record(value);
+	}
+	std::ranges::sort(values);
+
+	for (double percentile : { 10.0, 50.0, 90.0, 99.0, 99.9 })
+	{
+		const std::uint64_t exact = values[static_cast<size_t>(std::ceil(percentile / 100.0 * values.size())) - 1];
+		const std::uint64_t reported = spread.ValueAtPercentile(percentile);
+		EXPECT_GE(reported, exact) << "p" << percentile;
+		EXPECT_LE(static_cast<double>(reported - exact), static_cast<double>(exact) / 64.0) << "p" << percentile;
+	}
+}
+
+TEST(HistogramTest, MergeMatchesRecordingEverythingIntoOne)
+{
+	Histogram first;
+	Histogram second;
+	Histogram all;
+
+	std::mt19937_64 rng(10);
+	for (int iii = 0; iii < 5000; ++iii)
+	{
+		const std::uint64_t value = rng() >> std::uniform_int_distribution<int>(20, 63)(rng);
+		(iii % 3 == 0 ? first : second).Record(value);
+		all.Record(value);
+	}
+
+	// Merging an empty histogram changes nothing, in particular not the min
+	Histogram empty;
+	first.Merge(empty);
+	first.Merge(second);
+
+	EXPECT_EQ(first.GetCount(), all.GetCount());
+	EXPECT_EQ(first.GetMin(), all.GetMin());
+	EXPECT_EQ(first.GetMax(), all.GetMax());
+	EXPECT_DOUBLE_EQ(first.GetMean(), all.GetMean());
+	for (double percentile : { 0.0, 25.0, 50.0, 90.0, 99.0, 99.9, 100.0 })
+		EXPECT_EQ(first.ValueAtPercentile(percentile), all.ValueAtPercentile(percentile)) << "p" << percentile;
+
+	// Merging into an empty histogram copies it
+	empty.Merge(all);
+	EXPECT_EQ(empty.GetCount(), all.GetCount());
+	EXPECT_EQ(empty.GetMin(), all.GetMin());
+	EXPECT_EQ(empty.ValueAtPercentile(50.0), all.ValueAtPercentile(50.0));
+
+	all.Reset();
+	EXPECT_EQ(all.GetCount(), 0u);
+	EXPECT_EQ(all.GetMax(), 0u);
+	EXPECT_EQ(all.ValueAtPercentile(99.0), 0u);
+}
+
+TEST(HistogramTest, RecordsFromManyThreads)
+{
+	constexpr int threadCount = 4;
+	constexpr std::uint64_t perThread = 10'000;
+
+	Histogram histogram;
+	std::vector<std::thread> threads;
+	for (int iii = 0; iii < threadCount; ++iii)
+	{
+		threads.emplace_back([&histogram]()
+			{
+				for (std::uint64_t value = 1; value <= perThread; ++value)
+					histogram.Record(value);
+			}
+		);
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+
+	EXPECT_EQ(histogram.GetCount(), threadCount * perThread);
+	EXPECT_EQ(histogram.GetMin(), 1u);
+	EXPECT_EQ(histogram.GetMax(), perThread);
+	EXPECT_DOUBLE_EQ(histogram.GetMean(), (perThread + 1) / 2.0);
+}
+}
@@ -0,0 +1,151 @@
+#include "application/rendering/LightClusterer.h"
+
+#include <gtest/gtest.h>
+
+using namespace DirectX;
+
+namespace seethe
+{
+namespace
+{
+constexpr float FovY = 0.25f * XM_PI;
+constexpr float Aspect = 16.0f / 9.0f;
+constexpr float NearZ = 1.0f;
+constexpr float FarZ = 200.0f;
+
+// Points spread over a cluster's volume, including (just inside) its corners, edges and faces
+constexpr std::array<float, 5> SampleFractions = { 0.001f, 0.25f, 0.5f, 0.75f, 0.999f };
+
+// Checks that every light whose sphere reaches a sample point of a cluster is in that cluster's list. The samples are a
+// subset of the cluster, so this can only miss a light that touches a cluster between the samples, never flag one
+// that is correctly left out
+void ExpectBinningIsConservative(const LightClusterer& clusterer, const SceneLighting& lighting, FXMMATRIX view)
+{
+	const float tanHalfFovY = std::tan(0.5f * FovY);
+	const float tanHalfFovX = tanHalfFovY * Aspect;
+	const std::vector<LightCluster>& clusters = clusterer.GetClusters();
+	const std::vector<std::uint32_t>& indices = clusterer.GetLightIndices();
+	ASSERT_EQ(clusters.size(), LightClusterer::ClusterCount);
+
+	const std::uint32_t firstLight = lighting.NumDirectionalLights();
+	const std::uint32_t lightCount = lighting.NumPointLights() + lighting.NumSpotLights();
+	std::vector<XMFLOAT3> centers(lightCount);
+	for (std::uint32_t iii = 0; iii < lightCount; ++iii)
+		XMStoreFloat3(&centers[iii], XMVector3TransformCoord(XMLoadFloat3(&lighting.GetLight(firstLight + iii).Position), view));
+
+	size_t checked = 0;
+	for (unsigned int z = 0; z < LightClusterer::ClusterCountZ; ++z)
+	{
+		const float depth0 = NearZ * std::pow(FarZ / NearZ, static_cast<float>(z) / LightClusterer::ClusterCountZ);
+		const float depth1 = NearZ * std::pow(FarZ / NearZ, static_cast<float>(z + 1) / LightClusterer::ClusterCountZ);
+
+		for (unsigned int y = 0; y < LightClusterer::ClusterCountY; ++y)
+		{
+			for (unsigned int x = 0; x < LightClusterer::ClusterCountX; ++x)
+			{
+				const size_t cluster = (static_cast<size_t>(z) * LightClusterer::ClusterCountY + y) * LightClusterer::ClusterCountX + x;
+				const LightCluster& range = clusters[cluster];
+				ASSERT_LE(range.Offset + range.Count, indices.size());
+				const auto begin = indices.begin() + range.Offset;
+				const auto end = begin + range.Count;
+
+				for (std::uint32_t iii = 0; iii < lightCount; ++iii)
+				{
+					const XMFLOAT3& c = centers[iii];
+					const float radius = lighting.GetLight(firstLight + iii).FalloffEnd;
+
+					bool touches = false;
+					for (float fz : SampleFractions)
+					{
+						const float depth = depth0 + fz * (depth1 - depth0);
+						for (float fy : SampleFractions)
+						{
+							// Tile rows are counted from the top of the screen
+							const float ndcY = 1.0f - 2.0f * (y + fy) / LightClusterer::ClusterCountY;
+							for (float fx : SampleFractions)
+							{
+								const float ndcX = -1.0f + 2.0f * (x + fx) / LightClusterer::ClusterCountX;
+								const float dx = ndcX * depth * tanHalfFovX - c.x;
+								const float dy = ndcY * depth * tanHalfFovY - c.y;
+								const float dz = depth - c.z;
+								touches |= dx * dx + dy * dy + dz * dz < radius * radius * 0.9999f;
+							}
+						}
+					}
+
+					if (touches)
+					{
+						++checked;
+						ASSERT_NE(std::find(begin, end, firstLight + iii), end) << "light " << firstLight + iii << " is missing from cluster (" << x << ", " << y << ", " << z << ")";
+					}
+				}
+			}
+		}
+	}
+
+	// The lights have to actually reach some clusters for this to check anything
+	EXPECT_GT(checked, 0u);
+}
+
+// One directional light (so the light indices do not start at 0), and point and spot lights of various sizes in front
+// of, around and behind the camera at the origin, which looks down +z
+SceneLighting RandomLighting(std::mt19937& rng)
+{
+	SceneLighting lighting;
+	lighting.AddDirectionalLight({ 0.5f, 0.5f, 0.5f }, { 0.0f, -1.0f, 0.0f });
+
+	std::uniform_real_distribution<float> lateral(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> depth(-20.0f, 220.0f);
+	std::uniform_real_distribution<float> radius(0.5f, 30.0f);
+	for (int iii = 0; iii < 40; ++iii)
+		lighting.AddPointLight({ 1.0f, 1.0f, 1.0f }, { lateral(rng), lateral(rng), depth(rng) }, 0.1f, radius(rng));
+	for (int iii = 0; iii < 10; ++iii)
+		lighting.AddSpotLight({ 1.0f, 1.0f, 1.0f }, { lateral(rng), lateral(rng), depth(rng) }, { 0.0f, 0.0f, 1.0f }, 0.1f, radius(rng), 8.0f);
+
+	// A light around the camera itself, one straddling the far plane, and one that is huge
+	lighting.AddPointLight({ 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f }, 0.1f, 3.0f);
+	lighting.AddPointLight({ 1.0f, 1.0f, 1.0f }, { 5.0f, -5.0f, FarZ }, 0.1f, 10.0f);
+	lighting.AddPointLight({ 1.0f, 1.0f, 1.0f }, { -10.0f, 10.0f, 100.0f }, 0.1f, 150.0f);
+	return lighting;
+}
+}
+
+TEST(LightClustererTest, EveryLightThatTouchesAClusterIsBinnedIntoIt)
+{
+	std::mt19937 rng(41);
+	const SceneLighting lighting = RandomLighting(rng);
+	const XMMATRIX view = XMMatrixLookAtLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+
+	LightClusterer clusterer;
+	EXPECT_TRUE(clusterer.Update(lighting, view, FovY, Aspect, NearZ, FarZ));
+	ExpectBinningIsConservative(clusterer, lighting, view);
+}
+
+TEST(LightClustererTest, StaysConservativeWhenOnlySomeSlicesAreRebinned)
+{
+	std::mt19937 rng(42);
+	SceneLighting lighting = RandomLighting(rng);
+	XMMATRIX view = XMMatrixLookAtLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+
+	LightClusterer clusterer;
+	EXPECT_TRUE(clusterer.Update(lighting, view, FovY, Aspect, NearZ, FarZ));
+
+	// Nothing moved, so nothing is rebinned
+	EXPECT_FALSE(clusterer.Update(lighting, view, FovY, Aspect, NearZ, FarZ));
+
+	// A single light moves, which only touches the slices it leaves and enters
+	lighting.GetPointLight(3).Position = { 10.0f, 2.0f, 40.0f };
+	EXPECT_TRUE(clusterer.Update(lighting, view, FovY, Aspect, NearZ, FarZ));
+	ExpectBinningIsConservative(clusterer, lighting, view);
+
+	// The camera turns and moves, which moves every light in view space
+	view = XMMatrixLookAtLH(XMVectorSet(10.0f, 5.0f, -10.0f, 0.0f), XMVectorSet(-20.0f, 0.0f, 80.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	EXPECT_TRUE(clusterer.Update(lighting, view, FovY, Aspect, NearZ, FarZ));
+	ExpectBinningIsConservative(clusterer, lighting, view);
+
+	// Adding a light (which changes the light count) rebuilds everything
+	lighting.AddPointLight({ 1.0f, 1.0f, 1.0f }, { -20.0f, 0.0f, 80.0f }, 0.1f, 12.0f);
+	EXPECT_TRUE(clusterer.Update(lighting, view, FovY, Aspect, NearZ, FarZ));
+	ExpectBinningIsConservative(clusterer, lighting, view);
+}
+}
@@ -0,0 +1,89 @@
+#include "utils/Log.h"
+
+#include <gtest/gtest.h>
+
+namespace seethe
+{
+namespace
+{
+// Everything the logger writes to stderr while fn() runs
+template <typename F>
+std::string CaptureLog(F&& fn)
+{
+	log::Flush();
+	::testing::internal::CaptureStderr();
+	fn();
+	log::Flush();
+	return ::testing::internal::GetCapturedStderr();
+}
+
+size_t CountLines(std::string_view output, std::string_view token) noexcept
+{
+	size_t count = 0;
+	for (size_t pos = output.find(token); pos != std::string_view::npos; pos = output.find(token, pos + token.size()))
+		++count;
+	return count;
+}
+
+// Well over the 20 messages per second that a call site may write
+constexpr int Burst = 100;
+}
+
+TEST(LogTest, RateLimitsEachCallSite)
+{
+	const std::string output = CaptureLog([]()
+	{
+		for (int iii = 0; iii < Burst; ++iii)
+			LOG_WARN("rate-limited {}", iii);
+	});
+
+	const size_t written = CountLines(output, "rate-limited");
+	EXPECT_GT(written, 0u);
+	EXPECT_LT(written, static_cast<size_t>(Burst));
+}
+
+TEST(LogTest, CallSitesWithTheSameFormatStringHaveTheirOwnBudget)
+{
+	// Identical literals may well be merged into one string by the compiler, but they are still two call sites
+	const std::string output = CaptureLog([]()
+	{
+		for (int iii = 0; iii < Burst; ++iii)
+			LOG_WARN("same format {}", "first");
+		for (int iii = 0; iii < Burst; ++iii)
+			LOG_WARN("same format {}", "second");
+	});
+
+	const size_t first = CountLines(output, "same format first");
+	EXPECT_GT(first, 0u);
+	EXPECT_EQ(CountLines(output, "same format second"), first);
+}
+
+TEST(LogTest, NeverRateLimitsErrors)
+{
+	const std::string output = CaptureLog([]()
+	{
+		for (int iii = 0; iii < Burst; ++iii)
+			LOG_ERROR("not-limited {}", iii);
+	});
+
+	EXPECT_EQ(CountLines(output, "not-limited"), static_cast<size_t>(Burst));
+	EXPECT_EQ(CountLines(output, "suppressed"), 0u);
+}
+
+TEST(LogTest, WritesMessagesFromThreadsThatStartWhileItDrains)
+{
+	// Every thread adds a ring while the logging thread is busy with the ones before it. They all share one call site,
+	// so errors are used to keep the rate limit out of it
+	constexpr int threadCount = 64;
+	const std::string output = CaptureLog([]()
+	{
+		std::vector<std::thread> threads;
+		for (int iii = 0; iii < threadCount; ++iii)
+			threads.emplace_back([iii]() { LOG_ERROR("from thread {}", iii); });
+		for (std::thread& thread : threads)
+			thread.join();
+	});
+
+	EXPECT_EQ(CountLines(output, "from thread"), static_cast<size_t>(threadCount));
+}
+}
@@ -0,0 +1,129 @@
+#include "rendering/GeometryGenerator.h"
+#include "rendering/MeshOptimizer.h"
+
+#include <gtest/gtest.h>
+
+namespace seethe
+{
+namespace
+{
+using Vertex = GeometryGenerator::Vertex;
+
+// Each triangle as the bytes of its three vertices, in winding order. Two meshes draw the same triangles with the
+// same winding if these are equal after sorting, no matter how the vertices and triangles are ordered
+std::vector<std::string> TrianglesByValue(const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices) noexcept
+{
+	std::vector<std::string> triangles;
+	for (size_t iii = 0; iii + 2 < indices.size(); iii += 3)
+	{
+		std::string& triangle = triangles.emplace_back();
+		for (size_t corner = 0; corner < 3; ++corner)
+			triangle.append(reinterpret_cast<const char*>(&vertices[indices[iii + corner]]), sizeof(Vertex));
+	}
+	std::ranges::sort(triangles);
+	return triangles;
+}
+
+// A 64x64 grid with its triangles in random order, so there is hardly any reuse in the vertex cache
+GeometryGenerator::MeshData ShuffledGrid() noexcept
+{
+	GeometryGenerator::MeshData mesh = GeometryGenerator::CreateGrid(10.0f, 10.0f, 64, 64);
+
+	std::vector<size_t> order(mesh.Indices32.size() / 3);
+	std::iota(order.begin(), order.end(), size_t{ 0 });
+	std::ranges::shuffle(order, std::mt19937(3));
+
+	std::vector<std::uint32_t> shuffled;
+	for (size_t triangle : order)
+		shuffled.insert(shuffled.end(), mesh.Indices32.begin() + triangle * 3, mesh.Indices32.begin() + triangle * 3 + 3);
+	mesh.Indices32 = std::move(shuffled);
+	return mesh;
+}
+
+void ReportStats(const char* name, const VertexCacheStats& before, const VertexCacheStats& after) noexcept
+{
+	::testing::Test::RecordProperty(name, std::format("ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", before.ACMR, after.ACMR, before.ATVR, after.ATVR));
+}
+}
+
+TEST(MeshOptimizerTest, AnalyzesAFifoCache)
+{
+	// Two triangles that share an edge: 4 vertices transformed for 2 triangles
+	const std::vector<std::uint32_t> quad = { 0, 1, 2, 2, 1, 3 };
+	VertexCacheStats stats = AnalyzeVertexCache(quad, 4);
+	EXPECT_FLOAT_EQ(stats.ACMR, 2.0f);
+	EXPECT_FLOAT_EQ(stats.ATVR, 1.0f);
+
+	// With room for only 2 vertices, 0 and 1 have been evicted by the time the second triangle needs them
+	const std::vector<std::uint32_t> revisit = { 0, 1, 2, 0, 3, 1 };
+	stats = AnalyzeVertexCache(revisit, 4, 2);
+	EXPECT_FLOAT_EQ(stats.ACMR, 3.0f);		// Every index misses
+	EXPECT_FLOAT_EQ(stats.ATVR, 1.5f);
+}
+
+TEST(MeshOptimizerTest, VertexCacheOrderLowersAcmrAndKeepsEveryTriangle)
+{
+	const GeometryGenerator::MeshData mesh = ShuffledGrid();
+	const size_t vertexCount = mesh.Vertices.size();
+
+	const std::vector<std::uint32_t> optimized = OptimizeVertexCache(mesh.Indices32, vertexCount);
+
+	const VertexCacheStats before = AnalyzeVertexCache(mesh.Indices32, vertexCount);
+	const VertexCacheStats after = AnalyzeVertexCache(optimized, vertexCount);
+	ReportStats("Shuffled 64x64 grid", before, after);
+
+	EXPECT_LT(after.ACMR, before.ACMR);
+	EXPECT_LT(after.ATVR, before.ATVR);
+	EXPECT_LT(after.ACMR, 0.8f);
+
+	// Same triangles, each with its corners in the original order
+	ASSERT_EQ(optimized.size(), mesh.Indices32.size());
+	EXPECT_EQ(TrianglesByValue(mesh.Vertices, optimized), TrianglesByValue(mesh.Vertices, mesh.Indices32));
+}
+
+TEST(MeshOptimizerTest, OptimizeMeshPreservesWindingAndVertexData)
+{
+	const GeometryGenerator::MeshData grid = ShuffledGrid();
+
+	// Give every triangle its own copies of its vertices, so welding has something to do
+	std::vector<Vertex> vertices;
+	std::vector<std::uint32_t> indices;
+	for (std::uint32_t index : grid.Indices32)
+	{
+		indices.push_back(static_cast<std::uint32_t>(vertices.size()));
+		vertices.push_back(grid.Vertices[index]);
+	}
+	const std::vector<std::string> expected = TrianglesByValue(vertices, indices);
+	const VertexCacheStats before = AnalyzeVertexCache(indices, vertices.size());
+
+	OptimizeMesh(vertices, indices);
+	const VertexCacheStats after = AnalyzeVertexCache(indices, vertices.size());
+	ReportStats("Unwelded 64x64 grid", before, after);
+
+	// Without welding every vertex is transformed exactly once (an ATVR of 1), so only the ACMR says anything here
+	EXPECT_EQ(vertices.size(), grid.Vertices.size());
+	EXPECT_LT(after.ACMR, before.ACMR);
+	EXPECT_EQ(TrianglesByValue(vertices, indices), expected);
+
+	// The vertex fetch order follows the index buffer: each vertex is first used after all of the ones before it
+	std::uint32_t nextNew = 0;
+	for (std::uint32_t index : indices)
+	{
+		ASSERT_LE(index, nextNew);
+		if (index == nextNew)
+			++nextNew;
+	}
+}
+
+TEST(MeshOptimizerTest, GeneratedSpheresAreOptimized)
+{
+	// The generator runs OptimizeMesh() on everything it memoizes, so the spheres the atoms are drawn with should be
+	// close to the ~0.6 ACMR that a well ordered sphere reaches with a 16 entry cache
+	const GeometryGenerator::MeshData sphere = GeometryGenerator::CreateSphere(1.0f, 20, 20);
+	const VertexCacheStats stats = AnalyzeVertexCache(sphere.Indices32, sphere.Vertices.size());
+	RecordProperty("Sphere(1, 20, 20)", std::format("ACMR {:.3f}, ATVR {:.3f}", stats.ACMR, stats.ATVR));
+
+	EXPECT_LT(stats.ACMR, 0.8f);
+	EXPECT_LT(stats.ATVR, 1.3f);
+}
+}
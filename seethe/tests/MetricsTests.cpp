@@ -0,0 +1,188 @@
+#include "utils/Metrics.h"
+#include "utils/MetricsServer.h"
+
+#include <map>
+#include <regex>
+#include <sstream>
+
+#if defined(_WIN32)
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <gtest/gtest.h>
+
+namespace seethe
+{
+namespace
+{
+#if defined(_WIN32)
+using Socket = SOCKET;
+void CloseSocket(SOCKET socket) noexcept { closesocket(socket); }
+#else
+using Socket = int;
+void CloseSocket(int socket) noexcept { close(socket); }
+#endif
+
+struct HttpResponse
+{
+	std::string statusLine;
+	std::string headers;
+	std::string body;
+};
+
+// Sends 'request' to 127.0.0.1:port and reads until the server closes the connection, like a scraper would. The server
+// has to be running (on Windows that is also what keeps Winsock initialized)
+HttpResponse Request(std::uint16_t port, std::string_view request)
+{
+	const Socket client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	EXPECT_NE(client, static_cast<Socket>(-1));
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(client, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+	{
+		ADD_FAILURE() << "connect() to 127.0.0.1:" << port << " failed";
+		CloseSocket(client);
+		return {};
+	}
+
+	send(client, request.data(), static_cast<int>(request.size()), 0);
+
+	std::string response;
+	std::array<char, 4096> buffer;
+	for (int received; (received = static_cast<int>(recv(client, buffer.data(), static_cast<int>(buffer.size()), 0))) > 0;)
+		response.append(buffer.data(), static_cast<size_t>(received));
+	CloseSocket(client);
+
+	const size_t statusEnd = response.find("\r\n");
+	const size_t headersEnd = response.find("\r\n\r\n");
+	if (statusEnd == std::string::npos || headersEnd == std::string::npos)
+	{
+		ADD_FAILURE() << "Not an HTTP response: " << response;
+		return {};
+	}
+	return { response.substr(0, statusEnd), response.substr(statusEnd + 2, headersEnd - statusEnd), response.substr(headersEnd + 4) };
+}
+
+HttpResponse Get(std::uint16_t port, std::string_view path)
+{
+	return Request(port, std::format("GET {} HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n", path));
+}
+
+struct Family
+{
+	std::string type;
+	std::vector<std::pair<std::string, double>> samples;		// Labels (with the braces) and value
+};
+
+// Parses and checks the Prometheus text exposition format (version 0.0.4): each family is a HELP and a TYPE line
+// followed by its samples, and every sample belongs to the family above it
+std::map<std::string, Family> ParseExposition(const std::string& body)
+{
+	static const std::regex help(R"(^# HELP ([a-zA-Z_:][a-zA-Z0-9_:]*) \S.*$)");
+	static const std::regex type(R"(^# TYPE ([a-zA-Z_:][a-zA-Z0-9_:]*) (counter|gauge|summary|histogram|untyped)$)");
+	static const std::regex sample(R"(^([a-zA-Z_:][a-zA-Z0-9_:]*)(\{(?:[a-zA-Z_][a-zA-Z0-9_]*="[^"]*",?)*\})? (\S+)$)");
+
+	std::map<std::string, Family> families;
+	std::string current;
+	std::string pendingHelp;
+
+	std::istringstream lines(body);
+	std::string line;
+	std::smatch match;
+	while (std::getline(lines, line))
+	{
+		if (std::regex_match(line, match, help))
+		{
+			EXPECT_TRUE(pendingHelp.empty()) << "Two HELP lines in a row: " << line;
+			pendingHelp = match[1];
+		}
+		else if (std::regex_match(line, match, type))
+		{
+			EXPECT_EQ(match[1].str(), pendingHelp) << "TYPE without a HELP for the same metric: " << line;
+			current = match[1];
+			pendingHelp.clear();
+			EXPECT_FALSE(families.contains(current)) << "Metric family declared twice: " << current;
+			families[current].type = match[2];
+		}
+		else if (std::regex_match(line, match, sample))
+		{
+			const std::string name = match[1];
+			const bool isSummaryPart = families[current].type == "summary" && (name == current + "_sum" || name == current + "_count");
+			EXPECT_TRUE(name == current || isSummaryPart) << "Sample outside of its family '" << current << "': " << line;
+
+			double value = 0.0;
+			std::istringstream(match[3].str()) >> value;
+			families[current].samples.emplace_back(name + match[2].str(), value);
+		}
+		else
+		{
+			ADD_FAILURE() << "Not a valid exposition line: '" << line << "'";
+		}
+	}
+	EXPECT_TRUE(body.ends_with('\n'));
+	return families;
+}
+
+std::optional<double> Value(const std::map<std::string, Family>& families, const std::string& name)
+{
+	const auto family = families.find(name);
+	if (family == families.end() || family->second.samples.empty())
+		return std::nullopt;
+	return family->second.samples.front().second;
+}
+}
+
+TEST(MetricsServerTest, ServesTheExpositionFormatOnLoopback)
+{
+	MetricsServer server;
+	ASSERT_TRUE(server.Start(0));
+	ASSERT_NE(server.GetPort(), 0u);
+	EXPECT_TRUE(Metrics::Get().IsServed());
+
+	const HttpResponse first = Get(server.GetPort(), "/metrics");
+	EXPECT_EQ(first.statusLine, "HTTP/1.1 200 OK");
+	EXPECT_NE(first.headers.find("Content-Type: text/plain; version=0.0.4"), std::string::npos) << first.headers;
+	EXPECT_NE(first.headers.find(std::format("Content-Length: {}\r\n", first.body.size())), std::string::npos) << first.headers;
+
+	const std::map<std::string, Family> families = ParseExposition(first.body);
+	for (const auto& [name, type] : { std::pair{ "seethe_atoms", "gauge" }, std::pair{ "seethe_steps_total", "counter" },
+		std::pair{ "seethe_step_duration_seconds", "summary" }, std::pair{ "seethe_allocated_live_bytes", "gauge" },
+		std::pair{ "seethe_allocated_bytes_total", "counter" } })
+	{
+		ASSERT_TRUE(families.contains(name)) << name;
+		EXPECT_EQ(families.at(name).type, type) << name;
+	}
+	EXPECT_EQ(families.at("seethe_step_duration_seconds").samples.size(), 6u);		// 4 quantiles, _sum and _count
+	for (const auto& [sample, value] : families.at("seethe_allocated_live_bytes").samples)
+		EXPECT_TRUE(sample.starts_with("seethe_allocated_live_bytes{tag=\"")) << sample;
+
+	// Every scrape reads the live values
+	Metrics::Get().AddStep(100);
+	const std::map<std::string, Family> second = ParseExposition(Get(server.GetPort(), "/metrics").body);
+	EXPECT_EQ(Value(second, "seethe_steps_total"), Value(families, "seethe_steps_total").value_or(-1.0) + 1.0);
+
+	server.Stop();
+	EXPECT_FALSE(server.IsRunning());
+	EXPECT_FALSE(Metrics::Get().IsServed());
+}
+
+TEST(MetricsServerTest, RejectsOtherPathsAndMethods)
+{
+	MetricsServer server;
+	ASSERT_TRUE(server.Start(0));
+
+	EXPECT_EQ(Get(server.GetPort(), "/").statusLine, "HTTP/1.1 200 OK");
+	EXPECT_EQ(Get(server.GetPort(), "/metrics?format=text").statusLine, "HTTP/1.1 200 OK");
+	EXPECT_EQ(Get(server.GetPort(), "/secrets").statusLine, "HTTP/1.1 404 Not Found");
+	EXPECT_EQ(Request(server.GetPort(), "POST /metrics HTTP/1.1\r\nContent-Length: 0\r\n\r\n").statusLine, "HTTP/1.1 405 Method Not Allowed");
+}
+}
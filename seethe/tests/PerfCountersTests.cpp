@@ -0,0 +1,177 @@
+#include "utils/PerfCounters.h"
+#include "utils/ThreadPool.h"
+
+#include <gtest/gtest.h>
+
+namespace seethe
+{
+namespace
+{
+// Enough work that the counters move by a lot more than the cost of reading them
+std::uint64_t Burn(std::uint64_t iterations) noexcept
+{
+	volatile std::uint64_t sum = 0;
+	for (std::uint64_t iii = 0; iii < iterations; ++iii)
+		sum = sum + iii * iii;
+	return sum;
+}
+
+constexpr size_t Index(PerfCounter counter) noexcept { return static_cast<size_t>(counter); }
+}
+
+TEST(PerfCountersTest, GroupIsEitherReadableOrSaysWhyNot)
+{
+	const PerfCounterGroup& group = PerfCounterGroup::ForThisThread();
+	EXPECT_EQ(&group, &PerfCounterGroup::ForThisThread());
+
+	PerfCounterGroup::Reading reading;
+	if (!group.IsAvailable())
+	{
+		// No permission, no PMU (most containers and VMs) or not Linux. The phases fall back to timing only
+		EXPECT_FALSE(group.GetUnavailableReason().empty());
+		EXPECT_FALSE(group.Read(reading));
+		GTEST_SKIP() << group.GetUnavailableReason();
+	}
+
+	PerfCounterGroup::Reading start;
+	ASSERT_TRUE(group.Read(start));
+	Burn(10'000'000);
+	ASSERT_TRUE(group.Read(reading));
+
+	// Cycles lead the group, so they are there whenever the group is. The others depend on the CPU
+	ASSERT_TRUE(start.valid[Index(PerfCounter::CYCLES)]);
+	ASSERT_TRUE(reading.valid[Index(PerfCounter::CYCLES)]);
+	EXPECT_GT(reading.values[Index(PerfCounter::CYCLES)], start.values[Index(PerfCounter::CYCLES)]);
+
+	if (reading.valid[Index(PerfCounter::INSTRUCTIONS)])
+	{
+		EXPECT_GT(reading.values[Index(PerfCounter::INSTRUCTIONS)] - start.values[Index(PerfCounter::INSTRUCTIONS)], 10'000'000u);
+	}
+}
+
+TEST(PerfCountersTest, ThreadsHaveTheirOwnGroup)
+{
+	const PerfCounterGroup* mine = &PerfCounterGroup::ForThisThread();
+	const PerfCounterGroup* theirs = nullptr;
+	bool theirsAvailable = false;
+	std::thread([&] { theirs = &PerfCounterGroup::ForThisThread(); theirsAvailable = theirs->IsAvailable(); }).join();
+
+	EXPECT_NE(mine, theirs);
+	EXPECT_EQ(theirsAvailable, mine->IsAvailable());
+}
+
+TEST(PerfCountersTest, PhaseScopesAccumulateTimeWorkAndCounters)
+{
+	PhaseCounters& phases = PhaseCounters::Get();
+	const std::uint32_t id = phases.Register("PerfCountersTest::Phase");
+	EXPECT_EQ(phases.Register("PerfCountersTest::Phase"), id);
+
+	for (int iii = 0; iii < 3; ++iii)
+	{
+		PhaseCounterScope scope(id, 1000);
+		Burn(100'000);
+	}
+
+	const bool available = PerfCounterGroup::ForThisThread().IsAvailable();
+	bool found = false;
+	phases.ForEachPhase([&](const PhaseCounters::Phase& phase)
+	{
+		if (phase.name != "PerfCountersTest::Phase")
+			return;
+		found = true;
+
+		EXPECT_EQ(phase.calls, 3u);
+		EXPECT_EQ(phase.work, 3000u);
+		EXPECT_GT(phase.ns, 0u);
+		EXPECT_EQ(phase.valid[Index(PerfCounter::CYCLES)], available);
+		if (available)
+		{
+			EXPECT_GT(phase.counters[Index(PerfCounter::CYCLES)], 0u);
+		}
+		else
+		{
+			EXPECT_EQ(phase.IPC(), 0.0);
+		}
+	});
+	EXPECT_TRUE(found);
+
+	phases.Reset();
+	phases.ForEachPhase([](const PhaseCounters::Phase& phase)
+	{
+		EXPECT_EQ(phase.calls, 0u);
+		EXPECT_FALSE(phase.name.empty());
+	});
+}
+
+TEST(PerfCountersTest, WorkersCountTheirShareIntoTheSubmittingPhase)
+{
+	PhaseCounters& phases = PhaseCounters::Get();
+	const std::uint32_t id = phases.Register("PerfCountersTest::SharedPhase");
+	EXPECT_EQ(PhaseCounters::CurrentPhase(), PhaseCounters::NoPhase);
+
+	// Every range of the job, on the workers and on the calling thread, runs inside the phase
+	std::atomic<size_t> inPhase = 0;
+	{
+		PhaseCounterScope scope(id, 1);
+		EXPECT_EQ(PhaseCounters::CurrentPhase(), id);
+
+		ThreadPool pool(4);
+		pool.ParallelFor(64, 1, [&](size_t, size_t)
+		{
+			if (PhaseCounters::CurrentPhase() == id)
+				inPhase.fetch_add(1, std::memory_order_relaxed);
+		});
+	}
+	EXPECT_EQ(inPhase.load(), 64u);
+	EXPECT_EQ(PhaseCounters::CurrentPhase(), PhaseCounters::NoPhase);
+
+	// A share adds only the other thread's counters - no call, work or time
+	PerfCounterGroup::Reading before;
+	const bool available = PerfCounterGroup::ForThisThread().Read(before);
+	std::uint64_t cyclesBefore = 0;
+	phases.ForEachPhase([&](const PhaseCounters::Phase& phase)
+	{
+		if (phase.name == "PerfCountersTest::SharedPhase")
+			cyclesBefore = phase.counters[Index(PerfCounter::CYCLES)];
+	});
+
+	std::thread([&]
+	{
+		PhaseCounterShareScope share(id);
+		EXPECT_EQ(PhaseCounters::CurrentPhase(), id);
+		Burn(10'000'000);
+	}).join();
+
+	phases.ForEachPhase([&](const PhaseCounters::Phase& phase)
+	{
+		if (phase.name != "PerfCountersTest::SharedPhase")
+			return;
+
+		EXPECT_EQ(phase.calls, 1u);
+		EXPECT_EQ(phase.work, 1u);
+		if (available)
+		{
+			EXPECT_GT(phase.counters[Index(PerfCounter::CYCLES)], cyclesBefore);
+		}
+	});
+}
+
+TEST(PerfCountersTest, PhaseRatesOnlyUseValidCounters)
+{
+	PhaseCounters::Phase phase;
+	phase.work = 100;
+	phase.counters[Index(PerfCounter::CYCLES)] = 2000;
+	phase.counters[Index(PerfCounter::INSTRUCTIONS)] = 3000;
+	phase.counters[Index(PerfCounter::LLC_MISSES)] = 50;
+
+	EXPECT_EQ(phase.IPC(), 0.0);
+	EXPECT_EQ(phase.PerWork(PerfCounter::LLC_MISSES), 0.0);
+
+	phase.valid[Index(PerfCounter::CYCLES)] = true;
+	phase.valid[Index(PerfCounter::INSTRUCTIONS)] = true;
+	phase.valid[Index(PerfCounter::LLC_MISSES)] = true;
+	EXPECT_DOUBLE_EQ(phase.IPC(), 1.5);
+	EXPECT_DOUBLE_EQ(phase.PerWork(PerfCounter::LLC_MISSES), 0.5);
+	EXPECT_EQ(phase.PerWork(PerfCounter::BRANCH_MISSES), 0.0);
+}
+}
@@ -0,0 +1,196 @@
+#include "utils/RadixSort.h"
+
+#include <gtest/gtest.h>
+
+namespace seethe
+{
+namespace
+{
+using Strategy = RadixSorter::Strategy;
+
+struct Sorted
+{
+	std::vector<std::uint32_t> keys;
+	std::vector<std::uint32_t> values;
+};
+
+// Values are the original positions, so a stable sort leaves the values of equal keys in increasing order
+Sorted Sort(RadixSorter& sorter, std::vector<std::uint32_t> keys, unsigned int keyBits = 32)
+{
+	std::vector<std::uint32_t> values(keys.size());
+	std::iota(values.begin(), values.end(), 0u);
+	sorter.Sort(keys, values, keyBits);
+	return { std::move(keys), std::move(values) };
+}
+
+// std::stable_sort on the same low 'keyBits' bits
+Sorted SortByReference(const std::vector<std::uint32_t>& keys, unsigned int keyBits = 32)
+{
+	const std::uint32_t mask = keyBits == 32 ? ~0u : (1u << keyBits) - 1;
+	std::vector<std::uint32_t> order(keys.size());
+	std::iota(order.begin(), order.end(), 0u);
+	std::ranges::stable_sort(order, [&](std::uint32_t a, std::uint32_t b) { return (keys[a] & mask) < (keys[b] & mask); });
+
+	Sorted sorted;
+	for (std::uint32_t index : order)
+	{
+		sorted.keys.push_back(keys[index]);
+		sorted.values.push_back(index);
+	}
+	return sorted;
+}
+
+std::vector<std::uint32_t> RandomKeys(size_t count, std::uint32_t maxKey, std::mt19937& rng)
+{
+	std::uniform_int_distribution<std::uint32_t> key(0, maxKey);
+	std::vector<std::uint32_t> keys(count);
+	for (std::uint32_t& k : keys)
+		k = key(rng);
+	return keys;
+}
+
+void ExpectMatchesReference(RadixSorter& sorter, const std::vector<std::uint32_t>& keys, unsigned int keyBits = 32)
+{
+	const Sorted actual = Sort(sorter, keys, keyBits);
+	const Sorted expected = SortByReference(keys, keyBits);
+	EXPECT_EQ(actual.keys, expected.keys);
+	EXPECT_EQ(actual.values, expected.values);
+}
+
+// 0, 2, 4, ... with 'swaps' adjacent pairs swapped far enough apart that each swap is one descent and one move
+std::vector<std::uint32_t> SortedWithSwaps(size_t count, size_t swaps)
+{
+	std::vector<std::uint32_t> keys(count);
+	for (size_t iii = 0; iii < count; ++iii)
+		keys[iii] = static_cast<std::uint32_t>(2 * iii);
+	for (size_t iii = 0; iii < swaps; ++iii)
+		std::swap(keys[3 * iii + 1], keys[3 * iii + 2]);
+	return keys;
+}
+}
+
+TEST(RadixSorterTest, EqualKeysKeepTheirOrderWithEveryStrategy)
+{
+	std::mt19937 rng(21);
+	RadixSorter sorter;
+
+	// Few distinct keys, so most keys have many equals. The largest input is split into several parallel blocks
+	// (on any machine with more than one thread), whose order within each bucket also has to be kept
+	for (size_t count : { 100u, 1'000u, 200'000u })
+	{
+		SCOPED_TRACE(count);
+		const std::vector<std::uint32_t> keys = RandomKeys(count, 15, rng);
+		ExpectMatchesReference(sorter, keys);
+		EXPECT_EQ(sorter.GetLastStrategy(), Strategy::RADIX);
+
+		// Nearly sorted, which goes through the insertion sort: the first and last keys of neighboring runs of equal
+		// keys trade places
+		std::vector<std::uint32_t> nearly = SortByReference(keys).keys;
+		for (size_t iii = 0, swaps = 0; iii + 1 < count && swaps < count / 16; ++iii)
+		{
+			if (nearly[iii] != nearly[iii + 1])
+			{
+				std::swap(nearly[iii], nearly[iii + 1]);
+				++swaps;
+				++iii;
+			}
+		}
+		ExpectMatchesReference(sorter, nearly);
+		EXPECT_EQ(sorter.GetLastStrategy(), Strategy::INSERTION);
+
+		const std::vector<std::uint32_t> sorted = SortByReference(keys).keys;
+		ExpectMatchesReference(sorter, sorted);
+		EXPECT_EQ(sorter.GetLastStrategy(), Strategy::ALREADY_SORTED);
+		EXPECT_EQ(sorter.GetLastPassCount(), 0u);
+	}
+}
+
+TEST(RadixSorterTest, ChoosesInsertionSortUpToTheDescentThreshold)
+{
+	// The insertion sort is used for up to count / 16 descents, and the radix sort above that
+	constexpr size_t count = 1600;
+	RadixSorter sorter;
+
+	const std::vector<std::uint32_t> atThreshold = SortedWithSwaps(count, count / 16);
+	ExpectMatchesReference(sorter, atThreshold);
+	EXPECT_EQ(sorter.GetLastStrategy(), Strategy::INSERTION);
+	EXPECT_EQ(sorter.GetLastPassCount(), 0u);
+
+	const std::vector<std::uint32_t> aboveThreshold = SortedWithSwaps(count, count / 16 + 1);
+	ExpectMatchesReference(sorter, aboveThreshold);
+	EXPECT_EQ(sorter.GetLastStrategy(), Strategy::RADIX);
+}
+
+TEST(RadixSorterTest, FallsBackToRadixOnceTheInsertionSortMovesTooMuch)
+{
+	// A single descent, but every key of the second half has to move past the whole first half
+	constexpr size_t count = 1000;
+	std::vector<std::uint32_t> keys(count);
+	for (size_t iii = 0; iii < count; ++iii)
+		keys[iii] = static_cast<std::uint32_t>((iii + count / 2) % count);
+
+	RadixSorter sorter;
+	ExpectMatchesReference(sorter, keys);
+	EXPECT_EQ(sorter.GetLastStrategy(), Strategy::RADIX);
+
+	// Moving a few keys across the whole array stays within the budget
+	for (size_t iii = 0; iii < count; ++iii)
+		keys[iii] = static_cast<std::uint32_t>(iii < count - 4 ? iii + 4 : iii - (count - 4));
+	ExpectMatchesReference(sorter, keys);
+	EXPECT_EQ(sorter.GetLastStrategy(), Strategy::INSERTION);
+}
+
+TEST(RadixSorterTest, OddAndEvenPassCountsLeaveTheResultInTheCallersBuffers)
+{
+	// Each pass moves the data between the caller's buffers and the scratch buffers, so after an odd number of passes
+	// it has to be copied back
+	std::mt19937 rng(22);
+	RadixSorter sorter;
+
+	for (unsigned int keyBits : { 8u, 16u, 24u, 32u })
+	{
+		SCOPED_TRACE(keyBits);
+		const std::uint32_t maxKey = keyBits == 32 ? ~0u : (1u << keyBits) - 1;
+		ExpectMatchesReference(sorter, RandomKeys(5000, maxKey, rng), keyBits);
+		EXPECT_EQ(sorter.GetLastStrategy(), Strategy::RADIX);
+		EXPECT_EQ(sorter.GetLastPassCount(), keyBits / RadixSorter::DigitBits);
+	}
+
+	// Digits that are the same for every key are skipped, which makes a 16 bit sort a single pass
+	std::vector<std::uint32_t> keys = RandomKeys(5000, 0xFF, rng);
+	for (std::uint32_t& key : keys)
+		key |= 0x4200;
+	ExpectMatchesReference(sorter, keys, 16);
+	EXPECT_EQ(sorter.GetLastPassCount(), 1u);
+
+	// ...and the same for the low digit, which leaves only the second pass
+	for (std::uint32_t& key : keys)
+		key = (key & 0xFF) << 8;
+	ExpectMatchesReference(sorter, keys, 16);
+	EXPECT_EQ(sorter.GetLastPassCount(), 1u);
+}
+
+TEST(RadixSorterTest, OnlyTheLowKeyBitsAreCompared)
+{
+	std::mt19937 rng(23);
+	std::vector<std::uint32_t> keys = RandomKeys(3000, 0xFFFF, rng);
+	for (std::uint32_t& key : keys)
+		key |= std::uniform_int_distribution<std::uint32_t>(0, 0xFFFF)(rng) << 16;
+
+	RadixSorter sorter;
+	ExpectMatchesReference(sorter, keys, 16);
+	EXPECT_EQ(sorter.GetLastPassCount(), 2u);
+}
+
+TEST(RadixSorterTest, EmptyAndSingleElementInputs)
+{
+	RadixSorter sorter;
+	EXPECT_TRUE(Sort(sorter, {}).keys.empty());
+	EXPECT_EQ(sorter.GetLastStrategy(), Strategy::ALREADY_SORTED);
+
+	const Sorted single = Sort(sorter, { 7 });
+	EXPECT_EQ(single.keys, std::vector<std::uint32_t>{ 7 });
+	EXPECT_EQ(single.values, std::vector<std::uint32_t>{ 0 });
+	EXPECT_EQ(sorter.GetLastStrategy(), Strategy::ALREADY_SORTED);
+}
+}
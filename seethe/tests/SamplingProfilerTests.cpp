@@ -0,0 +1,170 @@
+#include "utils/SamplingProfiler.h"
+
+#include <charconv>
+
+#include <gtest/gtest.h>
+
+namespace seethe
+{
+namespace
+{
+std::uint64_t BurnCpu(std::chrono::milliseconds duration) noexcept
+{
+	volatile std::uint64_t sum = 0;
+	const auto end = std::chrono::steady_clock::now() + duration;
+	while (std::chrono::steady_clock::now() < end)
+	{
+		for (std::uint64_t iii = 0; iii < 10'000; ++iii)
+			sum = sum + iii * iii;
+	}
+	return sum;
+}
+
+struct CollapsedStack
+{
+	std::string frames;
+	std::uint64_t count;
+};
+
+// Parses "root;caller;callee count" lines. A line that does not have that shape fails the test
+std::vector<CollapsedStack> ReadCollapsedStacks(const std::filesystem::path& path)
+{
+	std::vector<CollapsedStack> stacks;
+	std::ifstream file(path);
+	std::string line;
+	while (std::getline(file, line))
+	{
+		const size_t space = line.rfind(' ');
+		EXPECT_NE(space, std::string::npos) << line;
+		EXPECT_GT(space, 0u) << line;
+		if (space == std::string::npos || space == 0)
+			continue;
+
+		const std::string_view count(line.data() + space + 1, line.size() - space - 1);
+		CollapsedStack& stack = stacks.emplace_back(line.substr(0, space), 0);
+		const auto [end, error] = std::from_chars(count.data(), count.data() + count.size(), stack.count);
+		EXPECT_TRUE(error == std::errc{} && end == count.data() + count.size()) << line;
+		EXPECT_GT(stack.count, 0u) << line;
+	}
+	return stacks;
+}
+
+class SamplingProfilerTest : public ::testing::Test
+{
+protected:
+	void TearDown() override
+	{
+		SamplingProfiler::Get().Stop();
+		std::filesystem::remove(m_path);
+	}
+
+	// Starts the profiler, or skips the test where sampling is not available
+	void StartOrSkip()
+	{
+		SamplingProfiler& profiler = SamplingProfiler::Get();
+		if (!profiler.Start(std::chrono::microseconds{ 200 }))
+		{
+			EXPECT_FALSE(profiler.GetUnavailableReason().empty());
+			EXPECT_FALSE(profiler.IsRunning());
+			GTEST_SKIP() << profiler.GetUnavailableReason();
+		}
+		ASSERT_TRUE(profiler.IsRunning());
+	}
+
+	const std::filesystem::path m_path = std::filesystem::temp_directory_path() / "seethe-sampling-profiler-test.folded";
+};
+}
+
+TEST_F(SamplingProfilerTest, SamplesTheBusyThread)
+{
+	StartOrSkip();
+	if (IsSkipped())
+		return;
+
+	SamplingProfiler& profiler = SamplingProfiler::Get();
+	BurnCpu(std::chrono::milliseconds{ 300 });
+	profiler.Stop();
+	EXPECT_FALSE(profiler.IsRunning());
+
+	// ~1500 samples at 200 us of CPU time each, but timers are coarse on a loaded machine
+	const size_t sampleCount = profiler.GetSampleCount();
+	EXPECT_GT(sampleCount, 50u);
+	EXPECT_EQ(profiler.GetDroppedCount(), 0u);
+
+	// Nothing is recorded once it has stopped
+	BurnCpu(std::chrono::milliseconds{ 50 });
+	EXPECT_EQ(profiler.GetSampleCount(), sampleCount);
+
+	ASSERT_TRUE(profiler.WriteCollapsedStacks(m_path));
+	const std::vector<CollapsedStack> stacks = ReadCollapsedStacks(m_path);
+	ASSERT_FALSE(stacks.empty());
+
+	std::uint64_t total = 0;
+	std::uint64_t inTest = 0;
+	for (const CollapsedStack& stack : stacks)
+	{
+		total += stack.count;
+
+		// The frames are symbolized, so the test body shows up by name (the build exports its symbols and keeps frame
+		// pointers so the stacks reach that far)
+		if (stack.frames.find("SamplingProfilerTest") != std::string::npos)
+			inTest += stack.count;
+	}
+	EXPECT_EQ(total, sampleCount);
+	EXPECT_GT(inTest, total / 2);
+}
+
+TEST_F(SamplingProfilerTest, StartDiscardsThePreviousSamples)
+{
+	StartOrSkip();
+	if (IsSkipped())
+		return;
+
+	SamplingProfiler& profiler = SamplingProfiler::Get();
+	BurnCpu(std::chrono::milliseconds{ 100 });
+	profiler.Stop();
+	ASSERT_GT(profiler.GetSampleCount(), 0u);
+
+	ASSERT_TRUE(profiler.Start(std::chrono::microseconds{ 200 }));
+	profiler.Stop();
+	EXPECT_LT(profiler.GetSampleCount(), 5u);
+
+	// Stopping again does nothing
+	profiler.Stop();
+	EXPECT_FALSE(profiler.IsRunning());
+}
+
+TEST_F(SamplingProfilerTest, WalksTheStacksOfRegisteredThreads)
+{
+	StartOrSkip();
+	if (IsSkipped())
+		return;
+
+	// The main thread only waits, so nearly every sample comes from the worker. Its functions are local symbols that
+	// have no names, so this checks how deep the stacks go: without registering, only the innermost frame is recorded.
+	// How many frames there are beyond that depends on inlining, and the walk ends at the first function that was
+	// built without frame pointers (i.e. in libstdc++)
+	std::thread worker([]()
+		{
+			SamplingProfiler::RegisterThread();
+			BurnCpu(std::chrono::milliseconds{ 300 });
+		}
+	);
+	worker.join();
+
+	SamplingProfiler& profiler = SamplingProfiler::Get();
+	profiler.Stop();
+	ASSERT_TRUE(profiler.WriteCollapsedStacks(m_path));
+
+	std::uint64_t total = 0;
+	std::uint64_t withCallers = 0;
+	for (const CollapsedStack& stack : ReadCollapsedStacks(m_path))
+	{
+		total += stack.count;
+		if (stack.frames.find(';') != std::string::npos)
+			withCallers += stack.count;
+	}
+	EXPECT_GT(total, 50u);
+	EXPECT_GT(withCallers, total / 2);
+}
+}
@@ -0,0 +1,91 @@
+#include "simulation/Simulation.h"
+
+#include <gtest/gtest.h>
+
+namespace seethe
+{
+namespace
+{
+constexpr size_t AtomCount = 64;
+
+void AddAtoms(Simulation& simulation)
+{
+	for (size_t iii = 0; iii < AtomCount; ++iii)
+		simulation.AddAtom(AtomType::HYDROGEN, { static_cast<float>(iii % 8), static_cast<float>(iii / 8), 0.0f });
+	simulation.DispatchEvents();
+}
+}
+
+TEST(SimulationSelectionTest, BulkSelectRecordsOneEventAndNoDuplicates)
+{
+	Simulation simulation;
+	AddAtoms(simulation);
+	simulation.SelectAtom(17);
+	simulation.SelectAtom(23);
+	simulation.SelectAtom(50);
+	simulation.DispatchEvents();
+
+	std::vector<ChangedRange> dispatched;
+	simulation.RegisterSelectedAtomsChangedHandler([&dispatched](const ChangedRange& range) { dispatched.push_back(range); });
+
+	// 17 and 23 are already selected. 5 and 40 are the smallest and largest of the new ones
+	const std::vector<size_t> indices = { 40, 5, 17, 23, 9, 31, 12 };
+	simulation.SelectAtoms(indices);
+	simulation.DispatchEvents();
+
+	ASSERT_EQ(dispatched.size(), 1u);
+	EXPECT_EQ(dispatched[0].begin, 5u);
+	EXPECT_EQ(dispatched[0].end, 41u);
+	EXPECT_EQ(dispatched[0].occurrences, 1u);
+
+	std::vector<size_t> selected = simulation.GetSelectedAtomIndices();
+	std::ranges::sort(selected);
+	EXPECT_EQ(selected, (std::vector<size_t>{ 5, 9, 12, 17, 23, 31, 40, 50 }));
+
+	for (size_t iii = 0; iii < AtomCount; ++iii)
+		EXPECT_EQ(simulation.AtomIsSelected(iii), std::ranges::binary_search(selected, iii)) << "atom " << iii;
+}
+
+TEST(SimulationSelectionTest, BulkSelectOfSelectedAtomsRecordsNothing)
+{
+	Simulation simulation;
+	AddAtoms(simulation);
+	simulation.SelectAtom(3);
+	simulation.SelectAtom(4);
+	simulation.DispatchEvents();
+
+	int calls = 0;
+	simulation.RegisterSelectedAtomsChangedHandler([&calls](const ChangedRange&) { ++calls; });
+
+	const std::vector<size_t> indices = { 4, 3 };
+	simulation.SelectAtoms(indices);
+	simulation.DispatchEvents();
+
+	EXPECT_EQ(calls, 0);
+	EXPECT_EQ(simulation.GetSelectedAtomIndices().size(), 2u);
+}
+
+TEST(SimulationSelectionTest, UnselectingAnAtomThatIsNotSelectedRecordsNothing)
+{
+	Simulation simulation;
+	AddAtoms(simulation);
+	simulation.SelectAtom(10);
+	simulation.DispatchEvents();
+
+	std::vector<ChangedRange> dispatched;
+	simulation.RegisterSelectedAtomsChangedHandler([&dispatched](const ChangedRange& range) { dispatched.push_back(range); });
+
+	simulation.UnselectAtom(11);
+	simulation.UnselectAtoms({ 12, 13 });
+	simulation.DispatchEvents();
+	EXPECT_TRUE(dispatched.empty());
+
+	simulation.UnselectAtoms({ 12, 10 });
+	simulation.DispatchEvents();
+	ASSERT_EQ(dispatched.size(), 1u);
+	EXPECT_EQ(dispatched[0].begin, 10u);
+	EXPECT_EQ(dispatched[0].end, 11u);
+	EXPECT_EQ(dispatched[0].occurrences, 1u);
+	EXPECT_TRUE(simulation.GetSelectedAtomIndices().empty());
+}
+}
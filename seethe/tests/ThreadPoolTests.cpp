@@ -0,0 +1,91 @@
+#include "utils/ThreadPool.h"
+
+#include <gtest/gtest.h>
+
+namespace seethe
+{
+namespace
+{
+// Runs a ParallelFor() over 'count' indices and checks that every one was visited exactly once, through sub-ranges
+// that are never empty, never larger than the grain size (except when the whole loop runs inline) and never out of range
+void ExpectEveryIndexOnce(ThreadPool& pool, size_t count, size_t grainSize)
+{
+	std::vector<std::atomic<int>> visits(count);
+	std::atomic<bool> badRange = false;
+	pool.ParallelFor(count, grainSize, [&](size_t begin, size_t end)
+		{
+			if (begin >= end || end > count || (end - begin > grainSize && end - begin != count))
+				badRange = true;
+			for (size_t iii = begin; iii < end && iii < count; ++iii)
+				visits[iii].fetch_add(1, std::memory_order_relaxed);
+		}
+	);
+
+	EXPECT_FALSE(badRange) << count << " indices, grain size " << grainSize;
+	for (size_t iii = 0; iii < count; ++iii)
+		ASSERT_EQ(visits[iii].load(), 1) << "index " << iii << " of " << count << ", grain size " << grainSize;
+}
+}
+
+TEST(ThreadPoolTest, ParallelForCoversEveryIndexExactlyOnce)
+{
+	for (unsigned int threadCount : { 1u, 2u, 4u, 7u })
+	{
+		ThreadPool pool(threadCount);
+		ASSERT_EQ(pool.GetThreadCount(), threadCount);
+
+		// Fewer, as many, and more indices than there are threads, with one index per chunk and with larger chunks
+		const size_t threads = threadCount;
+		for (size_t count : { size_t{ 0 }, size_t{ 1 }, threads - 1, threads, threads + 1, 3 * threads + 2, size_t{ 1000 } })
+		{
+			for (size_t grainSize : { size_t{ 1 }, size_t{ 3 }, size_t{ 64 } })
+				ExpectEveryIndexOnce(pool, count, grainSize);
+		}
+	}
+}
+
+TEST(ThreadPoolTest, ParallelForRunsRepeatedlyAndAfterResizing)
+{
+	ThreadPool pool(3);
+	for (int iii = 0; iii < 200; ++iii)
+		ExpectEveryIndexOnce(pool, 1 + iii % 17, 1);
+
+	pool.SetThreadCount(6);
+	EXPECT_EQ(pool.GetThreadCount(), 6u);
+	ExpectEveryIndexOnce(pool, 5, 1);
+	ExpectEveryIndexOnce(pool, 6, 1);
+	ExpectEveryIndexOnce(pool, 7, 1);
+
+	pool.SetThreadCount(1);
+	EXPECT_EQ(pool.GetThreadCount(), 1u);
+	ExpectEveryIndexOnce(pool, 100, 1);
+}
+
+TEST(ThreadPoolTest, NestedParallelForRunsInline)
+{
+	ThreadPool pool(4);
+	constexpr size_t outer = 16;
+	constexpr size_t inner = 50;
+
+	std::vector<std::atomic<int>> visits(outer * inner);
+	pool.ParallelFor(outer, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t iii = begin; iii < end; ++iii)
+			{
+				pool.ParallelFor(inner, 1, [&](size_t innerBegin, size_t innerEnd)
+					{
+						// Inline means a single call over the whole range
+						EXPECT_EQ(innerBegin, 0u);
+						EXPECT_EQ(innerEnd, inner);
+						for (size_t jjj = innerBegin; jjj < innerEnd; ++jjj)
+							visits[iii * inner + jjj].fetch_add(1, std::memory_order_relaxed);
+					}
+				);
+			}
+		}
+	);
+
+	for (size_t iii = 0; iii < visits.size(); ++iii)
+		ASSERT_EQ(visits[iii].load(), 1) << "index " << iii;
+}
+}